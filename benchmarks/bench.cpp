@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+#include <glib.h>
+
+#include "libdnf/dnf-utils.h"
+
+#include "bench.hpp"
+
+namespace bench {
+
+Runner::Runner(const Options &options)
+  : options(options)
+{
+    const SynthRepoParams &repo = options.repo;
+    printf("{\"type\": \"context\", \"version\": \"%s\", \"packages\": %u, \"fanout\": %u, "
+           "\"files\": %u, \"advisories\": %u, \"kernels\": %u, \"installed_percent\": %u, "
+           "\"transactions\": %u, \"seed\": %u, \"min_time_ms\": %u, "
+           "\"decompression\": \"%s\"}\n",
+           PACKAGE_VERSION, repo.packages, repo.fanout, repo.files, repo.advisories,
+           repo.kernels, repo.installedPercent, options.transactions, repo.seed,
+           options.minTime, options.serialDecompression ? "serial" : "threaded");
+    fflush(stdout);
+}
+
+uint64_t
+Runner::now()
+{
+    return static_cast< uint64_t >(g_get_monotonic_time()) * 1000;
+}
+
+bool
+Runner::enabled(const std::string &name) const
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+void
+Runner::run(const std::string &name, const std::function< void() > &body)
+{
+    run(name, [] {}, body);
+}
+
+void
+Runner::run(const std::string &name,
+            const std::function< void() > &setup,
+            const std::function< void() > &body)
+{
+    if (!enabled(name)) {
+        return;
+    }
+
+    uint64_t iterations = 0;
+    uint64_t total = 0;
+    uint64_t minNs = UINT64_MAX;
+    uint64_t maxNs = 0;
+    uint64_t deadline = now() + options.minTime * G_GUINT64_CONSTANT(1000000);
+    while (iterations < options.minIterations || now() < deadline) {
+        setup();
+        uint64_t start = now();
+        body();
+        uint64_t elapsed = now() - start;
+        total += elapsed;
+        minNs = std::min(minNs, elapsed);
+        maxNs = std::max(maxNs, elapsed);
+        ++iterations;
+    }
+    report(name, iterations, total, minNs, maxNs);
+}
+
+void
+Runner::report(const std::string &name, uint64_t iterations, uint64_t totalNs,
+               uint64_t minNs, uint64_t maxNs)
+{
+    printf("{\"type\": \"result\", \"name\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT
+           ", \"mean_ns\": %" G_GUINT64_FORMAT ", \"min_ns\": %" G_GUINT64_FORMAT
+           ", \"max_ns\": %" G_GUINT64_FORMAT "}\n",
+           name.c_str(), iterations, iterations ? totalNs / iterations : 0, minNs, maxNs);
+    fflush(stdout);
+}
+
+} // namespace bench
+
+int
+main(int argc, char *argv[])
+{
+    bench::Options options;
+    gint packages = options.repo.packages;
+    gint fanout = options.repo.fanout;
+    gint files = options.repo.files;
+    gint advisories = options.repo.advisories;
+    gint kernels = options.repo.kernels;
+    gint installedPercent = options.repo.installedPercent;
+    gint seed = options.repo.seed;
+    gint transactions = options.transactions;
+    gint minTime = options.minTime;
+    gboolean serialDecompression = options.serialDecompression;
+    g_autofree gchar *filter = NULL;
+    g_autofree gchar *workdir = NULL;
+    g_autofree gchar *tmpdir = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GOptionContext) context = NULL;
+    const GOptionEntry entries[] = {
+        { "packages", 0, 0, G_OPTION_ARG_INT, &packages,
+          "Number of generated packages", "N" },
+        { "fanout", 0, 0, G_OPTION_ARG_INT, &fanout,
+          "Requires per package", "N" },
+        { "files", 0, 0, G_OPTION_ARG_INT, &files,
+          "Files per package", "N" },
+        { "advisories", 0, 0, G_OPTION_ARG_INT, &advisories,
+          "Number of generated advisories", "N" },
+        { "kernels", 0, 0, G_OPTION_ARG_INT, &kernels,
+          "Versions of the installonly kernel package", "N" },
+        { "installed", 0, 0, G_OPTION_ARG_INT, &installedPercent,
+          "Percentage of packages with an installed older version", "PERCENT" },
+        { "seed", 0, 0, G_OPTION_ARG_INT, &seed,
+          "Seed of the generator", "N" },
+        { "transactions", 0, 0, G_OPTION_ARG_INT, &transactions,
+          "Number of transactions in the generated histories", "N" },
+        { "min-time", 0, 0, G_OPTION_ARG_INT, &minTime,
+          "Minimal time spent in each benchmark", "MS" },
+        { "serial-decompression", 0, 0, G_OPTION_ARG_NONE, &serialDecompression,
+          "Decompress repo metadata on the parsing thread", NULL },
+        { "filter", 0, 0, G_OPTION_ARG_STRING, &filter,
+          "Run only benchmarks containing this substring", "TEXT" },
+        { "workdir", 0, 0, G_OPTION_ARG_FILENAME, &workdir,
+          "Directory for the generated repos, a temporary one by default", "DIR" },
+        { NULL }
+    };
+
+    context = g_option_context_new(NULL);
+    g_option_context_set_summary(context, "Benchmarks of the libdnf hot paths");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return 1;
+    }
+    if (packages < 1 || fanout < 0 || files < 1 || advisories < 0 || kernels < 0 ||
+        installedPercent < 0 || installedPercent > 100 || transactions < 1 || minTime < 0) {
+        g_printerr("invalid benchmark parameters\n");
+        return 1;
+    }
+
+    options.repo.packages = packages;
+    options.repo.fanout = fanout;
+    options.repo.files = files;
+    options.repo.advisories = advisories;
+    options.repo.kernels = kernels;
+    options.repo.installedPercent = installedPercent;
+    options.repo.seed = seed;
+    options.transactions = transactions;
+    options.minTime = minTime;
+    options.serialDecompression = serialDecompression;
+    if (filter != NULL) {
+        options.filter = filter;
+    }
+    if (workdir == NULL) {
+        tmpdir = g_dir_make_tmp("libdnf-bench-XXXXXX", &error);
+        if (tmpdir == NULL) {
+            g_printerr("%s\n", error->message);
+            return 1;
+        }
+        options.workdir = tmpdir;
+    } else {
+        options.workdir = workdir;
+    }
+
+    int ret = 0;
+    try {
+        bench::Runner runner(options);
+        bench::benchEvr(runner);
+        bench::benchSack(runner);
+        bench::benchHistory(runner);
+    } catch (const std::exception &ex) {
+        g_printerr("benchmark failed: %s\n", ex.what());
+        ret = 1;
+    }
+
+    if (tmpdir != NULL && !dnf_remove_recursive(tmpdir, &error)) {
+        g_printerr("%s\n", error->message);
+    }
+    return ret;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef LIBDNF_BENCHMARKS_BENCH_HPP
+#define LIBDNF_BENCHMARKS_BENCH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "synthrepo.hpp"
+
+namespace bench {
+
+struct Options {
+    SynthRepoParams repo;
+    /// transactions in the generated sw.db and yum histories
+    unsigned transactions = 50000;
+    /// minimal wall time spent in one benchmark, in milliseconds
+    unsigned minTime = 200;
+    unsigned minIterations = 3;
+    /// decompress repo metadata on the parsing thread instead of a separate one
+    bool serialDecompression = false;
+    /// run only benchmarks with this substring in the name
+    std::string filter;
+    /// scratch directory for the generated repos and caches
+    std::string workdir;
+};
+
+/**
+ * Runs benchmark bodies and prints one JSON object per line to stdout:
+ *  {"type": "result", "name": ..., "iterations": ..., "mean_ns": ..., "min_ns": ..., "max_ns": ...}
+ * A {"type": "context", ...} line describing the parameters comes first.
+ */
+class Runner {
+public:
+    explicit Runner(const Options &options);
+
+    const Options &getOptions() const { return options; }
+
+    /// Check if the benchmark is selected by the filter
+    bool enabled(const std::string &name) const;
+
+    /// Time body until both minTime and minIterations are reached
+    void run(const std::string &name, const std::function< void() > &body);
+
+    /// Same as run(), setup is called before every iteration and is not timed
+    void run(const std::string &name,
+             const std::function< void() > &setup,
+             const std::function< void() > &body);
+
+    /// Report a single measurement of work done outside of the runner
+    void report(const std::string &name, uint64_t iterations, uint64_t totalNs,
+                uint64_t minNs, uint64_t maxNs);
+
+    /// Current monotonic time in nanoseconds
+    static uint64_t now();
+
+private:
+    Options options;
+};
+
+void benchSack(Runner &runner);
+void benchHistory(Runner &runner);
+void benchEvr(Runner &runner);
+
+} // namespace bench
+
+#endif // LIBDNF_BENCHMARKS_BENCH_HPP
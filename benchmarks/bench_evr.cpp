@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libdnf/dnf-sack.h"
+#include "libdnf/utils/evrcmp.hpp"
+
+#include "bench.hpp"
+
+namespace bench {
+
+static std::vector< std::string >
+makeEvrs(uint32_t seed, unsigned count)
+{
+    static const char *suffixes[] = {"", ".fc28", "~rc1", "^git1", ".el7_5", "a"};
+    std::mt19937 rng(seed);
+    std::vector< std::string > evrs;
+    for (unsigned i = 0; i < count; ++i) {
+        std::string evr;
+        if (rng() % 8 == 0) {
+            evr += std::to_string(rng() % 3) + ":";
+        }
+        evr += std::to_string(rng() % 10) + "." + std::to_string(rng() % 30) + "." +
+               std::to_string(rng() % 100) + suffixes[rng() % G_N_ELEMENTS(suffixes)];
+        evr += "-" + std::to_string(rng() % 20 + 1) + suffixes[rng() % G_N_ELEMENTS(suffixes)];
+        evrs.push_back(evr);
+    }
+    return evrs;
+}
+
+void
+benchEvr(Runner &runner)
+{
+    auto evrs = makeEvrs(runner.getOptions().repo.seed, 4096);
+    volatile int sink = 0;
+
+    runner.run("evr/evrcmp", [&] {
+        for (size_t i = 1; i < evrs.size(); ++i) {
+            sink += libdnf::evrcmp(evrs[i - 1].c_str(), evrs[i].c_str());
+        }
+    });
+
+    runner.run("evr/rpmvercmp", [&] {
+        for (size_t i = 1; i < evrs.size(); ++i) {
+            sink += libdnf::rpmvercmp(evrs[i - 1], evrs[i]);
+        }
+    });
+
+    if (!runner.enabled("evr/pool_evrcmp_str")) {
+        return;
+    }
+    DnfSack *sack = dnf_sack_new();
+    runner.run("evr/pool_evrcmp_str", [&] {
+        for (size_t i = 1; i < evrs.size(); ++i) {
+            sink += dnf_sack_evr_cmp(sack, evrs[i - 1].c_str(), evrs[i].c_str());
+        }
+    });
+    g_object_unref(sack);
+}
+
+} // namespace bench
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "libdnf/swdb/item_rpm.hpp"
+#include "libdnf/swdb/swdb.hpp"
+#include "libdnf/swdb/swdb_types.hpp"
+#include "libdnf/swdb/transformer.hpp"
+
+#include "bench.hpp"
+
+namespace bench {
+
+static std::string
+packageName(unsigned index)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "pkg%05u", index);
+    return name;
+}
+
+/**
+ * Fill the database with transactions of one to four packages each; every
+ * transaction bumps the version, so package history grows like on a real host
+ */
+static void
+populateHistory(Swdb &swdb, const Options &options)
+{
+    std::mt19937 rng(options.repo.seed);
+    auto conn = swdb.getConn();
+
+    conn->exec("BEGIN");
+    for (unsigned t = 0; t < options.transactions; ++t) {
+        swdb.initTransaction();
+        std::set< unsigned > picked;
+        for (unsigned n = rng() % 4 + 1; n > 0; --n) {
+            picked.insert(rng() % options.repo.packages);
+        }
+        for (auto index : picked) {
+            auto rpm = swdb.createRPMItem();
+            rpm->setName(packageName(index));
+            rpm->setEpoch(0);
+            rpm->setVersion("1." + std::to_string(t));
+            rpm->setRelease("1.fc28");
+            rpm->setArch("x86_64");
+            auto action = rng() % 3 ? TransactionItemAction::UPGRADE
+                                    : TransactionItemAction::INSTALL;
+            auto reason = rng() % 2 ? TransactionItemReason::USER
+                                    : TransactionItemReason::DEPENDENCY;
+            swdb.addItem(rpm, "synthetic", action, reason);
+        }
+        int64_t dtBegin = 1500000000 + static_cast< int64_t >(t) * 60;
+        swdb.beginTransaction(dtBegin, "rpmdb-" + std::to_string(t), "dnf upgrade", 0);
+        for (auto item : swdb.getItems()) {
+            swdb.setItemDone(item);
+        }
+        swdb.endTransaction(dtBegin + 30, "rpmdb-" + std::to_string(t + 1), true);
+    }
+    conn->exec("COMMIT");
+}
+
+/**
+ * Time the one-off conversion of a yum history database into sw.db
+ */
+static void
+benchMigrate(Runner &runner)
+{
+    const Options &options = runner.getOptions();
+    std::string inputDir = options.workdir + "/yum";
+    std::string outputFile = options.workdir + "/swdb-migrated.sqlite";
+
+    writeYumHistory(inputDir, options.repo, options.transactions);
+
+    // transform() dumps into the output file, start every iteration without one
+    runner.run("history/migrate",
+               [&] { std::remove(outputFile.c_str()); },
+               [&] {
+                   Transformer transformer(outputFile, inputDir);
+                   transformer.transform();
+               });
+}
+
+void
+benchHistory(Runner &runner)
+{
+    const Options &options = runner.getOptions();
+
+    if (runner.enabled("history/migrate")) {
+        benchMigrate(runner);
+    }
+
+    if (!runner.enabled("history/")) {
+        return;
+    }
+
+    auto conn = std::make_shared< SQLite3 >(":memory:");
+    Transformer::createDatabase(conn);
+    Swdb swdb(conn);
+
+    uint64_t start = Runner::now();
+    populateHistory(swdb, options);
+    uint64_t elapsed = Runner::now() - start;
+    runner.report("history/populate", options.transactions, elapsed, elapsed, elapsed);
+
+    unsigned lookup = 0;
+    auto nextName = [&] { return packageName(lookup++ % options.repo.packages); };
+    // the last transaction installed version "1.<transactions - 1>" of its packages
+    std::string lastVersion = "1." + std::to_string(options.transactions - 1);
+    std::string lastNevra;
+    for (auto item : swdb.getLastTransaction()->getItems()) {
+        auto rpm = std::dynamic_pointer_cast< RPMItem >(item->getItem());
+        if (rpm) {
+            lastNevra = rpm->getNEVRA();
+            break;
+        }
+    }
+
+    runner.run("history/last", [&] { swdb.getLastTransaction(); });
+
+    runner.run("history/list-page", [&] {
+        libdnf::TransactionRange range;
+        range.limit = 100;
+        range.reverse = true;
+        swdb.listTransactions(range, true);
+    });
+
+    runner.run("history/list-all", [&] { swdb.listTransactions(); });
+
+    runner.run("history/reason", [&] {
+        swdb.resolveRPMTransactionItemReason(nextName(), "x86_64", -1);
+    });
+
+    runner.run("history/reason-any-arch", [&] {
+        swdb.resolveRPMTransactionItemReason(nextName(), "", -1);
+    });
+
+    runner.run("history/rpm-repo", [&] { swdb.getRPMRepo(lastNevra); });
+
+    runner.run("history/rpm-item", [&] { swdb.getRPMTransactionItem(lastNevra); });
+
+    runner.run("history/search-name", [&] { swdb.searchTransactionsByRPM({nextName()}); });
+
+    runner.run("history/search-glob", [&] {
+        swdb.searchTransactionsByRPM({nextName().substr(0, 6) + "*"});
+    });
+
+    runner.run("history/search-nevra", [&] {
+        swdb.searchTransactionsByRPM({nextName() + "-" + lastVersion + "-1.fc28.x86_64"});
+    });
+}
+
+} // namespace bench
@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glib.h>
+
+#include "libdnf/dnf-package.h"
+#include "libdnf/dnf-sack-private.hpp"
+#include "libdnf/dnf-utils.h"
+#include "libdnf/hy-goal.h"
+#include "libdnf/hy-iutil-private.hpp"
+#include "libdnf/hy-query.h"
+#include "libdnf/hy-repo-private.hpp"
+#include "libdnf/hy-subject.h"
+
+#include "bench.hpp"
+
+namespace bench {
+
+static const char *AVAILABLE_REPO = "synthetic";
+static const char *INSTALLED_REPO = "synthetic-installed";
+
+static void
+throwError(GError *error)
+{
+    std::string message = error ? error->message : "unknown error";
+    g_clear_error(&error);
+    throw std::runtime_error(message);
+}
+
+static HyRepo
+createRepo(const char *name, const std::string &dir, bool updateinfo)
+{
+    HyRepo repo = hy_repo_create(name);
+    std::string repodata = dir + "/repodata/";
+    hy_repo_set_string(repo, HY_REPO_MD_FN, (repodata + "repomd.xml").c_str());
+    hy_repo_set_string(repo, HY_REPO_PRIMARY_FN, (repodata + "primary.xml.gz").c_str());
+    hy_repo_set_string(repo, HY_REPO_FILELISTS_FN, (repodata + "filelists.xml.gz").c_str());
+    if (updateinfo) {
+        hy_repo_set_string(repo, HY_REPO_UPDATEINFO_FN,
+                           (repodata + "updateinfo.xml.gz").c_str());
+    }
+    return repo;
+}
+
+static DnfSack *
+createSack(const std::string &cachedir)
+{
+    GError *error = NULL;
+    DnfSack *sack = dnf_sack_new();
+    dnf_sack_set_cachedir(sack, cachedir.c_str());
+    if (!dnf_sack_set_arch(sack, "x86_64", &error) ||
+        !dnf_sack_setup(sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, &error)) {
+        g_object_unref(sack);
+        throwError(error);
+    }
+    return sack;
+}
+
+static void
+loadRepo(DnfSack *sack, HyRepo repo, int flags)
+{
+    GError *error = NULL;
+    if (!dnf_sack_load_repo(sack, repo, flags, &error)) {
+        throwError(error);
+    }
+}
+
+static const int availableFlags = DNF_SACK_LOAD_FLAG_USE_FILELISTS |
+                                  DNF_SACK_LOAD_FLAG_USE_UPDATEINFO;
+
+/**
+ * Sack with the available repo loaded from the cache and the installed
+ * repo acting as the system repo, ready for queries
+ */
+static DnfSack *
+createQuerySack(const std::string &cachedir, HyRepo available, HyRepo installed)
+{
+    static const char *installonly[] = {"kernel", NULL};
+    DnfSack *sack = createSack(cachedir);
+    loadRepo(sack, available, availableFlags | DNF_SACK_LOAD_FLAG_BUILD_CACHE);
+    loadRepo(sack, installed, DNF_SACK_LOAD_FLAG_USE_FILELISTS);
+    pool_set_installed(dnf_sack_get_pool(sack), installed->libsolv_repo);
+    dnf_sack_set_installonly(sack, installonly);
+    dnf_sack_set_installonly_limit(sack, 3);
+    dnf_sack_make_provides_ready(sack);
+    dnf_sack_recompute_considered(sack);
+    return sack;
+}
+
+static std::string
+nevra(const SynthPackage &pkg)
+{
+    return pkg.name + "-" + pkg.version + "-" + pkg.release + "." + pkg.arch;
+}
+
+static void
+benchRepoLoad(Runner &runner, const std::string &cachedir, HyRepo available)
+{
+    GError *error = NULL;
+    auto removeCache = [&] {
+        if (g_file_test(cachedir.c_str(), G_FILE_TEST_IS_DIR) &&
+            !dnf_remove_recursive(cachedir.c_str(), &error)) {
+            throwError(error);
+        }
+    };
+
+    // fetch parses the XML and writes the caches, what happens after each refresh
+    runner.run("repo/load-fetch", removeCache, [&] {
+        DnfSack *sack = createSack(cachedir);
+        loadRepo(sack, available, availableFlags | DNF_SACK_LOAD_FLAG_BUILD_CACHE);
+        g_object_unref(sack);
+    });
+
+    // a valid cache would be used even without DNF_SACK_LOAD_FLAG_BUILD_CACHE
+    runner.run("repo/load-nocache", removeCache, [&] {
+        DnfSack *sack = createSack(cachedir);
+        loadRepo(sack, available, availableFlags);
+        g_object_unref(sack);
+    });
+
+    // make sure the caches exist even if load-fetch was filtered out
+    DnfSack *sack = createSack(cachedir);
+    loadRepo(sack, available, availableFlags | DNF_SACK_LOAD_FLAG_BUILD_CACHE);
+    g_object_unref(sack);
+
+    runner.run("repo/load-cache", [&] {
+        DnfSack *sack = createSack(cachedir);
+        loadRepo(sack, available, availableFlags | DNF_SACK_LOAD_FLAG_BUILD_CACHE);
+        g_object_unref(sack);
+    });
+
+    sack = NULL;
+    runner.run("sack/make-provides-ready",
+        [&] {
+            if (sack) {
+                g_object_unref(sack);
+            }
+            sack = createSack(cachedir);
+            loadRepo(sack, available, availableFlags | DNF_SACK_LOAD_FLAG_BUILD_CACHE);
+        },
+        [&] {
+            dnf_sack_make_provides_ready(sack);
+        });
+    if (sack) {
+        g_object_unref(sack);
+    }
+}
+
+static void
+benchQuery(Runner &runner, DnfSack *sack, const SynthRepo &synth)
+{
+    const auto &packages = synth.getPackages();
+    const SynthPackage &target = packages[synth.getParams().packages / 2];
+    std::string upperName = target.name;
+    for (auto &c : upperName) {
+        c = g_ascii_toupper(c);
+    }
+    std::string prefix = target.name.substr(0, target.name.size() - 2);
+    std::string fileGlob = "/usr/share/" + prefix + "*/file0001";
+
+    const std::vector< std::pair< std::string, std::function< void(HyQuery) > > > filters = {
+        {"query/all", [&](HyQuery) {}},
+        {"query/name-eq", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_NAME, HY_EQ, target.name.c_str());
+        }},
+        {"query/name-icase", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_NAME, HY_EQ | HY_ICASE, upperName.c_str());
+        }},
+        {"query/name-glob", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_NAME, HY_GLOB, (prefix + "*").c_str());
+        }},
+        {"query/name-substr", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_NAME, HY_SUBSTR, target.name.substr(3).c_str());
+        }},
+        {"query/nevra", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_NEVRA, HY_EQ, nevra(target).c_str());
+        }},
+        {"query/nevra-glob", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_NEVRA, HY_GLOB, (prefix + "*-1.1*").c_str());
+        }},
+        {"query/evr", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_EVR, HY_GT, "1.10-1.fc28");
+        }},
+        {"query/version", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_VERSION, HY_EQ, target.version.c_str());
+        }},
+        {"query/arch", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_ARCH, HY_EQ, "noarch");
+        }},
+        {"query/reponame", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_REPONAME, HY_EQ, AVAILABLE_REPO);
+        }},
+        {"query/summary-substr", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_SUMMARY, HY_SUBSTR, target.name.c_str());
+        }},
+        {"query/provides", [&](HyQuery q) {
+            hy_query_filter_provides(q, HY_EQ, SynthRepo::libraryProvide(target).c_str(), NULL);
+        }},
+        {"query/provides-glob", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_PROVIDES, HY_GLOB, ("lib" + prefix + "*").c_str());
+        }},
+        {"query/requires", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_REQUIRES, HY_EQ, target.name.c_str());
+        }},
+        {"query/file", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_FILE, HY_EQ, SynthRepo::binaryPath(target).c_str());
+        }},
+        {"query/file-glob", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_FILE, HY_GLOB, fileGlob.c_str());
+        }},
+        {"query/latest-per-arch", [&](HyQuery q) {
+            hy_query_filter_latest_per_arch(q, 1);
+        }},
+        {"query/upgrades", [&](HyQuery q) {
+            hy_query_filter_upgrades(q, 1);
+        }},
+        {"query/upgradable", [&](HyQuery q) {
+            hy_query_filter_upgradable(q, 1);
+        }},
+        {"query/downgrades", [&](HyQuery q) {
+            hy_query_filter_downgrades(q, 1);
+        }},
+        {"query/advisory-type", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_ADVISORY_TYPE, HY_EQ, "security");
+        }},
+        {"query/advisory-severity", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_ADVISORY_SEVERITY, HY_EQ, "Critical");
+        }},
+        {"query/advisory-cve", [&](HyQuery q) {
+            hy_query_filter(q, HY_PKG_ADVISORY_CVE, HY_EQ, "CVE-2018-00003");
+        }},
+    };
+
+    for (const auto &filter : filters) {
+        runner.run(filter.first, [&] {
+            HyQuery q = hy_query_create(sack);
+            filter.second(q);
+            hy_query_apply(q);
+            hy_query_free(q);
+        });
+    }
+
+    runner.run("query/run", [&] {
+        HyQuery q = hy_query_create(sack);
+        GPtrArray *pkgs = hy_query_run(q);
+        g_ptr_array_unref(pkgs);
+        hy_query_free(q);
+    });
+}
+
+static void
+benchSubject(Runner &runner, DnfSack *sack, const SynthRepo &synth)
+{
+    const SynthPackage &target = synth.getPackages()[synth.getParams().packages / 3];
+    const std::vector< std::pair< std::string, std::string > > patterns = {
+        {"subject/name", target.name},
+        {"subject/nevra", nevra(target)},
+        {"subject/glob", target.name.substr(0, target.name.size() - 2) + "*"},
+        {"subject/provides", SynthRepo::libraryProvide(target)},
+        {"subject/file", SynthRepo::binaryPath(target)},
+        {"subject/missing", "does-not-exist"},
+    };
+
+    for (const auto &pattern : patterns) {
+        runner.run(pattern.first, [&] {
+            HySubject subject = hy_subject_create(pattern.second.c_str());
+            HyQuery q = hy_subject_get_best_solution(subject, sack, NULL, NULL,
+                                                     FALSE, TRUE, TRUE, TRUE);
+            hy_query_apply(q);
+            hy_query_free(q);
+            hy_subject_free(subject);
+        });
+    }
+}
+
+static DnfPackage *
+latestAvailable(DnfSack *sack, const std::string &name)
+{
+    HyQuery q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_EQ, name.c_str());
+    hy_query_filter(q, HY_PKG_REPONAME, HY_EQ, AVAILABLE_REPO);
+    hy_query_filter_latest_per_arch(q, 1);
+    GPtrArray *pkgs = hy_query_run(q);
+    DnfPackage *pkg = pkgs->len ? DNF_PACKAGE(g_object_ref(g_ptr_array_index(pkgs, 0))) : NULL;
+    g_ptr_array_unref(pkgs);
+    hy_query_free(q);
+    return pkg;
+}
+
+static void
+benchGoal(Runner &runner, DnfSack *sack, const SynthRepo &synth)
+{
+    const auto &packages = synth.getPackages();
+    unsigned npackages = synth.getParams().packages;
+
+    runner.run("goal/upgrade-all", [&] {
+        HyGoal goal = hy_goal_create(sack);
+        hy_goal_upgrade_all(goal);
+        hy_goal_run_flags(goal, DNF_NONE);
+        hy_goal_free(goal);
+    });
+
+    // the newest packages have the deepest dependency chains
+    std::vector< DnfPackage * > install;
+    for (unsigned i = npackages; i > 0 && install.size() < 16; --i) {
+        const SynthPackage &pkg = packages[i - 1];
+        if (!pkg.installedVersion.empty()) {
+            continue;
+        }
+        DnfPackage *available = latestAvailable(sack, pkg.name);
+        if (available) {
+            install.push_back(available);
+        }
+    }
+    runner.run("goal/install", [&] {
+        HyGoal goal = hy_goal_create(sack);
+        for (auto pkg : install) {
+            hy_goal_install(goal, pkg);
+        }
+        hy_goal_run_flags(goal, DNF_NONE);
+        hy_goal_free(goal);
+    });
+    for (auto pkg : install) {
+        g_object_unref(pkg);
+    }
+
+    DnfPackage *kernel = latestAvailable(sack, "kernel");
+    if (kernel) {
+        runner.run("goal/install-installonly", [&] {
+            HyGoal goal = hy_goal_create(sack);
+            hy_goal_install(goal, kernel);
+            hy_goal_run_flags(goal, DNF_NONE);
+            hy_goal_free(goal);
+        });
+        g_object_unref(kernel);
+    }
+
+    // packages generated first are required by most of the others
+    HyQuery q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_REPONAME, HY_EQ, INSTALLED_REPO);
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "pkg0000*");
+    GPtrArray *erase = hy_query_run(q);
+    hy_query_free(q);
+    if (erase->len) {
+        auto pkg = DNF_PACKAGE(g_ptr_array_index(erase, 0));
+        runner.run("goal/erase-clean-deps", [&] {
+            HyGoal goal = hy_goal_create(sack);
+            hy_goal_erase_flags(goal, pkg, HY_CLEAN_DEPS);
+            hy_goal_run_flags(goal, DNF_ALLOW_UNINSTALL);
+            hy_goal_free(goal);
+        });
+    }
+    g_ptr_array_unref(erase);
+}
+
+void
+benchSack(Runner &runner)
+{
+    const Options &options = runner.getOptions();
+    std::string availableDir = options.workdir + "/" + AVAILABLE_REPO;
+    std::string installedDir = options.workdir + "/" + INSTALLED_REPO;
+    std::string cachedir = options.workdir + "/cache";
+
+    if (!runner.enabled("repo/") && !runner.enabled("sack/") && !runner.enabled("query/") &&
+        !runner.enabled("subject/") && !runner.enabled("goal/")) {
+        return;
+    }
+
+    // repo/load-fetch and repo/load-nocache decompress the metadata
+    xfopen_threaded_set_enabled(!options.serialDecompression);
+
+    SynthRepo synth(options.repo);
+    uint64_t start = Runner::now();
+    synth.write(availableDir, false);
+    synth.write(installedDir, true);
+    uint64_t elapsed = Runner::now() - start;
+    runner.report("generate/repos", 1, elapsed, elapsed, elapsed);
+
+    HyRepo available = createRepo(AVAILABLE_REPO, availableDir, true);
+    HyRepo installed = createRepo(INSTALLED_REPO, installedDir, false);
+
+    benchRepoLoad(runner, cachedir, available);
+
+    DnfSack *sack = createQuerySack(cachedir, available, installed);
+    benchQuery(runner, sack, synth);
+    benchSubject(runner, sack, synth);
+    benchGoal(runner, sack, synth);
+
+    // the sack still references both repos, it drops them last
+    hy_repo_free(available);
+    hy_repo_free(installed);
+    g_object_unref(sack);
+}
+
+} // namespace bench
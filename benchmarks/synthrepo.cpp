@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <solv/solv_xfopen.h>
+
+#include "libdnf/utils/sqlite3/sqlite3.hpp"
+
+#include "synthrepo.hpp"
+
+namespace bench {
+
+static const char *advisoryTypes[] = {"security", "bugfix", "enhancement"};
+static const char *severities[] = {"Critical", "Important", "Moderate", "Low"};
+
+/**
+ * Open a metadata file for writing, compressed according to its suffix
+ */
+static FILE *
+openOutput(const std::string &fn)
+{
+    FILE *fp = solv_xfopen(fn.c_str(), "w");
+    if (!fp) {
+        throw std::runtime_error("cannot write " + fn);
+    }
+    return fp;
+}
+
+static void
+closeOutput(FILE *fp, const std::string &fn)
+{
+    if (fclose(fp) != 0) {
+        throw std::runtime_error("failed writing " + fn);
+    }
+}
+
+static std::string
+pkgid(const SynthRepoParams &params, unsigned index, bool installed)
+{
+    char buf[65];
+    snprintf(buf, sizeof(buf), "%048x%08x%08x", installed ? 1u : 0u, params.seed, index);
+    return buf;
+}
+
+SynthRepo::SynthRepo(const SynthRepoParams &params)
+  : params(params)
+{
+    std::mt19937 rng(params.seed);
+
+    packages.reserve(params.packages + params.kernels);
+    for (unsigned i = 0; i < params.packages; ++i) {
+        SynthPackage pkg;
+        char name[32];
+        snprintf(name, sizeof(name), "pkg%05u", i);
+        pkg.name = name;
+        pkg.version = "1." + std::to_string(rng() % 20 + 1);
+        pkg.release = "1.fc28";
+        pkg.arch = rng() % 10 == 0 ? "noarch" : "x86_64";
+        if (rng() % 100 < params.installedPercent) {
+            pkg.installedVersion = "1.0";
+        }
+        for (unsigned k = 0; i > 0 && k < params.fanout; ++k) {
+            pkg.requires.push_back(rng() % i);
+        }
+        packages.push_back(pkg);
+    }
+
+    // installonly packages: every version but the newest is installed
+    for (unsigned k = 0; k < params.kernels; ++k) {
+        SynthPackage pkg;
+        pkg.name = "kernel";
+        pkg.version = "4." + std::to_string(10 + k) + ".0";
+        pkg.release = "1.fc28";
+        pkg.arch = "x86_64";
+        if (k + 1 < params.kernels) {
+            pkg.installedVersion = pkg.version;
+        }
+        packages.push_back(pkg);
+    }
+
+    for (unsigned a = 0; params.packages > 0 && a < params.advisories; ++a) {
+        std::vector< unsigned > pkglist;
+        for (unsigned n = rng() % 3 + 1; n > 0; --n) {
+            pkglist.push_back(rng() % params.packages);
+        }
+        advisories.push_back(pkglist);
+    }
+}
+
+std::string
+SynthRepo::libraryProvide(const SynthPackage &pkg)
+{
+    return "lib" + pkg.name + ".so.1()(64bit)";
+}
+
+std::string
+SynthRepo::binaryPath(const SynthPackage &pkg)
+{
+    return "/usr/bin/" + pkg.name;
+}
+
+void
+SynthRepo::write(const std::string &dir, bool installed) const
+{
+    std::string repodata = dir + "/repodata";
+    if (g_mkdir_with_parents(repodata.c_str(), 0755) != 0) {
+        throw std::runtime_error("cannot create " + repodata);
+    }
+    writePrimary(repodata + "/primary.xml.gz", installed);
+    writeFilelists(repodata + "/filelists.xml.gz", installed);
+    if (!installed) {
+        writeUpdateinfo(repodata + "/updateinfo.xml.gz");
+    }
+    writeRepomd(repodata + "/repomd.xml", installed);
+}
+
+void
+SynthRepo::writePrimary(const std::string &fn, bool installed) const
+{
+    FILE *fp = openOutput(fn);
+    fprintf(fp,
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<metadata xmlns=\"http://linux.duke.edu/metadata/common\" "
+            "xmlns:rpm=\"http://linux.duke.edu/metadata/rpm\" packages=\"%zu\">\n",
+            packages.size());
+    for (unsigned i = 0; i < packages.size(); ++i) {
+        const SynthPackage &pkg = packages[i];
+        if (installed && pkg.installedVersion.empty()) {
+            continue;
+        }
+        const char *name = pkg.name.c_str();
+        const char *arch = pkg.arch.c_str();
+        const char *ver = installed ? pkg.installedVersion.c_str() : pkg.version.c_str();
+        const char *rel = pkg.release.c_str();
+        fprintf(fp,
+                "<package type=\"rpm\">\n"
+                "  <name>%s</name>\n"
+                "  <arch>%s</arch>\n"
+                "  <version epoch=\"0\" ver=\"%s\" rel=\"%s\"/>\n"
+                "  <checksum type=\"sha256\" pkgid=\"YES\">%s</checksum>\n"
+                "  <summary>Synthetic package %s</summary>\n"
+                "  <description>Synthetic package %s generated for benchmarking.</description>\n"
+                "  <packager/>\n"
+                "  <url>https://example.com/%s</url>\n"
+                "  <time file=\"%u\" build=\"%u\"/>\n"
+                "  <size package=\"%u\" installed=\"%u\" archive=\"%u\"/>\n"
+                "  <location href=\"Packages/%s-%s-%s.%s.rpm\"/>\n"
+                "  <format>\n"
+                "    <rpm:license>MIT</rpm:license>\n"
+                "    <rpm:sourcerpm>%s-%s-%s.src.rpm</rpm:sourcerpm>\n"
+                "    <rpm:provides>\n"
+                "      <rpm:entry name=\"%s\" flags=\"EQ\" epoch=\"0\" ver=\"%s\" rel=\"%s\"/>\n"
+                "      <rpm:entry name=\"%s\"/>\n"
+                "    </rpm:provides>\n",
+                name, arch, ver, rel, pkgid(params, i, installed).c_str(),
+                name, name, name,
+                1500000000u + i, 1500000000u + i,
+                1024u * (i % 64 + 1), 4096u * (i % 64 + 1), 4096u * (i % 64 + 1),
+                name, ver, rel, arch,
+                name, ver, rel,
+                name, ver, rel,
+                libraryProvide(pkg).c_str());
+        if (!pkg.requires.empty()) {
+            fprintf(fp, "    <rpm:requires>\n");
+            // mix name, soname and file dependencies
+            for (unsigned k = 0; k < pkg.requires.size(); ++k) {
+                const SynthPackage &dep = packages[pkg.requires[k]];
+                std::string depname;
+                switch (k % 3) {
+                    case 0:
+                        depname = dep.name;
+                        break;
+                    case 1:
+                        depname = libraryProvide(dep);
+                        break;
+                    default:
+                        depname = binaryPath(dep);
+                        break;
+                }
+                fprintf(fp, "      <rpm:entry name=\"%s\"/>\n", depname.c_str());
+            }
+            fprintf(fp, "    </rpm:requires>\n");
+        }
+        fprintf(fp,
+                "    <file>%s</file>\n"
+                "  </format>\n"
+                "</package>\n",
+                binaryPath(pkg).c_str());
+    }
+    fprintf(fp, "</metadata>\n");
+    closeOutput(fp, fn);
+}
+
+void
+SynthRepo::writeFilelists(const std::string &fn, bool installed) const
+{
+    FILE *fp = openOutput(fn);
+    fprintf(fp,
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<filelists xmlns=\"http://linux.duke.edu/metadata/filelists\" packages=\"%zu\">\n",
+            packages.size());
+    for (unsigned i = 0; i < packages.size(); ++i) {
+        const SynthPackage &pkg = packages[i];
+        if (installed && pkg.installedVersion.empty()) {
+            continue;
+        }
+        const char *name = pkg.name.c_str();
+        fprintf(fp,
+                "<package pkgid=\"%s\" name=\"%s\" arch=\"%s\">\n"
+                "  <version epoch=\"0\" ver=\"%s\" rel=\"%s\"/>\n"
+                "  <file>%s</file>\n",
+                pkgid(params, i, installed).c_str(), name, pkg.arch.c_str(),
+                installed ? pkg.installedVersion.c_str() : pkg.version.c_str(),
+                pkg.release.c_str(), binaryPath(pkg).c_str());
+        for (unsigned f = 1; f < params.files; ++f) {
+            fprintf(fp, "  <file>/usr/share/%s/file%04u</file>\n", name, f);
+        }
+        fprintf(fp, "</package>\n");
+    }
+    fprintf(fp, "</filelists>\n");
+    closeOutput(fp, fn);
+}
+
+void
+SynthRepo::writeUpdateinfo(const std::string &fn) const
+{
+    FILE *fp = openOutput(fn);
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<updates>\n");
+    for (unsigned a = 0; a < advisories.size(); ++a) {
+        const char *type = advisoryTypes[a % G_N_ELEMENTS(advisoryTypes)];
+        fprintf(fp,
+                "<update from=\"bench@example.com\" status=\"stable\" type=\"%s\" version=\"1\">\n"
+                "  <id>FEDORA-2018-%06u</id>\n"
+                "  <title>Synthetic advisory %u</title>\n"
+                "  <issued date=\"2018-01-01 00:00:00\"/>\n"
+                "  <severity>%s</severity>\n"
+                "  <references>\n",
+                type, a, a, severities[a % G_N_ELEMENTS(severities)]);
+        if (a % G_N_ELEMENTS(advisoryTypes) == 0) {
+            fprintf(fp,
+                    "    <reference href=\"https://example.com/CVE-2018-%05u\" "
+                    "id=\"CVE-2018-%05u\" type=\"cve\" title=\"CVE-2018-%05u\"/>\n",
+                    a, a, a);
+        }
+        fprintf(fp,
+                "    <reference href=\"https://example.com/show_bug.cgi?id=%u\" "
+                "id=\"%u\" type=\"bugzilla\" title=\"Bug %u\"/>\n"
+                "  </references>\n"
+                "  <description>Synthetic advisory %u.</description>\n"
+                "  <pkglist>\n"
+                "    <collection short=\"F28\">\n"
+                "      <name>Fedora 28</name>\n",
+                1000000 + a, 1000000 + a, 1000000 + a, a);
+        for (auto index : advisories[a]) {
+            const SynthPackage &pkg = packages[index];
+            fprintf(fp,
+                    "      <package name=\"%s\" version=\"%s\" release=\"%s\" epoch=\"0\" "
+                    "arch=\"%s\" src=\"\">\n"
+                    "        <filename>%s-%s-%s.%s.rpm</filename>\n"
+                    "      </package>\n",
+                    pkg.name.c_str(), pkg.version.c_str(), pkg.release.c_str(), pkg.arch.c_str(),
+                    pkg.name.c_str(), pkg.version.c_str(), pkg.release.c_str(), pkg.arch.c_str());
+        }
+        fprintf(fp, "    </collection>\n  </pkglist>\n</update>\n");
+    }
+    fprintf(fp, "</updates>\n");
+    closeOutput(fp, fn);
+}
+
+void
+SynthRepo::writeRepomd(const std::string &fn, bool installed) const
+{
+    // the revision makes the repomd checksum, and thus the solv cache, differ per shape
+    FILE *fp = fopen(fn.c_str(), "w");
+    if (!fp) {
+        throw std::runtime_error("cannot write " + fn);
+    }
+    fprintf(fp,
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<repomd xmlns=\"http://linux.duke.edu/metadata/repo\">\n"
+            "  <revision>%s-%u-%u-%u-%u-%u-%u-%u</revision>\n"
+            "</repomd>\n",
+            installed ? "installed" : "available",
+            params.seed, params.packages, params.fanout, params.files,
+            params.advisories, params.kernels, params.installedPercent);
+    closeOutput(fp, fn);
+}
+
+static const char *yumHistorySchema = R"**(
+    CREATE TABLE pkgtups (
+        pkgtupid INTEGER PRIMARY KEY,
+        name TEXT NOT NULL,
+        arch TEXT NOT NULL,
+        epoch TEXT NOT NULL,
+        version TEXT NOT NULL,
+        release TEXT NOT NULL,
+        checksum TEXT
+    );
+    CREATE TABLE trans_beg (
+        tid INTEGER PRIMARY KEY,
+        timestamp INTEGER NOT NULL,
+        rpmdb_version TEXT NOT NULL,
+        loginuid INTEGER
+    );
+    CREATE TABLE trans_end (
+        tid INTEGER PRIMARY KEY REFERENCES trans_beg,
+        timestamp INTEGER NOT NULL,
+        rpmdb_version TEXT NOT NULL,
+        return_code INTEGER NOT NULL
+    );
+    CREATE TABLE trans_cmdline (
+        tid INTEGER NOT NULL REFERENCES trans_beg,
+        cmdline TEXT NOT NULL
+    );
+    CREATE TABLE trans_data_pkgs (
+        tid INTEGER NOT NULL REFERENCES trans_beg,
+        pkgtupid INTEGER NOT NULL REFERENCES pkgtups,
+        done BOOL NOT NULL DEFAULT FALSE, state TEXT NOT NULL
+    );
+    CREATE TABLE trans_script_stdout (
+        lid INTEGER PRIMARY KEY,
+        tid INTEGER NOT NULL REFERENCES trans_beg,
+        line TEXT NOT NULL
+    );
+    CREATE TABLE pkg_yumdb (
+        pkgtupid INTEGER NOT NULL REFERENCES pkgtups,
+        yumdb_key TEXT NOT NULL,
+        yumdb_val TEXT NOT NULL
+    );
+    CREATE TABLE trans_with_pkgs (
+        tid INTEGER NOT NULL REFERENCES trans_beg,
+        pkgtupid INTEGER NOT NULL REFERENCES pkgtups
+    );
+    CREATE TABLE trans_error (
+        mid INTEGER PRIMARY KEY,
+        tid INTEGER NOT NULL REFERENCES trans_beg,
+        msg TEXT NOT NULL
+    );
+)**";
+
+void
+writeYumHistory(const std::string &dir, const SynthRepoParams &params, unsigned transactions)
+{
+    std::string historyDir = dir + "/history";
+    if (g_mkdir_with_parents(historyDir.c_str(), 0755) != 0) {
+        throw std::runtime_error("cannot create " + historyDir);
+    }
+    std::string fn = historyDir + "/history-2018-01-01.sqlite";
+    g_unlink(fn.c_str());
+
+    std::mt19937 rng(params.seed);
+    SQLite3 db(fn);
+    db.exec(yumHistorySchema);
+    db.exec("BEGIN");
+
+    SQLite3::Statement pkgtup(db, "INSERT INTO pkgtups VALUES (?, ?, 'x86_64', '0', ?, '1.fc28', ?)");
+    SQLite3::Statement yumdb(db, "INSERT INTO pkg_yumdb VALUES (?, ?, ?)");
+    SQLite3::Statement beg(db, "INSERT INTO trans_beg VALUES (?, ?, ?, 1000)");
+    SQLite3::Statement end(db, "INSERT INTO trans_end VALUES (?, ?, ?, 0)");
+    SQLite3::Statement cmdline(db, "INSERT INTO trans_cmdline VALUES (?, 'upgrade -y')");
+    SQLite3::Statement data(db, "INSERT INTO trans_data_pkgs VALUES (?, ?, 'TRUE', ?)");
+    SQLite3::Statement output(db, "INSERT INTO trans_script_stdout (tid, line) VALUES (?, ?)");
+
+    // pkgtupid of the installed version of every package
+    std::map< unsigned, int64_t > installed;
+    int64_t lastPkgtup = 0;
+    for (unsigned t = 0; t < transactions; ++t) {
+        int64_t tid = t + 1;
+        std::set< unsigned > picked;
+        for (unsigned n = rng() % 4 + 1; n > 0; --n) {
+            picked.insert(rng() % params.packages);
+        }
+        for (auto index : picked) {
+            char name[32];
+            snprintf(name, sizeof(name), "pkg%05u", index);
+            int64_t id = ++lastPkgtup;
+            pkgtup.bindv(id, name, "1." + std::to_string(t), "sha256:" + std::to_string(id));
+            pkgtup.step();
+            pkgtup.reset();
+
+            yumdb.bindv(id, "reason", rng() % 2 ? "user" : "dep");
+            yumdb.step();
+            yumdb.reset();
+            yumdb.bindv(id, "from_repo", "synthetic");
+            yumdb.step();
+            yumdb.reset();
+            yumdb.bindv(id, "releasever", "28");
+            yumdb.step();
+            yumdb.reset();
+
+            // the order is important - Update, Updated
+            auto old = installed.find(index);
+            data.bindv(tid, id, old == installed.end() ? "Install" : "Update");
+            data.step();
+            data.reset();
+            if (old != installed.end()) {
+                data.bindv(tid, old->second, "Updated");
+                data.step();
+                data.reset();
+            }
+            installed[index] = id;
+        }
+
+        int64_t timestamp = 1500000000 + static_cast< int64_t >(t) * 60;
+        beg.bindv(tid, timestamp, "rpmdb-" + std::to_string(t));
+        beg.step();
+        beg.reset();
+        end.bindv(tid, timestamp + 30, "rpmdb-" + std::to_string(t + 1));
+        end.step();
+        end.reset();
+        cmdline.bindv(tid);
+        cmdline.step();
+        cmdline.reset();
+        output.bindv(tid, "Running scriptlet " + std::to_string(t));
+        output.step();
+        output.reset();
+    }
+    db.exec("COMMIT");
+}
+
+} // namespace bench
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef LIBDNF_BENCHMARKS_SYNTHREPO_HPP
+#define LIBDNF_BENCHMARKS_SYNTHREPO_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Shape of the generated repository. The same parameters and seed always
+ * produce the same metadata, so results of different runs compare.
+ */
+struct SynthRepoParams {
+    unsigned packages = 5000;
+    /// number of requires per package, each pointing to a package generated earlier
+    unsigned fanout = 4;
+    /// files per package, listed in filelists.xml
+    unsigned files = 20;
+    unsigned advisories = 500;
+    /// available "kernel" versions, all but the newest one are installed
+    unsigned kernels = 4;
+    /// share of the packages with an older version in the installed repo
+    unsigned installedPercent = 60;
+    uint32_t seed = 42;
+};
+
+/**
+ * Description of one generated package, enough to build queries against it
+ */
+struct SynthPackage {
+    std::string name;
+    std::string version;
+    std::string release;
+    std::string arch;
+    /// version in the installed repo, empty if the package is not installed
+    std::string installedVersion;
+    std::vector< unsigned > requires;
+};
+
+class SynthRepo {
+public:
+    explicit SynthRepo(const SynthRepoParams &params);
+
+    const SynthRepoParams &getParams() const { return params; }
+    const std::vector< SynthPackage > &getPackages() const { return packages; }
+
+    /**
+     * Write repodata/ with repomd.xml, primary, filelists and updateinfo
+     * \param installed write the installed versions instead of the available ones
+     */
+    void write(const std::string &dir, bool installed) const;
+
+    /// Library provide of the given package, e.g. "libpkg00042.so.1()(64bit)"
+    static std::string libraryProvide(const SynthPackage &pkg);
+    static std::string binaryPath(const SynthPackage &pkg);
+
+private:
+    void writePrimary(const std::string &fn, bool installed) const;
+    void writeFilelists(const std::string &fn, bool installed) const;
+    void writeUpdateinfo(const std::string &fn) const;
+    void writeRepomd(const std::string &fn, bool installed) const;
+
+    SynthRepoParams params;
+    std::vector< SynthPackage > packages;
+    /// indices into packages per advisory
+    std::vector< std::vector< unsigned > > advisories;
+};
+
+/**
+ * Write a yum history database to dir/history/, the input of Transformer::transform().
+ * Every transaction installs or upgrades one to four of the generated packages,
+ * with yumdb reasons, repos and script output, deterministic for the seed.
+ */
+void writeYumHistory(const std::string &dir, const SynthRepoParams &params, unsigned transactions);
+
+} // namespace bench
+
+#endif // LIBDNF_BENCHMARKS_SYNTHREPO_HPP
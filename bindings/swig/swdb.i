@@ -14,6 +14,9 @@
 
 
 %rename ("__hash__", fullname=1) "TransactionItem::getHash";
+// std::function callbacks are not wrapped, use listTransactions() instead
+%ignore Swdb::forEachTransaction;
+%ignore RPMItem::forEachLatestReason;
 
 
 %exception {
@@ -99,6 +102,14 @@ typedef int int32_t;
 %template() std::map<std::string,std::string>;
 %template() std::vector<std::pair<int,std::string> >;
 
+// SQLite3 is not wrapped, only its connection mode for Swdb(path, mode):
+// Swdb(path, SQLite3.ConnectionMode_EXCLUSIVE)
+%nodefaultctor SQLite3;
+class SQLite3 {
+public:
+    enum class ConnectionMode { EXCLUSIVE, WAL };
+};
+
 // make SWIG look into following headers
 %include "libdnf/swdb/item.hpp"
 %include "libdnf/swdb/item_comps_environment.hpp"
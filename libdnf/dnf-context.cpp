@@ -48,6 +48,7 @@
 #include "dnf-state.h"
 #include "dnf-transaction.h"
 #include "dnf-utils.h"
+#include "dnf-sack-private.hpp"
 #include "dnf-sack.h"
 #include "hy-query.h"
 #include "hy-subject.h"
@@ -110,11 +111,15 @@ typedef struct
     gchar            *http_proxy;
     gchar            *user_agent;
     guint            cache_age;     /*seconds*/
+    guint            refresh_id;
+    gboolean         refresh_running;
     gboolean         check_disk_space;
     gboolean         check_transaction;
     gboolean         only_trusted;
     gboolean         enable_yumdb;
     gboolean         keep_cache;
+    gboolean         deltarpm;
+    guint            deltarpm_percentage;
     gboolean         enrollment_valid;
     DnfLock         *lock;
     DnfTransaction  *transaction;
@@ -130,6 +135,15 @@ typedef struct
     DnfSack         *sack;
 } DnfContextPrivate;
 
+/* what refreshing the metadata needs, usable outside of the thread of the context */
+typedef struct {
+    GPtrArray       *repos;
+    guint            cache_age;     /*seconds*/
+    gchar           *solv_dir;
+    gchar           *install_root;
+    gboolean         deltarpm;
+} DnfContextRefresh;
+
 enum {
     SIGNAL_INVALIDATE,
     SIGNAL_LAST
@@ -169,6 +183,8 @@ dnf_context_finalize(GObject *object)
     g_object_unref(priv->state);
     g_hash_table_unref(priv->override_macros);
 
+    if (priv->refresh_id != 0)
+        g_source_remove(priv->refresh_id);
     if (priv->transaction != NULL)
         g_object_unref(priv->transaction);
     if (priv->repo_loader != NULL)
@@ -199,6 +215,7 @@ dnf_context_init(DnfContext *context)
     priv->state = dnf_state_new();
     priv->lock = dnf_lock_new();
     priv->cache_age = 60 * 60 * 24 * 7; /* 1 week */
+    priv->deltarpm_percentage = 75;
     priv->override_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                   g_free, g_free);
     priv->user_agent = g_strdup("libdnf/" PACKAGE_VERSION);
@@ -614,6 +631,45 @@ dnf_context_get_state(DnfContext *context)
     return priv->state;
 }
 
+/**
+ * dnf_context_set_enable_trace:
+ * @context: a #DnfContext instance.
+ * @enable_trace: if tracing should be enabled
+ *
+ * Records wall and CPU time of every step and action reported on the
+ * context state, see dnf_state_set_enable_trace().
+ *
+ * Only work done with the context state, or children of it, is recorded.
+ * Callers passing their own #DnfState to e.g. dnf_context_setup_sack() have
+ * to enable tracing on that state themselves.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_context_set_enable_trace(DnfContext *context, gboolean enable_trace)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    dnf_state_set_enable_trace(priv->state, enable_trace);
+}
+
+/**
+ * dnf_context_get_trace:
+ * @context: a #DnfContext instance.
+ * @format: a #DnfStateTraceFormat, e.g. %DNF_STATE_TRACE_FORMAT_CHROME
+ *
+ * Exports the spans recorded on the context state.
+ *
+ * Returns: (transfer full): the trace, or %NULL if tracing was never enabled
+ *
+ * Since: 0.13.0
+ **/
+gchar *
+dnf_context_get_trace(DnfContext *context, DnfStateTraceFormat format)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    return dnf_state_get_trace(priv->state, format);
+}
+
 /**
  * dnf_context_get_user_agent:
  * @context: a #DnfContext instance.
@@ -697,6 +753,40 @@ dnf_context_get_only_trusted(DnfContext *context)
     return priv->only_trusted;
 }
 
+/**
+ * dnf_context_get_deltarpm:
+ * @context: a #DnfContext instance.
+ *
+ * Gets if updates may be downloaded as delta RPMs.
+ *
+ * Returns: %TRUE if delta RPMs are used
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+dnf_context_get_deltarpm(DnfContext *context)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    return priv->deltarpm;
+}
+
+/**
+ * dnf_context_get_deltarpm_percentage:
+ * @context: a #DnfContext instance.
+ *
+ * Gets the maximum size of a delta RPM, relative to the full package.
+ *
+ * Returns: size in percent of the full package
+ *
+ * Since: 0.13.0
+ **/
+guint
+dnf_context_get_deltarpm_percentage(DnfContext *context)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    return priv->deltarpm_percentage;
+}
+
 /**
  * dnf_context_get_cache_age:
  * @context: a #DnfContext instance.
@@ -1002,6 +1092,43 @@ dnf_context_set_yumdb_enabled(DnfContext    *context,
     priv->enable_yumdb = enable_yumdb;
 }
 
+/**
+ * dnf_context_set_deltarpm:
+ * @context: a #DnfContext instance.
+ * @deltarpm: %TRUE to download updates as delta RPMs when possible
+ *
+ * Enables or disables delta RPMs. When enabled the presto metadata is
+ * loaded by dnf_context_setup_sack() and dnf_transaction_download()
+ * rebuilds updates from deltas against the installed packages, which
+ * needs applydeltarpm to be installed.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_context_set_deltarpm(DnfContext *context, gboolean deltarpm)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    priv->deltarpm = deltarpm;
+}
+
+/**
+ * dnf_context_set_deltarpm_percentage:
+ * @context: a #DnfContext instance.
+ * @deltarpm_percentage: size in percent of the full package, default 75
+ *
+ * Sets the maximum size of a delta RPM relative to its full package.
+ * Deltas which are bigger aren't worth the time spent rebuilding the
+ * package and are not used.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_context_set_deltarpm_percentage(DnfContext *context, guint deltarpm_percentage)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    priv->deltarpm_percentage = deltarpm_percentage;
+}
+
 /**
  * dnf_context_set_cache_age:
  * @context: a #DnfContext instance.
@@ -1163,6 +1290,7 @@ dnf_context_setup_sack(DnfContext *context, DnfState *state, GError **error)
 {
     DnfContextPrivate *priv = GET_PRIVATE(context);
     gboolean ret;
+    DnfSackAddFlags add_flags;
     g_autofree gchar *solv_dir_real = NULL;
 
     /* create empty sack */
@@ -1185,10 +1313,13 @@ dnf_context_setup_sack(DnfContext *context, DnfState *state, GError **error)
     }
 
     /* add remote */
+    add_flags = DNF_SACK_ADD_FLAG_FILELISTS;
+    if (priv->deltarpm)
+        add_flags = static_cast<DnfSackAddFlags>(add_flags | DNF_SACK_ADD_FLAG_DELTAINFO);
     ret = dnf_sack_add_repos(priv->sack,
                              priv->repos,
                              priv->cache_age,
-                             DNF_SACK_ADD_FLAG_FILELISTS,
+                             add_flags,
                              state,
                              error);
     if (!ret)
@@ -2081,6 +2212,412 @@ dnf_context_clean_cache(DnfContext *context,
             return FALSE;
         return ret;
 }
+
+/**
+ * dnf_context_prebuild_repo_cache:
+ *
+ * Builds the .solv and extension caches of a freshly downloaded repo by
+ * loading it into a scratch sack. A private HyRepo is used so the one owned
+ * by the #DnfRepo, which may be linked into the main sack, is not touched.
+ **/
+static gboolean
+dnf_context_prebuild_repo_cache(const DnfContextRefresh *refresh, DnfRepo *repo, GError **error)
+{
+    HyRepo hrepo_src = dnf_repo_get_repo(repo);
+    HyRepo hrepo;
+    gboolean ret;
+    int load_flags;
+    g_autofree gchar *solv_dir_real = NULL;
+    g_autoptr(DnfSack) sack = NULL;
+    const int which[] = { HY_REPO_MD_FN,
+                          HY_REPO_PRIMARY_FN,
+                          HY_REPO_FILELISTS_FN,
+                          HY_REPO_PRESTO_FN,
+                          HY_REPO_UPDATEINFO_FN };
+
+    if (hrepo_src == NULL)
+        return TRUE;
+
+    solv_dir_real = dnf_realpath(refresh->solv_dir);
+    sack = dnf_sack_new();
+    dnf_sack_set_cachedir(sack, solv_dir_real);
+    dnf_sack_set_rootdir(sack, refresh->install_root);
+    if (!dnf_sack_setup(sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, error))
+        return FALSE;
+
+    hrepo = hy_repo_create(dnf_repo_get_id(repo));
+    for (int w : which)
+        hy_repo_set_string(hrepo, w, hy_repo_get_string(hrepo_src, w));
+
+    /* write_main() and write_ext() replace the cache files atomically */
+    g_debug("prebuilding cache for %s", dnf_repo_get_id(repo));
+    load_flags = DNF_SACK_LOAD_FLAG_BUILD_CACHE |
+                 DNF_SACK_LOAD_FLAG_USE_FILELISTS |
+                 DNF_SACK_LOAD_FLAG_USE_UPDATEINFO;
+    if (refresh->deltarpm)
+        load_flags |= DNF_SACK_LOAD_FLAG_USE_PRESTO;
+    ret = dnf_sack_load_repo(sack, hrepo, load_flags, error);
+    if (ret)
+        dnf_sack_prime_fileprovides(sack);
+    hy_repo_free(hrepo);
+    return ret;
+}
+
+/**
+ * dnf_context_refresh_repo:
+ *
+ * Returns: %TRUE if the repo was refreshed or is still valid
+ **/
+static gboolean
+dnf_context_refresh_repo(const DnfContextRefresh *refresh,
+                         DnfRepo *repo,
+                         gboolean *refreshed,
+                         DnfState *state,
+                         GError **error)
+{
+    DnfState *state_local;
+    gboolean ret;
+    g_autoptr(GError) error_local = NULL;
+
+    /* set state */
+    ret = dnf_state_set_steps(state, error,
+                              5, /* check */
+                              65, /* download */
+                              30, /* build cache */
+                              -1);
+    if (!ret)
+        return FALSE;
+
+    /* still within metadata_expire */
+    state_local = dnf_state_get_child(state);
+    if (dnf_repo_check(repo, refresh->cache_age, state_local, &error_local))
+        return dnf_state_finished(state, error);
+    g_debug("refreshing %s: %s", dnf_repo_get_id(repo), error_local->message);
+    g_clear_error(&error_local);
+    dnf_state_reset(state_local);
+    if (!dnf_state_done(state, error))
+        return FALSE;
+
+    /* downloads into location_tmp and swaps it in under the metadata lock */
+    state_local = dnf_state_get_child(state);
+    ret = dnf_repo_update(repo, DNF_REPO_UPDATE_FLAG_NONE, state_local, &error_local);
+    if (!ret) {
+        if (!dnf_repo_get_required(repo) &&
+            g_error_matches(error_local,
+                            DNF_ERROR,
+                            DNF_ERROR_CANNOT_FETCH_SOURCE)) {
+            g_warning("Skipping refresh of %s: %s",
+                      dnf_repo_get_id(repo),
+                      error_local->message);
+            return dnf_state_finished(state, error);
+        }
+        g_propagate_error(error, static_cast<GError *>(g_steal_pointer(&error_local)));
+        return FALSE;
+    }
+    if (!dnf_state_done(state, error))
+        return FALSE;
+
+    /* build the caches before anybody in the foreground needs them */
+    state_local = dnf_state_get_child(state);
+    if (!dnf_state_take_lock(state_local,
+                             DNF_LOCK_TYPE_METADATA,
+                             DNF_LOCK_MODE_PROCESS,
+                             error))
+        return FALSE;
+    dnf_state_action_start(state_local, DNF_STATE_ACTION_LOADING_CACHE, NULL);
+    ret = dnf_context_prebuild_repo_cache(refresh, repo, error);
+    dnf_state_release_locks(state_local);
+    if (!ret)
+        return FALSE;
+    *refreshed = TRUE;
+    return dnf_state_done(state, error);
+}
+
+/**
+ * dnf_context_refresh_free:
+ **/
+static void
+dnf_context_refresh_free(DnfContextRefresh *refresh)
+{
+    g_ptr_array_unref(refresh->repos);
+    g_free(refresh->solv_dir);
+    g_free(refresh->install_root);
+    g_slice_free(DnfContextRefresh, refresh);
+}
+
+/**
+ * dnf_context_refresh_new:
+ *
+ * Gets the enabled remote repos, the only ones whose metadata can expire,
+ * and the settings refreshing them needs. Copies of the repos are taken
+ * with @copy_repos, for refreshing in another thread.
+ **/
+static DnfContextRefresh *
+dnf_context_refresh_new(DnfContext *context, gboolean copy_repos, GError **error)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    DnfContextRefresh *refresh = g_slice_new0(DnfContextRefresh);
+
+    refresh->repos = g_ptr_array_new_with_free_func((GDestroyNotify) g_object_unref);
+    refresh->cache_age = priv->cache_age;
+    refresh->solv_dir = g_strdup(priv->solv_dir);
+    refresh->install_root = g_strdup(priv->install_root);
+    refresh->deltarpm = priv->deltarpm;
+    for (guint i = 0; i < priv->repos->len; i++) {
+        auto repo = static_cast<DnfRepo *>(g_ptr_array_index(priv->repos, i));
+        if (dnf_repo_get_enabled(repo) == DNF_REPO_ENABLED_NONE)
+            continue;
+        if (dnf_repo_get_kind(repo) != DNF_REPO_KIND_REMOTE)
+            continue;
+        if (!copy_repos) {
+            g_ptr_array_add(refresh->repos, g_object_ref(repo));
+            continue;
+        }
+        DnfRepo *copy = dnf_repo_copy(repo, error);
+        if (copy == NULL) {
+            dnf_context_refresh_free(refresh);
+            return NULL;
+        }
+        g_ptr_array_add(refresh->repos, copy);
+    }
+    return refresh;
+}
+
+/**
+ * dnf_context_refresh_repos:
+ **/
+static gboolean
+dnf_context_refresh_repos(const DnfContextRefresh *refresh,
+                          gboolean *refreshed,
+                          DnfState *state,
+                          GError **error)
+{
+    GPtrArray *repos = refresh->repos;
+
+    if (repos->len == 0)
+        return dnf_state_finished(state, error);
+    if (!dnf_state_set_number_steps(state, repos->len))
+        return FALSE;
+
+    for (guint i = 0; i < repos->len; i++) {
+        auto repo = static_cast<DnfRepo *>(g_ptr_array_index(repos, i));
+        DnfState *state_local = dnf_state_get_child(state);
+        if (!dnf_context_refresh_repo(refresh, repo, refreshed, state_local, error))
+            return FALSE;
+        if (!dnf_state_done(state, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * dnf_context_refresh_metadata:
+ * @context: a #DnfContext instance.
+ * @state: A #DnfState
+ * @error: A #GError or %NULL
+ *
+ * Re-validates the metadata of all enabled repos against the cache age and
+ * their metadata_expire value. Expired metadata is downloaded into the
+ * temporary location, the .solv and extension caches are prebuilt and then
+ * swapped in, so a later dnf_context_setup_sack() finds a hot cache.
+ *
+ * The ::invalidate signal is emitted if any repo was refreshed.
+ *
+ * Returns: %TRUE for success, %FALSE otherwise
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+dnf_context_refresh_metadata(DnfContext *context, DnfState *state, GError **error)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    gboolean refreshed = FALSE;
+    gboolean ret;
+    DnfContextRefresh *refresh;
+
+    /* set up the context if it hasn't been set earlier */
+    if (priv->repos == NULL) {
+        if (!dnf_context_setup(context, NULL, error))
+            return FALSE;
+    }
+
+    refresh = dnf_context_refresh_new(context, FALSE, error);
+    if (refresh == NULL)
+        return FALSE;
+    ret = dnf_context_refresh_repos(refresh, &refreshed, state, error);
+    dnf_context_refresh_free(refresh);
+    if (!ret)
+        return FALSE;
+    if (refreshed)
+        dnf_context_invalidate(context, "metadata refreshed");
+    return TRUE;
+}
+
+/**
+ * dnf_context_refresh_thread_cb:
+ *
+ * Refreshes private copies of the repos, the librepo handles of the repos
+ * owned by the context are not safe to use outside of its thread. Neither is
+ * the context, everything needed from it was copied into the task data.
+ **/
+static void
+dnf_context_refresh_thread_cb(GTask *task,
+                              gpointer source_object,
+                              gpointer task_data,
+                              GCancellable *cancellable)
+{
+    auto refresh = static_cast<DnfContextRefresh *>(task_data);
+    g_autoptr(DnfState) state = dnf_state_new();
+    gboolean refreshed = FALSE;
+    GError *error = NULL;
+
+    if (cancellable != NULL)
+        dnf_state_set_cancellable(state, cancellable);
+    if (!dnf_context_refresh_repos(refresh, &refreshed, state, &error)) {
+        g_task_return_error(task, error);
+        return;
+    }
+    g_task_return_boolean(task, refreshed);
+}
+
+/**
+ * dnf_context_refresh_metadata_async:
+ * @context: a #DnfContext instance.
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: the function to call when the refresh is done
+ * @user_data: the data to pass to @callback
+ *
+ * Does what dnf_context_refresh_metadata() does in a worker thread, on
+ * copies of the enabled remote repos. @callback is called in the
+ * thread-default main context and should call
+ * dnf_context_refresh_metadata_finish(), which emits the ::invalidate signal
+ * if any repo was refreshed.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_context_refresh_metadata_async(DnfContext *context,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    g_autoptr(GTask) task = g_task_new(context, cancellable, callback, user_data);
+    DnfContextRefresh *refresh;
+    GError *error = NULL;
+
+    g_task_set_source_tag(task, (gpointer) dnf_context_refresh_metadata_async);
+
+    /* set up the context if it hasn't been set earlier */
+    if (priv->repos == NULL) {
+        if (!dnf_context_setup(context, NULL, &error)) {
+            g_task_return_error(task, error);
+            return;
+        }
+    }
+
+    refresh = dnf_context_refresh_new(context, TRUE, &error);
+    if (refresh == NULL) {
+        g_task_return_error(task, error);
+        return;
+    }
+    g_task_set_task_data(task, refresh, (GDestroyNotify) dnf_context_refresh_free);
+    g_task_run_in_thread(task, dnf_context_refresh_thread_cb);
+}
+
+/**
+ * dnf_context_refresh_metadata_finish:
+ * @context: a #DnfContext instance.
+ * @result: the #GAsyncResult passed to the callback
+ * @error: A #GError or %NULL
+ *
+ * Gets the result of dnf_context_refresh_metadata_async().
+ *
+ * Returns: %TRUE for success, %FALSE otherwise
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+dnf_context_refresh_metadata_finish(DnfContext *context, GAsyncResult *result, GError **error)
+{
+    g_autoptr(GError) error_local = NULL;
+    gboolean refreshed;
+
+    g_return_val_if_fail(g_task_is_valid(result, context), FALSE);
+
+    refreshed = g_task_propagate_boolean(G_TASK(result), &error_local);
+    if (error_local != NULL) {
+        g_propagate_error(error, static_cast<GError *>(g_steal_pointer(&error_local)));
+        return FALSE;
+    }
+
+    /* the updated copies didn't touch the context, this runs in its thread */
+    if (refreshed) {
+        dnf_context_invalidate_full(context, "updated repo cache",
+                                    DNF_CONTEXT_INVALIDATE_FLAG_ENROLLMENT);
+        dnf_context_invalidate(context, "metadata refreshed");
+    }
+    return TRUE;
+}
+
+/**
+ * dnf_context_refresh_done_cb:
+ **/
+static void
+dnf_context_refresh_done_cb(GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+    auto context = DNF_CONTEXT(source_object);
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    g_autoptr(GError) error = NULL;
+
+    priv->refresh_running = FALSE;
+    if (!dnf_context_refresh_metadata_finish(context, result, &error))
+        g_warning("failed to refresh metadata: %s", error->message);
+}
+
+/**
+ * dnf_context_refresh_cb:
+ **/
+static gboolean
+dnf_context_refresh_cb(gpointer user_data)
+{
+    auto context = static_cast<DnfContext *>(user_data);
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+
+    /* the previous refresh is still downloading */
+    if (priv->refresh_running)
+        return G_SOURCE_CONTINUE;
+    priv->refresh_running = TRUE;
+    dnf_context_refresh_metadata_async(context, NULL, dnf_context_refresh_done_cb, NULL);
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * dnf_context_set_refresh_interval:
+ * @context: a #DnfContext instance.
+ * @refresh_interval: seconds between refreshes, or 0 to disable
+ *
+ * Schedules dnf_context_refresh_metadata_async() on the thread-default main
+ * context, so long running daemons keep the metadata cache hot between
+ * user requests without blocking the main loop.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_context_set_refresh_interval(DnfContext *context, guint refresh_interval)
+{
+    DnfContextPrivate *priv = GET_PRIVATE(context);
+    if (priv->refresh_id != 0) {
+        g_source_remove(priv->refresh_id);
+        priv->refresh_id = 0;
+    }
+    if (refresh_interval == 0)
+        return;
+    priv->refresh_id = g_timeout_add_seconds(refresh_interval,
+                                             dnf_context_refresh_cb,
+                                             context);
+}
+
 /**
  * dnf_context_new:
  *
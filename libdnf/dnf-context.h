@@ -104,6 +104,8 @@ gboolean         dnf_context_get_check_disk_space       (DnfContext     *context
 gboolean         dnf_context_get_check_transaction      (DnfContext     *context);
 gboolean         dnf_context_get_keep_cache             (DnfContext     *context);
 gboolean         dnf_context_get_only_trusted           (DnfContext     *context);
+gboolean         dnf_context_get_deltarpm               (DnfContext     *context);
+guint            dnf_context_get_deltarpm_percentage    (DnfContext     *context);
 guint            dnf_context_get_cache_age              (DnfContext     *context);
 guint            dnf_context_get_installonly_limit      (DnfContext     *context);
 const gchar     *dnf_context_get_http_proxy             (DnfContext     *context);
@@ -116,6 +118,8 @@ HyGoal           dnf_context_get_goal                   (DnfContext     *context
 #endif
 DnfState*        dnf_context_get_state                  (DnfContext     *context);
 const char *     dnf_context_get_user_agent             (DnfContext     *context);
+gchar           *dnf_context_get_trace                  (DnfContext     *context,
+                                                         DnfStateTraceFormat format);
 
 /* setters */
 void             dnf_context_set_repo_dir               (DnfContext     *context,
@@ -150,6 +154,10 @@ void             dnf_context_set_yumdb_enabled          (DnfContext     *context
                                                          gboolean        enable_yumdb);
 void             dnf_context_set_cache_age              (DnfContext     *context,
                                                          guint           cache_age);
+void             dnf_context_set_deltarpm               (DnfContext     *context,
+                                                         gboolean        deltarpm);
+void             dnf_context_set_deltarpm_percentage    (DnfContext     *context,
+                                                         guint           deltarpm_percentage);
 
 void             dnf_context_set_rpm_macro              (DnfContext     *context,
                                                          const gchar    *key,
@@ -158,6 +166,10 @@ void             dnf_context_set_http_proxy             (DnfContext     *context
                                                          const gchar    *proxyurl);
 void             dnf_context_set_user_agent             (DnfContext     *context,
                                                          const gchar    *user_agent);
+void             dnf_context_set_enable_trace           (DnfContext     *context,
+                                                         gboolean        enable_trace);
+void             dnf_context_set_refresh_interval       (DnfContext     *context,
+                                                         guint           refresh_interval);
 
 /* object methods */
 gboolean         dnf_context_setup                      (DnfContext     *context,
@@ -179,6 +191,16 @@ void             dnf_context_invalidate_full            (DnfContext     *context
 gboolean         dnf_context_clean_cache                (DnfContext     *context,
                                                          DnfContextCleanFlags      flags,
                                                          GError         **error);
+gboolean         dnf_context_refresh_metadata           (DnfContext     *context,
+                                                         DnfState       *state,
+                                                         GError         **error);
+void             dnf_context_refresh_metadata_async     (DnfContext     *context,
+                                                         GCancellable   *cancellable,
+                                                         GAsyncReadyCallback callback,
+                                                         gpointer        user_data);
+gboolean         dnf_context_refresh_metadata_finish    (DnfContext     *context,
+                                                         GAsyncResult   *result,
+                                                         GError         **error);
 gboolean         dnf_context_install                    (DnfContext     *context,
                                                          const gchar    *name,
                                                          GError         **error);
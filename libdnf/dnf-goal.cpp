@@ -193,7 +193,7 @@ dnf_goal_add_protected(HyGoal goal, DnfPackageSet *pset)
 {
     Pool *pool = dnf_sack_get_pool(goal->sack);
     Map *protected_pkgs = goal->protected_pkgs;
-    Map *nprotected = dnf_packageset_get_map(pset);
+    const Map *nprotected = dnf_packageset_peek_map(pset);
 
     if (protected_pkgs == NULL) {
         protected_pkgs = (Map*)g_malloc0(sizeof(Map));
@@ -218,7 +218,7 @@ dnf_goal_set_protected(HyGoal goal, DnfPackageSet *pset)
     goal->protected_pkgs = free_map_fully(goal->protected_pkgs);
 
     if (pset) {
-        Map *nprotected = dnf_packageset_get_map(pset);
+        const Map *nprotected = dnf_packageset_peek_map(pset);
 
         goal->protected_pkgs = (Map*)g_malloc0(sizeof(Map));
         map_init_clone(goal->protected_pkgs, nprotected);
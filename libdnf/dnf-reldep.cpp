@@ -80,7 +80,11 @@ dnf_reldep_from_pool (Pool *pool,
  * @cmp_type: Comparison type
  * @evr: (nullable): EVR
  *
- * Returns: an #DnfReldep
+ * Frozen sacks are shared by their readers, so the name, @evr and the relation
+ * are only looked up there and never added to the pool.
+ *
+ * Returns: (nullable): an #DnfReldep, or %NULL if the sack is frozen and the
+ * relation is not in its pool
  *
  * Since: 0.7.0
  */
@@ -91,13 +95,20 @@ dnf_reldep_new (DnfSack           *sack,
                 const gchar       *evr)
 {
     Pool *pool = dnf_sack_get_pool (sack);
-    Id id = pool_str2id (pool, name, 1);
+    int create = !dnf_sack_is_frozen (sack);
+    Id id = pool_str2id (pool, name, create);
+    if (!id)
+        return NULL;
 
     if (evr) {
         g_assert (cmp_type);
-        Id ievr = pool_str2id (pool, evr, 1);
+        Id ievr = pool_str2id (pool, evr, create);
+        if (!ievr)
+            return NULL;
         int flags = cmptype2relflags(cmp_type);
-        id = pool_rel2id (pool, id, ievr, flags, 1);
+        id = pool_rel2id (pool, id, ievr, flags, create);
+        if (!id)
+            return NULL;
     }
 
     return dnf_reldep_from_pool (pool, id);
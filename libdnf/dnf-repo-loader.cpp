@@ -33,7 +33,13 @@
 
 #include <strings.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include <gio/gunixmounts.h>
+#include <gio/gunixoutputstream.h>
+#include <glib/gstdio.h>
 #include <librepo/util.h>
 #include <string.h>
 
@@ -257,24 +263,70 @@ dnf_repo_loader_repo_cost_fn(gconstpointer a, gconstpointer b)
     return 0;
 }
 
+/* cached repos.d snapshot; bump the version when the layout changes */
+#define DNF_REPO_LOADER_CACHE_FILENAME  "repos.d.cache"
+#define DNF_REPO_LOADER_CACHE_VERSION   "1"
+#define DNF_REPO_LOADER_CACHE_TYPE      "(ssxa(sttxs))"
+
+typedef struct
+{
+    gchar           *filename;
+    guint64          size;
+    guint64          inode;
+    gint64           mtime;         /* ns */
+    gchar           *data;          /* normalized keyfile, or NULL */
+    GKeyFile        *keyfile;
+    GError          *error;
+} DnfRepoLoaderFile;
+
 /**
- * dnf_repo_loader_load_multiline_key_file:
+ * dnf_repo_loader_file_free:
+ */
+static void
+dnf_repo_loader_file_free(DnfRepoLoaderFile *file)
+{
+    g_free(file->filename);
+    g_free(file->data);
+    if (file->keyfile != NULL)
+        g_key_file_unref(file->keyfile);
+    g_clear_error(&file->error);
+    g_slice_free(DnfRepoLoaderFile, file);
+}
+
+/**
+ * dnf_repo_loader_get_stamp:
+ *
+ * Gets what is needed to tell if a file or directory changed since it was
+ * last looked at.
+ */
+static gboolean
+dnf_repo_loader_get_stamp(const gchar *filename,
+                          guint64 *size,
+                          guint64 *inode,
+                          gint64 *mtime)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0)
+        return FALSE;
+    *size = st.st_size;
+    *inode = st.st_ino;
+    *mtime = (gint64) st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+    return TRUE;
+}
+
+/**
+ * dnf_repo_loader_normalize_multiline_key_file:
+ *
+ * Rewrites the indented continuation lines .repo files may use into
+ * something #GKeyFile can load.
  **/
-static GKeyFile *
-dnf_repo_loader_load_multiline_key_file(const gchar *filename, GError **error)
+static gchar *
+dnf_repo_loader_normalize_multiline_key_file(const gchar *data)
 {
-    GKeyFile *file = NULL;
-    gboolean ret;
-    gsize len;
     guint i;
-    g_autofree gchar *data = NULL;
-    g_autoptr(GString) string = NULL;
+    GString *string;
     g_auto(GStrv) lines = NULL;
 
-    /* load file */
-    if (!g_file_get_contents(filename, &data, &len, error))
-        return NULL;
-
     /* split into lines */
     string = g_string_new("");
     lines = g_strsplit(data, "\n", -1);
@@ -291,39 +343,170 @@ dnf_repo_loader_load_multiline_key_file(const gchar *filename, GError **error)
             g_strstrip(lines[i]);
 
             /* skip over the line if it was only whitespace */
-            if (strlen(lines[i]) == 0)
+            if (lines[i][0] == '\0')
                 continue;
 
             /* remove old newline from previous line */
             g_string_set_size(string, string->len - 1);
 
             /* only add a ';' if we have anything after the '=' */
-            if (string->str[string->len - 1] == '=') {
-                g_string_append_printf(string, "%s\n", lines[i]);
-            } else {
-                g_string_append_printf(string, ";%s\n", lines[i]);
-            }
-        } else {
-            g_string_append_printf(string, "%s\n", lines[i]);
+            if (string->str[string->len - 1] != '=')
+                g_string_append_c(string, ';');
         }
+        g_string_append(string, lines[i]);
+        g_string_append_c(string, '\n');
     }
 
     /* remove final newline */
     if (string->len > 0)
         g_string_set_size(string, string->len - 1);
+    return g_string_free(string, FALSE);
+}
+
+/**
+ * dnf_repo_loader_load_file_cb:
+ *
+ * Reads one .repo file unless its data came from the cache, and loads it
+ * into a #GKeyFile. Only touches @data so it can run in any thread.
+ **/
+static void
+dnf_repo_loader_load_file_cb(gpointer data, gpointer user_data)
+{
+    auto file = static_cast<DnfRepoLoaderFile *>(data);
+
+    if (file->data == NULL) {
+        g_autofree gchar *contents = NULL;
+        if (!g_file_get_contents(file->filename, &contents, NULL, &file->error))
+            goto out;
+        file->data = dnf_repo_loader_normalize_multiline_key_file(contents);
+    }
 
     /* load modified lines */
-    file = g_key_file_new();
-    ret = g_key_file_load_from_data(file,
-                                    string->str,
-                                    -1,
-                                    G_KEY_FILE_KEEP_COMMENTS,
-                                    error);
-    if (!ret) {
-        g_key_file_free(file);
+    file->keyfile = g_key_file_new();
+    if (!g_key_file_load_from_data(file->keyfile,
+                                   file->data,
+                                   -1,
+                                   G_KEY_FILE_KEEP_COMMENTS,
+                                   &file->error)) {
+        g_key_file_unref(file->keyfile);
+        file->keyfile = NULL;
+    }
+out:
+    if (file->error != NULL)
+        g_prefix_error(&file->error, "Failed to load %s: ", file->filename);
+}
+
+/**
+ * dnf_repo_loader_cache_load:
+ *
+ * Gets the .repo files of @repo_path from the snapshot in @cache_fn.
+ *
+ * Returns: the files with their data, or %NULL if any of them changed
+ **/
+static GPtrArray *
+dnf_repo_loader_cache_load(const gchar *cache_fn, const gchar *repo_path, gint64 dir_mtime)
+{
+    const gchar *version;
+    const gchar *cached_path;
+    gint64 cached_dir_mtime;
+    GVariantIter *iter = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    g_autoptr(GMappedFile) mapped = NULL;
+    g_autoptr(GPtrArray) files = NULL;
+    g_autoptr(GVariant) snapshot = NULL;
+
+    mapped = g_mapped_file_new(cache_fn, FALSE, NULL);
+    if (mapped == NULL)
+        return NULL;
+    bytes = g_mapped_file_get_bytes(mapped);
+    snapshot = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(DNF_REPO_LOADER_CACHE_TYPE),
+                                                           bytes, FALSE));
+    g_variant_get(snapshot, "(&s&sxa(sttxs))", &version, &cached_path, &cached_dir_mtime, &iter);
+    if (g_strcmp0(version, DNF_REPO_LOADER_CACHE_VERSION) != 0 ||
+        g_strcmp0(cached_path, repo_path) != 0 ||
+        cached_dir_mtime != dir_mtime) {
+        g_variant_iter_free(iter);
         return NULL;
     }
-    return file;
+
+    files = g_ptr_array_new_with_free_func((GDestroyNotify) dnf_repo_loader_file_free);
+    while (TRUE) {
+        const gchar *basename;
+        const gchar *data;
+        DnfRepoLoaderFile *file;
+        guint64 size;
+        guint64 inode;
+        gint64 mtime;
+
+        if (!g_variant_iter_next(iter, "(&sttx&s)", &basename, &size, &inode, &mtime, &data))
+            break;
+        file = g_slice_new0(DnfRepoLoaderFile);
+        file->filename = g_build_filename(repo_path, basename, NULL);
+        g_ptr_array_add(files, file);
+        if (!dnf_repo_loader_get_stamp(file->filename, &file->size, &file->inode, &file->mtime) ||
+            file->size != size || file->inode != inode || file->mtime != mtime) {
+            g_debug("%s changed, not using %s", file->filename, cache_fn);
+            g_variant_iter_free(iter);
+            return NULL;
+        }
+        file->data = g_strdup(data);
+    }
+    g_variant_iter_free(iter);
+    return static_cast<GPtrArray *>(g_steal_pointer(&files));
+}
+
+/**
+ * dnf_repo_loader_cache_save:
+ *
+ * Writes the snapshot of the loaded .repo files. The files may contain
+ * credentials, so the snapshot is only readable by the owner. Failing to
+ * write it is not fatal, the files are just parsed again next time.
+ **/
+static void
+dnf_repo_loader_cache_save(const gchar *cache_fn,
+                           const gchar *repo_path,
+                           gint64 dir_mtime,
+                           GPtrArray *files)
+{
+    gint fd;
+    GVariantBuilder builder;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GOutputStream) stream = NULL;
+    g_autoptr(GVariant) snapshot = NULL;
+    g_autofree gchar *tmp_fn = g_strdup_printf("%s.XXXXXX", cache_fn);
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sttxs)"));
+    for (guint i = 0; i < files->len; i++) {
+        auto file = static_cast<DnfRepoLoaderFile *>(g_ptr_array_index(files, i));
+        g_autofree gchar *basename = g_path_get_basename(file->filename);
+        g_variant_builder_add(&builder, "(sttxs)",
+                              basename, file->size, file->inode, file->mtime, file->data);
+    }
+    snapshot = g_variant_ref_sink(g_variant_new("(ssxa(sttxs))",
+                                                DNF_REPO_LOADER_CACHE_VERSION,
+                                                repo_path,
+                                                dir_mtime,
+                                                &builder));
+
+    fd = g_mkstemp_full(tmp_fn, O_WRONLY | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        g_debug("failed to create %s: %s", tmp_fn, g_strerror(errno));
+        return;
+    }
+    stream = g_unix_output_stream_new(fd, TRUE);
+    if (!g_output_stream_write_all(stream,
+                                   g_variant_get_data(snapshot),
+                                   g_variant_get_size(snapshot),
+                                   NULL, NULL, &error) ||
+        !g_output_stream_close(stream, NULL, &error)) {
+        g_debug("failed to write %s: %s", tmp_fn, error->message);
+        g_unlink(tmp_fn);
+        return;
+    }
+    if (g_rename(tmp_fn, cache_fn) != 0) {
+        g_debug("failed to rename %s: %s", tmp_fn, g_strerror(errno));
+        g_unlink(tmp_fn);
+    }
 }
 
 /**
@@ -359,28 +542,26 @@ dnf_repo_loader_repo_parse_id(DnfRepoLoader *self,
  **/
 static gboolean
 dnf_repo_loader_repo_parse(DnfRepoLoader *self,
-                           const gchar *filename,
+                           DnfRepoLoaderFile *file,
                            GError **error)
 {
     gboolean ret = TRUE;
     guint i;
     g_auto(GStrv) groups = NULL;
-    g_autoptr(GKeyFile) keyfile = NULL;
 
-    /* load non-standard keyfile */
-    keyfile = dnf_repo_loader_load_multiline_key_file(filename, error);
-    if (keyfile == NULL) {
-        g_prefix_error(error, "Failed to load %s: ", filename);
+    /* non-standard keyfile failed to load */
+    if (file->keyfile == NULL) {
+        g_propagate_error(error, static_cast<GError *>(g_steal_pointer(&file->error)));
         return FALSE;
     }
 
     /* save all the repos listed in the file */
-    groups = g_key_file_get_groups(keyfile, NULL);
+    groups = g_key_file_get_groups(file->keyfile, NULL);
     for (i = 0; groups[i] != NULL; i++) {
         ret = dnf_repo_loader_repo_parse_id(self,
                                             groups[i],
-                                            filename,
-                                            keyfile,
+                                            file->filename,
+                                            file->keyfile,
                                             error);
         if (!ret)
             return FALSE;
@@ -388,16 +569,59 @@ dnf_repo_loader_repo_parse(DnfRepoLoader *self,
     return TRUE;
 }
 
+/**
+ * dnf_repo_loader_list_files:
+ *
+ * Finds all the .repo files in @repo_path, noting their stamps before
+ * anything is read.
+ **/
+static GPtrArray *
+dnf_repo_loader_list_files(const gchar *repo_path, GError **error)
+{
+    const gchar *file;
+    g_autoptr(GDir) dir = NULL;
+    g_autoptr(GPtrArray) files = NULL;
+
+    /* open dir */
+    dir = g_dir_open(repo_path, 0, error);
+    if (dir == NULL)
+        return NULL;
+
+    /* find all the .repo files */
+    files = g_ptr_array_new_with_free_func((GDestroyNotify) dnf_repo_loader_file_free);
+    while ((file = g_dir_read_name(dir)) != NULL) {
+        DnfRepoLoaderFile *tmp;
+        if (!g_str_has_suffix(file, ".repo"))
+            continue;
+        tmp = g_slice_new0(DnfRepoLoaderFile);
+        tmp->filename = g_build_filename(repo_path, file, NULL);
+        tmp->mtime = -1;
+        dnf_repo_loader_get_stamp(tmp->filename, &tmp->size, &tmp->inode, &tmp->mtime);
+        g_ptr_array_add(files, tmp);
+    }
+    return static_cast<GPtrArray *>(g_steal_pointer(&files));
+}
+
 /**
  * dnf_repo_loader_refresh:
+ *
+ * The .repo files are read and loaded in parallel. When a cache directory
+ * is set, their normalized contents are also kept in a snapshot that is
+ * used for as long as neither the directory nor any of the files change.
  */
 static gboolean
 dnf_repo_loader_refresh(DnfRepoLoader *self, GError **error)
 {
     DnfRepoLoaderPrivate *priv = GET_PRIVATE(self);
-    const gchar *file;
+    const gchar *cache_dir;
     const gchar *repo_path;
-    g_autoptr(GDir) dir = NULL;
+    gboolean have_dir_stamp;
+    gboolean from_cache = FALSE;
+    guint64 dir_size;
+    guint64 dir_inode;
+    gint64 dir_mtime;
+    g_autofree gchar *cache_fn = NULL;
+    g_autoptr(GPtrArray) files = NULL;
 
     /* no longer loaded */
     dnf_repo_loader_invalidate(self);
@@ -407,22 +631,61 @@ dnf_repo_loader_refresh(DnfRepoLoader *self, GError **error)
     if (!dnf_context_setup_enrollments(priv->context, error))
         return FALSE;
 
-    /* open dir */
+    /* try the snapshot first, the directory has to be stat-ed before
+     * it is read so changes while we are loading are never cached */
     repo_path = dnf_context_get_repo_dir(priv->context);
-    dir = g_dir_open(repo_path, 0, error);
-    if (dir == NULL)
-        return FALSE;
+    cache_dir = dnf_context_get_cache_dir(priv->context);
+    have_dir_stamp = repo_path != NULL &&
+                     dnf_repo_loader_get_stamp(repo_path, &dir_size, &dir_inode, &dir_mtime);
+    if (cache_dir != NULL && have_dir_stamp) {
+        cache_fn = g_build_filename(cache_dir, DNF_REPO_LOADER_CACHE_FILENAME, NULL);
+        files = dnf_repo_loader_cache_load(cache_fn, repo_path, dir_mtime);
+        from_cache = files != NULL;
+        if (from_cache)
+            g_debug("using %s", cache_fn);
+    }
+    if (files == NULL) {
+        files = dnf_repo_loader_list_files(repo_path, error);
+        if (files == NULL)
+            return FALSE;
+    }
 
-    /* find all the .repo files */
-    while ((file = g_dir_read_name(dir)) != NULL) {
-        g_autofree gchar *path_tmp = NULL;
-        if (!g_str_has_suffix(file, ".repo"))
-            continue;
-        path_tmp = g_build_filename(repo_path, file, NULL);
-        if (!dnf_repo_loader_repo_parse(self, path_tmp, error))
+    /* read and load all the keyfiles; DnfRepo is not thread safe, so the
+     * repos themselves are set up in this thread afterwards */
+    if (files->len > 1) {
+        guint nthreads = MIN(g_get_num_processors(), files->len);
+        GThreadPool *thread_pool = g_thread_pool_new(dnf_repo_loader_load_file_cb, NULL, nthreads,
+                                                     FALSE, NULL);
+        for (guint i = 0; i < files->len; i++) {
+            gpointer file = g_ptr_array_index(files, i);
+            if (thread_pool == NULL || !g_thread_pool_push(thread_pool, file, NULL))
+                dnf_repo_loader_load_file_cb(file, NULL);
+        }
+        if (thread_pool != NULL)
+            g_thread_pool_free(thread_pool, FALSE, TRUE);
+    } else if (files->len == 1) {
+        dnf_repo_loader_load_file_cb(g_ptr_array_index(files, 0), NULL);
+    }
+
+    /* save all the repos listed in the files */
+    for (guint i = 0; i < files->len; i++) {
+        auto file = static_cast<DnfRepoLoaderFile *>(g_ptr_array_index(files, i));
+        if (!dnf_repo_loader_repo_parse(self, file, error))
             return FALSE;
     }
 
+    /* files that could not be stat-ed would never match the snapshot */
+    if (cache_fn != NULL && !from_cache) {
+        gboolean cacheable = TRUE;
+        for (guint i = 0; i < files->len; i++) {
+            auto file = static_cast<DnfRepoLoaderFile *>(g_ptr_array_index(files, i));
+            if (file->mtime < 0)
+                cacheable = FALSE;
+        }
+        if (cacheable)
+            dnf_repo_loader_cache_save(cache_fn, repo_path, dir_mtime, files);
+    }
+
     /* add any DVD repos */
     if (!dnf_repo_loader_get_repos_removable(self, error))
         return FALSE;
@@ -47,6 +47,25 @@
 #include "dnf-types.h"
 #include "dnf-utils.h"
 
+/* Values parsed from the repo group of the keyfile; never modified, but
+ * dropped whenever the keyfile is replaced or changed */
+typedef struct
+{
+    gint             skip_if_unavailable;   /* -1 if unset */
+    guint            cost;                  /* 0 if unset */
+    guint            metadata_expire;       /* seconds */
+    gchar          **baseurls;
+    gchar           *mirrorlisturl;
+    gchar           *metalinkurl;
+    gchar          **gpgkeys;
+    gboolean         gpgcheck_pkgs;
+    gboolean         gpgcheck_md;
+    gchar          **exclude_packages;
+    gchar           *proxy;                 /* NULL to use the context one */
+    gchar           *proxy_usr_pwd;
+    gchar           *usr_pwd;
+} DnfRepoConfig;
+
 typedef struct
 {
     DnfRepoEnabled   enabled;
@@ -69,8 +88,12 @@ typedef struct
     gint64           timestamp_modified;    /* µs */
     GError          *last_check_error;
     GKeyFile        *keyfile;
+    DnfRepoConfig   *config;                /* parsed keyfile, or NULL */
     GHashTable      *filenames_md;          /* key:filename */
-    DnfContext      *context;               /* weak reference */
+    GHashTable      *handle_opts;           /* key:LrHandleOption value:applied */
+    DnfContext      *context;               /* weak reference, NULL for copies */
+    gchar           *http_proxy;            /* of the context, for copies */
+    gboolean         deltarpm;              /* of the context, for copies */
     DnfRepoKind      kind;
     HyRepo           repo;
     LrHandle        *repo_handle;
@@ -81,6 +104,35 @@ typedef struct
 G_DEFINE_TYPE_WITH_PRIVATE(DnfRepo, dnf_repo, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (static_cast<DnfRepoPrivate *>(dnf_repo_get_instance_private (o)))
 
+/**
+ * dnf_repo_config_free:
+ */
+static void
+dnf_repo_config_free(DnfRepoConfig *config)
+{
+    g_strfreev(config->baseurls);
+    g_free(config->mirrorlisturl);
+    g_free(config->metalinkurl);
+    g_strfreev(config->gpgkeys);
+    g_strfreev(config->exclude_packages);
+    g_free(config->proxy);
+    g_free(config->proxy_usr_pwd);
+    g_free(config->usr_pwd);
+    g_slice_free(DnfRepoConfig, config);
+}
+
+/**
+ * dnf_repo_invalidate_config:
+ *
+ * Drops the parsed keyfile values, they get re-read on the next use.
+ */
+static void
+dnf_repo_invalidate_config(DnfRepo *repo)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    g_clear_pointer(&priv->config, dnf_repo_config_free);
+}
+
 /**
  * dnf_repo_finalize:
  **/
@@ -100,7 +152,9 @@ dnf_repo_finalize(GObject *object)
     g_free(priv->packages_tmp);
     g_free(priv->keyring);
     g_free(priv->keyring_tmp);
+    g_free(priv->http_proxy);
     g_hash_table_unref(priv->filenames_md);
+    g_hash_table_unref(priv->handle_opts);
     g_clear_error(&priv->last_check_error);
     if (priv->repo_result != NULL)
         lr_result_free(priv->repo_result);
@@ -110,6 +164,7 @@ dnf_repo_finalize(GObject *object)
         hy_repo_free(priv->repo);
     if (priv->keyfile != NULL)
         g_key_file_unref(priv->keyfile);
+    dnf_repo_invalidate_config(repo);
     if (priv->context != NULL)
         g_object_remove_weak_pointer(G_OBJECT(priv->context),
                                      (void **) &priv->context);
@@ -129,6 +184,8 @@ dnf_repo_init(DnfRepo *repo)
     priv->repo_result = lr_result_init();
     priv->filenames_md = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                g_free, g_free);
+    priv->handle_opts = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                              NULL, g_free);
     priv->required = FALSE;  /* This is the original default which we're
                               * keeping for compatibility.
                               */
@@ -751,6 +808,7 @@ dnf_repo_set_keyfile(DnfRepo *repo, GKeyFile *keyfile)
     if (priv->keyfile != NULL)
         g_key_file_unref(priv->keyfile);
     priv->keyfile = g_key_file_ref(keyfile);
+    dnf_repo_invalidate_config(repo);
 }
 
 /**
@@ -896,82 +954,259 @@ dnf_repo_get_boolean(GKeyFile *keyfile,
     return FALSE;
 }
 
-/* Initialize (or potentially reset) repo & LrHandle from keyfile values. */
-static gboolean
-dnf_repo_set_keyfile_data(DnfRepo *repo, GError **error)
+/**
+ * dnf_repo_config_new:
+ *
+ * Parses the keyfile group of the repo into a new #DnfRepoConfig.
+ */
+static DnfRepoConfig *
+dnf_repo_config_new(DnfRepo *repo, GError **error)
 {
     DnfRepoPrivate *priv = GET_PRIVATE(repo);
-    guint cost;
+    DnfRepoConfig *config = g_slice_new0(DnfRepoConfig);
     g_autofree gchar *metadata_expire_str = NULL;
     g_autofree gchar *mirrorlist = NULL;
-    g_autofree gchar *mirrorlisturl = NULL;
-    g_autofree gchar *metalinkurl = NULL;
-    g_autofree gchar *proxy = NULL;
     g_autofree gchar *tmp_strval = NULL;
     g_autofree gchar *pwd = NULL;
     g_autofree gchar *usr = NULL;
-    g_autofree gchar *usr_pwd = NULL;
-    g_autofree gchar *usr_pwd_proxy = NULL;
-    g_auto(GStrv) baseurls;
 
-    g_debug("setting keyfile data for %s", priv->id);
+    g_debug("parsing keyfile data for %s", priv->id);
 
     /* skip_if_unavailable is optional */
-    if (g_key_file_has_key(priv->keyfile, priv->id, "skip_if_unavailable", NULL)) {
-        if (dnf_repo_get_boolean(priv->keyfile, priv->id, "skip_if_unavailable", NULL))
-            priv->required = FALSE;
-        else
-            priv->required = TRUE;
-    }
+    config->skip_if_unavailable = -1;
+    if (g_key_file_has_key(priv->keyfile, priv->id, "skip_if_unavailable", NULL))
+        config->skip_if_unavailable =
+            dnf_repo_get_boolean(priv->keyfile, priv->id, "skip_if_unavailable", NULL);
 
     /* cost is optional */
-    cost = g_key_file_get_integer(priv->keyfile, priv->id, "cost", NULL);
-    if (cost != 0)
-        dnf_repo_set_cost(repo, cost);
+    config->cost = g_key_file_get_integer(priv->keyfile, priv->id, "cost", NULL);
 
     /* baseurl is optional; if missing, unset it */
-    baseurls = g_key_file_get_string_list(priv->keyfile, priv->id, "baseurl", NULL, NULL);
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_URLS, baseurls))
-        return FALSE;
+    config->baseurls = g_key_file_get_string_list(priv->keyfile, priv->id, "baseurl", NULL, NULL);
 
     /* metadata_expire is optional, if shown, we parse the string to add the time */
     metadata_expire_str = g_key_file_get_string(priv->keyfile, priv->id, "metadata_expire", NULL);
     if (metadata_expire_str) {
-        guint metadata_expire;
-        if (!dnf_repo_parse_time_from_str(metadata_expire_str, &metadata_expire, error))
-            return FALSE;
-        dnf_repo_set_metadata_expire(repo, metadata_expire);
+        if (!dnf_repo_parse_time_from_str(metadata_expire_str, &config->metadata_expire, error)) {
+            dnf_repo_config_free(config);
+            return NULL;
+        }
     } else {
         /* default to 48h; this is in line with dnf's default */
-        dnf_repo_set_metadata_expire(repo, 60 * 60 * 48);
+        config->metadata_expire = 60 * 60 * 48;
     }
 
     /* the "mirrorlist" entry could be either a real mirrorlist, or a metalink entry */
     mirrorlist = g_key_file_get_string(priv->keyfile, priv->id, "mirrorlist", NULL);
     if (mirrorlist) {
         if (strstr(mirrorlist, "metalink"))
-            metalinkurl = static_cast<gchar *>(g_steal_pointer(&mirrorlist));
+            config->metalinkurl = static_cast<gchar *>(g_steal_pointer(&mirrorlist));
         else /* it really is a mirrorlist */
-            mirrorlisturl = static_cast<gchar *>(g_steal_pointer(&mirrorlist));
+            config->mirrorlisturl = static_cast<gchar *>(g_steal_pointer(&mirrorlist));
     }
 
     /* let "metalink" entry override metalink-as-mirrorlist entry */
     if (g_key_file_has_key(priv->keyfile, priv->id, "metalink", NULL)) {
-        g_free(metalinkurl);
-        metalinkurl = g_key_file_get_string(priv->keyfile, priv->id, "metalink", NULL);
+        g_free(config->metalinkurl);
+        config->metalinkurl = g_key_file_get_string(priv->keyfile, priv->id, "metalink", NULL);
+    }
+
+    /* gpgkey is optional for gpgcheck=1, but required for repo_gpgcheck=1 */
+    tmp_strval = g_key_file_get_string(priv->keyfile, priv->id, "gpgkey", NULL);
+    if (tmp_strval) {
+        config->gpgkeys = g_strsplit_set(tmp_strval, " ,", -1);
+        g_free(g_steal_pointer (&tmp_strval));
+        /* Canonicalize the empty list to NULL for ease of checking elsewhere */
+        if (config->gpgkeys && !*config->gpgkeys)
+            g_strfreev(static_cast<gchar **>(g_steal_pointer(&config->gpgkeys)));
+    }
+    /* Currently, we don't have a global configuration file.  The way this worked in yum
+     * is that the yum package enabled gpgcheck=1 by default in /etc/yum.conf.  Basically,
+     * I don't think many people changed that.  It's just saner to disable it in the individual
+     * repo files as required.  To claim compatibility with yum repository files, I think
+     * we need to basically hard code the yum.conf defaults here.
+     */
+    if (!g_key_file_has_key(priv->keyfile, priv->id, "gpgcheck", NULL))
+        config->gpgcheck_pkgs = TRUE;
+    else
+        config->gpgcheck_pkgs = dnf_repo_get_boolean(priv->keyfile, priv->id, "gpgcheck", NULL);
+    config->gpgcheck_md = dnf_repo_get_boolean(priv->keyfile, priv->id, "repo_gpgcheck", NULL);
+    if (config->gpgcheck_md && config->gpgkeys == NULL) {
+        g_set_error_literal(error,
+                            DNF_ERROR,
+                            DNF_ERROR_FILE_INVALID,
+                            "gpgkey not set, yet repo_gpgcheck=1");
+        dnf_repo_config_free(config);
+        return NULL;
+    }
+
+    tmp_strval = g_key_file_get_string(priv->keyfile, priv->id, "exclude", NULL);
+    if (tmp_strval) {
+        config->exclude_packages = g_strsplit_set(tmp_strval, " ,", -1);
+        g_free(g_steal_pointer (&tmp_strval));
+    }
+
+    /* proxy is optional, the context one is used when it is missing */
+    config->proxy = g_key_file_get_string(priv->keyfile, priv->id, "proxy", NULL);
+
+    /* both parts of the proxy auth are optional */
+    usr = g_key_file_get_string(priv->keyfile, priv->id, "proxy_username", NULL);
+    pwd = g_key_file_get_string(priv->keyfile, priv->id, "proxy_password", NULL);
+    config->proxy_usr_pwd = dnf_repo_get_username_password_string(usr, pwd);
+    g_free(g_steal_pointer(&usr));
+    g_free(g_steal_pointer(&pwd));
+
+    /* both parts of the HTTP auth are optional */
+    usr = g_key_file_get_string(priv->keyfile, priv->id, "username", NULL);
+    pwd = g_key_file_get_string(priv->keyfile, priv->id, "password", NULL);
+    config->usr_pwd = dnf_repo_get_username_password_string(usr, pwd);
+
+    return config;
+}
+
+/**
+ * dnf_repo_handle_opt_cached:
+ *
+ * Setting the mirror options also drops the mirrorlist and metalink librepo
+ * fetched for them, so they are set every time and never cached.
+ */
+static gboolean
+dnf_repo_handle_opt_cached(LrHandleOption option)
+{
+    switch (option) {
+    case LRO_URLS:
+    case LRO_MIRRORLISTURL:
+    case LRO_METALINKURL:
+        return FALSE;
+    default:
+        return TRUE;
+    }
+}
+
+/**
+ * dnf_repo_handle_opt_applied:
+ *
+ * Checks if the handle option was last set to the value serialized as @key.
+ * Options cached this way must never be set with plain lr_handle_setopt(),
+ * or the cache would go stale.
+ */
+static gboolean
+dnf_repo_handle_opt_applied(DnfRepo *repo, LrHandleOption option, const gchar *key)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    const gchar *applied;
+    if (!dnf_repo_handle_opt_cached(option))
+        return FALSE;
+    applied = static_cast<const gchar *>(g_hash_table_lookup(priv->handle_opts,
+                                                             GINT_TO_POINTER(option)));
+    return g_strcmp0(applied, key) == 0;
+}
+
+/**
+ * dnf_repo_handle_opt_remember:
+ *
+ * Records the value the handle option was set to, %NULL forgets it.
+ */
+static void
+dnf_repo_handle_opt_remember(DnfRepo *repo, LrHandleOption option, gchar *key)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    if (!dnf_repo_handle_opt_cached(option)) {
+        g_free(key);
+        return;
+    }
+    if (key == NULL)
+        g_hash_table_remove(priv->handle_opts, GINT_TO_POINTER(option));
+    else
+        g_hash_table_insert(priv->handle_opts, GINT_TO_POINTER(option), key);
+}
+
+static gboolean
+dnf_repo_handle_set_string(DnfRepo *repo, LrHandleOption option, const gchar *value, GError **error)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    g_autofree gchar *key = value != NULL ? g_strconcat("s:", value, NULL) : g_strdup("n");
+    if (dnf_repo_handle_opt_applied(repo, option, key))
+        return TRUE;
+    if (!lr_handle_setopt(priv->repo_handle, error, option, value)) {
+        dnf_repo_handle_opt_remember(repo, option, NULL);
+        return FALSE;
+    }
+    dnf_repo_handle_opt_remember(repo, option, static_cast<gchar *>(g_steal_pointer(&key)));
+    return TRUE;
+}
+
+static gboolean
+dnf_repo_handle_set_strv(DnfRepo *repo, LrHandleOption option, const gchar * const *value, GError **error)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    g_autofree gchar *key = NULL;
+    if (value != NULL) {
+        g_autofree gchar *joined = g_strjoinv("\n", const_cast<gchar **>(value));
+        key = g_strconcat("v:", joined, NULL);
+    } else {
+        key = g_strdup("n");
+    }
+    if (dnf_repo_handle_opt_applied(repo, option, key))
+        return TRUE;
+    if (!lr_handle_setopt(priv->repo_handle, error, option, value)) {
+        dnf_repo_handle_opt_remember(repo, option, NULL);
+        return FALSE;
+    }
+    dnf_repo_handle_opt_remember(repo, option, static_cast<gchar *>(g_steal_pointer(&key)));
+    return TRUE;
+}
+
+static gboolean
+dnf_repo_handle_set_long(DnfRepo *repo, LrHandleOption option, long value, GError **error)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    g_autofree gchar *key = g_strdup_printf("l:%ld", value);
+    if (dnf_repo_handle_opt_applied(repo, option, key))
+        return TRUE;
+    if (!lr_handle_setopt(priv->repo_handle, error, option, value)) {
+        dnf_repo_handle_opt_remember(repo, option, NULL);
+        return FALSE;
+    }
+    dnf_repo_handle_opt_remember(repo, option, static_cast<gchar *>(g_steal_pointer(&key)));
+    return TRUE;
+}
+
+/* Initialize (or potentially reset) repo & LrHandle from keyfile values.
+ * The keyfile is only parsed again after it changed, and handle options
+ * which already have the wanted value are not set again. */
+static gboolean
+dnf_repo_set_keyfile_data(DnfRepo *repo, GError **error)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    DnfRepoConfig *config;
+    const gchar *proxy;
+
+    if (priv->config == NULL) {
+        priv->config = dnf_repo_config_new(repo, error);
+        if (priv->config == NULL)
+            return FALSE;
     }
+    config = priv->config;
 
-    /* now set the final values (or unset them) */
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_MIRRORLISTURL, mirrorlisturl))
+    if (config->skip_if_unavailable != -1)
+        priv->required = !config->skip_if_unavailable;
+    if (config->cost != 0)
+        dnf_repo_set_cost(repo, config->cost);
+    dnf_repo_set_metadata_expire(repo, config->metadata_expire);
+
+    if (!dnf_repo_handle_set_strv(repo, LRO_URLS, config->baseurls, error))
+        return FALSE;
+    if (!dnf_repo_handle_set_string(repo, LRO_MIRRORLISTURL, config->mirrorlisturl, error))
         return FALSE;
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_METALINKURL, metalinkurl))
+    if (!dnf_repo_handle_set_string(repo, LRO_METALINKURL, config->metalinkurl, error))
         return FALSE;
 
     /* file:// */
-    if (baseurls != NULL && baseurls[0] != NULL &&
-        mirrorlisturl == NULL && metalinkurl == NULL) {
+    if (config->baseurls != NULL && config->baseurls[0] != NULL &&
+        config->mirrorlisturl == NULL && config->metalinkurl == NULL) {
         g_autofree gchar *url = NULL;
-        url = lr_prepend_url_protocol(baseurls[0]);
+        url = lr_prepend_url_protocol(config->baseurls[0]);
         if (url != NULL && strncasecmp(url, "file://", 7) == 0) {
             if (g_strstr_len(url, -1, "$testdatadir") == NULL)
                 priv->kind = DNF_REPO_KIND_LOCAL;
@@ -980,7 +1215,7 @@ dnf_repo_set_keyfile_data(DnfRepo *repo, GError **error)
     }
 
     /* set location if currently unset */
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_LOCAL, 0L))
+    if (!dnf_repo_handle_set_long(repo, LRO_LOCAL, 0L, error))
         return FALSE;
 
     if (priv->location == NULL) {
@@ -1005,64 +1240,24 @@ dnf_repo_set_keyfile_data(DnfRepo *repo, GError **error)
         dnf_repo_set_location_tmp(repo, tmp->str);
     }
 
-    /* gpgkey is optional for gpgcheck=1, but required for repo_gpgcheck=1 */
     g_strfreev(priv->gpgkeys);
-    tmp_strval = g_key_file_get_string(priv->keyfile, priv->id, "gpgkey", NULL);
-    if (tmp_strval) {
-        priv->gpgkeys = g_strsplit_set(tmp_strval, " ,", -1);
-        g_free(g_steal_pointer (&tmp_strval));
-        /* Canonicalize the empty list to NULL for ease of checking elsewhere */
-        if (priv->gpgkeys && !*priv->gpgkeys)
-            g_strfreev(static_cast<gchar **>(g_steal_pointer(&priv->gpgkeys)));
-    }
-    /* Currently, we don't have a global configuration file.  The way this worked in yum
-     * is that the yum package enabled gpgcheck=1 by default in /etc/yum.conf.  Basically,
-     * I don't think many people changed that.  It's just saner to disable it in the individual
-     * repo files as required.  To claim compatibility with yum repository files, I think
-     * we need to basically hard code the yum.conf defaults here.
-     */
-    if (!g_key_file_has_key(priv->keyfile, priv->id, "gpgcheck", NULL))
-        priv->gpgcheck_pkgs = TRUE;
-    else
-        priv->gpgcheck_pkgs = dnf_repo_get_boolean(priv->keyfile, priv->id, "gpgcheck", NULL);
-    priv->gpgcheck_md = dnf_repo_get_boolean(priv->keyfile, priv->id, "repo_gpgcheck", NULL);
-    if (priv->gpgcheck_md && priv->gpgkeys == NULL) {
-        g_set_error_literal(error,
-                            DNF_ERROR,
-                            DNF_ERROR_FILE_INVALID,
-                            "gpgkey not set, yet repo_gpgcheck=1");
-        return FALSE;
-    }
-
-    /* XXX: setopt() expects a long, so we need a long on the stack */
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_GPGCHECK, (long)priv->gpgcheck_md))
+    priv->gpgkeys = g_strdupv(config->gpgkeys);
+    priv->gpgcheck_pkgs = config->gpgcheck_pkgs;
+    priv->gpgcheck_md = config->gpgcheck_md;
+    if (!dnf_repo_handle_set_long(repo, LRO_GPGCHECK, (long)priv->gpgcheck_md, error))
         return FALSE;
 
-    tmp_strval = g_key_file_get_string(priv->keyfile, priv->id, "exclude", NULL);
-    if (tmp_strval) {
-        priv->exclude_packages = g_strsplit_set(tmp_strval, " ,", -1);
-        g_free(g_steal_pointer (&tmp_strval));
-    }
+    g_strfreev(priv->exclude_packages);
+    priv->exclude_packages = g_strdupv(config->exclude_packages);
 
-    /* proxy is optional */
-    proxy = g_key_file_get_string(priv->keyfile, priv->id, "proxy", NULL);
+    proxy = config->proxy;
     if (proxy == NULL)
-        proxy = g_strdup(dnf_context_get_http_proxy(priv->context));
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_PROXY, proxy))
+        proxy = priv->context != NULL ? dnf_context_get_http_proxy(priv->context) : priv->http_proxy;
+    if (!dnf_repo_handle_set_string(repo, LRO_PROXY, proxy, error))
         return FALSE;
-
-    /* both parts of the proxy auth are optional */
-    usr = g_key_file_get_string(priv->keyfile, priv->id, "proxy_username", NULL);
-    pwd = g_key_file_get_string(priv->keyfile, priv->id, "proxy_password", NULL);
-    usr_pwd_proxy = dnf_repo_get_username_password_string(usr, pwd);
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_PROXYUSERPWD, usr_pwd_proxy))
+    if (!dnf_repo_handle_set_string(repo, LRO_PROXYUSERPWD, config->proxy_usr_pwd, error))
         return FALSE;
-
-    /* both parts of the HTTP auth are optional */
-    usr = g_key_file_get_string(priv->keyfile, priv->id, "username", NULL);
-    pwd = g_key_file_get_string(priv->keyfile, priv->id, "password", NULL);
-    usr_pwd = dnf_repo_get_username_password_string(usr, pwd);
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_USERPWD, usr_pwd))
+    if (!dnf_repo_handle_set_string(repo, LRO_USERPWD, config->usr_pwd, error))
         return FALSE;
     return TRUE;
 }
@@ -1265,6 +1460,7 @@ dnf_repo_check_internal(DnfRepo *repo,
         "updateinfo",
         "appstream",
         "appstream-icons",
+        NULL,   /* prestodelta */
         NULL};
     const gchar *tmp;
     gboolean ret;
@@ -1297,14 +1493,18 @@ dnf_repo_check_internal(DnfRepo *repo,
         return FALSE;
     }
 
+    /* deltas are only worth their metadata when they are used */
+    if (priv->context != NULL ? dnf_context_get_deltarpm(priv->context) : priv->deltarpm)
+        download_list[G_N_ELEMENTS(download_list) - 2] = "prestodelta";
+
     /* Yum metadata */
     dnf_state_action_start(state, DNF_STATE_ACTION_LOADING_CACHE, NULL);
     urls[0] = priv->location;
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_URLS, urls))
+    if (!dnf_repo_handle_set_strv(repo, LRO_URLS, urls, error))
         return FALSE;
     if (!lr_handle_setopt(priv->repo_handle, error, LRO_DESTDIR, priv->location))
         return FALSE;
-    if (!lr_handle_setopt(priv->repo_handle, error, LRO_LOCAL, 1L))
+    if (!dnf_repo_handle_set_long(repo, LRO_LOCAL, 1L, error))
         return FALSE;
     if (!lr_handle_setopt(priv->repo_handle, error, LRO_CHECKSUM, 1L))
         return FALSE;
@@ -1392,6 +1592,13 @@ dnf_repo_check_internal(DnfRepo *repo,
                             g_strdup("updateinfo"),
                             g_strdup(tmp));
     }
+    tmp = lr_yum_repo_path(yum_repo, "prestodelta");
+    if (tmp != NULL) {
+        hy_repo_set_string(priv->repo, HY_REPO_PRESTO_FN, tmp);
+        g_hash_table_insert(priv->filenames_md,
+                            g_strdup("prestodelta"),
+                            g_strdup(tmp));
+    }
     tmp = lr_yum_repo_path(yum_repo, "group");
     if (tmp != NULL) {
         g_hash_table_insert(priv->filenames_md,
@@ -1719,8 +1926,7 @@ dnf_repo_update(DnfRepo *repo,
     }
 
     g_debug("Attempting to update %s", priv->id);
-    ret = lr_handle_setopt(priv->repo_handle, error,
-                           LRO_LOCAL, 0L);
+    ret = dnf_repo_handle_set_long(repo, LRO_LOCAL, 0L, error);
     if (!ret)
         goto out;
     ret = lr_handle_setopt(priv->repo_handle, error,
@@ -1841,9 +2047,11 @@ dnf_repo_update(DnfRepo *repo,
     if (!ret)
         goto out;
 
-    /* signal that the vendor platform data is not resyned */
-    dnf_context_invalidate_full(priv->context, "updated repo cache",
-                                DNF_CONTEXT_INVALIDATE_FLAG_ENROLLMENT);
+    /* signal that the vendor platform data is not resyned, copies leave that
+     * to the thread of the context */
+    if (priv->context != NULL)
+        dnf_context_invalidate_full(priv->context, "updated repo cache",
+                                    DNF_CONTEXT_INVALIDATE_FLAG_ENROLLMENT);
 
     /* done */
     ret = dnf_state_done(state, error);
@@ -1885,6 +2093,7 @@ dnf_repo_set_data(DnfRepo *repo,
 {
     DnfRepoPrivate *priv = GET_PRIVATE(repo);
     g_key_file_set_string(priv->keyfile, priv->id, parameter, value);
+    dnf_repo_invalidate_config(repo);
     return TRUE;
 }
 
@@ -2025,6 +2234,8 @@ LrHandle *
 dnf_repo_get_lr_handle(DnfRepo *repo)
 {
     DnfRepoPrivate *priv = GET_PRIVATE (repo);
+    /* the caller may change any option, so don't trust what was applied */
+    g_hash_table_remove_all(priv->handle_opts);
     return priv->repo_handle;
 }
 
@@ -2070,32 +2281,32 @@ dnf_repo_download_package(DnfRepo *repo,
 }
 
 /**
- * dnf_repo_download_packages:
+ * dnf_repo_download_targets:
  * @repo: a #DnfRepo instance.
  * @packages: (element-type DnfPackage): an array of packages, must be from this repo
+ * @deltas: (element-type DnfPackageDelta) (allow-none): deltas to download instead of @packages
  * @directory: the destination directory.
  * @state: a #DnfState.
  * @error: a #GError or %NULL.
  *
- * Downloads multiple packages from a repo. The target filename will be
- * equivalent to `g_path_get_basename (dnf_package_get_location (pkg))`.
- *
- * Returns: %TRUE for success, %FALSE otherwise
- *
- * Since: 0.2.3
+ * Downloads either the packages or, when @deltas is set, the delta of every
+ * package. Deltas are optional, so a failed delta doesn't fail the whole
+ * download, its partial file is just removed.
  **/
-gboolean
-dnf_repo_download_packages(DnfRepo *repo,
-                           GPtrArray *packages,
-                           const gchar *directory,
-                           DnfState *state,
-                           GError **error)
+static gboolean
+dnf_repo_download_targets(DnfRepo *repo,
+                          GPtrArray *packages,
+                          GPtrArray *deltas,
+                          const gchar *directory,
+                          DnfState *state,
+                          GError **error)
 {
     DnfRepoPrivate *priv = GET_PRIVATE(repo);
     gboolean ret = FALSE;
     guint i;
     GSList *package_targets = NULL;
     GlobalDownloadData global_data = { 0, };
+    LrPackageDownloadFlag flags;
     g_autoptr(GError) error_local = NULL;
     g_autofree gchar *directory_slash = NULL;
 
@@ -2134,47 +2345,64 @@ dnf_repo_download_packages(DnfRepo *repo,
         directory_slash = g_build_filename(directory, "/", NULL);
     }
 
-    global_data.download_size = dnf_package_array_get_download_size(packages);
     for (i = 0; i < packages->len; i++) {
         auto pkg = static_cast<DnfPackage *>(packages->pdata[i]);
         PackageDownloadData *data;
         LrPackageTarget *target;
+        const gchar *location;
+        const gchar *baseurl;
         const unsigned char *checksum;
         int checksum_type;
+        guint64 downloadsize;
         g_autofree char *checksum_str = NULL;
 
-        g_debug("downloading %s to %s",
-                dnf_package_get_location(pkg),
-                directory_slash);
+        if (deltas != NULL) {
+            auto delta = static_cast<DnfPackageDelta *>(deltas->pdata[i]);
+            location = dnf_packagedelta_get_location(delta);
+            baseurl = dnf_packagedelta_get_baseurl(delta);
+            checksum = dnf_packagedelta_get_chksum(delta, &checksum_type);
+            downloadsize = dnf_packagedelta_get_downloadsize(delta);
+        } else {
+            location = dnf_package_get_location(pkg);
+            baseurl = dnf_package_get_baseurl(pkg);
+            checksum = dnf_package_get_chksum(pkg, &checksum_type);
+            downloadsize = dnf_package_get_downloadsize(pkg);
+        }
+        global_data.download_size += downloadsize;
+
+        g_debug("downloading %s to %s", location, directory_slash);
 
         data = g_slice_new0(PackageDownloadData);
         data->pkg = pkg;
         data->state = state;
         data->global_download_data = &global_data;
 
-        checksum = dnf_package_get_chksum(pkg, &checksum_type);
         checksum_str = hy_chksum_str(checksum, checksum_type);
 
         target = lr_packagetarget_new_v2(priv->repo_handle,
-                                         dnf_package_get_location(pkg),
+                                         location,
                                          directory_slash,
                                          dnf_repo_checksum_hy_to_lr(checksum_type),
                                          checksum_str,
-                                         dnf_package_get_downloadsize(pkg),
-                                         dnf_package_get_baseurl(pkg),
+                                         downloadsize,
+                                         baseurl,
                                          TRUE,
                                          package_download_update_state_cb,
                                          data,
                                          package_download_end_cb,
                                          mirrorlist_failure_cb,
                                          error);
-        if (target == NULL)
+        if (target == NULL) {
+            g_slice_free(PackageDownloadData, data);
             goto out;
+        }
 
         package_targets = g_slist_prepend(package_targets, target);
     }
 
-    ret = lr_download_packages(package_targets, LR_PACKAGEDOWNLOAD_FAILFAST, &error_local);
+    /* deltas are optional, don't stop on the first one that fails */
+    flags = deltas != NULL ? static_cast<LrPackageDownloadFlag>(0) : LR_PACKAGEDOWNLOAD_FAILFAST;
+    ret = lr_download_packages(package_targets, flags, &error_local);
     if (!ret) {
         if (g_error_matches(error_local,
                             LR_PACKAGE_DOWNLOADER_ERROR,
@@ -2192,6 +2420,18 @@ dnf_repo_download_packages(DnfRepo *repo,
         }
     }
 
+    /* the caller falls back to the full package when the delta is missing */
+    if (deltas != NULL) {
+        for (GSList *l = package_targets; l != NULL; l = l->next) {
+            auto target = static_cast<LrPackageTarget *>(l->data);
+            if (target->err == NULL)
+                continue;
+            g_debug("failed to download delta %s: %s", target->relative_url, target->err);
+            if (target->local_path != NULL)
+                g_unlink(target->local_path);
+        }
+    }
+
     ret = TRUE;
 out:
     lr_handle_setopt(priv->repo_handle, NULL, LRO_PROGRESSCB, NULL);
@@ -2202,6 +2442,110 @@ out:
     return ret;
 }
 
+/**
+ * dnf_repo_download_packages:
+ * @repo: a #DnfRepo instance.
+ * @packages: (element-type DnfPackage): an array of packages, must be from this repo
+ * @directory: the destination directory.
+ * @state: a #DnfState.
+ * @error: a #GError or %NULL.
+ *
+ * Downloads multiple packages from a repo. The target filename will be
+ * equivalent to `g_path_get_basename (dnf_package_get_location (pkg))`.
+ *
+ * Returns: %TRUE for success, %FALSE otherwise
+ *
+ * Since: 0.2.3
+ **/
+gboolean
+dnf_repo_download_packages(DnfRepo *repo,
+                           GPtrArray *packages,
+                           const gchar *directory,
+                           DnfState *state,
+                           GError **error)
+{
+    return dnf_repo_download_targets(repo, packages, NULL, directory, state, error);
+}
+
+/**
+ * dnf_repo_download_deltas:
+ * @repo: a #DnfRepo instance.
+ * @packages: (element-type DnfPackage): an array of packages, must be from this repo
+ * @deltas: (element-type DnfPackageDelta): the delta of each package in @packages
+ * @directory: the destination directory.
+ * @state: a #DnfState.
+ * @error: a #GError or %NULL.
+ *
+ * Downloads the delta RPMs of multiple packages from a repo. The target
+ * filename will be `g_path_get_basename (dnf_packagedelta_get_location (delta))`.
+ *
+ * A delta that fails to download does not fail the whole operation, its
+ * file is simply not present afterwards and the caller is expected to
+ * download the full package instead.
+ *
+ * Returns: %TRUE for success, %FALSE otherwise
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+dnf_repo_download_deltas(DnfRepo *repo,
+                         GPtrArray *packages,
+                         GPtrArray *deltas,
+                         const gchar *directory,
+                         DnfState *state,
+                         GError **error)
+{
+    g_return_val_if_fail(packages->len == deltas->len, FALSE);
+    return dnf_repo_download_targets(repo, packages, deltas, directory, state, error);
+}
+
+/**
+ * dnf_repo_copy:
+ * @repo: a #DnfRepo instance.
+ * @error: a #GError or %NULL
+ *
+ * Creates a repo from the same .repo file section and location, with its own
+ * keyfile and librepo handle and no loaded metadata, so it can be updated in
+ * another thread while @repo stays in use. The copy keeps the context settings
+ * it needs and no reference to the context, updating it doesn't invalidate the
+ * context.
+ *
+ * Returns: (transfer full): a new #DnfRepo, or %NULL for failure
+ **/
+DnfRepo *
+dnf_repo_copy(DnfRepo *repo, GError **error)
+{
+    DnfRepoPrivate *priv = GET_PRIVATE(repo);
+    g_autoptr(DnfRepo) copy = NULL;
+    g_autoptr(GKeyFile) keyfile = g_key_file_new();
+    g_autofree gchar *data = NULL;
+    gsize len;
+
+    data = g_key_file_to_data(priv->keyfile, &len, NULL);
+    if (!g_key_file_load_from_data(keyfile, data, len, G_KEY_FILE_KEEP_COMMENTS, error))
+        return NULL;
+
+    copy = dnf_repo_new(priv->context);
+    dnf_repo_set_kind(copy, priv->kind);
+    dnf_repo_set_keyfile(copy, keyfile);
+    dnf_repo_set_filename(copy, priv->filename);
+    dnf_repo_set_id(copy, priv->id);
+    if (priv->location != NULL)
+        dnf_repo_set_location(copy, priv->location);
+    if (!dnf_repo_setup(copy, error))
+        return NULL;
+    dnf_repo_set_enabled(copy, priv->enabled);
+    dnf_repo_set_required(copy, priv->required);
+
+    /* the context is only safe to use in its own thread */
+    DnfRepoPrivate *copy_priv = GET_PRIVATE(copy);
+    copy_priv->http_proxy = g_strdup(dnf_context_get_http_proxy(priv->context));
+    copy_priv->deltarpm = dnf_context_get_deltarpm(priv->context);
+    g_object_remove_weak_pointer(G_OBJECT(copy_priv->context), (void **) &copy_priv->context);
+    copy_priv->context = NULL;
+    return static_cast<DnfRepo *>(g_steal_pointer(&copy));
+}
+
 /**
  * dnf_repo_new:
  * @context: A #DnfContext instance
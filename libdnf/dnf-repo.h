@@ -196,6 +196,12 @@ gboolean         dnf_repo_download_packages     (DnfRepo              *repo,
                                                  const gchar          *directory,
                                                  DnfState             *state,
                                                  GError              **error);
+gboolean         dnf_repo_download_deltas       (DnfRepo              *repo,
+                                                 GPtrArray            *pkgs,
+                                                 GPtrArray            *deltas,
+                                                 const gchar          *directory,
+                                                 DnfState             *state,
+                                                 GError              **error);
 #endif
 
 G_END_DECLS
@@ -33,5 +33,6 @@ inline DnfRepoEnabled & operator|=(DnfRepoEnabled & a, DnfRepoEnabled b)
     return a = a | b;
 }
 
+DnfRepo *dnf_repo_copy(DnfRepo *repo, GError **error);
 
 #endif /* __DNF_REPO_HPP */
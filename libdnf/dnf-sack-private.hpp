@@ -26,16 +26,31 @@
 
 #include "dnf-sack.h"
 
+namespace libdnf {
+struct PackageSet;
+}
+
 typedef Id  (*dnf_sack_running_kernel_fn_t) (DnfSack    *sack);
 
 /**
- * @brief Store Map with only pkg_solvables to increase query performance
+ * @brief Components of an evr string, as pool_split_evr() returns them
+ */
+struct DnfEvrSplit {
+    unsigned long epoch;    ///< 0 when the evr has no epoch
+    Id version;
+    Id release;             ///< 0 when the evr has no release
+};
+
+/**
+ * @brief Store set with only pkg_solvables to increase query performance. The bitmap is shared
+ *        with pkg_solvables, not copied.
  *
  * @param sack p_sack:...
- * @param pkg_solvables Map with only all pkg_solvables
+ * @param pkg_solvables Set with only all pkg_solvables
  * @param pool_nsolvables Number of pool_nsolvables in pool. It used as checksum.
  */
-void dnf_sack_set_pkg_solvables(DnfSack *sack, Map *pkg_solvables, int pool_nsolvables);
+void dnf_sack_set_pkg_solvables(DnfSack *sack, const libdnf::PackageSet &pkg_solvables,
+                                int pool_nsolvables);
 
 /**
  * @brief Returns number of pool_nsolvables at time of creation of pkg_solvables. It can be used to
@@ -47,14 +62,47 @@ void dnf_sack_set_pkg_solvables(DnfSack *sack, Map *pkg_solvables, int pool_nsol
 int dnf_sack_get_pool_nsolvables(DnfSack *sack);
 
 /**
- * @brief Returns Map with every package solvable in pool
+ * @brief Returns set with every package solvable in pool. Copies of the set share its bitmap
+ *        until they are modified.
+ *
+ * @param sack p_sack:...
+ * @return const libdnf::PackageSet*
+ */
+const libdnf::PackageSet *dnf_sack_get_pkg_solvables(DnfSack *sack);
+
+/**
+ * @brief Returns evr split into epoch, version and release. The record is created on the first
+ *        request and kept for the lifetime of the sack. Not thread safe, it can add the version
+ *        and release strings into the pool, except on frozen sacks. Those only look up the
+ *        strings, a version or release that is not in the pool is returned as 0.
+ *
+ * @param sack p_sack:...
+ * @param evr Id of an evr string
+ * @return DnfEvrSplit
+ */
+DnfEvrSplit dnf_sack_get_evr_split(DnfSack *sack, Id evr);
+
+/**
+ * @brief Compare two evrs like pool_evrcmp() with EVRCMP_COMPARE does, using the split records
+ *
+ * @param sack p_sack:...
+ * @param evr1 Id of the first evr string
+ * @param evr2 Id of the second evr string
+ * @return int <0, 0, >0 if evr1 is older, equal or newer than evr2
+ */
+int dnf_sack_evr_split_cmp(DnfSack *sack, Id evr1, Id evr2);
+
+/**
+ * @brief Asserts that nothing added strings or relations to the pool of a frozen sack and that
+ *        its lazily computed state is still valid. Does nothing for sacks that are not frozen.
  *
  * @param sack p_sack:...
- * @return Map*
  */
-Map *dnf_sack_get_pkg_solvables(DnfSack *sack);
+void dnf_sack_check_frozen(DnfSack *sack);
 
 void         dnf_sack_make_provides_ready   (DnfSack    *sack);
+void         dnf_sack_flush_rewrites        (DnfSack    *sack);
+void         dnf_sack_prime_fileprovides    (DnfSack    *sack);
 Id           dnf_sack_running_kernel        (DnfSack    *sack);
 void         dnf_sack_recompute_considered  (DnfSack    *sack);
 Id           dnf_sack_last_solvable         (DnfSack    *sack);
@@ -0,0 +1,755 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/**
+ * SECTION:dnf-sack-server
+ * @short_description: Serve read-only queries from one prepared sack
+ * @include: libdnf.h
+ * @stability: Unstable
+ *
+ * A #DnfSackServer loads the installed packages and all enabled repos of a
+ * #DnfContext once, makes the provides ready and then answers queries of
+ * other processes over a local UNIX socket. Short lived clients get their
+ * answers without loading any .solv file themselves.
+ *
+ * The protocol is line based, fields are separated by tabs:
+ *
+ * |[
+ * query [<key> <cmp> <match>]...   filters as in hy_query_filter()
+ * subject <pattern>                as in hy_subject_get_best_solution()
+ * ping
+ * ]|
+ *
+ * where key and cmp are the decimal values of #_hy_key_name_e and
+ * #_hy_comparison_type_e. Each request is answered with "ok" and the number
+ * of packages followed by one NEVRA per line, or with "error" and a message.
+ * A connection may send any number of requests, each at most 4096 bytes long.
+ *
+ * The sack is rebuilt on the next request after the rpmdb or the repomd.xml
+ * of an enabled repo changed, or after the context was invalidated.
+ *
+ * See also: #DnfSack
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+
+#include "dnf-sack-private.hpp"
+#include "dnf-sack-server.h"
+#include "dnf-repo.h"
+#include "dnf-state.h"
+#include "dnf-types.h"
+#include "dnf-utils.h"
+#include "hy-package.h"
+#include "hy-query.h"
+#include "hy-subject.h"
+
+/* connections served at the same time, the others wait to be accepted */
+#define DNF_SACK_SERVER_MAX_THREADS     16
+/* longest request line, longer requests are refused and the connection closed */
+#define DNF_SACK_SERVER_MAX_REQUEST     4096
+/* every local user may query, the server only answers read-only requests */
+#define DNF_SACK_SERVER_SOCKET_MODE     0666
+
+typedef struct
+{
+    DnfContext      *context;       /* weak reference */
+    GSocketService  *service;
+    gchar           *socket_path;
+    gulong           invalidate_id;
+    volatile gint    invalidated;
+    GMutex           mutex;         /* protects the members below */
+    DnfSack         *sack;
+    GHashTable      *stamps;        /* key:filename value:mtime */
+    guint            generation;
+} DnfSackServerPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE(DnfSackServer, dnf_sack_server, G_TYPE_OBJECT)
+#define GET_PRIVATE(o) (static_cast<DnfSackServerPrivate *>(dnf_sack_server_get_instance_private (o)))
+
+/**
+ * dnf_sack_server_finalize:
+ **/
+static void
+dnf_sack_server_finalize(GObject *object)
+{
+    DnfSackServer *server = DNF_SACK_SERVER(object);
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+
+    dnf_sack_server_stop(server);
+    if (priv->context != NULL) {
+        g_signal_handler_disconnect(priv->context, priv->invalidate_id);
+        g_object_remove_weak_pointer(G_OBJECT(priv->context),
+                                     (void **) &priv->context);
+    }
+    if (priv->sack != NULL)
+        g_object_unref(priv->sack);
+    if (priv->stamps != NULL)
+        g_hash_table_unref(priv->stamps);
+    g_mutex_clear(&priv->mutex);
+
+    G_OBJECT_CLASS(dnf_sack_server_parent_class)->finalize(object);
+}
+
+/**
+ * dnf_sack_server_init:
+ **/
+static void
+dnf_sack_server_init(DnfSackServer *server)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    g_mutex_init(&priv->mutex);
+}
+
+/**
+ * dnf_sack_server_class_init:
+ **/
+static void
+dnf_sack_server_class_init(DnfSackServerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    object_class->finalize = dnf_sack_server_finalize;
+}
+
+/**
+ * dnf_sack_server_context_invalidate_cb:
+ **/
+static void
+dnf_sack_server_context_invalidate_cb(DnfContext *context,
+                                      const gchar *message,
+                                      DnfSackServer *server)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    g_debug("sack server invalidated: %s", message);
+    g_atomic_int_set(&priv->invalidated, TRUE);
+}
+
+/**
+ * dnf_sack_server_add_stamp:
+ **/
+static void
+dnf_sack_server_add_stamp(GHashTable *stamps, gchar *filename)
+{
+    struct stat st;
+    gint64 *mtime = g_new(gint64, 1);
+    if (stat(filename, &st) == 0)
+        *mtime = (gint64) st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+    else
+        *mtime = -1;
+    g_hash_table_insert(stamps, filename, mtime);
+}
+
+/**
+ * dnf_sack_server_get_stamps:
+ *
+ * Gets the modification times of the files the sack was built from.
+ **/
+static GHashTable *
+dnf_sack_server_get_stamps(DnfSackServer *server)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    GPtrArray *repos = dnf_context_get_repos(priv->context);
+    GHashTable *stamps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    dnf_sack_server_add_stamp(stamps,
+                              g_build_filename(dnf_context_get_install_root(priv->context),
+                                               "var/lib/rpm/Packages", NULL));
+    for (guint i = 0; repos != NULL && i < repos->len; i++) {
+        auto repo = static_cast<DnfRepo *>(g_ptr_array_index(repos, i));
+        if ((dnf_repo_get_enabled(repo) & DNF_REPO_ENABLED_PACKAGES) == 0)
+            continue;
+        dnf_sack_server_add_stamp(stamps,
+                                  g_build_filename(dnf_repo_get_location(repo),
+                                                   "repodata", "repomd.xml", NULL));
+    }
+    return stamps;
+}
+
+/**
+ * dnf_sack_server_stamps_equal:
+ **/
+static gboolean
+dnf_sack_server_stamps_equal(GHashTable *stamps1, GHashTable *stamps2)
+{
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    if (g_hash_table_size(stamps1) != g_hash_table_size(stamps2))
+        return FALSE;
+    g_hash_table_iter_init(&iter, stamps1);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        auto mtime = static_cast<gint64 *>(g_hash_table_lookup(stamps2, key));
+        if (mtime == NULL || *mtime != *static_cast<gint64 *>(value))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * dnf_sack_server_build_sack:
+ *
+ * Loads a sack the same way dnf_context_setup_sack() does, but without
+ * touching the sack of the context.
+ **/
+static DnfSack *
+dnf_sack_server_build_sack(DnfSackServer *server, GError **error)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    DnfContext *context = priv->context;
+    g_autofree gchar *solv_dir_real = NULL;
+    g_autofree gchar *usr_path = NULL;
+    g_autoptr(DnfSack) sack = NULL;
+    g_autoptr(DnfState) state = NULL;
+
+    solv_dir_real = dnf_realpath(dnf_context_get_solv_dir(context));
+    sack = dnf_sack_new();
+    dnf_sack_set_cachedir(sack, solv_dir_real);
+    dnf_sack_set_rootdir(sack, dnf_context_get_install_root(context));
+    if (!dnf_sack_setup(sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, error))
+        return NULL;
+    dnf_sack_set_installonly(sack, dnf_context_get_installonly_pkgs(context));
+    dnf_sack_set_installonly_limit(sack, dnf_context_get_installonly_limit(context));
+
+    /* add installed packages */
+    usr_path = g_build_filename(dnf_context_get_install_root(context), "usr", NULL);
+    if (g_file_test(usr_path, G_FILE_TEST_IS_DIR)) {
+        if (!dnf_sack_load_system_repo(sack, NULL, DNF_SACK_LOAD_FLAG_BUILD_CACHE, error))
+            return NULL;
+    }
+
+    /* add remote */
+    state = dnf_state_new();
+    if (!dnf_sack_add_repos(sack,
+                            dnf_context_get_repos(context),
+                            dnf_context_get_cache_age(context),
+                            DNF_SACK_ADD_FLAG_FILELISTS,
+                            state,
+                            error))
+        return NULL;
+
+    /* do all the lazy work now rather than in the first request */
+    dnf_sack_make_provides_ready(sack);
+    dnf_sack_flush_rewrites(sack);
+    dnf_sack_recompute_considered(sack);
+    return static_cast<DnfSack *>(g_steal_pointer(&sack));
+}
+
+/**
+ * dnf_sack_server_ensure_sack:
+ *
+ * Makes sure the sack is up to date. Must be called with the mutex held.
+ **/
+static gboolean
+dnf_sack_server_ensure_sack(DnfSackServer *server, GError **error)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    g_autoptr(GHashTable) stamps = NULL;
+    DnfSack *sack;
+
+    if (priv->context == NULL) {
+        g_set_error_literal(error,
+                            DNF_ERROR,
+                            DNF_ERROR_INTERNAL_ERROR,
+                            "context has been destroyed");
+        return FALSE;
+    }
+
+    /* anything changed since the sack was built */
+    stamps = dnf_sack_server_get_stamps(server);
+    if (g_atomic_int_compare_and_exchange(&priv->invalidated, TRUE, FALSE) ||
+        (priv->stamps != NULL && !dnf_sack_server_stamps_equal(priv->stamps, stamps))) {
+        g_clear_object(&priv->sack);
+    }
+    if (priv->sack != NULL)
+        return TRUE;
+
+    sack = dnf_sack_server_build_sack(server, error);
+    if (sack == NULL)
+        return FALSE;
+    priv->sack = sack;
+    if (priv->stamps != NULL)
+        g_hash_table_unref(priv->stamps);
+    priv->stamps = static_cast<GHashTable *>(g_steal_pointer(&stamps));
+    priv->generation++;
+    g_debug("sack server loaded generation %u", priv->generation);
+    return TRUE;
+}
+
+/**
+ * dnf_sack_server_parse_int:
+ *
+ * Parses a decimal number, rejecting empty strings and trailing garbage.
+ **/
+static gboolean
+dnf_sack_server_parse_int(const gchar *str, gint64 *value)
+{
+    gchar *endptr = NULL;
+    *value = g_ascii_strtoll(str, &endptr, 10);
+    return endptr != str && *endptr == '\0';
+}
+
+/**
+ * dnf_sack_server_run_query:
+ **/
+static HyQuery
+dnf_sack_server_run_query(DnfSack *sack, gchar **fields, GError **error)
+{
+    hy_autoquery HyQuery query = hy_query_create(sack);
+    guint nfields = g_strv_length(fields);
+
+    if (nfields % 3 != 0) {
+        g_set_error_literal(error,
+                            DNF_ERROR,
+                            DNF_ERROR_BAD_QUERY,
+                            "filters need a key, a comparison and a match");
+        return NULL;
+    }
+    for (guint i = 0; i < nfields; i += 3) {
+        gint64 keyname;
+        gint64 cmp_type;
+        const gchar *match = fields[i + 2];
+        gint64 match_num;
+
+        if (dnf_sack_server_parse_int(fields[i], &keyname) &&
+            dnf_sack_server_parse_int(fields[i + 1], &cmp_type)) {
+            /* numeric keys don't take strings */
+            if (hy_query_filter(query, keyname, cmp_type, match) == 0)
+                continue;
+            if (dnf_sack_server_parse_int(match, &match_num) &&
+                hy_query_filter_num(query, keyname, cmp_type, match_num) == 0)
+                continue;
+        }
+        g_set_error(error,
+                    DNF_ERROR,
+                    DNF_ERROR_BAD_QUERY,
+                    "invalid filter %s %s %s", fields[i], fields[i + 1], match);
+        return NULL;
+    }
+    return static_cast<HyQuery>(g_steal_pointer(&query));
+}
+
+/**
+ * dnf_sack_server_handle_request:
+ *
+ * Returns: the reply to one request line
+ **/
+static GString *
+dnf_sack_server_handle_request(DnfSackServer *server, const gchar *line)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    GString *reply = g_string_new(NULL);
+    HyQuery query = NULL;
+    g_auto(GStrv) fields = g_strsplit(line, "\t", -1);
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->mutex);
+
+    if (g_strcmp0(fields[0], "ping") == 0) {
+        g_string_append(reply, "ok\t0\n");
+        return reply;
+    }
+
+    if (!dnf_sack_server_ensure_sack(server, &error))
+        goto out;
+
+    if (g_strcmp0(fields[0], "query") == 0) {
+        query = dnf_sack_server_run_query(priv->sack, fields + 1, &error);
+    } else if (g_strcmp0(fields[0], "subject") == 0 && g_strv_length(fields) == 2) {
+        HySubject subject = hy_subject_create(fields[1]);
+        query = hy_subject_get_best_solution(subject, priv->sack, NULL, NULL,
+                                             FALSE, TRUE, TRUE, TRUE);
+        hy_subject_free(subject);
+    } else {
+        g_set_error(&error,
+                    DNF_ERROR,
+                    DNF_ERROR_BAD_QUERY,
+                    "invalid request %s", fields[0]);
+    }
+out:
+    if (query == NULL) {
+        /* the reply is a single line */
+        g_strdelimit(error->message, "\n", ' ');
+        g_string_append_printf(reply, "error\t%s\n", error->message);
+    } else {
+        g_autoptr(GPtrArray) pkgs = hy_query_run(query);
+        g_string_append_printf(reply, "ok\t%u\n", pkgs->len);
+        for (guint i = 0; i < pkgs->len; i++) {
+            auto pkg = static_cast<DnfPackage *>(g_ptr_array_index(pkgs, i));
+            g_string_append(reply, dnf_package_get_nevra(pkg));
+            g_string_append_c(reply, '\n');
+        }
+        hy_query_free(query);
+    }
+    return reply;
+}
+
+/**
+ * dnf_sack_server_read_request:
+ *
+ * Reads one request line of at most %DNF_SACK_SERVER_MAX_REQUEST bytes.
+ * The input buffer is never grown, so a client can't make the server
+ * allocate more than that.
+ *
+ * Returns: the line without the newline, or %NULL at the end of the input
+ * or on error
+ **/
+static gchar *
+dnf_sack_server_read_request(GDataInputStream *input, GError **error)
+{
+    GBufferedInputStream *buffered = G_BUFFERED_INPUT_STREAM(input);
+
+    while (TRUE) {
+        gsize available;
+        gssize nread;
+        const void *buffer = g_buffered_input_stream_peek_buffer(buffered, &available);
+
+        if (memchr(buffer, '\n', available) != NULL)
+            break;
+        if (available >= DNF_SACK_SERVER_MAX_REQUEST) {
+            g_set_error(error,
+                        DNF_ERROR,
+                        DNF_ERROR_BAD_QUERY,
+                        "request longer than %i bytes",
+                        DNF_SACK_SERVER_MAX_REQUEST);
+            return NULL;
+        }
+        nread = g_buffered_input_stream_fill(buffered, -1, NULL, error);
+        if (nread < 0)
+            return NULL;
+        /* the last line may lack the newline */
+        if (nread == 0)
+            break;
+    }
+    return g_data_input_stream_read_line(input, NULL, NULL, error);
+}
+
+/**
+ * dnf_sack_server_run_cb:
+ *
+ * Serves one connection in a thread of the socket service.
+ **/
+static gboolean
+dnf_sack_server_run_cb(GThreadedSocketService *service,
+                       GSocketConnection *connection,
+                       GObject *source_object,
+                       DnfSackServer *server)
+{
+    GOutputStream *output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    /* the server may be unreferenced while this connection is served */
+    g_autoptr(DnfSackServer) server_ref = DNF_SACK_SERVER(g_object_ref(server));
+    g_autoptr(GDataInputStream) input = NULL;
+
+    input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_buffered_input_stream_set_buffer_size(G_BUFFERED_INPUT_STREAM(input),
+                                            DNF_SACK_SERVER_MAX_REQUEST);
+    while (TRUE) {
+        g_autofree gchar *line = NULL;
+        g_autoptr(GError) error = NULL;
+        g_autoptr(GString) reply = NULL;
+
+        line = dnf_sack_server_read_request(input, &error);
+        if (line == NULL) {
+            if (g_error_matches(error, DNF_ERROR, DNF_ERROR_BAD_QUERY)) {
+                g_autofree gchar *message = g_strdup_printf("error\t%s\n", error->message);
+                g_output_stream_write_all(output, message, strlen(message), NULL, NULL, NULL);
+            }
+            if (error != NULL)
+                g_debug("failed to read request: %s", error->message);
+            break;
+        }
+        reply = dnf_sack_server_handle_request(server, line);
+        if (!g_output_stream_write_all(output, reply->str, reply->len,
+                                       NULL, NULL, &error)) {
+            g_debug("failed to write reply: %s", error->message);
+            break;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * dnf_sack_server_is_listening:
+ *
+ * Checks whether some server still accepts connections on @address.
+ **/
+static gboolean
+dnf_sack_server_is_listening(GSocketAddress *address)
+{
+    g_autoptr(GSocketClient) client = g_socket_client_new();
+    g_autoptr(GSocketConnection) connection = NULL;
+
+    connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
+    return connection != NULL;
+}
+
+/**
+ * dnf_sack_server_listen:
+ * @server: a #DnfSackServer instance.
+ * @socket_path: the path of the UNIX socket, e.g. "/run/dnf-sack.sock"
+ * @error: a #GError or %NULL
+ *
+ * Loads the sack and starts serving queries on @socket_path. A stale socket
+ * left behind by a previous server is replaced, but if another server still
+ * answers on @socket_path this fails with %G_IO_ERROR_ADDRESS_IN_USE. The
+ * socket is made accessible to all local users. Up to 16 connections are
+ * served in their own threads, requests are answered one at a time.
+ *
+ * The context must not be used by anything else while the server runs.
+ *
+ * Returns: %TRUE for success, %FALSE otherwise
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+dnf_sack_server_listen(DnfSackServer *server, const gchar *socket_path, GError **error)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    struct stat st;
+    gboolean ret;
+    g_autoptr(GSocketAddress) address = NULL;
+    g_autoptr(GSocketService) service = NULL;
+
+    g_return_val_if_fail(DNF_IS_SACK_SERVER(server), FALSE);
+    g_return_val_if_fail(socket_path != NULL, FALSE);
+
+    /* load everything before any client can connect */
+    g_mutex_lock(&priv->mutex);
+    ret = dnf_sack_server_ensure_sack(server, error);
+    g_mutex_unlock(&priv->mutex);
+    if (!ret)
+        return FALSE;
+
+    /* listening on the same path again replaces our own service */
+    if (g_strcmp0(priv->socket_path, socket_path) == 0)
+        dnf_sack_server_stop(server);
+
+    address = g_unix_socket_address_new(socket_path);
+    if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        if (dnf_sack_server_is_listening(address)) {
+            g_set_error(error,
+                        G_IO_ERROR,
+                        G_IO_ERROR_ADDRESS_IN_USE,
+                        "a server is already listening on %s",
+                        socket_path);
+            return FALSE;
+        }
+        g_unlink(socket_path);
+    }
+
+    service = g_threaded_socket_service_new(DNF_SACK_SERVER_MAX_THREADS);
+    if (!g_socket_listener_add_address(G_SOCKET_LISTENER(service),
+                                       address,
+                                       G_SOCKET_TYPE_STREAM,
+                                       G_SOCKET_PROTOCOL_DEFAULT,
+                                       NULL, NULL, error))
+        return FALSE;
+    if (g_chmod(socket_path, DNF_SACK_SERVER_SOCKET_MODE) != 0) {
+        int errsv = errno;
+        g_set_error(error,
+                    G_IO_ERROR,
+                    g_io_error_from_errno(errsv),
+                    "failed to set the mode of %s: %s",
+                    socket_path, g_strerror(errsv));
+        g_socket_listener_close(G_SOCKET_LISTENER(service));
+        g_unlink(socket_path);
+        return FALSE;
+    }
+
+    /* the handler goes away with the server, connections being served
+     * keep their own reference */
+    g_signal_connect_object(service, "run",
+                            G_CALLBACK(dnf_sack_server_run_cb), server,
+                            (GConnectFlags) 0);
+    g_socket_service_start(service);
+
+    dnf_sack_server_stop(server);
+    priv->service = static_cast<GSocketService *>(g_steal_pointer(&service));
+    priv->socket_path = g_strdup(socket_path);
+    return TRUE;
+}
+
+/**
+ * dnf_sack_server_stop:
+ * @server: a #DnfSackServer instance.
+ *
+ * Stops serving queries and removes the socket.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_sack_server_stop(DnfSackServer *server)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+
+    if (priv->service == NULL)
+        return;
+    g_socket_service_stop(priv->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(priv->service));
+    g_clear_object(&priv->service);
+    g_unlink(priv->socket_path);
+    g_clear_pointer(&priv->socket_path, g_free);
+}
+
+/**
+ * dnf_sack_server_get_generation:
+ * @server: a #DnfSackServer instance.
+ *
+ * Gets how many times the sack has been loaded, which grows every time the
+ * server notices the rpmdb or the metadata changed.
+ *
+ * Returns: the number of loaded sacks
+ *
+ * Since: 0.13.0
+ **/
+guint
+dnf_sack_server_get_generation(DnfSackServer *server)
+{
+    DnfSackServerPrivate *priv = GET_PRIVATE(server);
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->mutex);
+    return priv->generation;
+}
+
+/**
+ * dnf_sack_server_request:
+ * @socket_path: the path of the UNIX socket of a server
+ * @request: (array zero-terminated=1): the fields of the request, e.g.
+ *   { "query", "8", "256", "bash", NULL }
+ * @error: a #GError or %NULL
+ *
+ * Sends one request to a #DnfSackServer, possibly in another process.
+ *
+ * Returns: (transfer container) (element-type utf8): NEVRAs of the
+ *   matching packages, or %NULL on error
+ *
+ * Since: 0.13.0
+ **/
+GPtrArray *
+dnf_sack_server_request(const gchar *socket_path,
+                        const gchar * const *request,
+                        GError **error)
+{
+    guint64 count = 0;
+    gchar *endptr = NULL;
+    g_autofree gchar *line = NULL;
+    g_autofree gchar *status = NULL;
+    g_autoptr(GDataInputStream) input = NULL;
+    g_autoptr(GPtrArray) nevras = NULL;
+    g_autoptr(GSocketAddress) address = NULL;
+    g_autoptr(GSocketClient) client = NULL;
+    g_autoptr(GSocketConnection) connection = NULL;
+
+    g_return_val_if_fail(socket_path != NULL, NULL);
+    g_return_val_if_fail(request != NULL && request[0] != NULL, NULL);
+
+    /* fields are separated by tabs, requests by newlines */
+    for (guint i = 0; request[i] != NULL; i++) {
+        if (strpbrk(request[i], "\t\n") != NULL) {
+            g_set_error(error,
+                        DNF_ERROR,
+                        DNF_ERROR_BAD_QUERY,
+                        "invalid request field %s", request[i]);
+            return NULL;
+        }
+    }
+    line = g_strjoinv("\t", (gchar **) request);
+
+    client = g_socket_client_new();
+    address = g_unix_socket_address_new(socket_path);
+    connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, error);
+    if (connection == NULL)
+        return NULL;
+    if (!g_output_stream_write_all(g_io_stream_get_output_stream(G_IO_STREAM(connection)),
+                                   line, strlen(line), NULL, NULL, error))
+        return NULL;
+    if (!g_output_stream_write_all(g_io_stream_get_output_stream(G_IO_STREAM(connection)),
+                                   "\n", 1, NULL, NULL, error))
+        return NULL;
+
+    /* "ok <count>" or "error <message>" */
+    input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    status = g_data_input_stream_read_line(input, NULL, NULL, error);
+    if (status == NULL) {
+        if (error != NULL && *error == NULL)
+            g_set_error_literal(error,
+                                DNF_ERROR,
+                                DNF_ERROR_FAILED,
+                                "sack server closed the connection");
+        return NULL;
+    }
+    if (g_str_has_prefix(status, "error\t")) {
+        g_set_error_literal(error, DNF_ERROR, DNF_ERROR_FAILED, status + 6);
+        return NULL;
+    }
+    if (g_str_has_prefix(status, "ok\t"))
+        count = g_ascii_strtoull(status + 3, &endptr, 10);
+    if (endptr == NULL || endptr == status + 3 || *endptr != '\0') {
+        g_set_error(error,
+                    DNF_ERROR,
+                    DNF_ERROR_FAILED,
+                    "invalid reply %s", status);
+        return NULL;
+    }
+
+    nevras = g_ptr_array_new_with_free_func(g_free);
+    for (guint64 i = 0; i < count; i++) {
+        gchar *nevra = g_data_input_stream_read_line(input, NULL, NULL, error);
+        if (nevra == NULL) {
+            if (error != NULL && *error == NULL)
+                g_set_error_literal(error,
+                                    DNF_ERROR,
+                                    DNF_ERROR_FAILED,
+                                    "sack server closed the connection");
+            return NULL;
+        }
+        g_ptr_array_add(nevras, nevra);
+    }
+    return static_cast<GPtrArray *>(g_steal_pointer(&nevras));
+}
+
+/**
+ * dnf_sack_server_new:
+ * @context: a #DnfContext instance, already set up
+ *
+ * Creates a new #DnfSackServer for the installed packages and the enabled
+ * repos of @context.
+ *
+ * Returns: (transfer full): a #DnfSackServer
+ *
+ * Since: 0.13.0
+ **/
+DnfSackServer *
+dnf_sack_server_new(DnfContext *context)
+{
+    DnfSackServerPrivate *priv;
+    auto server = DNF_SACK_SERVER(g_object_new(DNF_TYPE_SACK_SERVER, NULL));
+    priv = GET_PRIVATE(server);
+    priv->context = context;
+    g_object_add_weak_pointer(G_OBJECT(priv->context), (void **) &priv->context);
+    priv->invalidate_id = g_signal_connect(context, "invalidate",
+                                           G_CALLBACK(dnf_sack_server_context_invalidate_cb),
+                                           server);
+    return DNF_SACK_SERVER(server);
+}
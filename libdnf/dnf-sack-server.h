@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __DNF_SACK_SERVER_H
+#define __DNF_SACK_SERVER_H
+
+#include <glib-object.h>
+
+#include "dnf-context.h"
+
+G_BEGIN_DECLS
+
+#define DNF_TYPE_SACK_SERVER (dnf_sack_server_get_type ())
+G_DECLARE_DERIVABLE_TYPE (DnfSackServer, dnf_sack_server, DNF, SACK_SERVER, GObject)
+
+struct _DnfSackServerClass
+{
+        GObjectClass            parent_class;
+        /*< private >*/
+        void (*_dnf_reserved1)  (void);
+        void (*_dnf_reserved2)  (void);
+        void (*_dnf_reserved3)  (void);
+        void (*_dnf_reserved4)  (void);
+        void (*_dnf_reserved5)  (void);
+        void (*_dnf_reserved6)  (void);
+        void (*_dnf_reserved7)  (void);
+        void (*_dnf_reserved8)  (void);
+};
+
+DnfSackServer   *dnf_sack_server_new            (DnfContext     *context);
+gboolean         dnf_sack_server_listen         (DnfSackServer  *server,
+                                                 const gchar    *socket_path,
+                                                 GError         **error);
+void             dnf_sack_server_stop           (DnfSackServer  *server);
+guint            dnf_sack_server_get_generation (DnfSackServer  *server);
+
+GPtrArray       *dnf_sack_server_request        (const gchar    *socket_path,
+                                                 const gchar * const *request,
+                                                 GError         **error);
+
+G_END_DECLS
+
+#endif /* __DNF_SACK_SERVER_H */
@@ -42,6 +42,8 @@
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
+#include <string>
+#include <unordered_map>
 
 extern "C" {
 #include <solv/evr.h>
@@ -55,7 +57,6 @@ extern "C" {
 #include <solv/repo_rpmdb.h>
 #include <solv/repo_solv.h>
 #include <solv/repo_write.h>
-#include <solv/solv_xfopen.h>
 #include <solv/solver.h>
 #include <solv/solverdebug.h>
 }
@@ -72,9 +73,11 @@ extern "C" {
 #include "sack/packageset.hpp"
 
 #include "utils/bgettext/bgettext-lib.h"
+#include "utils/evrcmp.hpp"
 
 #define DEFAULT_CACHE_ROOT "/var/cache/hawkey"
 #define DEFAULT_CACHE_USER "/var/tmp/hawkey"
+#define FILEPROVIDES_FN "fileprovides.list"
 
 typedef struct
 {
@@ -82,7 +85,7 @@ typedef struct
     Map                 *pkg_excludes;
     Map                 *pkg_includes;
     Map                 *repo_excludes;
-    Map                 *pkg_solvables;     /* Map representing only solvable pkgs of query */
+    libdnf::PackageSet  *pkg_solvables;     /* Set representing only solvable pkgs of query */
     int                  pool_nsolvables;   /* Number of nsolvables for creation of pkg_solvables*/
     Pool                *pool;
     Queue                installonly;
@@ -94,6 +97,14 @@ typedef struct
     gchar               *cache_dir;
     dnf_sack_running_kernel_fn_t  running_kernel_fn;
     guint                installonly_limit;
+    Queue                pending_fileprovides;      /* not yet written to the .solv caches */
+    Queue                pending_fileprovides_inst;
+    gboolean             rewrite_pending;
+    GSource             *rewrite_source;
+    std::unordered_map<Id, DnfEvrSplit> *evr_splits;    /* created on first use */
+    gboolean             frozen;
+    int                  frozen_nstrings;   /* pool size at dnf_sack_freeze() */
+    int                  frozen_nrels;
 } DnfSackPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(DnfSack, dnf_sack, G_TYPE_OBJECT)
@@ -112,6 +123,11 @@ dnf_sack_finalize(GObject *object)
     Repo *repo;
     int i;
 
+    /* the repos still reference their HyRepo, write what was deferred */
+    dnf_sack_flush_rewrites(sack);
+    queue_free(&priv->pending_fileprovides);
+    queue_free(&priv->pending_fileprovides_inst);
+
     FOR_REPOS(i, repo) {
         auto hrepo = static_cast<HyRepo>(repo->appdata);
         if (!hrepo)
@@ -125,7 +141,8 @@ dnf_sack_finalize(GObject *object)
     free_map_fully(priv->pkg_includes);
     free_map_fully(priv->repo_excludes);
     free_map_fully(pool->considered);
-    free_map_fully(priv->pkg_solvables);
+    delete priv->pkg_solvables;
+    delete priv->evr_splits;
     pool_free(priv->pool);
 
     G_OBJECT_CLASS(dnf_sack_parent_class)->finalize(object);
@@ -165,6 +182,8 @@ dnf_sack_init(DnfSack *sack)
     priv->considered_uptodate = TRUE;
     priv->cmdline_repo = NULL;
     queue_init(&priv->installonly);
+    queue_init(&priv->pending_fileprovides);
+    queue_init(&priv->pending_fileprovides_inst);
 
     /* logging up after this*/
     pool_setdebugcallback(priv->pool, log_cb, sack);
@@ -252,19 +271,19 @@ void
 dnf_sack_set_running_kernel_fn (DnfSack *sack, dnf_sack_running_kernel_fn_t fn)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
+    assert(!priv->frozen);
     priv->running_kernel_fn = fn;
 }
 
 void
-dnf_sack_set_pkg_solvables(DnfSack *sack, Map *pkg_solvables, int pool_nsolvables)
+dnf_sack_set_pkg_solvables(DnfSack *sack, const libdnf::PackageSet &pkg_solvables,
+                           int pool_nsolvables)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
 
-    auto pkg_solvables_tmp = static_cast<Map *>(g_malloc(sizeof(Map)));
-    if (priv->pkg_solvables)
-        free_map_fully(priv->pkg_solvables);
-    map_init_clone(pkg_solvables_tmp, pkg_solvables);
-    priv->pkg_solvables = pkg_solvables_tmp;
+    assert(!priv->frozen);
+    delete priv->pkg_solvables;
+    priv->pkg_solvables = new libdnf::PackageSet(pkg_solvables);
     priv->pool_nsolvables = pool_nsolvables;
 }
 
@@ -275,14 +294,107 @@ dnf_sack_get_pool_nsolvables(DnfSack *sack)
     return priv->pool_nsolvables;
 }
 
-Map *
+const libdnf::PackageSet *
 dnf_sack_get_pkg_solvables(DnfSack *sack)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
-    auto pkg_solvables_tmp = new Map;
+    return priv->pkg_solvables;
+}
+
+/* same splitting as pool_split_evr(), the string is copied because creating the version and
+ * release Ids can move the string space */
+static DnfEvrSplit
+evr_split_parse(Pool *pool, Id evr, int create)
+{
+    std::string evr_str(pool_id2str(pool, evr));
+    const char *begin = evr_str.c_str();
+    const char *e;
+    const char *r = NULL;
+    DnfEvrSplit split = {0, ID_EMPTY, 0};
+
+    if (*begin == '\0')
+        return split;
+    for (e = begin + 1; *e != ':' && *e != '-' && *e != '\0'; ++e)
+        ;
+    if (*e == '-') {
+        split.version = pool_strn2id(pool, begin, e - begin, create);
+        r = e + 1;
+    } else if (*e == '\0') {
+        split.version = pool_str2id(pool, begin, create);
+    } else {
+        split.epoch = strtoul(begin, NULL, 10);
+        r = strchr(e + 1, '-');
+        if (r) {
+            split.version = pool_strn2id(pool, e + 1, r - e - 1, create);
+            r++;
+        } else {
+            split.version = pool_str2id(pool, e + 1, create);
+        }
+    }
+    if (r)
+        split.release = pool_str2id(pool, r, create);
+    return split;
+}
+
+static const DnfEvrSplit *
+evr_split_find(DnfSackPrivate *priv, Id evr)
+{
+    if (!priv->evr_splits)
+        return NULL;
+    auto found = priv->evr_splits->find(evr);
+    return found != priv->evr_splits->end() ? &found->second : NULL;
+}
+
+DnfEvrSplit
+dnf_sack_get_evr_split(DnfSack *sack, Id evr)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+
+    const DnfEvrSplit *found = evr_split_find(priv, evr);
+    if (found)
+        return *found;
+    /* dnf_sack_freeze() split the evrs of all solvables and advisories, anything else is
+     * parsed on every call, without adding strings or records other readers could see */
+    if (priv->frozen)
+        return evr_split_parse(priv->pool, evr, 0);
+
+    if (!priv->evr_splits)
+        priv->evr_splits = new std::unordered_map<Id, DnfEvrSplit>;
+    DnfEvrSplit split = evr_split_parse(priv->pool, evr, 1);
+    priv->evr_splits->emplace(evr, split);
+    return split;
+}
+
+int
+dnf_sack_evr_split_cmp(DnfSack *sack, Id evr1, Id evr2)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    Pool *pool = priv->pool;
 
-    map_init_clone(pkg_solvables_tmp, priv->pkg_solvables);
-    return pkg_solvables_tmp;
+    if (evr1 == evr2)
+        return 0;
+    if (priv->frozen && (!evr_split_find(priv, evr1) || !evr_split_find(priv, evr2)))
+        /* the version or release may be missing from the frozen pool */
+        return pool_evrcmp(pool, evr1, evr2, EVRCMP_COMPARE);
+    DnfEvrSplit split1 = dnf_sack_get_evr_split(sack, evr1);
+    DnfEvrSplit split2 = dnf_sack_get_evr_split(sack, evr2);
+
+    if (split1.epoch != split2.epoch)
+        return split1.epoch < split2.epoch ? -1 : 1;
+    if (split1.version != split2.version) {
+        const char *v1 = pool_id2str(pool, split1.version);
+        const char *v2 = pool_id2str(pool, split2.version);
+        int cmp = libdnf::rpmvercmp(v1, v1 + strlen(v1), v2, v2 + strlen(v2));
+        if (cmp)
+            return cmp;
+    }
+    if (split1.release == split2.release)
+        return 0;
+    if (!split1.release || !split2.release)
+        return split1.release ? 1 : -1;
+    const char *r1 = pool_id2str(pool, split1.release);
+    const char *r2 = pool_id2str(pool, split2.release);
+    return libdnf::rpmvercmp(r1, r1 + strlen(r1), r2, r2 + strlen(r2));
 }
 
 /**
@@ -316,6 +428,7 @@ dnf_sack_recompute_considered(DnfSack *sack)
     Pool *pool = dnf_sack_get_pool(sack);
     if (priv->considered_uptodate)
         return;
+    assert(!priv->frozen);
     if (!pool->considered) {
         if (!priv->repo_excludes && !priv->pkg_excludes && !priv->pkg_includes)
             return;
@@ -355,10 +468,36 @@ dnf_sack_recompute_considered(DnfSack *sack)
     priv->considered_uptodate = TRUE;
 }
 
+/**
+ * prefetch_ext:
+ *
+ * Starts decompressing an extension whose cache cannot be used, so that
+ * it is inflated while the main data and other extensions are parsed.
+ */
+static FILE *
+prefetch_ext(DnfSack *sack, HyRepo hrepo, const char *suffix, int which_filename)
+{
+    const char *fn = hy_repo_get_string(hrepo, which_filename);
+    FILE *fp;
+    int usable;
+
+    if (fn == NULL)
+        return NULL;
+    char *fn_cache = dnf_sack_give_cache_fn(sack, hrepo->libsolv_repo->name, suffix);
+    fp = fopen(fn_cache, "r");
+    usable = can_use_repomd_cache(fp, hrepo->checksum);
+    if (fp)
+        fclose(fp);
+    g_free(fn_cache);
+    if (usable)
+        return NULL;
+    return xfopen_threaded(fn);
+}
+
 static gboolean
 load_ext(DnfSack *sack, HyRepo hrepo, _hy_repo_repodata which_repodata,
          const char *suffix, int which_filename,
-         int (*cb)(Repo *, FILE *), GError **error)
+         int (*cb)(Repo *, FILE *), FILE **fp_prefetched, GError **error)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
     int ret = 0;
@@ -409,7 +548,12 @@ load_ext(DnfSack *sack, HyRepo hrepo, _hy_repo_repodata which_repodata,
     if (done)
         return TRUE;
 
-    fp = solv_xfopen(fn, "r");
+    if (*fp_prefetched != NULL) {
+        fp = *fp_prefetched;
+        *fp_prefetched = NULL;
+    } else {
+        fp = xfopen_threaded(fn);
+    }
     if (fp == NULL) {
         g_set_error (error,
                      DNF_ERROR,
@@ -678,8 +822,7 @@ load_yum_repo(DnfSack *sack, HyRepo hrepo, GError **error)
         }
         hrepo->state_main = _HY_LOADED_CACHE;
     } else {
-        fp_primary = solv_xfopen(hy_repo_get_string(hrepo, HY_REPO_PRIMARY_FN),
-                                 "r");
+        fp_primary = xfopen_threaded(hy_repo_get_string(hrepo, HY_REPO_PRIMARY_FN));
         assert(fp_primary);
 
         g_debug("fetching %s", name);
@@ -749,6 +892,8 @@ dnf_sack_set_arch (DnfSack *sack, const gchar *value, GError **error)
     const char *arch = value;
     g_autofree gchar *detected = NULL;
 
+    assert(!priv->frozen);
+
     /* autodetect */
     if (arch == NULL) {
         if (hy_detect_arch(&detected)) {
@@ -786,6 +931,7 @@ void
 dnf_sack_set_all_arch (DnfSack *sack, gboolean all_arch)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
+    assert(!priv->frozen);
     priv->all_arch = all_arch;
 }
 
@@ -817,6 +963,7 @@ void
 dnf_sack_set_rootdir (DnfSack *sack, const gchar *value)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
+    assert(!priv->frozen);
     pool_set_rootdir(priv->pool, value);
     /* Don't look for running kernels if we're not operating live on
      * the current system.
@@ -1005,6 +1152,7 @@ dnf_sack_set_installonly(DnfSack *sack, const char **installonly)
     DnfSackPrivate *priv = GET_PRIVATE(sack);
     const char *name;
 
+    assert(!priv->frozen);
     queue_empty(&priv->installonly);
     if (installonly == NULL)
         return;
@@ -1092,6 +1240,7 @@ DnfPackage *
 dnf_sack_add_cmdline_package(DnfSack *sack, const char *fn)
 {
     DnfSackPrivate *priv = GET_PRIVATE(sack);
+    assert(!priv->frozen);
     Repo *repo = dnf_sack_setup_cmdline_repo(sack);
     Id p;
 
@@ -1139,6 +1288,7 @@ dnf_sack_count(DnfSack *sack)
 static void
 dnf_sack_add_excludes_or_includes(DnfSack *sack, Map **dest, DnfPackageSet *pkgset)
 {
+    assert(!dnf_sack_is_frozen(sack));
     Map *destmap = *dest;
     if (destmap == NULL) {
         destmap = static_cast<Map *>(g_malloc0(sizeof(Map)));
@@ -1147,7 +1297,7 @@ dnf_sack_add_excludes_or_includes(DnfSack *sack, Map **dest, DnfPackageSet *pkgs
         *dest = destmap;
     }
 
-    Map *pkgmap = dnf_packageset_get_map(pkgset);
+    const Map *pkgmap = dnf_packageset_peek_map(pkgset);
     map_or(destmap, pkgmap);
     DnfSackPrivate *priv = GET_PRIVATE(sack);
     priv->considered_uptodate = FALSE;
@@ -1188,9 +1338,10 @@ dnf_sack_add_includes(DnfSack *sack, DnfPackageSet *pset)
 static void
 dnf_sack_remove_excludes_or_includes(DnfSack *sack, Map *from, DnfPackageSet *pkgset)
 {
+    assert(!dnf_sack_is_frozen(sack));
     if (from == NULL)
         return;
-    Map *pkgmap = dnf_packageset_get_map(pkgset);
+    const Map *pkgmap = dnf_packageset_peek_map(pkgset);
     map_subtract(from, pkgmap);
     DnfSackPrivate *priv = GET_PRIVATE(sack);
     priv->considered_uptodate = FALSE;
@@ -1231,13 +1382,14 @@ dnf_sack_remove_includes(DnfSack *sack, DnfPackageSet *pset)
 static void
 dnf_sack_set_excludes_or_includes(DnfSack *sack, Map **dest, DnfPackageSet *pkgset)
 {
+    assert(!dnf_sack_is_frozen(sack));
     if (*dest == NULL && pkgset == NULL)
         return;
 
     *dest = free_map_fully(*dest);
     if (pkgset) {
         *dest = static_cast<Map *>(g_malloc0(sizeof(Map)));
-        Map *pkgmap = dnf_packageset_get_map(pkgset);
+        const Map *pkgmap = dnf_packageset_peek_map(pkgset);
         map_init_clone(*dest, pkgmap);
     }
     DnfSackPrivate *priv = GET_PRIVATE(sack);
@@ -1355,6 +1507,7 @@ dnf_sack_set_use_includes(DnfSack *sack, const char *reponame, gboolean enabled)
     DnfSackPrivate *priv = GET_PRIVATE(sack);
     Pool *pool = dnf_sack_get_pool(sack);
 
+    assert(!priv->frozen);
     if (reponame) {
         HyRepo hyrepo = hrepo_by_name(sack, reponame);
         if (!hyrepo)
@@ -1422,6 +1575,7 @@ dnf_sack_repo_enabled(DnfSack *sack, const char *reponame, int enabled)
     Repo *repo = repo_by_name(sack, reponame);
     Map *excl = priv->repo_excludes;
 
+    assert(!priv->frozen);
     if (repo == NULL)
         return DNF_ERROR_INTERNAL_ERROR;
     if (excl == NULL) {
@@ -1470,6 +1624,7 @@ dnf_sack_load_system_repo(DnfSack *sack, HyRepo a_hrepo, int flags, GError **err
     Repo *repo;
     const int build_cache = flags & DNF_SACK_LOAD_FLAG_BUILD_CACHE;
 
+    assert(!priv->frozen);
     g_free(cache_fn);
     if (hrepo)
         hy_repo_set_string(hrepo, HY_REPO_NAME, HY_SYSTEM_REPO_NAME);
@@ -1554,9 +1709,29 @@ dnf_sack_load_repo(DnfSack *sack, HyRepo repo, int flags, GError **error)
     GError *error_local = NULL;
     const int build_cache = flags & DNF_SACK_LOAD_FLAG_BUILD_CACHE;
     gboolean retval;
+    /* parsing into the pool is serial, but all extensions that need to be
+     * fetched are decompressed concurrently from here on */
+    struct PrefetchedExt {
+        FILE *fp[_HY_REPODATA_UPDATEINFO + 1] = {};
+        ~PrefetchedExt() {
+            for (FILE *f : fp)
+                if (f)
+                    fclose(f);
+        }
+    } prefetched;
+    assert(!priv->frozen);
     if (!load_yum_repo(sack, repo, error))
         return FALSE;
     repo->load_flags = flags;
+    if (flags & DNF_SACK_LOAD_FLAG_USE_FILELISTS)
+        prefetched.fp[_HY_REPODATA_FILENAMES] =
+            prefetch_ext(sack, repo, HY_EXT_FILENAMES, HY_REPO_FILELISTS_FN);
+    if (flags & DNF_SACK_LOAD_FLAG_USE_PRESTO)
+        prefetched.fp[_HY_REPODATA_PRESTO] =
+            prefetch_ext(sack, repo, HY_EXT_PRESTO, HY_REPO_PRESTO_FN);
+    if (flags & DNF_SACK_LOAD_FLAG_USE_UPDATEINFO)
+        prefetched.fp[_HY_REPODATA_UPDATEINFO] =
+            prefetch_ext(sack, repo, HY_EXT_UPDATEINFO, HY_REPO_UPDATEINFO_FN);
     if (repo->state_main == _HY_LOADED_FETCH && build_cache) {
         if (!write_main(sack, repo, 1, error))
             return FALSE;
@@ -1567,7 +1742,8 @@ dnf_sack_load_repo(DnfSack *sack, HyRepo repo, int flags, GError **error)
     if (flags & DNF_SACK_LOAD_FLAG_USE_FILELISTS) {
         retval = load_ext(sack, repo, _HY_REPODATA_FILENAMES,
                           HY_EXT_FILENAMES, HY_REPO_FILELISTS_FN,
-                          load_filelists_cb, &error_local);
+                          load_filelists_cb,
+                          &prefetched.fp[_HY_REPODATA_FILENAMES], &error_local);
         /* allow missing files */
         if (!retval) {
             if (g_error_matches (error_local,
@@ -1590,7 +1766,8 @@ dnf_sack_load_repo(DnfSack *sack, HyRepo repo, int flags, GError **error)
     if (flags & DNF_SACK_LOAD_FLAG_USE_PRESTO) {
         retval = load_ext(sack, repo, _HY_REPODATA_PRESTO,
                           HY_EXT_PRESTO, HY_REPO_PRESTO_FN,
-                          load_presto_cb, &error_local);
+                          load_presto_cb,
+                          &prefetched.fp[_HY_REPODATA_PRESTO], &error_local);
         if (!retval) {
             if (g_error_matches (error_local,
                                  DNF_ERROR,
@@ -1611,7 +1788,8 @@ dnf_sack_load_repo(DnfSack *sack, HyRepo repo, int flags, GError **error)
     if (flags & DNF_SACK_LOAD_FLAG_USE_UPDATEINFO) {
         retval = load_ext(sack, repo, _HY_REPODATA_UPDATEINFO,
                           HY_EXT_UPDATEINFO, HY_REPO_UPDATEINFO_FN,
-                          load_updateinfo_cb, &error_local);
+                          load_updateinfo_cb,
+                          &prefetched.fp[_HY_REPODATA_UPDATEINFO], &error_local);
         /* allow missing files */
         if (!retval) {
             if (g_error_matches (error_local,
@@ -1708,6 +1886,183 @@ rewrite_repos(DnfSack *sack, Queue *addedfileprovides,
     map_free(&providedids);
 }
 
+/**
+ * dnf_sack_load_fileprovides:
+ *
+ * Reads the union of the file provides any sack sharing this cache directory
+ * has needed so far, one path per line.
+ **/
+static gchar **
+dnf_sack_load_fileprovides(DnfSack *sack)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    g_autofree gchar *fn = NULL;
+    g_autofree gchar *data = NULL;
+
+    if (priv->cache_dir == NULL)
+        return NULL;
+    fn = g_build_filename(priv->cache_dir, FILEPROVIDES_FN, NULL);
+    if (!g_file_get_contents(fn, &data, NULL, NULL))
+        return NULL;
+    return g_strsplit(data, "\n", -1);
+}
+
+/**
+ * dnf_sack_save_fileprovides:
+ *
+ * Merges the file provides in @addedq into the union stored in the cache
+ * directory. The file is only written when it gains new paths.
+ **/
+static void
+dnf_sack_save_fileprovides(DnfSack *sack, Queue *addedq, Queue *addedq_inst)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    Pool *pool = priv->pool;
+    Queue *queues[] = { addedq, addedq_inst };
+    g_auto(GStrv) known = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GHashTable) seen = NULL;
+    g_autoptr(GString) str = NULL;
+    g_autofree gchar *fn = NULL;
+    gboolean changed = FALSE;
+
+    if (priv->cache_dir == NULL)
+        return;
+    seen = g_hash_table_new(g_str_hash, g_str_equal);
+    str = g_string_new(NULL);
+    known = dnf_sack_load_fileprovides(sack);
+    for (guint i = 0; known != NULL && known[i] != NULL; i++) {
+        if (known[i][0] != '/' || !g_hash_table_add(seen, known[i]))
+            continue;
+        g_string_append_printf(str, "%s\n", known[i]);
+    }
+    for (Queue *q : queues) {
+        for (int i = 0; i < q->count; i++) {
+            const char *path = pool_id2str(pool, q->elements[i]);
+            if (!g_hash_table_add(seen, (gpointer) path))
+                continue;
+            g_string_append_printf(str, "%s\n", path);
+            changed = TRUE;
+        }
+    }
+    if (!changed)
+        return;
+    fn = g_build_filename(priv->cache_dir, FILEPROVIDES_FN, NULL);
+    if (!g_file_set_contents(fn, str->str, str->len, &error))
+        g_debug("failed to save file provides: %s", error->message);
+}
+
+/**
+ * dnf_sack_flush_rewrites:
+ * @sack: a #DnfSack instance.
+ *
+ * Writes the file provides computed by dnf_sack_make_provides_ready() into
+ * the .solv caches that lack them. This is deferred so the I/O does not slow
+ * down the first query; it otherwise happens from an idle callback or when
+ * the sack is destroyed.
+ **/
+void
+dnf_sack_flush_rewrites(DnfSack *sack)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+
+    if (priv->rewrite_source != NULL) {
+        g_source_destroy(priv->rewrite_source);
+        g_source_unref(priv->rewrite_source);
+        priv->rewrite_source = NULL;
+    }
+    if (!priv->rewrite_pending)
+        return;
+    priv->rewrite_pending = FALSE;
+    rewrite_repos(sack, &priv->pending_fileprovides,
+                  &priv->pending_fileprovides_inst);
+    dnf_sack_save_fileprovides(sack, &priv->pending_fileprovides,
+                               &priv->pending_fileprovides_inst);
+    queue_empty(&priv->pending_fileprovides);
+    queue_empty(&priv->pending_fileprovides_inst);
+}
+
+static gboolean
+dnf_sack_rewrite_idle_cb(gpointer user_data)
+{
+    auto sack = static_cast<DnfSack *>(user_data);
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+
+    /* dnf_sack_flush_rewrites() would destroy the running source */
+    g_source_unref(priv->rewrite_source);
+    priv->rewrite_source = NULL;
+    dnf_sack_flush_rewrites(sack);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+dnf_sack_defer_rewrite(DnfSack *sack, Queue *addedq, Queue *addedq_inst)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    GMainContext *ctx;
+
+    /* the latest computation covers the whole pool, it supersedes older ones */
+    queue_free(&priv->pending_fileprovides);
+    queue_free(&priv->pending_fileprovides_inst);
+    queue_init_clone(&priv->pending_fileprovides, addedq);
+    queue_init_clone(&priv->pending_fileprovides_inst, addedq_inst);
+    priv->rewrite_pending = TRUE;
+    if (priv->rewrite_source != NULL)
+        return;
+
+    /* only use an idle if this thread runs the loop, other threads may be
+     * querying the sack while it would be dispatched */
+    ctx = g_main_context_ref_thread_default();
+    if (g_main_context_is_owner(ctx)) {
+        priv->rewrite_source = g_idle_source_new();
+        g_source_set_priority(priv->rewrite_source, G_PRIORITY_LOW);
+        g_source_set_callback(priv->rewrite_source,
+                              dnf_sack_rewrite_idle_cb, sack, NULL);
+        g_source_attach(priv->rewrite_source, ctx);
+    }
+    g_main_context_unref(ctx);
+}
+
+/**
+ * dnf_sack_prime_fileprovides:
+ * @sack: a #DnfSack instance.
+ *
+ * Adds the file provides recorded by earlier sessions to the repos loaded
+ * with %DNF_SACK_LOAD_FLAG_BUILD_CACHE and writes them into their .solv
+ * caches right away, so a freshly built cache does not have to be rewritten
+ * by the first dnf_sack_make_provides_ready() that needs them.
+ **/
+void
+dnf_sack_prime_fileprovides(DnfSack *sack)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    Pool *pool = priv->pool;
+    g_auto(GStrv) paths = dnf_sack_load_fileprovides(sack);
+
+    assert(!priv->frozen);
+    if (paths == NULL || paths[0] == NULL)
+        return;
+
+    /* a throwaway solvable requiring every known path makes libsolv
+     * compute the provides for all of them */
+    Repo *repo = repo_create(pool, "@fileprovides");
+    Solvable *s = pool_id2solvable(pool, repo_add_solvable(repo));
+    s->name = pool_str2id(pool, "@fileprovides", 1);
+    s->evr = ID_EMPTY;
+    s->arch = ARCH_NOARCH;
+    for (guint i = 0; paths[i] != NULL; i++) {
+        if (paths[i][0] != '/')
+            continue;
+        s->requires = repo_addid_dep(repo, s->requires,
+                                     pool_str2id(pool, paths[i], 1), 0);
+    }
+    dnf_sack_make_provides_ready(sack);
+    dnf_sack_flush_rewrites(sack);
+    repo_free(repo, 1);
+    priv->provides_ready = 0;
+    priv->considered_uptodate = FALSE;
+}
+
 /**
  * dnf_sack_make_provides_ready:
  * @sack: a #DnfSack instance.
@@ -1723,6 +2078,7 @@ dnf_sack_make_provides_ready(DnfSack *sack)
 
     if (priv->provides_ready)
         return;
+    assert(!priv->frozen);
     repo_internalize_all_trigger(priv->pool);
     Queue addedfileprovides;
     Queue addedfileprovides_inst;
@@ -1731,7 +2087,7 @@ dnf_sack_make_provides_ready(DnfSack *sack)
     pool_addfileprovides_queue(priv->pool, &addedfileprovides,
                                &addedfileprovides_inst);
     if (addedfileprovides.count || addedfileprovides_inst.count)
-        rewrite_repos(sack, &addedfileprovides, &addedfileprovides_inst);
+        dnf_sack_defer_rewrite(sack, &addedfileprovides, &addedfileprovides_inst);
     queue_free(&addedfileprovides);
     queue_free(&addedfileprovides_inst);
     pool_createwhatprovides(priv->pool);
@@ -1759,6 +2115,126 @@ dnf_sack_running_kernel(DnfSack *sack)
     return priv->running_kernel_id;
 }
 
+/**
+ * dnf_sack_freeze:
+ * @sack: a #DnfSack instance.
+ *
+ * Computes everything the sack and libsolv would otherwise compute lazily
+ * during queries and makes the sack read-only. Once frozen, any number of
+ * threads can run queries, combine package sets, match selectors and call the
+ * #DnfPackage getters without locking, as long as every thread uses its own
+ * query, selector and package objects.
+ *
+ * Not covered are the advisory filters and #DnfAdvisory, which move the
+ * shared libsolv lookup position, HY_PKG_LOCATION, dnf_package_get_location(),
+ * dnf_package_get_sourcerpm() and dnf_reldep_to_string(), which format into the
+ * shared pool temporary space.
+ *
+ * Nothing is added to the pool of a frozen sack. Dependency filters match
+ * relations that are not in the pool by their strings, dnf_reldep_new()
+ * returns %NULL for them and selectors reject them with
+ * DNF_ERROR_BAD_SELECTOR. Rich dependencies can't be parsed without adding
+ * them, filtering on them fails with DNF_ERROR_BAD_QUERY.
+ *
+ * Freezing disables paging of the repo data, so all of it is kept in memory.
+ * Loading repos, changing excludes and the other setters abort in debug builds
+ * once the sack is frozen. A sack cannot be unfrozen.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_sack_freeze(DnfSack *sack)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    Pool *pool = priv->pool;
+    Dataiterator di;
+    Repo *repo;
+    Id p;
+    int i;
+
+    if (priv->frozen)
+        return;
+
+    dnf_sack_make_provides_ready(sack);
+    dnf_sack_flush_rewrites(sack);
+    dnf_sack_recompute_considered(sack);
+    priv->considered_uptodate = TRUE;
+    dnf_sack_running_kernel(sack);
+
+    /* what Query::Impl::initResult() stores on the first query */
+    if (priv->pool_nsolvables == 0 || priv->pool_nsolvables != pool->nsolvables) {
+        libdnf::PackageSet pkg_solvables(sack);
+        FOR_PKG_SOLVABLES(p)
+            pkg_solvables.set(p);
+        dnf_sack_set_pkg_solvables(sack, pkg_solvables, pool->nsolvables);
+    }
+
+    /* every evr the filters and advisory comparisons can split */
+    FOR_POOL_SOLVABLES(p) {
+        Solvable *s = pool_id2solvable(pool, p);
+        if (s->evr != ID_EMPTY)
+            dnf_sack_get_evr_split(sack, s->evr);
+    }
+    dataiterator_init(&di, pool, 0, 0, UPDATE_COLLECTION_EVR, 0, 0);
+    dataiterator_prepend_keyname(&di, UPDATE_COLLECTION);
+    while (dataiterator_step(&di))
+        dnf_sack_get_evr_split(sack, di.kv.id);
+    dataiterator_free(&di);
+
+    /* lookups would page in data from the .solv files */
+    FOR_REPOS(i, repo) {
+        Repodata *data;
+        int rdid;
+        FOR_REPODATAS(repo, rdid, data)
+            repodata_disable_paging(data);
+    }
+
+    /* libsolv fills in the providers of relations and file names on first
+     * use, do it for all of them now */
+    for (Id id = 1; id < pool->ss.nstrings; ++id)
+        pool_whatprovides(pool, id);
+    for (Id id = 1; id < pool->nrels; ++id)
+        pool_whatprovides(pool, MAKERELDEP(id));
+
+    /* pool_createwhatprovides() dropped the string and relation hashes, the
+     * first lookup would rebuild them */
+    pool_str2id(pool, "noarch", 0);
+    pool_rel2id(pool, ARCH_NOARCH, ARCH_NOARCH, REL_EQ, 0);
+
+    priv->frozen_nstrings = pool->ss.nstrings;
+    priv->frozen_nrels = pool->nrels;
+    priv->frozen = TRUE;
+}
+
+/**
+ * dnf_sack_is_frozen:
+ * @sack: a #DnfSack instance.
+ *
+ * Returns: %TRUE if dnf_sack_freeze() was called on the sack
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+dnf_sack_is_frozen(DnfSack *sack)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    return priv->frozen;
+}
+
+void
+dnf_sack_check_frozen(DnfSack *sack)
+{
+    DnfSackPrivate *priv = GET_PRIVATE(sack);
+    Pool *pool = priv->pool;
+
+    if (!priv->frozen)
+        return;
+    assert(pool->ss.nstrings == priv->frozen_nstrings);
+    assert(pool->nrels == priv->frozen_nrels);
+    assert(priv->provides_ready && priv->considered_uptodate);
+    (void)pool;
+}
+
 /**
  * dnf_sack_get_pool: (skip)
  * @sack: a #DnfSack instance.
@@ -1877,6 +2353,8 @@ dnf_sack_add_repo(DnfSack *sack,
         flags_hy |= DNF_SACK_LOAD_FLAG_USE_FILELISTS;
     if ((flags & DNF_SACK_ADD_FLAG_UPDATEINFO) > 0)
         flags_hy |= DNF_SACK_LOAD_FLAG_USE_UPDATEINFO;
+    if ((flags & DNF_SACK_ADD_FLAG_DELTAINFO) > 0)
+        flags_hy |= DNF_SACK_LOAD_FLAG_USE_PRESTO;
 
     /* load solv */
     g_debug("Loading repo %s", dnf_repo_get_id(repo));
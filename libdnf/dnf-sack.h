@@ -149,6 +149,8 @@ gboolean     dnf_sack_load_repo             (DnfSack        *sack,
                                              HyRepo          hrepo,
                                              int             flags,
                                              GError        **error);
+void         dnf_sack_freeze                (DnfSack        *sack);
+gboolean     dnf_sack_is_frozen             (DnfSack        *sack);
 Pool        *dnf_sack_get_pool              (DnfSack    *sack);
 
 
@@ -161,6 +163,7 @@ Pool        *dnf_sack_get_pool              (DnfSack    *sack);
  * @DNF_SACK_ADD_FLAG_UPDATEINFO:               Add the updateinfo
  * @DNF_SACK_ADD_FLAG_REMOTE:                   Use remote repos
  * @DNF_SACK_ADD_FLAG_UNAVAILABLE:              Add repos that are unavailable
+ * @DNF_SACK_ADD_FLAG_DELTAINFO:                Add the presto deltainfo
  *
  * The error code.
  **/
@@ -170,6 +173,7 @@ typedef enum {
         DNF_SACK_ADD_FLAG_UPDATEINFO            = 2,
         DNF_SACK_ADD_FLAG_REMOTE                = 4,
         DNF_SACK_ADD_FLAG_UNAVAILABLE           = 8,
+        DNF_SACK_ADD_FLAG_DELTAINFO             = 16,
         /*< private >*/
         DNF_SACK_ADD_FLAG_LAST
 } DnfSackAddFlags;
@@ -81,11 +81,58 @@
  */
 
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <json/json.h>
+
 #include "dnf-state.h"
 #include "dnf-utils.h"
 
 #include "utils/bgettext/bgettext-lib.h"
 
+/* Progress shared by a rate limited state and all of its children, the
+ * root and every child hold a reference; root is cleared when it goes away */
+struct DnfStateAggregate {
+    gint                     ref_count;
+    DnfState                *root;
+    gint64                   interval;
+    std::atomic<guint>       percentage{0};
+    std::atomic<guint64>     speed{0};
+    std::atomic<guint>       published_percentage{0};
+    std::atomic<guint64>     published_speed{0};
+    std::atomic<gint64>      last_publish{0};
+};
+
+/* One recorded span of a traced state tree, times are in microseconds */
+struct DnfStateSpan {
+    std::string              name;
+    const gchar             *category;
+    guint                    depth;
+    gint64                   start;
+    gint64                   duration;
+    gint64                   cpu_start;
+    gint64                   cpu;
+    bool                     open;
+};
+
+/* Most recent spans kept by a trace, older ones are overwritten */
+#define DNF_STATE_TRACE_MAX_SPANS               65536
+
+/* Spans shared by a traced state and all of its children, each of them holds
+ * a reference; spans is a ring buffer indexed by span id modulo its size */
+struct DnfStateTrace {
+    gint                     ref_count;
+    bool                     enabled;
+    gint64                   origin;
+    gint64                   next_span;
+    std::vector<DnfStateSpan> spans;
+};
+
 typedef struct
 {
     gboolean         allow_cancel;
@@ -116,6 +163,11 @@ typedef struct
     DnfState         *parent;
     GPtrArray        *lock_ids;
     DnfLock          *lock;
+    DnfStateAggregate *aggregate;
+    DnfStateTrace    *trace;
+    gint64            trace_state_span;
+    gint64            trace_step_span;
+    gint64            trace_action_span;
 } DnfStatePrivate;
 
 enum {
@@ -140,6 +192,67 @@ G_DEFINE_TYPE_WITH_PRIVATE(DnfState, dnf_state, G_TYPE_OBJECT)
 
 #define DNF_STATE_SPEED_SMOOTHING_ITEMS        5
 
+/**
+ * dnf_state_aggregate_ref:
+ **/
+static DnfStateAggregate *
+dnf_state_aggregate_ref(DnfStateAggregate *aggregate)
+{
+    if (aggregate != NULL)
+        g_atomic_int_inc(&aggregate->ref_count);
+    return aggregate;
+}
+
+/**
+ * dnf_state_aggregate_unref:
+ **/
+static void
+dnf_state_aggregate_unref(DnfStateAggregate *aggregate, DnfState *state)
+{
+    if (aggregate == NULL)
+        return;
+    if (aggregate->root == state)
+        aggregate->root = NULL;
+    if (g_atomic_int_dec_and_test(&aggregate->ref_count))
+        delete aggregate;
+}
+
+/**
+ * dnf_state_trace_ref:
+ **/
+static DnfStateTrace *
+dnf_state_trace_ref(DnfStateTrace *trace)
+{
+    if (trace != NULL)
+        g_atomic_int_inc(&trace->ref_count);
+    return trace;
+}
+
+/**
+ * dnf_state_trace_unref:
+ **/
+static void
+dnf_state_trace_unref(DnfStateTrace *trace)
+{
+    if (trace != NULL && g_atomic_int_dec_and_test(&trace->ref_count))
+        delete trace;
+}
+
+/**
+ * dnf_state_release_child:
+ *
+ * Stops a child the parent no longer monitors from reporting to it; the
+ * child may be kept alive by its caller after the parent moved on.
+ **/
+static void
+dnf_state_release_child(DnfState *child)
+{
+    DnfStatePrivate *child_priv = GET_PRIVATE(child);
+    child_priv->parent = NULL;
+    dnf_state_aggregate_unref(child_priv->aggregate, child);
+    child_priv->aggregate = NULL;
+}
+
 /**
  * dnf_state_finalize:
  **/
@@ -163,6 +276,8 @@ dnf_state_finalize(GObject *object)
     g_free(priv->speed_data);
     g_ptr_array_unref(priv->lock_ids);
     g_object_unref(priv->lock);
+    dnf_state_aggregate_unref(priv->aggregate, state);
+    dnf_state_trace_unref(priv->trace);
 
     G_OBJECT_CLASS(dnf_state_parent_class)->finalize(object);
 }
@@ -183,6 +298,9 @@ dnf_state_init(DnfState *state)
     priv->report_progress = TRUE;
     priv->lock = dnf_lock_new();
     priv->speed_data = g_new0(guint64, DNF_STATE_SPEED_SMOOTHING_ITEMS);
+    priv->trace_state_span = -1;
+    priv->trace_step_span = -1;
+    priv->trace_action_span = -1;
 }
 
 /**
@@ -316,6 +434,352 @@ dnf_state_set_enable_profile(DnfState *state, gboolean enable_profile)
     priv->enable_profile = enable_profile;
 }
 
+/**
+ * dnf_state_set_progress_rate:
+ * @state: A #DnfState
+ * @rate: the maximum number of progress updates per second, or 0 for no limit
+ *
+ * Enables progress aggregation for this state and all children created
+ * afterwards with dnf_state_get_child(). Children then report percentage
+ * and speed straight to @state without emitting any signals, and @state
+ * emits the coalesced values at most @rate times per second. Reaching 100%
+ * and finishing a step with dnf_state_done() is always reported.
+ *
+ * This should be set on the state consumers connect to, before any child
+ * is created. Signals on the children themselves are not emitted. A child
+ * replaced by dnf_state_get_child() or dropped by dnf_state_reset() stops
+ * reporting to its parent, as without aggregation.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_state_set_progress_rate(DnfState *state, guint rate)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+
+    g_return_if_fail(priv->child == NULL);
+    g_return_if_fail(priv->aggregate == NULL || priv->aggregate->root == state);
+
+    dnf_state_aggregate_unref(priv->aggregate, state);
+    priv->aggregate = NULL;
+    if (rate == 0)
+        return;
+    priv->aggregate = new DnfStateAggregate;
+    priv->aggregate->ref_count = 1;
+    priv->aggregate->root = state;
+    priv->aggregate->interval = G_USEC_PER_SEC / rate;
+    priv->aggregate->percentage = priv->last_percentage;
+    priv->aggregate->published_percentage = priv->last_percentage;
+    priv->aggregate->speed = priv->speed;
+    priv->aggregate->published_speed = priv->speed;
+}
+
+/**
+ * dnf_state_aggregate_publish:
+ **/
+static void
+dnf_state_aggregate_publish(DnfStateAggregate *aggregate, gboolean force)
+{
+    gint64 now = g_get_monotonic_time();
+    gint64 last = aggregate->last_publish.load();
+
+    /* too soon, the next update or flush picks the values up */
+    if (!force && now - last < aggregate->interval)
+        return;
+    if (!aggregate->last_publish.compare_exchange_strong(last, now) && !force)
+        return;
+
+    guint percentage = aggregate->percentage.load();
+    if (aggregate->published_percentage.exchange(percentage) != percentage)
+        g_signal_emit(aggregate->root, signals [SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
+    guint64 speed = aggregate->speed.load();
+    if (aggregate->published_speed.exchange(speed) != speed)
+        g_object_notify(G_OBJECT(aggregate->root), "speed");
+}
+
+/**
+ * dnf_state_flush_progress:
+ **/
+static void
+dnf_state_flush_progress(DnfState *state)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    if (priv->aggregate != NULL)
+        dnf_state_aggregate_publish(priv->aggregate, TRUE);
+}
+
+/**
+ * dnf_state_get_cpu_time:
+ **/
+static gint64
+dnf_state_get_cpu_time(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+/**
+ * dnf_state_action_to_string:
+ **/
+static const gchar *
+dnf_state_action_to_string(DnfStateAction action)
+{
+    switch (action) {
+    case DNF_STATE_ACTION_DOWNLOAD_PACKAGES:
+        return "download-packages";
+    case DNF_STATE_ACTION_DOWNLOAD_METADATA:
+        return "download-metadata";
+    case DNF_STATE_ACTION_LOADING_CACHE:
+        return "loading-cache";
+    case DNF_STATE_ACTION_TEST_COMMIT:
+        return "test-commit";
+    case DNF_STATE_ACTION_REQUEST:
+        return "request";
+    case DNF_STATE_ACTION_REMOVE:
+        return "remove";
+    case DNF_STATE_ACTION_INSTALL:
+        return "install";
+    case DNF_STATE_ACTION_UPDATE:
+        return "update";
+    case DNF_STATE_ACTION_CLEANUP:
+        return "cleanup";
+    case DNF_STATE_ACTION_OBSOLETE:
+        return "obsolete";
+    case DNF_STATE_ACTION_REINSTALL:
+        return "reinstall";
+    case DNF_STATE_ACTION_DOWNGRADE:
+        return "downgrade";
+    case DNF_STATE_ACTION_QUERY:
+        return "query";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * dnf_state_trace_enabled:
+ **/
+static gboolean
+dnf_state_trace_enabled(DnfState *state)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    return priv->trace != NULL && priv->trace->enabled;
+}
+
+/**
+ * dnf_state_trace_get_span:
+ *
+ * Gets a recorded span, or %NULL if it was overwritten by newer ones.
+ **/
+static DnfStateSpan *
+dnf_state_trace_get_span(DnfStateTrace *trace, gint64 span)
+{
+    if (span < 0 || span + (gint64) trace->spans.size() < trace->next_span)
+        return NULL;
+    return &trace->spans[span % DNF_STATE_TRACE_MAX_SPANS];
+}
+
+/**
+ * dnf_state_trace_depth:
+ *
+ * Gets the nesting level of a new span started in this state.
+ **/
+static guint
+dnf_state_trace_depth(DnfState *state)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    const gint64 spans[] = { priv->trace_action_span,
+                             priv->trace_step_span,
+                             priv->trace_state_span };
+
+    for (gint64 span : spans) {
+        DnfStateSpan *item = span >= 0 ? dnf_state_trace_get_span(priv->trace, span) : NULL;
+        if (item != NULL)
+            return item->depth + 1;
+    }
+    if (priv->parent != NULL)
+        return dnf_state_trace_depth(priv->parent);
+    return 0;
+}
+
+/**
+ * dnf_state_trace_open:
+ **/
+static void
+dnf_state_trace_open(DnfState *state, gint64 *span, const gchar *category, std::string &&name)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    DnfStateSpan item;
+
+    item.name = std::move(name);
+    item.category = category;
+    item.depth = dnf_state_trace_depth(state);
+    item.start = g_get_monotonic_time();
+    item.duration = 0;
+    item.cpu_start = dnf_state_get_cpu_time();
+    item.cpu = 0;
+    item.open = true;
+    *span = priv->trace->next_span++;
+    if (priv->trace->spans.size() < DNF_STATE_TRACE_MAX_SPANS)
+        priv->trace->spans.push_back(std::move(item));
+    else
+        priv->trace->spans[*span % DNF_STATE_TRACE_MAX_SPANS] = std::move(item);
+}
+
+/**
+ * dnf_state_trace_close:
+ **/
+static void
+dnf_state_trace_close(DnfState *state, gint64 *span)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    DnfStateSpan *item;
+
+    if (*span < 0)
+        return;
+    item = priv->trace != NULL ? dnf_state_trace_get_span(priv->trace, *span) : NULL;
+    if (item != NULL) {
+        item->duration = g_get_monotonic_time() - item->start;
+        item->cpu = dnf_state_get_cpu_time() - item->cpu_start;
+        item->open = false;
+    }
+    *span = -1;
+}
+
+/**
+ * dnf_state_trace_open_step:
+ **/
+static void
+dnf_state_trace_open_step(DnfState *state)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    gchar *name;
+
+    if (!dnf_state_trace_enabled(state))
+        return;
+    name = g_strdup_printf("%s step %u/%u", priv->id, priv->current + 1, priv->steps);
+    dnf_state_trace_open(state, &priv->trace_step_span, "step", name);
+    g_free(name);
+}
+
+/**
+ * dnf_state_set_enable_trace:
+ * @state: A #DnfState
+ * @enable_trace: if tracing should be enabled
+ *
+ * Enables recording of nested spans for this state and all children created
+ * afterwards with dnf_state_get_child(). Each call to
+ * dnf_state_set_number_steps(), each step finished with dnf_state_done() and
+ * each dnf_state_action_start()/dnf_state_action_stop() pair is recorded with
+ * its wall and CPU time.
+ *
+ * Unlike dnf_state_set_enable_profile() nothing is printed; use
+ * dnf_state_get_trace() to export the recorded spans. The trace is a ring
+ * buffer keeping only the most recent 65536 spans, so a long running process
+ * can leave tracing enabled without growing memory.
+ *
+ * Since: 0.13.0
+ **/
+void
+dnf_state_set_enable_trace(DnfState *state, gboolean enable_trace)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+
+    if (priv->trace == NULL) {
+        if (!enable_trace)
+            return;
+        priv->trace = new DnfStateTrace;
+        priv->trace->ref_count = 1;
+        priv->trace->origin = g_get_monotonic_time();
+        priv->trace->next_span = 0;
+    }
+    priv->trace->enabled = enable_trace;
+}
+
+/**
+ * dnf_state_get_trace:
+ * @state: A #DnfState
+ * @format: A #DnfStateTraceFormat, e.g. %DNF_STATE_TRACE_FORMAT_CHROME
+ *
+ * Exports the spans recorded since tracing was enabled, either as Chrome
+ * trace-event JSON, which can be loaded into chrome://tracing, or as a flat
+ * text summary with the total wall and CPU time of every span name. Only
+ * the most recent 65536 spans are kept, older ones are not exported.
+ *
+ * Returns: (transfer full): the trace, or %NULL if tracing was never enabled
+ *
+ * Since: 0.13.0
+ **/
+gchar *
+dnf_state_get_trace(DnfState *state, DnfStateTraceFormat format)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    gint64 now = g_get_monotonic_time();
+    gint64 cpu_now = dnf_state_get_cpu_time();
+    gint64 first_span;
+
+    if (priv->trace == NULL)
+        return NULL;
+    first_span = priv->trace->next_span - priv->trace->spans.size();
+
+    if (format == DNF_STATE_TRACE_FORMAT_CHROME) {
+        Json::Value root;
+        Json::Value &events = root["traceEvents"];
+        events = Json::Value(Json::arrayValue);
+        for (gint64 span = first_span; span < priv->trace->next_span; span++) {
+            const DnfStateSpan &item = *dnf_state_trace_get_span(priv->trace, span);
+            Json::Value event;
+            event["name"] = item.name;
+            event["cat"] = item.category;
+            event["ph"] = "X";
+            event["ts"] = Json::Int64(item.start - priv->trace->origin);
+            event["dur"] = Json::Int64(item.open ? now - item.start : item.duration);
+            event["pid"] = Json::Int64(getpid());
+            event["tid"] = 0;
+            event["args"]["cpu_us"] = Json::Int64(item.open ? cpu_now - item.cpu_start : item.cpu);
+            event["args"]["depth"] = item.depth;
+            events.append(event);
+        }
+        root["displayTimeUnit"] = "ms";
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return g_strdup(Json::writeString(builder, root).c_str());
+    }
+
+    /* flat summary, sorted by total wall time */
+    struct Total {
+        std::string name;
+        guint count;
+        gint64 wall;
+        gint64 cpu;
+    };
+    std::map<std::string, Total> totals;
+    for (gint64 span = first_span; span < priv->trace->next_span; span++) {
+        const DnfStateSpan &item = *dnf_state_trace_get_span(priv->trace, span);
+        auto &total = totals[item.name];
+        total.name = item.name;
+        total.count++;
+        total.wall += item.open ? now - item.start : item.duration;
+        total.cpu += item.open ? cpu_now - item.cpu_start : item.cpu;
+    }
+    std::vector<Total> sorted;
+    for (const auto &it : totals)
+        sorted.push_back(it.second);
+    std::sort(sorted.begin(), sorted.end(), [](const Total &a, const Total &b) {
+        return a.wall > b.wall;
+    });
+
+    GString *result = g_string_new("    wall ms      cpu ms  count  name\n");
+    for (const auto &total : sorted) {
+        g_string_append_printf(result, "%11.3f %11.3f %6u  %s\n",
+                               total.wall / 1000.0, total.cpu / 1000.0,
+                               total.count, total.name.c_str());
+    }
+    return g_string_free(result, FALSE);
+}
+
 /**
  * dnf_state_take_lock:
  * @state: A #DnfState
@@ -490,10 +954,25 @@ static void
 dnf_state_set_speed_internal(DnfState *state, guint64 speed)
 {
     DnfStatePrivate *priv = GET_PRIVATE(state);
+    DnfStateAggregate *aggregate = priv->aggregate;
+
     if (priv->speed == speed)
         return;
     priv->speed = speed;
-    g_object_notify(G_OBJECT(state), "speed");
+
+    if (aggregate == NULL) {
+        g_object_notify(G_OBJECT(state), "speed");
+        return;
+    }
+
+    /* children report straight to the parent, released children have no
+     * aggregate and emit the signal nobody is connected to any more */
+    if (aggregate->root != state) {
+        dnf_state_set_speed_internal(priv->parent, speed);
+        return;
+    }
+    aggregate->speed.store(speed);
+    dnf_state_aggregate_publish(aggregate, FALSE);
 }
 
 /**
@@ -563,6 +1042,31 @@ dnf_state_release_locks(DnfState *state)
     return TRUE;
 }
 
+static void dnf_state_child_percentage_changed(DnfState *state, guint percentage);
+
+/**
+ * dnf_state_emit_percentage:
+ **/
+static void
+dnf_state_emit_percentage(DnfState *state, guint percentage)
+{
+    DnfStatePrivate *priv = GET_PRIVATE(state);
+    DnfStateAggregate *aggregate = priv->aggregate;
+
+    if (aggregate == NULL) {
+        g_signal_emit(state, signals [SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
+        return;
+    }
+
+    /* children report straight to the parent */
+    if (aggregate->root != state) {
+        dnf_state_child_percentage_changed(priv->parent, percentage);
+        return;
+    }
+    aggregate->percentage.store(percentage);
+    dnf_state_aggregate_publish(aggregate, percentage == 100);
+}
+
 /**
  * dnf_state_set_percentage:
  * @state: a #DnfState instance.
@@ -630,7 +1134,7 @@ dnf_state_set_percentage(DnfState *state, guint percentage)
     priv->last_percentage = percentage;
 
     /* emit */
-    g_signal_emit(state, signals [SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
+    dnf_state_emit_percentage(state, percentage);
 
     /* success */
     return TRUE;
@@ -698,6 +1202,15 @@ dnf_state_action_start(DnfState *state, DnfStateAction action, const gchar *acti
     /* save */
     priv->action = action;
 
+    /* record the span */
+    if (dnf_state_trace_enabled(state)) {
+        std::string name = dnf_state_action_to_string(action);
+        if (action_hint != NULL)
+            name.append(" ").append(action_hint);
+        dnf_state_trace_close(state, &priv->trace_action_span);
+        dnf_state_trace_open(state, &priv->trace_action_span, "action", std::move(name));
+    }
+
     /* just emit */
     g_signal_emit(state, signals [SIGNAL_ACTION_CHANGED], 0, action, action_hint);
     return TRUE;
@@ -752,6 +1265,7 @@ dnf_state_action_stop(DnfState *state)
     }
 
     /* pop and reset */
+    dnf_state_trace_close(state, &priv->trace_action_span);
     priv->action = priv->last_action;
     priv->last_action = DNF_STATE_ACTION_UNKNOWN;
     if (priv->action_hint != NULL) {
@@ -799,10 +1313,10 @@ dnf_state_get_action(DnfState *state)
 }
 
 /**
- * dnf_state_child_percentage_changed_cb:
+ * dnf_state_child_percentage_changed:
  **/
 static void
-dnf_state_child_percentage_changed_cb(DnfState *child, guint percentage, DnfState *state)
+dnf_state_child_percentage_changed(DnfState *state, guint percentage)
 {
     DnfStatePrivate *priv = GET_PRIVATE(state);
     gfloat offset;
@@ -862,6 +1376,15 @@ out:
     dnf_state_set_percentage(state, parent_percentage);
 }
 
+/**
+ * dnf_state_child_percentage_changed_cb:
+ **/
+static void
+dnf_state_child_percentage_changed_cb(DnfState *child, guint percentage, DnfState *state)
+{
+    dnf_state_child_percentage_changed(state, percentage);
+}
+
 /**
  * dnf_state_child_allow_cancel_changed_cb:
  **/
@@ -931,6 +1454,11 @@ dnf_state_reset(DnfState *state)
     if (!priv->report_progress)
         return TRUE;
 
+    /* close any recorded spans */
+    dnf_state_trace_close(state, &priv->trace_action_span);
+    dnf_state_trace_close(state, &priv->trace_step_span);
+    dnf_state_trace_close(state, &priv->trace_state_span);
+
     /* reset values */
     priv->steps = 0;
     priv->current = 0;
@@ -964,6 +1492,7 @@ dnf_state_reset(DnfState *state)
 
     /* unref child */
     if (priv->child != NULL) {
+        dnf_state_release_child(priv->child);
         g_object_unref(priv->child);
         priv->child = NULL;
     }
@@ -1027,6 +1556,7 @@ dnf_state_get_child(DnfState *state)
                                     priv->package_progress_child_id);
         g_signal_handler_disconnect(priv->child,
                                     priv->notify_speed_child_id);
+        dnf_state_release_child(priv->child);
         g_object_unref(priv->child);
     }
 
@@ -1071,6 +1601,12 @@ dnf_state_get_child(DnfState *state)
 
     /* set the profile state */
     dnf_state_set_enable_profile(child, priv->enable_profile);
+
+    /* share the progress aggregation */
+    child_priv->aggregate = dnf_state_aggregate_ref(priv->aggregate);
+
+    /* share the trace */
+    child_priv->trace = dnf_state_trace_ref(priv->trace);
     return child;
 }
 
@@ -1124,6 +1660,12 @@ dnf_state_set_number_steps_real(DnfState *state, guint steps, const gchar *strlo
     /* set steps */
     priv->steps = steps;
 
+    /* record the spans */
+    if (dnf_state_trace_enabled(state)) {
+        dnf_state_trace_open(state, &priv->trace_state_span, "state", priv->id);
+        dnf_state_trace_open_step(state);
+    }
+
     /* success */
     return TRUE;
 }
@@ -1375,6 +1917,13 @@ dnf_state_done_real(DnfState *state, GError **error, const gchar *strloc)
     /* another */
     priv->current++;
 
+    /* record the spans */
+    dnf_state_trace_close(state, &priv->trace_step_span);
+    if (priv->current < priv->steps)
+        dnf_state_trace_open_step(state);
+    else
+        dnf_state_trace_close(state, &priv->trace_state_span);
+
     /* find new percentage */
     if (priv->step_data == NULL) {
         percentage = dnf_state_discrete_to_percent(priv->current,
@@ -1384,6 +1933,7 @@ dnf_state_done_real(DnfState *state, GError **error, const gchar *strloc)
         percentage = priv->step_data[priv->current - 1];
     }
     dnf_state_set_percentage(state,(guint) percentage);
+    dnf_state_flush_progress(state);
 
     /* show any profiling stats */
     if (priv->enable_profile &&
@@ -1428,9 +1978,12 @@ dnf_state_finished_real(DnfState *state, GError **error, const gchar *strloc)
 
     /* all done */
     priv->current = priv->steps;
+    dnf_state_trace_close(state, &priv->trace_step_span);
+    dnf_state_trace_close(state, &priv->trace_state_span);
 
     /* set new percentage */
     dnf_state_set_percentage(state, 100);
+    dnf_state_flush_progress(state);
     return TRUE;
 }
 
@@ -71,6 +71,20 @@ typedef enum {
         DNF_STATE_ACTION_LAST
 } DnfStateAction;
 
+/**
+ * DnfStateTraceFormat:
+ * @DNF_STATE_TRACE_FORMAT_CHROME:              Chrome trace-event JSON
+ * @DNF_STATE_TRACE_FORMAT_SUMMARY:             Flat text summary
+ *
+ * The export format of recorded spans.
+ **/
+typedef enum {
+        DNF_STATE_TRACE_FORMAT_CHROME           = 0,    /* Since: 0.13.0 */
+        DNF_STATE_TRACE_FORMAT_SUMMARY          = 1,    /* Since: 0.13.0 */
+        /*< private >*/
+        DNF_STATE_TRACE_FORMAT_LAST
+} DnfStateTraceFormat;
+
 struct _DnfStateClass
 {
         GObjectClass    parent_class;
@@ -123,6 +137,8 @@ void             dnf_state_set_speed                    (DnfState
                                                          guint64                 speed);
 void             dnf_state_set_report_progress          (DnfState               *state,
                                                          gboolean                report_progress);
+void             dnf_state_set_progress_rate            (DnfState               *state,
+                                                         guint                   rate);
 gboolean         dnf_state_set_number_steps_real        (DnfState               *state,
                                                          guint                   steps,
                                                          const gchar            *strloc);
@@ -157,6 +173,10 @@ gboolean         dnf_state_finished_real                (DnfState
 gboolean         dnf_state_reset                        (DnfState               *state);
 void             dnf_state_set_enable_profile           (DnfState               *state,
                                                          gboolean                enable_profile);
+void             dnf_state_set_enable_trace             (DnfState               *state,
+                                                         gboolean                enable_trace);
+gchar           *dnf_state_get_trace                    (DnfState               *state,
+                                                         DnfStateTraceFormat     format);
 #ifndef __GI_SCANNER__
 gboolean         dnf_state_take_lock                    (DnfState               *state,
                                                          DnfLockType             lock_type,
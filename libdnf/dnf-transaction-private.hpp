@@ -0,0 +1,37 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __DNF_TRANSACTION_PRIVATE_H
+#define __DNF_TRANSACTION_PRIVATE_H
+
+#include "dnf-transaction.h"
+
+gint             dnf_transaction_pick_delta             (guint64         package_size,
+                                                         const guint64  *delta_sizes,
+                                                         guint           n_deltas,
+                                                         guint           percentage);
+gboolean         dnf_transaction_apply_delta            (GChecksumType   checksum_type,
+                                                         const gchar    *checksum,
+                                                         const gchar    *arch,
+                                                         const gchar    *delta_fn,
+                                                         const gchar    *rpm_fn);
+
+#endif /* __DNF_TRANSACTION_PRIVATE_H */
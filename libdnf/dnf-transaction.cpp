@@ -28,6 +28,9 @@
  * This object represents an RPM transaction.
  */
 
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <librepo/librepo.h>
 #include <rpm/rpmlib.h>
 #include <rpm/rpmlog.h>
 #include <rpm/rpmts.h>
@@ -36,9 +39,10 @@
 #include "dnf-goal.h"
 #include "dnf-keyring.h"
 #include "dnf-package.h"
+#include "dnf-repo.h"
 #include "dnf-rpmts.h"
 #include "dnf-sack.h"
-#include "dnf-transaction.h"
+#include "dnf-transaction-private.hpp"
 #include "dnf-utils.h"
 #include "hy-query.h"
 #include "hy-util-private.hpp"
@@ -74,6 +78,7 @@ typedef struct {
     GPtrArray *pkgs_to_download;
     GHashTable *erased_by_package_hash;
     guint64 flags;
+    guint64 delta_bytes_saved;
     Swdb *swdb;
 } DnfTransactionPrivate;
 
@@ -171,6 +176,24 @@ dnf_transaction_get_remote_pkgs(DnfTransaction *transaction)
     return priv->pkgs_to_download;
 }
 
+/**
+ * dnf_transaction_get_delta_bytes_saved:
+ * @transaction: a #DnfTransaction instance.
+ *
+ * Gets how much less was downloaded in dnf_transaction_download() thanks to
+ * the updates rebuilt from delta RPMs, see dnf_context_set_deltarpm().
+ *
+ * Returns: the number of bytes saved
+ *
+ * Since: 0.13.0
+ **/
+guint64
+dnf_transaction_get_delta_bytes_saved(DnfTransaction *transaction)
+{
+    DnfTransactionPrivate *priv = GET_PRIVATE(transaction);
+    return priv->delta_bytes_saved;
+}
+
 /**
  * dnf_transaction_set_repos:
  * @transaction: a #DnfTransaction instance.
@@ -886,6 +909,340 @@ dnf_transaction_check_free_space(DnfTransaction *transaction, GError **error)
     return TRUE;
 }
 
+/* rebuilds the update from a delta and the files of the installed package */
+#define DNF_TRANSACTION_APPLYDELTARPM "/usr/bin/applydeltarpm"
+
+typedef struct {
+    DnfPackage      *pkg;           /* the update, owned by pkgs_to_download */
+    DnfPackageDelta *delta;
+    const gchar     *arch;
+    GChecksumType    checksum_type;
+    gchar           *checksum;      /* of the update, from the metadata */
+    gchar           *delta_fn;
+    gchar           *rpm_fn;
+    gboolean         rebuilt;
+} DnfTransactionDelta;
+
+static void
+dnf_transaction_delta_free(DnfTransactionDelta *item)
+{
+    g_object_unref(item->delta);
+    g_free(item->checksum);
+    g_free(item->delta_fn);
+    g_free(item->rpm_fn);
+    g_slice_free(DnfTransactionDelta, item);
+}
+
+/**
+ * dnf_transaction_pick_delta:
+ * @package_size: download size of the full package
+ * @delta_sizes: download sizes of the deltas against the installed versions
+ * @n_deltas: number of deltas
+ * @percentage: the deltarpm percentage, see dnf_context_set_deltarpm_percentage()
+ *
+ * Picks the smallest delta that is smaller than @percentage of the full package.
+ *
+ * Returns: index into @delta_sizes, or -1 if the full package should be downloaded
+ **/
+gint
+dnf_transaction_pick_delta(guint64 package_size,
+                           const guint64 *delta_sizes,
+                           guint n_deltas,
+                           guint percentage)
+{
+    guint64 limit = package_size * percentage / 100;
+    gint best = -1;
+
+    for (guint i = 0; i < n_deltas; i++) {
+        if (delta_sizes[i] == 0 || delta_sizes[i] >= limit)
+            continue;
+        if (best >= 0 && delta_sizes[i] >= delta_sizes[best])
+            continue;
+        best = i;
+    }
+    return best;
+}
+
+/**
+ * dnf_transaction_plan_deltas:
+ * @transaction: a #DnfTransaction instance.
+ * @full: the packages to be downloaded in full are appended here
+ *
+ * Splits the packages to download into updates rebuilt from a delta against
+ * the installed package and packages downloaded in full. A delta is only
+ * used when it is smaller than the deltarpm percentage of the full package;
+ * when more versions are installed, e.g. kernels, the smallest delta wins.
+ *
+ * Returns: (transfer full) (element-type DnfTransactionDelta): the planned deltas
+ **/
+static GPtrArray *
+dnf_transaction_plan_deltas(DnfTransaction *transaction, GPtrArray *full)
+{
+    DnfTransactionPrivate *priv = GET_PRIVATE(transaction);
+    DnfSack *sack = dnf_context_get_sack(priv->context);
+    guint percentage = dnf_context_get_deltarpm_percentage(priv->context);
+    GPtrArray *deltas;
+    HyQuery query;
+    g_autoptr(GPtrArray) pkglist = NULL;
+    g_autoptr(GHashTable) installed = NULL;
+
+    deltas = g_ptr_array_new_with_free_func((GDestroyNotify) dnf_transaction_delta_free);
+    if (!dnf_context_get_deltarpm(priv->context) || sack == NULL ||
+        !g_file_test(DNF_TRANSACTION_APPLYDELTARPM, G_FILE_TEST_IS_EXECUTABLE)) {
+        for (guint i = 0; i < priv->pkgs_to_download->len; i++)
+            g_ptr_array_add(full, g_ptr_array_index(priv->pkgs_to_download, i));
+        return deltas;
+    }
+
+    /* the installed packages a delta can be based on, by name.arch */
+    installed = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      g_free, (GDestroyNotify) g_ptr_array_unref);
+    query = hy_query_create(sack);
+    hy_query_filter(query, HY_PKG_REPONAME, HY_EQ, HY_SYSTEM_REPO_NAME);
+    pkglist = hy_query_run(query);
+    hy_query_free(query);
+    for (guint i = 0; i < pkglist->len; i++) {
+        auto pkg = static_cast<DnfPackage *>(g_ptr_array_index(pkglist, i));
+        gchar *key = g_strdup_printf("%s.%s", dnf_package_get_name(pkg),
+                                     dnf_package_get_arch(pkg));
+        auto candidates = static_cast<GPtrArray *>(g_hash_table_lookup(installed, key));
+        if (candidates == NULL) {
+            candidates = g_ptr_array_new();
+            g_hash_table_insert(installed, key, candidates);
+        } else {
+            g_free(key);
+        }
+        g_ptr_array_add(candidates, pkg);
+    }
+
+    for (guint i = 0; i < priv->pkgs_to_download->len; i++) {
+        auto pkg = static_cast<DnfPackage *>(g_ptr_array_index(priv->pkgs_to_download, i));
+        DnfPackageDelta *best;
+        DnfTransactionDelta *item;
+        const gchar *filename;
+        const unsigned char *checksum;
+        gint idx;
+        int checksum_type;
+        g_autofree gchar *key = NULL;
+        g_autofree gchar *basename = NULL;
+        g_autoptr(GPtrArray) found = NULL;
+        g_autoptr(GArray) sizes = NULL;
+
+        /* already in the cache from an earlier run */
+        filename = dnf_package_get_filename(pkg);
+        if (filename == NULL || g_file_test(filename, G_FILE_TEST_EXISTS)) {
+            g_ptr_array_add(full, pkg);
+            continue;
+        }
+
+        /* a rebuilt update is verified against the checksum from the metadata */
+        checksum = dnf_package_get_chksum(pkg, &checksum_type);
+        if (checksum == NULL) {
+            g_ptr_array_add(full, pkg);
+            continue;
+        }
+
+        key = g_strdup_printf("%s.%s", dnf_package_get_name(pkg), dnf_package_get_arch(pkg));
+        auto candidates = static_cast<GPtrArray *>(g_hash_table_lookup(installed, key));
+        found = g_ptr_array_new_with_free_func((GDestroyNotify) g_object_unref);
+        sizes = g_array_new(FALSE, FALSE, sizeof(guint64));
+        for (guint j = 0; candidates != NULL && j < candidates->len; j++) {
+            auto pkg_installed = static_cast<DnfPackage *>(g_ptr_array_index(candidates, j));
+            DnfPackageDelta *delta;
+            guint64 size;
+
+            delta = dnf_package_get_delta_from_evr(pkg, dnf_package_get_evr(pkg_installed));
+            if (delta == NULL)
+                continue;
+            size = dnf_packagedelta_get_downloadsize(delta);
+            g_ptr_array_add(found, delta);
+            g_array_append_val(sizes, size);
+        }
+        idx = dnf_transaction_pick_delta(dnf_package_get_downloadsize(pkg),
+                                         (const guint64 *) sizes->data, sizes->len,
+                                         percentage);
+        if (idx < 0) {
+            g_ptr_array_add(full, pkg);
+            continue;
+        }
+        best = static_cast<DnfPackageDelta *>(g_object_ref(g_ptr_array_index(found, idx)));
+
+        /* everything the worker threads need is looked up here,
+         * they don't touch the pool */
+        basename = g_path_get_basename(dnf_packagedelta_get_location(best));
+        item = g_slice_new0(DnfTransactionDelta);
+        item->pkg = pkg;
+        item->delta = best;
+        item->arch = dnf_package_get_arch(pkg);
+        item->checksum_type = (GChecksumType) checksum_type;
+        item->checksum = hy_chksum_str(checksum, checksum_type);
+        item->delta_fn = g_build_filename(dnf_repo_get_packages(dnf_package_get_repo(pkg)),
+                                          basename, NULL);
+        item->rpm_fn = g_strdup(filename);
+        g_ptr_array_add(deltas, item);
+    }
+    return deltas;
+}
+
+/**
+ * dnf_transaction_download_deltas:
+ *
+ * Downloads the planned deltas, one librepo batch per repo. Deltas which
+ * fail to download are missing afterwards, they are not an error.
+ **/
+static gboolean
+dnf_transaction_download_deltas(GPtrArray *deltas, DnfState *state, GError **error)
+{
+    GHashTableIter hiter;
+    gpointer key, value;
+    g_autoptr(GHashTable) repo_to_items = NULL;
+
+    repo_to_items = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
+    for (guint i = 0; i < deltas->len; i++) {
+        auto item = static_cast<DnfTransactionDelta *>(g_ptr_array_index(deltas, i));
+        DnfRepo *repo = dnf_package_get_repo(item->pkg);
+        auto items = static_cast<GPtrArray *>(g_hash_table_lookup(repo_to_items, repo));
+        if (items == NULL) {
+            items = g_ptr_array_new();
+            g_hash_table_insert(repo_to_items, repo, items);
+        }
+        g_ptr_array_add(items, item);
+    }
+
+    dnf_state_set_number_steps(state, g_hash_table_size(repo_to_items));
+
+    g_hash_table_iter_init(&hiter, repo_to_items);
+    while (g_hash_table_iter_next(&hiter, &key, &value)) {
+        auto repo = static_cast<DnfRepo *>(key);
+        auto items = static_cast<GPtrArray *>(value);
+        g_autoptr(GPtrArray) packages = g_ptr_array_sized_new(items->len);
+        g_autoptr(GPtrArray) repo_deltas = g_ptr_array_sized_new(items->len);
+        DnfState *state_local;
+
+        for (guint i = 0; i < items->len; i++) {
+            auto item = static_cast<DnfTransactionDelta *>(g_ptr_array_index(items, i));
+            g_ptr_array_add(packages, item->pkg);
+            g_ptr_array_add(repo_deltas, item->delta);
+        }
+
+        state_local = dnf_state_get_child(state);
+        if (!dnf_repo_download_deltas(repo, packages, repo_deltas, NULL, state_local, error))
+            return FALSE;
+        if (!dnf_state_done(state, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * dnf_transaction_checksum_hy_to_lr:
+ **/
+static LrChecksumType
+dnf_transaction_checksum_hy_to_lr(GChecksumType checksum)
+{
+    if (checksum == G_CHECKSUM_MD5)
+        return LR_CHECKSUM_MD5;
+    if (checksum == G_CHECKSUM_SHA1)
+        return LR_CHECKSUM_SHA1;
+    if (checksum == G_CHECKSUM_SHA256)
+        return LR_CHECKSUM_SHA256;
+    return LR_CHECKSUM_SHA512;
+}
+
+/**
+ * dnf_transaction_apply_delta:
+ * @checksum_type: type of @checksum
+ * @checksum: hex checksum of the update from the metadata
+ * @arch: architecture of the update
+ * @delta_fn: the downloaded delta
+ * @rpm_fn: where the update is rebuilt
+ *
+ * Rebuilds the update from the delta and verifies it against @checksum.
+ * The delta is removed afterwards, and so is a rebuilt package which
+ * doesn't match, so it gets downloaded in full. Nothing here touches the
+ * pool, so rebuilds can run on worker threads.
+ *
+ * Returns: %TRUE if @rpm_fn holds the update
+ **/
+gboolean
+dnf_transaction_apply_delta(GChecksumType checksum_type,
+                            const gchar *checksum,
+                            const gchar *arch,
+                            const gchar *delta_fn,
+                            const gchar *rpm_fn)
+{
+    const gchar *argv[] = { DNF_TRANSACTION_APPLYDELTARPM, "-a", arch,
+                            delta_fn, rpm_fn, NULL };
+    gint exit_status;
+    gint fd;
+    gboolean valid = FALSE;
+    g_autofree gchar *standard_error = NULL;
+    g_autoptr(GError) error = NULL;
+
+    /* the download failed */
+    if (!g_file_test(delta_fn, G_FILE_TEST_EXISTS))
+        return FALSE;
+
+    if (!g_spawn_sync(NULL, (gchar **) argv, NULL, G_SPAWN_STDOUT_TO_DEV_NULL,
+                      NULL, NULL, NULL, &standard_error, &exit_status, &error) ||
+        !g_spawn_check_exit_status(exit_status, &error)) {
+        g_debug("failed to rebuild %s from %s: %s %s", rpm_fn, delta_fn,
+                error->message, standard_error != NULL ? standard_error : "");
+    } else if ((fd = g_open(rpm_fn, O_RDONLY, 0)) < 0) {
+        g_debug("failed to open %s", rpm_fn);
+    } else {
+        if (!lr_checksum_fd_cmp(dnf_transaction_checksum_hy_to_lr(checksum_type), fd,
+                                checksum, TRUE /* use xattr value */, &valid, &error)) {
+            g_debug("failed to check %s: %s", rpm_fn, error->message);
+            valid = FALSE;
+        } else if (!valid) {
+            g_debug("%s rebuilt from %s does not match the checksum", rpm_fn, delta_fn);
+        }
+        g_close(fd, NULL);
+    }
+    if (!valid)
+        g_unlink(rpm_fn);
+    g_unlink(delta_fn);
+    return valid;
+}
+
+static void
+dnf_transaction_apply_delta_cb(gpointer data, gpointer user_data)
+{
+    auto item = static_cast<DnfTransactionDelta *>(data);
+    auto state = static_cast<DnfState *>(user_data);
+
+    /* no new rebuilds once cancelled, the queued deltas are just dropped */
+    if (!dnf_state_check(state, NULL)) {
+        g_unlink(item->delta_fn);
+        return;
+    }
+    item->rebuilt = dnf_transaction_apply_delta(item->checksum_type, item->checksum,
+                                                item->arch, item->delta_fn, item->rpm_fn);
+}
+
+/**
+ * dnf_transaction_apply_deltas:
+ *
+ * Rebuilds the updates from the downloaded deltas. applydeltarpm is mostly
+ * bound by decompression, so the rebuilds run on a pool of one worker per CPU.
+ * Cancelling @state stops before the next rebuild starts.
+ **/
+static void
+dnf_transaction_apply_deltas(GPtrArray *deltas, DnfState *state)
+{
+    guint nthreads = MIN(g_get_num_processors(), deltas->len);
+    GThreadPool *thread_pool = g_thread_pool_new(dnf_transaction_apply_delta_cb, state, nthreads,
+                                                 FALSE, NULL);
+    for (guint i = 0; i < deltas->len; i++) {
+        gpointer item = g_ptr_array_index(deltas, i);
+        if (thread_pool == NULL || !g_thread_pool_push(thread_pool, item, NULL))
+            dnf_transaction_apply_delta_cb(item, state);
+    }
+    if (thread_pool != NULL)
+        g_thread_pool_free(thread_pool, FALSE, TRUE);
+}
+
 /**
  * dnf_transaction_download:
  * @transaction: a #DnfTransaction instance.
@@ -894,6 +1251,10 @@ dnf_transaction_check_free_space(DnfTransaction *transaction, GError **error)
  *
  * Downloads all the packages needed for a transaction.
  *
+ * If delta RPMs are enabled with dnf_context_set_deltarpm(), updates with a
+ * small enough delta against the installed package are downloaded as deltas
+ * and rebuilt locally. Any update that can't be rebuilt is downloaded in full.
+ *
  * Returns: %TRUE for success, %FALSE otherwise
  *
  * Since: 0.1.0
@@ -902,13 +1263,70 @@ gboolean
 dnf_transaction_download(DnfTransaction *transaction, DnfState *state, GError **error)
 {
     DnfTransactionPrivate *priv = GET_PRIVATE(transaction);
+    DnfState *state_local;
+    guint64 delta_size = 0;
+    guint64 rebuilt_size = 0;
+    g_autoptr(GPtrArray) full = NULL;
+    g_autoptr(GPtrArray) deltas = NULL;
+
+    priv->delta_bytes_saved = 0;
 
     /* check that we have enough free space */
     if (!dnf_transaction_check_free_space(transaction, error))
         return FALSE;
 
-    /* just download the list */
-    return dnf_package_array_download(priv->pkgs_to_download, NULL, state, error);
+    /* without any usable delta just download the list */
+    full = g_ptr_array_new();
+    deltas = dnf_transaction_plan_deltas(transaction, full);
+    if (deltas->len == 0)
+        return dnf_package_array_download(priv->pkgs_to_download, NULL, state, error);
+
+    if (!dnf_state_set_steps(state, error,
+                             30, /* download deltas */
+                             20, /* rebuild */
+                             50, /* download the rest */
+                             -1))
+        return FALSE;
+
+    state_local = dnf_state_get_child(state);
+    if (!dnf_transaction_download_deltas(deltas, state_local, error))
+        return FALSE;
+    if (!dnf_state_done(state, error))
+        return FALSE;
+
+    /* anything not rebuilt falls back to the full package */
+    dnf_transaction_apply_deltas(deltas, state);
+    if (!dnf_state_check(state, error))
+        return FALSE;
+    for (guint i = 0; i < deltas->len; i++) {
+        auto item = static_cast<DnfTransactionDelta *>(g_ptr_array_index(deltas, i));
+        if (!item->rebuilt) {
+            g_ptr_array_add(full, item->pkg);
+            continue;
+        }
+        delta_size += dnf_packagedelta_get_downloadsize(item->delta);
+        rebuilt_size += dnf_package_get_downloadsize(item->pkg);
+    }
+    priv->delta_bytes_saved = rebuilt_size - delta_size;
+    if (rebuilt_size > 0) {
+        g_autofree gchar *formatted_rebuilt_size = g_format_size(rebuilt_size);
+        g_autofree gchar *formatted_delta_size = g_format_size(delta_size);
+        g_debug("delta RPMs reduced %s of updates to %s (%.1f%% saved)",
+                formatted_rebuilt_size, formatted_delta_size,
+                100.0 * priv->delta_bytes_saved / rebuilt_size);
+    }
+    if (!dnf_state_done(state, error))
+        return FALSE;
+
+    state_local = dnf_state_get_child(state);
+    if (full->len > 0) {
+        if (!dnf_package_array_download(full, NULL, state_local, error))
+            return FALSE;
+    } else {
+        if (!dnf_state_finished(state_local, error))
+            return FALSE;
+    }
+    return dnf_state_done(state, error);
 }
 
 /**
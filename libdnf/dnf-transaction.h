@@ -76,6 +76,7 @@ DnfTransaction  *dnf_transaction_new                    (DnfContext     *context
 /* getters */
 guint64          dnf_transaction_get_flags              (DnfTransaction *transaction);
 GPtrArray       *dnf_transaction_get_remote_pkgs        (DnfTransaction *transaction);
+guint64          dnf_transaction_get_delta_bytes_saved  (DnfTransaction *transaction);
 
 /* setters */
 void             dnf_transaction_set_repos            (DnfTransaction *transaction,
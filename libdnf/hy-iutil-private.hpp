@@ -41,6 +41,8 @@ int is_readable_rpm(const char *fn);
 int mkcachedir(char *path);
 gboolean mv(const char *old_path, const char *new_path, GError **error);
 char *this_username(void);
+FILE *xfopen_threaded(const char *fn);
+void xfopen_threaded_set_enabled(gboolean enabled);
 
 /* misc utils */
 char *read_whole_file(const char *path);
@@ -27,6 +27,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
@@ -39,6 +40,7 @@ extern "C" {
 #include <solv/solver.h>
 #include <solv/solverdebug.h>
 #include <solv/util.h>
+#include <solv/solv_xfopen.h>
 #include <solv/pool_parserpmrichdep.h>
 }
 
@@ -62,6 +64,7 @@ extern "C" {
 #define CHKSUM_TYPE REPOKEY_TYPE_SHA256
 #define CHKSUM_IDENT "H000"
 #define CACHEDIR_PERMISSIONS 0700
+#define XF_RING_SIZE (1024 * 1024)
 
 static mode_t
 get_umask(void)
@@ -340,6 +343,163 @@ read_whole_file(const char *path)
   return contents;
 }
 
+/* cleared to compare against plain serial decompression */
+static gint xf_threaded_enabled = TRUE;
+
+/* decompressed stream produced by a thread, see xfopen_threaded() */
+struct XfRing {
+    GMutex mutex;
+    GCond cond;
+    FILE *src;
+    GThread *thread;
+    char *buf;
+    size_t capacity;
+    size_t head;        /* first filled byte */
+    size_t filled;
+    gboolean eof;
+    gboolean failed;
+    gboolean closed;
+};
+
+static gpointer
+xf_ring_produce(gpointer user_data)
+{
+    auto ring = static_cast<XfRing *>(user_data);
+
+    g_mutex_lock(&ring->mutex);
+    while (!ring->closed) {
+        while (ring->filled == ring->capacity && !ring->closed)
+            g_cond_wait(&ring->cond, &ring->mutex);
+        if (ring->closed)
+            break;
+
+        /* the free span is only ever written by this thread, so the
+         * decompressor can fill it in place with the lock dropped */
+        size_t tail = (ring->head + ring->filled) % ring->capacity;
+        size_t span = tail >= ring->head ? ring->capacity - tail : ring->head - tail;
+        g_mutex_unlock(&ring->mutex);
+        size_t n = fread(ring->buf + tail, 1, span, ring->src);
+        g_mutex_lock(&ring->mutex);
+
+        ring->filled += n;
+        if (n < span) {
+            ring->eof = TRUE;
+            ring->failed = ferror(ring->src) != 0;
+        }
+        g_cond_broadcast(&ring->cond);
+        if (ring->eof)
+            break;
+    }
+    g_mutex_unlock(&ring->mutex);
+    return NULL;
+}
+
+static ssize_t
+xf_ring_read(void *cookie, char *buf, size_t size)
+{
+    auto ring = static_cast<XfRing *>(cookie);
+    size_t n;
+
+    g_mutex_lock(&ring->mutex);
+    while (ring->filled == 0 && !ring->eof)
+        g_cond_wait(&ring->cond, &ring->mutex);
+    if (ring->filled == 0) {
+        g_mutex_unlock(&ring->mutex);
+        return ring->failed ? -1 : 0;
+    }
+    n = MIN(size, MIN(ring->filled, ring->capacity - ring->head));
+    g_mutex_unlock(&ring->mutex);
+
+    /* the filled span is only ever released by this thread */
+    memcpy(buf, ring->buf + ring->head, n);
+
+    g_mutex_lock(&ring->mutex);
+    ring->head = (ring->head + n) % ring->capacity;
+    ring->filled -= n;
+    g_cond_broadcast(&ring->cond);
+    g_mutex_unlock(&ring->mutex);
+    return n;
+}
+
+static int
+xf_ring_close(void *cookie)
+{
+    auto ring = static_cast<XfRing *>(cookie);
+
+    g_mutex_lock(&ring->mutex);
+    ring->closed = TRUE;
+    g_cond_broadcast(&ring->cond);
+    g_mutex_unlock(&ring->mutex);
+    g_thread_join(ring->thread);
+
+    fclose(ring->src);
+    g_mutex_clear(&ring->mutex);
+    g_cond_clear(&ring->cond);
+    g_free(ring->buf);
+    g_free(ring);
+    return 0;
+}
+
+/**
+ * xfopen_threaded:
+ * @fn: a possibly compressed file
+ *
+ * Like solv_xfopen(fn, "r"), but the decompression runs on its own thread
+ * and fills a ring buffer the returned stream reads from, so parsing the
+ * previous chunk overlaps with inflating the next one. Several streams can
+ * be opened up front to decompress more files at once.
+ *
+ * Falls back to a plain solv_xfopen() stream if no thread can be started
+ * or threaded decompression is disabled, see xfopen_threaded_set_enabled().
+ *
+ * Returns: a stream to fclose(), or %NULL if @fn cannot be opened
+ */
+FILE *
+xfopen_threaded(const char *fn)
+{
+    static const cookie_io_functions_t io = { xf_ring_read, NULL, NULL, xf_ring_close };
+    FILE *src = solv_xfopen(fn, "r");
+    FILE *fp;
+
+    if (src == NULL || !g_atomic_int_get(&xf_threaded_enabled))
+        return src;
+
+    auto ring = g_new0(XfRing, 1);
+    g_mutex_init(&ring->mutex);
+    g_cond_init(&ring->cond);
+    ring->src = src;
+    ring->capacity = XF_RING_SIZE;
+    ring->buf = static_cast<char *>(g_malloc(ring->capacity));
+    ring->thread = g_thread_try_new("xfopen", xf_ring_produce, ring, NULL);
+    if (ring->thread == NULL)
+        goto fallback;
+    fp = fopencookie(ring, "r", io);
+    if (fp == NULL) {
+        xf_ring_close(ring);
+        return solv_xfopen(fn, "r");
+    }
+    return fp;
+
+fallback:
+    g_mutex_clear(&ring->mutex);
+    g_cond_clear(&ring->cond);
+    g_free(ring->buf);
+    g_free(ring);
+    return src;
+}
+
+/**
+ * xfopen_threaded_set_enabled:
+ * @enabled: %FALSE to make xfopen_threaded() decompress on the reading thread
+ *
+ * Switches threaded decompression of repo metadata, for benchmarks and tests.
+ */
+void
+xfopen_threaded_set_enabled(gboolean enabled)
+{
+    g_atomic_int_set(&xf_threaded_enabled, enabled);
+}
+
 static char *
 pool_tmpdup(Pool *pool, const char *s)
 {
@@ -668,7 +828,9 @@ parse_reldep_str(const char *reldep_str, char **name, char **evr,
  * @reldep_str: Reldep string
  *
  * Creates new #DnfReldep from @reldep_str. Returns %NULL
- * if string can't be parsed.
+ * if string can't be parsed, or if the sack is frozen and
+ * the relation is not in its pool. Rich dependencies can't be
+ * parsed without adding them, they are always %NULL then.
  *
  * Returns: (transfer full): new #DnfReldep, or %NULL
  */
@@ -677,6 +839,8 @@ reldep_from_str(DnfSack *sack, const char *reldep_str)
 {
     if (reldep_str[0] == '(') {
         /* Rich dependency */
+        if (dnf_sack_is_frozen(sack))
+            return NULL;
         Pool *pool = dnf_sack_get_pool (sack);
         Id id = pool_parserpmrichdep(pool, reldep_str);
         if (!id)
@@ -20,6 +20,7 @@
 
 #include "hy-nevra.hpp"
 #include "dnf-sack.h"
+#include "utils/evrcmp.hpp"
 
 class Nevra::Impl {
 public:
@@ -91,6 +92,10 @@ std::string Nevra::getEvr() const
 
 int Nevra::compareEvr(const Nevra & nevra2, DnfSack *sack) const
 {
+    // without a sack there is no pool to ask, dnf_sack_evr_cmp() would have to create one
+    if (!sack)
+        return libdnf::evrcmp(pImpl->epoch, pImpl->version, pImpl->release,
+                              nevra2.pImpl->epoch, nevra2.pImpl->version, nevra2.pImpl->release);
     return dnf_sack_evr_cmp(sack, getEvr().c_str(), nevra2.getEvr().c_str());
 }
 
@@ -51,6 +51,7 @@ typedef struct
     gboolean         loaded;
     Id               id;
     DnfSack         *sack;
+    gchar           *nevra;     /* only used with frozen sacks */
 } DnfPackagePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(DnfPackage, dnf_package, G_TYPE_OBJECT)
@@ -62,6 +63,11 @@ G_DEFINE_TYPE_WITH_PRIVATE(DnfPackage, dnf_package, G_TYPE_OBJECT)
 static void
 dnf_package_finalize(GObject *object)
 {
+    DnfPackage *pkg = DNF_PACKAGE(object);
+    DnfPackagePrivate *priv = GET_PRIVATE(pkg);
+
+    g_free(priv->nevra);
+
     G_OBJECT_CLASS(dnf_package_parent_class)->finalize(object);
 }
 
@@ -389,8 +395,22 @@ dnf_package_get_baseurl(DnfPackage *pkg)
 const char *
 dnf_package_get_nevra(DnfPackage *pkg)
 {
+    DnfPackagePrivate *priv = GET_PRIVATE(pkg);
     Solvable *s = get_solvable(pkg);
-    return pool_solvable2str(dnf_package_get_pool(pkg), s);
+    Pool *pool = dnf_package_get_pool(pkg);
+
+    if (!dnf_sack_is_frozen(priv->sack))
+        return pool_solvable2str(pool, s);
+
+    /* the pool temporary space is shared by all threads */
+    if (priv->nevra == NULL) {
+        const char *evr = s->evr ? pool_id2str(pool, s->evr) : "";
+        const char *arch = s->arch ? pool_id2str(pool, s->arch) : "";
+        priv->nevra = g_strconcat(pool_id2str(pool, s->name),
+                                  *evr ? "-" : "", evr,
+                                  *arch ? "." : "", arch, NULL);
+    }
+    return priv->nevra;
 }
 
 /**
@@ -424,7 +444,14 @@ dnf_package_get_sourcerpm(DnfPackage *pkg)
 const char *
 dnf_package_get_version(DnfPackage *pkg)
 {
+    DnfPackagePrivate *priv = GET_PRIVATE(pkg);
+    Solvable *s = get_solvable(pkg);
     char *e, *v, *r;
+
+    if (dnf_sack_is_frozen(priv->sack) && s->evr != ID_EMPTY) {
+        DnfEvrSplit split = dnf_sack_get_evr_split(priv->sack, s->evr);
+        return pool_id2str(dnf_package_get_pool(pkg), split.version);
+    }
     pool_split_evr(dnf_package_get_pool(pkg), dnf_package_get_evr(pkg), &e, &v, &r);
     return v;
 }
@@ -442,7 +469,14 @@ dnf_package_get_version(DnfPackage *pkg)
 const char *
 dnf_package_get_release(DnfPackage *pkg)
 {
+    DnfPackagePrivate *priv = GET_PRIVATE(pkg);
+    Solvable *s = get_solvable(pkg);
     char *e, *v, *r;
+
+    if (dnf_sack_is_frozen(priv->sack) && s->evr != ID_EMPTY) {
+        DnfEvrSplit split = dnf_sack_get_evr_split(priv->sack, s->evr);
+        return split.release ? pool_id2str(dnf_package_get_pool(pkg), split.release) : NULL;
+    }
     pool_split_evr(dnf_package_get_pool(pkg), dnf_package_get_evr(pkg), &e, &v, &r);
     return r;
 }
@@ -688,7 +722,10 @@ dnf_package_get_downloadsize(DnfPackage *pkg)
 guint64
 dnf_package_get_epoch(DnfPackage *pkg)
 {
-    return pool_get_epoch(dnf_package_get_pool(pkg), dnf_package_get_evr(pkg));
+    Solvable *s = get_solvable(pkg);
+    if (s->evr == ID_EMPTY)
+        return 0;
+    return dnf_sack_get_evr_split(dnf_package_get_sack(pkg), s->evr).epoch;
 }
 
 /**
@@ -83,6 +83,23 @@ dnf_packageset_get_map(DnfPackageSet *pset)
     return pset->getMap();
 }
 
+/**
+ * dnf_packageset_peek_map: (skip):
+ * @pset: a #DnfPackageSet instance.
+ *
+ * Gets the map for reading. Unlike dnf_packageset_get_map() the map stays
+ * shared with copies of the set, so nothing is copied.
+ *
+ * Returns: A #Map, or %NULL
+ *
+ * Since: 0.13.0
+ */
+const Map *
+dnf_packageset_peek_map(const DnfPackageSet *pset)
+{
+    return pset->getMap();
+}
+
 /**
  * dnf_packageset_clone:
  * @pset: a #DnfPackageSet instance.
@@ -39,6 +39,7 @@ int                  dnf_packageset_has         (DnfPackageSet *pset, DnfPackage
 
 DnfPackageSet       *dnf_packageset_from_bitmap (DnfSack *sack, Map *m);
 Map             *dnf_packageset_get_map        (DnfPackageSet *pset);
+const Map       *dnf_packageset_peek_map       (const DnfPackageSet *pset);
 
 #ifdef __cplusplus
 }
@@ -19,6 +19,8 @@
  */
 
 #include <assert.h>
+#include <string>
+#include "dnf-sack.h"
 #include "hy-goal-private.hpp"
 #include "hy-iutil-private.hpp"
 #include "hy-query-private.hpp"
@@ -132,7 +134,23 @@ hy_query_filter_provides(HyQuery q, int cmp_type, const char *name,
 {
     DnfReldep *reldep = dnf_reldep_new(q->getSack(), name,
                                        static_cast<DnfComparisonKind>(cmp_type), evr);
-    assert(reldep);
+    if (!reldep) {
+        /* not in the pool of a frozen sack, match the relation by its string */
+        assert(dnf_sack_is_frozen(q->getSack()));
+        std::string str(name);
+        if (evr) {
+            str += ' ';
+            if (cmp_type & HY_LT)
+                str += '<';
+            if (cmp_type & HY_GT)
+                str += '>';
+            if (cmp_type & HY_EQ)
+                str += '=';
+            str += ' ';
+            str += evr;
+        }
+        return q->addFilter(HY_PKG_PROVIDES, HY_EQ, str.c_str());
+    }
     int ret = hy_query_filter_reldep(q, HY_PKG_PROVIDES, reldep);
     g_object_unref(reldep);
     return ret;
@@ -151,6 +169,11 @@ hy_query_filter_provides_in(HyQuery q, char **reldep_strs)
             g_object_unref(reldeplist);
             return DNF_ERROR_BAD_QUERY;
         }
+        if (dnf_sack_is_frozen(q->getSack())) {
+            g_free(name);
+            g_free(evr);
+            continue;
+        }
         reldep = dnf_reldep_new(q->getSack(), name, static_cast<DnfComparisonKind>(cmp_type), evr);
         if (reldep) {
             dnf_reldep_list_add(reldeplist, reldep);
@@ -159,7 +182,11 @@ hy_query_filter_provides_in(HyQuery q, char **reldep_strs)
         g_free(name);
         g_free(evr);
     }
-    q->addFilter(HY_PKG_PROVIDES, reldeplist);
+    /* relations that are not in the pool of a frozen sack can't be added, match the strings */
+    if (dnf_sack_is_frozen(q->getSack()))
+        q->addFilter(HY_PKG_PROVIDES, HY_EQ, (const char **)reldep_strs);
+    else
+        q->addFilter(HY_PKG_PROVIDES, reldeplist);
     g_object_unref(reldeplist);
     return 0;
 }
@@ -297,7 +324,7 @@ hy_query_is_applied(const HyQuery query)
 const Map *
 hy_query_get_result(const HyQuery query)
 {
-    return query->getResult();
+    return static_cast<const libdnf::Query *>(query)->getResult();
 }
 
 DnfSack *
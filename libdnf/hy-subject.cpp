@@ -21,6 +21,11 @@
 
 #include <stdlib.h>
 #include <fnmatch.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <solv/evr.h>
 #include "dnf-reldep.h"
 #include "dnf-sack-private.hpp"
 #include "hy-subject.h"
@@ -34,6 +39,7 @@
 #include "hy-selector.h"
 #include "hy-util-private.hpp"
 #include "sack/packageset.hpp"
+#include "sack/query.hpp"
 
 // most specific to least
 const HyForm HY_FORMS_MOST_SPEC[] = {
@@ -186,6 +192,40 @@ struct NevraToQuery {
     int query_type;
 };
 
+/* Fallbacks used when none of the NEVRA forms of the subject matched anything: NEVRA glob,
+ * provides glob and file glob, in that order. */
+static HyQuery
+get_best_solution_fallback(HySubject subject, DnfSack *sack, gboolean with_nevra,
+                           gboolean with_provides, gboolean with_filenames)
+{
+    HyQuery query = NULL;
+
+    if (with_nevra) {
+        query = hy_query_create(sack);
+        hy_query_filter(query, HY_PKG_NEVRA, HY_GLOB, subject);
+        if (!hy_query_is_empty(query))
+            return query;
+        hy_query_free(query);
+    }
+    if (with_provides) {
+        query = hy_query_create(sack);
+        hy_query_filter(query, HY_PKG_PROVIDES, HY_GLOB, subject);
+        if (!hy_query_is_empty(query))
+            return query;
+        hy_query_free(query);
+    }
+
+    if (with_filenames && hy_is_file_pattern(subject)) {
+        query = hy_query_create(sack);
+        hy_query_filter(query, HY_PKG_FILE, HY_GLOB, subject);
+        return query;
+    }
+
+    query = hy_query_create(sack);
+    hy_query_filter_empty(query);
+    return query;
+}
+
 /* Given a subject, attempt to create a query choose the first one, and update
  * the query to try to match it.
  *
@@ -216,31 +256,252 @@ hy_subject_get_best_solution(HySubject subject, DnfSack *sack, HyForm *forms, Hy
         hy_possibilities_free(iter);
         delete *nevra;
         *nevra = nullptr;
-        query = hy_query_create(sack);
-        hy_query_filter(query, HY_PKG_NEVRA, HY_GLOB, subject);
-        if (!hy_query_is_empty(query))
-            return query;
-        hy_query_free(query);
     }
-    if (with_provides) {
-        query = hy_query_create(sack);
-        hy_query_filter(query, HY_PKG_PROVIDES, HY_GLOB, subject);
-        if (!hy_query_is_empty(query))
-            return query;
-        hy_query_free(query);
+    return get_best_solution_fallback(subject, sack, with_nevra, with_provides, with_filenames);
+}
+
+namespace {
+
+/* Entry of the name index shared by all subjects of one batch. */
+struct NameIndexItem {
+    const char *name;
+    Id id;
+};
+
+/* Read-only state shared by the worker threads of one batch. */
+struct BatchContext {
+    Pool *pool;
+    const std::vector<NameIndexItem> *index;
+    const HyForm *forms;
+    gboolean icase;
+};
+
+struct BatchSubject {
+    const char *subject;
+    std::vector<Id> matches;
+    HyNevra nevra{nullptr};
+};
+
+}
+
+static bool
+name_index_cmp(const NameIndexItem & first, const NameIndexItem & second)
+{
+    int cmp = strcmp(first.name, second.name);
+    if (cmp != 0)
+        return cmp < 0;
+    return first.id < second.id;
+}
+
+static bool
+name_index_name_cmp(const NameIndexItem & first, const NameIndexItem & second)
+{
+    return strcmp(first.name, second.name) < 0;
+}
+
+/* Same splitting as pool_split_evr(), but without the pool temporary space, which must not be
+ * touched from worker threads. */
+static void
+split_evr(const char *evr, std::string & epoch, std::string & version, std::string & release)
+{
+    const char *e;
+
+    epoch.clear();
+    release.clear();
+    for (e = evr + 1; *e != ':' && *e != '-' && *e != '\0'; ++e)
+        ;
+    if (*e == '-') {
+        version.assign(evr, e - evr);
+        release.assign(e + 1);
+    } else if (*e == '\0') {
+        version.assign(evr);
+    } else {
+        epoch.assign(evr, e - evr);
+        const char *r = strchr(e + 1, '-');
+        if (r == NULL) {
+            version.assign(e + 1);
+        } else {
+            version.assign(e + 1, r - e - 1);
+            release.assign(r + 1);
+        }
     }
+}
 
-    if (with_filenames && hy_is_file_pattern(subject)) {
-        query = hy_query_create(sack);
-        hy_query_filter(query, HY_PKG_FILE, HY_GLOB, subject);
-        return query;
+static bool
+is_wildcard(const std::string & pattern)
+{
+    return pattern.empty() || pattern == "*";
+}
+
+/* Match one component of EVR the way Query filters HY_PKG_VERSION and HY_PKG_RELEASE with
+ * HY_GLOB: by fnmatch() for a true glob, by EVR comparison otherwise. */
+static bool
+evr_component_match(Pool *pool, const std::string & pattern, const std::string & value,
+                    bool is_version)
+{
+    if (hy_is_glob_pattern(pattern.c_str()))
+        return fnmatch(pattern.c_str(), value.c_str(), 0) == 0;
+    std::string vr = is_version ? value + "-0" : "0-" + value;
+    std::string filter_vr = is_version ? pattern + "-0" : "0-" + pattern;
+    return pool_evrcmp_str(pool, vr.c_str(), filter_vr.c_str(), EVRCMP_COMPARE) == 0;
+}
+
+/* Equivalent of hy_query_from_nevra() evaluated over the name index. */
+static bool
+nevra_match_solvable(const BatchContext & ctx, const Nevra & nevra, Id id)
+{
+    Pool *pool = ctx.pool;
+    Solvable *s = pool_id2solvable(pool, id);
+    bool check_evr = nevra.getEpoch() != -1 || !is_wildcard(nevra.getVersion())
+        || !is_wildcard(nevra.getRelease());
+
+    if (check_evr) {
+        if (s->evr == ID_EMPTY)
+            return false;
+        std::string epoch, version, release;
+        split_evr(pool_id2str(pool, s->evr), epoch, version, release);
+        if (nevra.getEpoch() != -1) {
+            long pkg_epoch = epoch.empty() ? 0 : strtol(epoch.c_str(), NULL, 10);
+            if (pkg_epoch != nevra.getEpoch())
+                return false;
+        }
+        if (!is_wildcard(nevra.getVersion()) &&
+            !evr_component_match(pool, nevra.getVersion(), version, true))
+            return false;
+        if (!is_wildcard(nevra.getRelease()) &&
+            !evr_component_match(pool, nevra.getRelease(), release, false))
+            return false;
+    }
+    if (!is_wildcard(nevra.getArch())) {
+        const char *arch = pool_id2str(pool, s->arch);
+        const char *pattern = nevra.getArch().c_str();
+        if (hy_is_glob_pattern(pattern)) {
+            if (fnmatch(pattern, arch, 0) != 0)
+                return false;
+        } else if (strcmp(pattern, arch) != 0)
+            return false;
     }
+    return true;
+}
 
-    query = hy_query_create(sack);
-    hy_query_filter_empty(query);
-    return query;
+static void
+nevra_match_index(const BatchContext & ctx, const Nevra & nevra, std::vector<Id> & matches)
+{
+    const std::vector<NameIndexItem> & index = *ctx.index;
+    const char *name = nevra.getName().c_str();
+
+    if (!ctx.icase && !hy_is_glob_pattern(name)) {
+        NameIndexItem key{name, 0};
+        auto range = std::equal_range(index.begin(), index.end(), key, name_index_name_cmp);
+        for (auto it = range.first; it != range.second; ++it)
+            if (nevra_match_solvable(ctx, nevra, it->id))
+                matches.push_back(it->id);
+        return;
+    }
+
+    bool wildcard = is_wildcard(nevra.getName());
+    bool glob = hy_is_glob_pattern(name);
+    const char *block_name = NULL;
+    bool block_match = false;
+    for (const auto & item : index) {
+        // items with the same name Id share the same string, so a name is matched only once
+        if (item.name != block_name) {
+            block_name = item.name;
+            if (wildcard)
+                block_match = true;
+            else if (glob)
+                block_match = fnmatch(name, item.name, ctx.icase ? FNM_CASEFOLD : 0) == 0;
+            else
+                block_match = strcasecmp(name, item.name) == 0;
+        }
+        if (block_match && nevra_match_solvable(ctx, nevra, item.id))
+            matches.push_back(item.id);
+    }
+}
+
+static void
+batch_resolve_nevra_cb(gpointer data, gpointer user_data)
+{
+    auto item = static_cast<BatchSubject *>(data);
+    auto ctx = static_cast<const BatchContext *>(user_data);
+
+    for (const HyForm *form = ctx->forms; *form != _HY_FORM_STOP_; ++form) {
+        Nevra nevra;
+        if (hy_nevra_possibility(item->subject, *form, &nevra) != 0)
+            continue;
+        nevra_match_index(*ctx, nevra, item->matches);
+        if (!item->matches.empty()) {
+            item->nevra = new Nevra(std::move(nevra));
+            return;
+        }
+    }
 }
 
+/* Batch variant of hy_subject_get_best_solution(). All lazily computed sack state is prepared
+ * once on the calling thread and a name index of the considered packages is built in a single
+ * pass over the sack. The NEVRA forms of all subjects are then parsed and matched against that
+ * index on a thread pool, touching the pool only for reading. Subjects without a NEVRA match
+ * fall back to the NEVRA glob, provides and file queries of the serial code path.
+ */
+GPtrArray *
+hy_subject_get_best_solutions(HySubject *subjects, int nsubjects, DnfSack *sack, HyForm *forms,
+                              HyNevra *nevras, gboolean icase, gboolean with_nevra,
+                              gboolean with_provides, gboolean with_filenames)
+{
+    GPtrArray *queries = g_ptr_array_new_full(nsubjects, (GDestroyNotify) hy_query_free);
+    std::vector<BatchSubject> items(nsubjects);
+
+    for (int i = 0; i < nsubjects; ++i)
+        items[i].subject = subjects[i];
+
+    if (with_nevra && nsubjects > 0) {
+        Pool *pool = dnf_sack_get_pool(sack);
+        std::vector<NameIndexItem> index;
+
+        // applying an empty query computes considered packages and the package solvables map
+        libdnf::Query base(sack);
+        base.apply();
+        const Map *result = hy_query_get_result(&base);
+        for (Id id = 1; id < pool->nsolvables; ++id) {
+            if (!MAPTST(result, id))
+                continue;
+            index.push_back({pool_id2str(pool, pool_id2solvable(pool, id)->name), id});
+        }
+        std::sort(index.begin(), index.end(), name_index_cmp);
+
+        BatchContext ctx{pool, &index, forms == NULL ? HY_FORMS_MOST_SPEC : forms, icase};
+        guint nthreads = MIN(g_get_num_processors(), (guint) nsubjects);
+        GThreadPool *thread_pool = g_thread_pool_new(batch_resolve_nevra_cb, &ctx, nthreads,
+                                                     FALSE, NULL);
+        for (auto & item : items) {
+            if (thread_pool == NULL || !g_thread_pool_push(thread_pool, &item, NULL))
+                batch_resolve_nevra_cb(&item, &ctx);
+        }
+        if (thread_pool != NULL)
+            g_thread_pool_free(thread_pool, FALSE, TRUE);
+    }
+
+    for (int i = 0; i < nsubjects; ++i) {
+        auto & item = items[i];
+        HyQuery query;
+        if (!item.matches.empty()) {
+            libdnf::PackageSet pset(sack);
+            for (Id id : item.matches)
+                pset.set(id);
+            query = hy_query_create(sack);
+            hy_query_filter_package_in(query, HY_PKG, HY_EQ, &pset);
+        } else {
+            query = get_best_solution_fallback(item.subject, sack, with_nevra, with_provides,
+                                               with_filenames);
+        }
+        if (nevras != NULL)
+            nevras[i] = item.nevra;
+        else
+            delete item.nevra;
+        g_ptr_array_add(queries, query);
+    }
+    return queries;
+}
 
 HySelector
 hy_subject_get_best_sltr(HySubject subject, DnfSack *sack, HyForm *forms, bool obsoletes,
@@ -92,6 +92,23 @@ HyQuery hy_subject_get_best_solution(HySubject subject, DnfSack *sack, HyForm *f
                                      gboolean with_provides, gboolean with_filenames);
 HyQuery hy_subject_get_best_query(HySubject subject, DnfSack *sack, gboolean with_provides);
 
+/**
+* @brief Resolves many subjects at once, with the same result as calling
+* hy_subject_get_best_solution() for each of them. NEVRA forms of all subjects are matched against
+* one name index built in a single pass over the sack, using a thread pool.
+*
+* @param subjects array of subjects
+* @param nsubjects number of subjects
+* @param sack DnfSack
+* @param forms HyForm *forms or NULL
+* @param nevras array of nsubjects HyNevra receiving the matched NEVRA of each subject, or NULL
+* @return GPtrArray of HyQuery in the order of subjects
+*/
+GPtrArray *hy_subject_get_best_solutions(HySubject *subjects, int nsubjects, DnfSack *sack,
+                                         HyForm *forms, HyNevra *nevras, gboolean icase,
+                                         gboolean with_nevra, gboolean with_provides,
+                                         gboolean with_filenames);
+
 /**
 * @brief Returns HySelector with packages that represents subject. Subject can be NEVRA, provide,
 * or file provide. Additionally result can be enrich for obsoletes if subject is NEVRA with just
@@ -41,6 +41,7 @@ extern "C" {
 #include <libdnf/dnf-repo.h>
 #include <libdnf/dnf-rpmts.h>
 #include <libdnf/dnf-sack.h>
+#include <libdnf/dnf-sack-server.h>
 #include <libdnf/dnf-state.h>
 #include <libdnf/dnf-transaction.h>
 #include <libdnf/dnf-types.h>
@@ -36,9 +36,19 @@ public:
 private:
     friend PackageSet;
     DnfSack *sack;
-    Map map;
+    /* shared with copies of the set until one of them writes */
+    std::shared_ptr<Map> map;
+
+    Map * getWritableMap();
 };
 
+static void
+map_delete(Map *map)
+{
+    map_free(map);
+    delete map;
+}
+
 PackageSet::PackageSet(DnfSack* sack) : pImpl(new Impl(sack)) {}
 PackageSet::PackageSet(DnfSack* sack, Map* map_source) : pImpl(new Impl(sack, map_source)) {}
 PackageSet::PackageSet(const PackageSet & pset): pImpl(new Impl(pset)) {}
@@ -47,23 +57,35 @@ PackageSet::~PackageSet() = default;
 PackageSet::Impl::Impl(DnfSack* sack) :
 sack(sack)
 {
-    map_init(&map, dnf_sack_get_pool(sack)->nsolvables);
+    auto new_map = new Map;
+    map_init(new_map, dnf_sack_get_pool(sack)->nsolvables);
+    map.reset(new_map, map_delete);
 }
 PackageSet::Impl::Impl(DnfSack* sack, Map* map_source) : sack(sack)
 {
-    map_init_clone(&map, map_source);
+    auto new_map = new Map;
+    map_init_clone(new_map, map_source);
+    map.reset(new_map, map_delete);
 }
-PackageSet::Impl::Impl(const PackageSet & pset): sack(pset.pImpl->sack)
+PackageSet::Impl::Impl(const PackageSet & pset): sack(pset.pImpl->sack), map(pset.pImpl->map) {}
+PackageSet::Impl::~Impl() = default;
+
+Map *
+PackageSet::Impl::getWritableMap()
 {
-    map_init_clone(&map, &pset.pImpl->map);
+    if (map.use_count() > 1) {
+        auto new_map = new Map;
+        map_init_clone(new_map, map.get());
+        map.reset(new_map, map_delete);
+    }
+    return map.get();
 }
-PackageSet::Impl::~Impl() { map_free(&map); }
 
 Id
 PackageSet::operator [](unsigned int index) const
 {
-    const unsigned char *ti = pImpl->map.map;
-    const unsigned char *end = ti + pImpl->map.size;
+    const unsigned char *ti = pImpl->map->map;
+    const unsigned char *end = ti + pImpl->map->size;
     unsigned int enabled;
     Id id;
 
@@ -75,7 +97,7 @@ PackageSet::operator [](unsigned int index) const
             ti++;
             continue;
         }
-        id = (ti - pImpl->map.map) << 3;
+        id = (ti - pImpl->map->map) << 3;
 
         index++;
         for (unsigned char byte = *ti; index; byte >>= 1) {
@@ -90,18 +112,19 @@ PackageSet::operator [](unsigned int index) const
     return id;
 }
 
-void PackageSet::set(DnfPackage *pkg) { MAPSET(&pImpl->map, dnf_package_get_id(pkg)); }
-void PackageSet::set(Id id) { MAPSET(&pImpl->map, id); }
-bool PackageSet::has(DnfPackage *pkg) const { return MAPTST(&pImpl->map, dnf_package_get_id(pkg)); }
-bool PackageSet::has(Id id) const { return MAPTST(&pImpl->map, id); }
-Map * PackageSet::getMap() { return &pImpl->map; }
+void PackageSet::set(DnfPackage *pkg) { MAPSET(pImpl->getWritableMap(), dnf_package_get_id(pkg)); }
+void PackageSet::set(Id id) { MAPSET(pImpl->getWritableMap(), id); }
+bool PackageSet::has(DnfPackage *pkg) const { return MAPTST(pImpl->map.get(), dnf_package_get_id(pkg)); }
+bool PackageSet::has(Id id) const { return MAPTST(pImpl->map.get(), id); }
+Map * PackageSet::getMap() { return pImpl->getWritableMap(); }
+const Map * PackageSet::getMap() const { return pImpl->map.get(); }
 DnfSack * PackageSet::getSack() { return pImpl->sack; }
-size_t PackageSet::size() { return map_count(&pImpl->map); }
+size_t PackageSet::size() const { return map_count(pImpl->map.get()); }
 
 Id PackageSet::next(Id previous) const
 {
-    const unsigned char *ti = pImpl->map.map;
-    const unsigned char *end = ti + pImpl->map.size;
+    const unsigned char *ti = pImpl->map->map;
+    const unsigned char *end = ti + pImpl->map->size;
     Id id;
 
     if (previous >= 0) {
@@ -121,7 +144,7 @@ Id PackageSet::next(Id previous) const
             ti++;
             continue;
         }
-        id = (ti - pImpl->map.map) << 3;
+        id = (ti - pImpl->map->map) << 3;
         for (unsigned char byte = *ti; 1; byte >>= 1, id++) {
             if (byte & 0x01)
                 return id;
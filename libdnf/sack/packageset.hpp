@@ -29,6 +29,10 @@
 
 namespace libdnf {
 
+/**
+* @brief Set of packages of one sack backed by a bitmap. Copies share the bitmap until one of
+*        them is modified, so copying a set is cheap.
+*/
 struct PackageSet {
 public:
     PackageSet(DnfSack* sack);
@@ -40,9 +44,23 @@ public:
     void set(Id id);
     bool has(DnfPackage *pkg) const;
     bool has(Id id) const;
+
+    /**
+    * @brief Returns the bitmap for modification, it stops being shared with copies of the set.
+    *        The pointer is valid until the set is copied or destroyed.
+    *
+    * @return Map*
+    */
     Map * getMap();
+
+    /**
+    * @brief Returns the bitmap for reading, it may be shared with copies of the set
+    *
+    * @return const Map*
+    */
+    const Map * getMap() const;
     DnfSack * getSack();
-    size_t size();
+    size_t size() const;
 
     /**
     * @brief Returns next id in packageset or -1 if end of package set reached
@@ -21,6 +21,8 @@
 #include <algorithm>
 #include <assert.h>
 #include <fnmatch.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <solv/bitmap.h>
@@ -34,6 +36,7 @@
 #include "../dnf-sack-private.hpp"
 #include "../dnf-advisorypkg.h"
 #include "../dnf-advisory-private.hpp"
+#include "../utils/evrcmp.hpp"
 #include "advisory.hpp"
 #include "advisorypkg.hpp"
 #include "packageset.hpp"
@@ -195,6 +198,136 @@ reldep_keyname2id(int keyname)
     }
 }
 
+/* pool_intersect_evrs() for evr strings that may be missing from the pool */
+static bool
+intersect_evrs_str(Pool *pool, int pflags, const char *pevr, int flags, const char *evr)
+{
+    if (!pflags || !flags || pflags >= 8 || flags >= 8)
+        return false;
+    if (flags == 7 || pflags == 7)
+        return true;
+    if ((pflags & flags & (REL_LT | REL_GT)) != 0)
+        return true;
+    switch (pool_evrcmp_str(pool, pevr, evr, EVRCMP_MATCH_RELEASE)) {
+        case -2:
+            return (pflags & REL_EQ) != 0;
+        case -1:
+            return (flags & REL_LT) || (pflags & REL_GT);
+        case 0:
+            return (flags & pflags & REL_EQ) != 0;
+        case 1:
+            return (flags & REL_GT) || (pflags & REL_LT);
+        case 2:
+            return (flags & REL_EQ) != 0;
+        default:
+            return false;
+    }
+}
+
+/* A relation parsed from a filter string. Frozen pools can't take new Ids, 'id' is 0 when the
+ * relation of the existing 'name' and 'evr' is not in the pool. */
+struct StrReldep {
+    Id name;
+    int flags;
+    const char *evr;
+    Id id;
+};
+
+/* pool_match_dep() of the filter relation against dep */
+static bool
+str_reldep_match_dep(Pool *pool, const StrReldep & reldep, Id dep)
+{
+    if (reldep.id)
+        return pool_match_dep(pool, reldep.id, dep);
+    if (!ISRELDEP(dep))
+        return dep == reldep.name;
+    Reldep *rd = GETRELDEP(pool, dep);
+    switch (rd->flags) {
+        case REL_AND:
+        case REL_OR:
+        case REL_WITH:
+#ifdef REL_WITHOUT
+        case REL_WITHOUT:
+#endif
+        case REL_COND:
+        case REL_UNLESS:
+            if (str_reldep_match_dep(pool, reldep, rd->name))
+                return true;
+            if ((rd->flags == REL_COND || rd->flags == REL_UNLESS) && ISRELDEP(rd->evr)) {
+                rd = GETRELDEP(pool, rd->evr);
+                if (rd->flags != REL_ELSE)
+                    return false;
+            }
+            if (rd->flags == REL_COND || rd->flags == REL_UNLESS)
+                return false;
+#ifdef REL_WITHOUT
+            if (rd->flags == REL_WITHOUT)
+                return false;
+#endif
+            return str_reldep_match_dep(pool, reldep, rd->evr);
+        default:
+            break;
+    }
+    if (!pool_match_dep(pool, reldep.name, rd->name))
+        return false;
+    return intersect_evrs_str(pool, reldep.flags, reldep.evr, rd->flags,
+                              pool_id2str(pool, rd->evr));
+}
+
+/* Resolve a reldep filter string without adding anything to the pool. Names that are not in the
+ * pool can't be provided or required by anything and are left out. */
+static void
+str_reldeps_resolve(Pool *pool, const char *match, bool glob, std::string & evr_buffer,
+                    std::vector<StrReldep> & reldeps)
+{
+    char *name = NULL;
+    char *evr = NULL;
+    int cmp_type = 0;
+    Queue names;
+
+    if (parse_reldep_str(match, &name, &evr, &cmp_type) == -1)
+        return;
+    queue_init(&names);
+    if (glob) {
+        Dataiterator di;
+        dataiterator_init(&di, pool, 0, 0, 0, name, SEARCH_STRING | SEARCH_GLOB);
+        while (dataiterator_step(&di)) {
+            Id id = pool_str2id(pool, di.kv.str, 0);
+            if (id)
+                queue_pushunique(&names, id);
+        }
+        dataiterator_free(&di);
+    } else {
+        Id id = pool_str2id(pool, name, 0);
+        if (id)
+            queue_push(&names, id);
+    }
+
+    int flags = 0;
+    if (evr) {
+        if (cmp_type & HY_EQ)
+            flags |= REL_EQ;
+        if (cmp_type & HY_LT)
+            flags |= REL_LT;
+        if (cmp_type & HY_GT)
+            flags |= REL_GT;
+        evr_buffer = evr;
+    }
+    Id evr_id = evr ? pool_str2id(pool, evr, 0) : 0;
+    for (int i = 0; i < names.count; ++i) {
+        StrReldep reldep = {names.elements[i], flags, evr ? evr_buffer.c_str() : NULL, 0};
+        if (!evr)
+            reldep.id = reldep.name;
+        else if (evr_id)
+            reldep.id = pool_rel2id(pool, reldep.name, evr_id, flags, 0);
+        reldeps.push_back(reldep);
+    }
+
+    queue_free(&names);
+    g_free(name);
+    g_free(evr);
+}
+
 static Id
 di_keyname2id(int keyname)
 {
@@ -242,62 +375,109 @@ type2flags(int type, int keyname)
     }
 }
 
-static char *
-pool_solvable_epoch_optional_2str(Pool *pool, const Solvable *s, gboolean with_epoch)
+/* Returns the ':' ending the epoch of an evr string, NULL if there is none. */
+static const char *
+evr_epoch_end(const char *evr)
+{
+    if (*evr == '\0')
+        return NULL;
+    for (const char *e = evr + 1; *e != '-' && *e != '\0'; ++e) {
+        if (*e == ':')
+            return e;
+    }
+    return NULL;
+}
+
+/* Formats the NEVRA of a solvable into buffer, the epoch is always shown
+ * with with_epoch and never without it. */
+static void
+solvable_nevra_to_buffer(Pool *pool, const Solvable *s, bool with_epoch, std::string & buffer)
 {
-    const char *e;
-    const char *name = pool_id2str(pool, s->name);
     const char *evr = pool_id2str(pool, s->evr);
+    const char *epoch_end = evr_epoch_end(evr);
     const char *arch = pool_id2str(pool, s->arch);
-    bool present_epoch = false;
 
-    for (e = evr + 1; *e != '-' && *e != '\0'; ++e) {
-        if (*e == ':') {
-            present_epoch = true;
-            break;
-        }
+    buffer.assign(pool_id2str(pool, s->name));
+    if (!epoch_end && with_epoch) {
+        buffer.append("-0:");
+        buffer.append(evr);
+    } else if (*evr != '\0') {
+        buffer.push_back('-');
+        buffer.append(epoch_end && !with_epoch ? epoch_end + 1 : evr);
     }
-    char *output_string;
-    int evr_length, arch_length;
-    int extra_epoch_length = 0;
-    int name_length = strlen(name);
-    evr_length = strlen(evr);
-    arch_length = strlen(arch);
-    if (!present_epoch && with_epoch) {
-        extra_epoch_length = 2;
-    } else if (present_epoch && !with_epoch) {
-        extra_epoch_length = evr - e - 1;
+    if (*arch != '\0') {
+        buffer.push_back('.');
+        buffer.append(arch);
     }
+}
 
-    output_string = pool_alloctmpspace(
-        pool, name_length + evr_length + extra_epoch_length + arch_length + 3);
-
-    strcpy(output_string, name);
+/* One way to read an exact NEVRA pattern: name and arch as pool Ids and the
+ * rest as the evr to compare. */
+struct NevraCandidate {
+    Id name;
+    Id arch;
+    const char *evr;    /* not NUL terminated */
+    size_t evrLength;
+    bool withEpoch;
+};
 
-    if (evr_length || extra_epoch_length > 0) {
-        output_string[name_length++] = '-';
+static bool
+nevra_candidate_cmp(const NevraCandidate & first, const NevraCandidate & second)
+{
+    if (first.name != second.name)
+        return first.name < second.name;
+    return first.arch < second.arch;
+}
 
-        if (extra_epoch_length > 0) {
-            output_string[name_length++] = '0';
-            output_string[name_length++] = ':';
-            output_string[name_length] = '\0';
-        }
+/**
+ * Parse an exact NEVRA pattern once instead of formatting every solvable.
+ * Names may contain dashes, so every dash before the arch yields a candidate
+ * if the name before it is known to the pool. Returns false if the pattern
+ * has to be compared as a string.
+ */
+static bool
+nevra_pattern_split(Pool *pool, const char *pattern, std::vector<NevraCandidate> & candidates)
+{
+    const char *dot = strrchr(pattern, '.');
+    if (dot == NULL)
+        return false;
+    Id arch = pool_str2id(pool, dot + 1, 0);
+    if (arch == 0)
+        return true;
+    bool withEpoch = strchr(pattern, ':') != NULL;
+
+    /* solvables without evr are formatted as "name.arch" */
+    if (!withEpoch) {
+        Id name = pool_strn2id(pool, pattern, dot - pattern, 0);
+        if (name != 0)
+            candidates.push_back({name, arch, dot, 0, false});
     }
-
-    if (evr_length) {
-        if (extra_epoch_length >= 0) {
-            strcpy(output_string + name_length, evr);
-        } else {
-            strcpy(output_string + name_length, evr - extra_epoch_length);
-            evr_length = evr_length + extra_epoch_length;
-        }
+    for (const char *dash = strchr(pattern, '-'); dash && dash + 1 < dot;
+         dash = strchr(dash + 1, '-')) {
+        Id name = pool_strn2id(pool, pattern, dash - pattern, 0);
+        if (name != 0)
+            candidates.push_back({name, arch, dash + 1, size_t(dot - dash - 1), withEpoch});
     }
+    return true;
+}
 
-    if (arch_length) {
-        output_string[name_length + evr_length] = '.';
-        strcpy(output_string + name_length + evr_length + 1, arch);
+static bool
+nevra_candidate_match_evr(Pool *pool, const NevraCandidate & candidate, Id evr_id)
+{
+    const char *evr = pool_id2str(pool, evr_id);
+    const char *epoch_end = evr_epoch_end(evr);
+    const char *match = candidate.evr;
+    size_t length = candidate.evrLength;
+
+    if (candidate.withEpoch && !epoch_end) {
+        if (length < 2 || match[0] != '0' || match[1] != ':')
+            return false;
+        match += 2;
+        length -= 2;
+    } else if (!candidate.withEpoch && epoch_end) {
+        evr = epoch_end + 1;
     }
-    return output_string;
+    return strlen(evr) == length && memcmp(evr, match, length) == 0;
 }
 
 static int
@@ -534,6 +714,7 @@ private:
     int flags;
     std::unique_ptr<PackageSet> result;
     std::vector<Filter> filters;
+    std::string nevraBuffer;    /* reused by filterNevra() */
     void apply();
     void initResult();
     void filterPkg(const Filter & f, Map *m);
@@ -548,6 +729,7 @@ private:
     void filterSourcerpm(const Filter & f, Map *m);
     void filterObsoletes(const Filter & f, Map *m);
     void filterProvidesReldep(const Filter & f, Map *m);
+    void filterReldepStr(const Filter & f, Map *m);
     void filterReponame(const Filter & f, Map *m);
     void filterLocation(const Filter & f, Map *m);
     void filterAdvisory(const Filter & f, Map *m, int keyname);
@@ -602,7 +784,16 @@ Query::getResult() noexcept
         return nullptr;
 }
 
-const Map * Query::getResult() const noexcept { return pImpl->result->getMap(); }
+const Map *
+Query::getResult() const noexcept
+{
+    // the const overload reads the bitmap without unsharing it
+    const PackageSet *resultPset = pImpl->result.get();
+    if (resultPset)
+        return resultPset->getMap();
+    else
+        return nullptr;
+}
 bool Query::getApplied() const noexcept { return pImpl->applied; }
 DnfSack * Query::getSack() { return pImpl->sack; }
 
@@ -687,6 +878,16 @@ Query::addFilter(int keyname, int cmp_type, const char *match)
         case HY_PKG_SUPPLEMENTS: {
             DnfSack *sack = pImpl->sack;
 
+            /* adding the relation to the pool of a frozen sack would race with the other
+             * readers, match it by the string instead */
+            if (dnf_sack_is_frozen(sack)) {
+                if (match[0] == '(')
+                    return DNF_ERROR_BAD_QUERY;
+                pImpl->filters.push_back(Filter(keyname, cmp_type == HY_GLOB ? HY_GLOB : HY_EQ,
+                                                match));
+                return 0;
+            }
+
             if (cmp_type == HY_GLOB) {
                 DnfReldepList *reldeplist = reldeplist_from_str(sack, match);
                 if (reldeplist == NULL)
@@ -759,12 +960,12 @@ Query::Impl::initResult()
 
     int sack_pool_nsolvables = dnf_sack_get_pool_nsolvables(sack);
     if (sack_pool_nsolvables != 0 && sack_pool_nsolvables == pool->nsolvables)
-        result.reset(new PackageSet(sack, dnf_sack_get_pkg_solvables(sack)));
+        result.reset(new PackageSet(*dnf_sack_get_pkg_solvables(sack)));
     else {
         result.reset(new PackageSet(sack));
         FOR_PKG_SOLVABLES(solvid)
             result->set(solvid);
-        dnf_sack_set_pkg_solvables(sack, result->getMap(), pool->nsolvables);
+        dnf_sack_set_pkg_solvables(sack, *result, pool->nsolvables);
     }
     if (!(flags & HY_IGNORE_EXCLUDES)) {
         dnf_sack_recompute_considered(sack);
@@ -780,7 +981,7 @@ Query::Impl::filterPkg(const Filter & f, Map *m)
     assert(f.getMatchType() == _HY_PKG);
 
     map_free(m);
-    map_init_clone(m, dnf_packageset_get_map(f.getMatches()[0].pset));
+    map_init_clone(m, dnf_packageset_peek_map(f.getMatches()[0].pset));
 }
 
 void
@@ -934,8 +1135,7 @@ Query::Impl::filterEpoch(const Filter & f, Map *m)
             if (s->evr == ID_EMPTY)
                 continue;
 
-            const char *evr = pool_id2str(pool, s->evr);
-            unsigned long pkg_epoch = pool_get_epoch(pool, evr);
+            unsigned long pkg_epoch = dnf_sack_get_evr_split(sack, s->evr).epoch;
 
             if ((pkg_epoch > epoch && cmp_type & HY_GT) ||
                 (pkg_epoch < epoch && cmp_type & HY_LT) ||
@@ -953,7 +1153,8 @@ Query::Impl::filterEvr(const Filter & f, Map *m)
     auto resultPset = result.get();
 
     for (auto match : f.getMatches()) {
-        Id match_evr = pool_str2id(pool, match.str, 1);
+        /* no new string for the match, the sack can be frozen */
+        Id match_evr = pool_str2id(pool, match.str, 0);
 
         Id id = -1;
         while (true) {
@@ -961,7 +1162,8 @@ Query::Impl::filterEvr(const Filter & f, Map *m)
             if (id == -1)
                 break;
             Solvable *s = pool_id2solvable(pool, id);
-            int cmp = pool_evrcmp(pool, s->evr, match_evr, EVRCMP_COMPARE);
+            int cmp = match_evr ? pool_evrcmp(pool, s->evr, match_evr, EVRCMP_COMPARE) :
+                pool_evrcmp_str(pool, pool_id2str(pool, s->evr), match.str, EVRCMP_COMPARE);
 
             if ((cmp > 0 && cmp_type & HY_GT) || (cmp < 0 && cmp_type & HY_LT) ||
                 (cmp == 0 && cmp_type & HY_EQ)) {
@@ -978,13 +1180,44 @@ Query::Impl::filterNevra(const Filter & f, Map *m)
     int cmp_type = f.getCmpType();
     int fn_flags = (HY_ICASE & cmp_type) ? FNM_CASEFOLD : 0;
     auto resultPset = result.get();
+    std::vector<NevraCandidate> candidates;
+    std::vector<const char *> patterns;
 
     for (auto match : f.getMatches()) {
         const char *nevra_pattern = match.str;
         if (strpbrk(nevra_pattern, "(/=<> "))
             continue;
+        bool exact = !(HY_ICASE & cmp_type) &&
+            (!(HY_GLOB & cmp_type) ||
+             (!hy_is_glob_pattern(nevra_pattern) && !strchr(nevra_pattern, '\\')));
+        if (exact && nevra_pattern_split(pool, nevra_pattern, candidates))
+            continue;
+        patterns.push_back(nevra_pattern);
+    }
+
+    if (!candidates.empty()) {
+        std::sort(candidates.begin(), candidates.end(), nevra_candidate_cmp);
+        Id id = -1;
+        while (true) {
+            id = resultPset->next(id);
+            if (id == -1)
+                break;
+            Solvable *s = pool_id2solvable(pool, id);
+            NevraCandidate key{s->name, s->arch, NULL, 0, false};
+            auto range = std::equal_range(candidates.begin(), candidates.end(), key,
+                                          nevra_candidate_cmp);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (nevra_candidate_match_evr(pool, *it, s->evr)) {
+                    MAPSET(m, id);
+                    break;
+                }
+            }
+        }
+    }
 
-        gboolean present_epoch = strchr(nevra_pattern, ':') != NULL;
+    /* globs and case insensitive patterns need the formatted NEVRA */
+    for (auto nevra_pattern : patterns) {
+        bool present_epoch = strchr(nevra_pattern, ':') != NULL;
 
         Id id = -1;
         while (true) {
@@ -993,7 +1226,8 @@ Query::Impl::filterNevra(const Filter & f, Map *m)
                 break;
             Solvable* s = pool_id2solvable(pool, id);
 
-            char* nevra = pool_solvable_epoch_optional_2str(pool, s, present_epoch);
+            solvable_nevra_to_buffer(pool, s, present_epoch, nevraBuffer);
+            const char *nevra = nevraBuffer.c_str();
             if (!(HY_GLOB & cmp_type)) {
                 if (HY_ICASE & cmp_type) {
                     if (strcasecmp(nevra_pattern, nevra) == 0)
@@ -1009,43 +1243,59 @@ Query::Impl::filterNevra(const Filter & f, Map *m)
     }
 }
 
+/* Match the version or release component of evr against one filter value. Every distinct evr
+ * is evaluated only once, solvables sharing it are answered from 'results'. Stays away from the
+ * pool temporary space, so that frozen sacks can be queried from several threads. */
+static bool
+evr_component_match(DnfSack *sack, Id evr, bool version, const char *match,
+                    const char *filter_vr, int cmp_type, std::unordered_map<Id, bool> & results)
+{
+    auto found = results.find(evr);
+    if (found != results.end())
+        return found->second;
+
+    Pool *pool = dnf_sack_get_pool(sack);
+    DnfEvrSplit split = dnf_sack_get_evr_split(sack, evr);
+    Id component = version ? split.version : split.release;
+    const char *str = component ? pool_id2str(pool, component) : "";
+    bool matched;
+
+    if (cmp_type & HY_GLOB) {
+        matched = fnmatch(match, str, 0) == 0;
+    } else {
+        std::string vr = version ? std::string(str) + "-0" : "0-" + std::string(str);
+        int cmp = libdnf::evrcmp(vr.c_str(), filter_vr);
+        matched = (cmp > 0 && cmp_type & HY_GT) ||
+                  (cmp < 0 && cmp_type & HY_LT) ||
+                  (cmp == 0 && cmp_type & HY_EQ);
+    }
+    results.emplace(evr, matched);
+    return matched;
+}
+
 void
 Query::Impl::filterVersion(const Filter & f, Map *m)
 {
     Pool *pool = dnf_sack_get_pool(sack);
     int cmp_type = f.getCmpType();
     auto resultPset = result.get();
+    std::unordered_map<Id, bool> results;
 
     for (auto match_in : f.getMatches()) {
         const char *match = match_in.str;
         char *filter_vr = solv_dupjoin(match, "-0", NULL);
 
+        results.clear();
         Id id = -1;
         while (true) {
             id = resultPset->next(id);
             if (id == -1)
                 break;
-            char *e, *v, *r;
             Solvable *s = pool_id2solvable(pool, id);
             if (s->evr == ID_EMPTY)
                 continue;
-            const char *evr = pool_id2str(pool, s->evr);
-
-            pool_split_evr(pool, evr, &e, &v, &r);
-
-            if (cmp_type & HY_GLOB) {
-                if (fnmatch(match, v, 0) == 0)
-                    MAPSET(m, id);
-                continue;
-            }
-
-            char *vr = pool_tmpjoin(pool, v, "-0", NULL);
-            int cmp = pool_evrcmp_str(pool, vr, filter_vr, EVRCMP_COMPARE);
-            if ((cmp > 0 && cmp_type & HY_GT) ||
-                (cmp < 0 && cmp_type & HY_LT) ||
-                (cmp == 0 && cmp_type & HY_EQ)) {
+            if (evr_component_match(sack, s->evr, true, match, filter_vr, cmp_type, results))
                 MAPSET(m, id);
-            }
         }
         solv_free(filter_vr);
     }
@@ -1057,39 +1307,23 @@ Query::Impl::filterRelease(const Filter & f, Map *m)
     Pool *pool = dnf_sack_get_pool(sack);
     int cmp_type = f.getCmpType();
     auto resultPset = result.get();
+    std::unordered_map<Id, bool> results;
 
     for (auto match_in : f.getMatches()) {
         const char *match = match_in.str;
         char *filter_vr = solv_dupjoin("0-", match, NULL);
 
+        results.clear();
         Id id = -1;
         while (true) {
             id = resultPset->next(id);
             if (id == -1)
                 break;
-            char *e, *v, *r;
             Solvable *s = pool_id2solvable(pool, id);
             if (s->evr == ID_EMPTY)
                 continue;
-            const char *evr = pool_id2str(pool, s->evr);
-
-            pool_split_evr(pool, evr, &e, &v, &r);
-
-            if (cmp_type & HY_GLOB) {
-                if (fnmatch(match, r, 0) == 0)
-                    MAPSET(m, id);
-                continue;
-            }
-
-            char *vr = pool_tmpjoin(pool, "0-", r, NULL);
-
-            int cmp = pool_evrcmp_str(pool, vr, filter_vr, EVRCMP_COMPARE);
-
-            if ((cmp > 0 && cmp_type & HY_GT) ||
-                (cmp < 0 && cmp_type & HY_LT) ||
-                (cmp == 0 && cmp_type & HY_EQ)) {
+            if (evr_component_match(sack, s->evr, false, match, filter_vr, cmp_type, results))
                 MAPSET(m, id);
-            }
         }
         solv_free(filter_vr);
     }
@@ -1168,12 +1402,12 @@ Query::Impl::filterObsoletes(const Filter & f, Map *m)
 {
     Pool *pool = dnf_sack_get_pool(sack);
     int obsprovides = pool_get_flag(pool, POOL_FLAG_OBSOLETEUSESPROVIDES);
-    Map *target;
+    const Map *target;
     auto resultPset = result.get();
 
     assert(f.getMatchType() == _HY_PKG);
     assert(f.getMatches().size() == 1);
-    target = dnf_packageset_get_map(f.getMatches()[0].pset);
+    target = dnf_packageset_peek_map(f.getMatches()[0].pset);
     dnf_sack_make_provides_ready(sack);
     Id id = -1;
     while (true) {
@@ -1214,6 +1448,75 @@ Query::Impl::filterProvidesReldep(const Filter & f, Map *m)
     }
 }
 
+void
+Query::Impl::filterReldepStr(const Filter & f, Map *m)
+{
+    assert(f.getMatchType() == _HY_STR);
+
+    Pool *pool = dnf_sack_get_pool(sack);
+    bool glob = f.getCmpType() & HY_GLOB;
+    std::vector<StrReldep> reldeps;
+    std::vector<std::string> evrs(f.getMatches().size());
+    Queue deps;
+    Id p, pp;
+
+    for (size_t i = 0; i < f.getMatches().size(); ++i)
+        str_reldeps_resolve(pool, f.getMatches()[i].str, glob, evrs[i], reldeps);
+
+    dnf_sack_make_provides_ready(sack);
+    queue_init(&deps);
+    if (f.getKeyname() == HY_PKG_PROVIDES) {
+        for (auto & reldep : reldeps) {
+            if (reldep.id) {
+                FOR_PROVIDES(p, pp, reldep.id)
+                    MAPSET(m, p);
+                continue;
+            }
+            /* what pool_whatprovides() does for a relation, an unversioned provide matches
+             * every version */
+            FOR_PROVIDES(p, pp, reldep.name) {
+                queue_empty(&deps);
+                solvable_lookup_idarray(pool_id2solvable(pool, p), SOLVABLE_PROVIDES, &deps);
+                for (int j = 0; j < deps.count; ++j) {
+                    Id dep = deps.elements[j];
+                    if (dep == reldep.name) {
+                        MAPSET(m, p);
+                        break;
+                    }
+                    if (!ISRELDEP(dep))
+                        continue;
+                    Reldep *rd = GETRELDEP(pool, dep);
+                    if (rd->name == reldep.name &&
+                        intersect_evrs_str(pool, rd->flags, pool_id2str(pool, rd->evr),
+                                           reldep.flags, reldep.evr)) {
+                        MAPSET(m, p);
+                        break;
+                    }
+                }
+            }
+        }
+    } else {
+        Id rco_key = reldep_keyname2id(f.getKeyname());
+        auto resultPset = result.get();
+        Id s_id = -1;
+        while ((s_id = resultPset->next(s_id)) != -1) {
+            queue_empty(&deps);
+            solvable_lookup_idarray(pool_id2solvable(pool, s_id), rco_key, &deps);
+            for (auto & reldep : reldeps) {
+                int j;
+                for (j = 0; j < deps.count; ++j)
+                    if (str_reldep_match_dep(pool, reldep, deps.elements[j]))
+                        break;
+                if (j < deps.count) {
+                    MAPSET(m, s_id);
+                    break;
+                }
+            }
+        }
+    }
+    queue_free(&deps);
+}
+
 void
 Query::Impl::filterReponame(const Filter & f, Map *m)
 {
@@ -1369,7 +1672,7 @@ Query::Impl::filterAdvisory(const Filter & f, Map *m, int keyname)
         while (low != pkgsSecondRun.end() && low->getName() == s->name &&
             low->getArch() == s->arch) {
 
-            int cmp = pool_evrcmp(pool, s->evr, low->getEVR(), EVRCMP_COMPARE);
+            int cmp = dnf_sack_evr_split_cmp(sack, s->evr, low->getEVR());
             if ((cmp > 0 && cmp_type & HY_GT) ||
                 (cmp < 0 && cmp_type & HY_LT) ||
                 (cmp == 0 && cmp_type & HY_EQ)) {
@@ -1482,7 +1785,7 @@ Query::Impl::filterUpdownAble(const Filter  &f, Map *m)
     if (!pool->installed) {
         return;
     }
-    auto resultMap = result->getMap();
+    const Map *resultMap = static_cast<const PackageSet *>(result.get())->getMap();
 
     for (auto match_in : f.getMatches()) {
         if (match_in.num == 0)
@@ -1543,7 +1846,7 @@ Query::Impl::apply()
     if (!result)
         initResult();
     map_init(&m, pool->nsolvables);
-    assert(m.size == result->getMap()->size);
+    assert(m.size == static_cast<const PackageSet *>(result.get())->getMap()->size);
     for (auto f : filters) {
         map_empty(&m);
         switch (f.getKeyname()) {
@@ -1555,7 +1858,10 @@ Query::Impl::apply()
                 /* used to set query empty by keeping Map m empty */
                 break;
             case HY_PKG_CONFLICTS:
-                filterRcoReldep(f, &m);
+                if (f.getMatchType() == _HY_STR)
+                    filterReldepStr(f, &m);
+                else
+                    filterRcoReldep(f, &m);
                 break;
             case HY_PKG_NAME:
                 filterName(f, &m);
@@ -1584,22 +1890,32 @@ Query::Impl::apply()
             case HY_PKG_OBSOLETES:
                 if (f.getMatchType() == _HY_RELDEP)
                     filterRcoReldep(f, &m);
+                else if (f.getMatchType() == _HY_STR)
+                    filterReldepStr(f, &m);
                 else {
                     assert(f.getMatchType() == _HY_PKG);
                     filterObsoletes(f, &m);
                 }
                 break;
             case HY_PKG_PROVIDES:
-                assert(f.getMatchType() == _HY_RELDEP);
-                filterProvidesReldep(f, &m);
+                if (f.getMatchType() == _HY_STR)
+                    filterReldepStr(f, &m);
+                else {
+                    assert(f.getMatchType() == _HY_RELDEP);
+                    filterProvidesReldep(f, &m);
+                }
                 break;
             case HY_PKG_ENHANCES:
             case HY_PKG_RECOMMENDS:
             case HY_PKG_REQUIRES:
             case HY_PKG_SUGGESTS:
             case HY_PKG_SUPPLEMENTS:
-                assert(f.getMatchType() == _HY_RELDEP);
-                filterRcoReldep(f, &m);
+                if (f.getMatchType() == _HY_STR)
+                    filterReldepStr(f, &m);
+                else {
+                    assert(f.getMatchType() == _HY_RELDEP);
+                    filterRcoReldep(f, &m);
+                }
                 break;
             case HY_PKG_REPONAME:
                 filterReponame(f, &m);
@@ -1635,6 +1951,7 @@ Query::Impl::apply()
             map_and(result->getMap(), &m);
     }
     map_free(&m);
+    dnf_sack_check_frozen(sack);
 
     applied = true;
     filters.clear();
@@ -1673,26 +1990,26 @@ Query::getIndexItem(int index)
 }
 
 void
-Query::queryUnion(Query other)
+Query::queryUnion(const Query & other)
 {
     apply();
-    other.apply();
+    other.pImpl->apply();
     map_or(pImpl->result->getMap(), other.getResult());
 }
 
 void
-Query::queryIntersection(Query other)
+Query::queryIntersection(const Query & other)
 {
     apply();
-    other.apply();
+    other.pImpl->apply();
     map_and(pImpl->result->getMap(), other.getResult());
 }
 
 void
-Query::queryDifference(Query other)
+Query::queryDifference(const Query & other)
 {
     apply();
-    other.apply();
+    other.pImpl->apply();
     map_subtract(pImpl->result->getMap(), other.getResult());
 }
 
@@ -1700,8 +2017,9 @@ bool
 Query::empty()
 {
     apply();
-    const unsigned char *res = pImpl->result->getMap()->map;
-    const unsigned char *end = res + pImpl->result->getMap()->size;
+    const Map *resultMap = static_cast<const Query *>(this)->getResult();
+    const unsigned char *res = resultMap->map;
+    const unsigned char *end = res + resultMap->size;
 
     while (res < end) {
         if (*res++)
@@ -1719,7 +2037,6 @@ Query::filterExtras()
 
     apply();
 
-    auto resultMap = pImpl->result->getMap();
     Query query_installed(*this);
     query_installed.addFilter(HY_PKG_REPONAME, HY_EQ, HY_SYSTEM_REPO_NAME);
     Query query_available(*this);
@@ -1727,6 +2044,7 @@ Query::filterExtras()
 
     query_installed.apply();
     query_available.apply();
+    auto resultMap = pImpl->result->getMap();
     MAPZERO(resultMap);
     Id id_installed = -1;
     auto resultInstalled = query_installed.pImpl->result.get();
@@ -1848,7 +2166,7 @@ Query::getAdvisoryPkgs(int cmpType, std::vector<AdvisoryPkg> & advisoryPkgs)
         auto low = std::lower_bound(pkgs.begin(), pkgs.end(), *s,
                                     advisoryPkgCompareSolvableNameArch);
         while (low != pkgs.end() && low->getName() == s->name && low->getArch() == s->arch) {
-            int cmp = pool_evrcmp(pool, low->getEVR(), s->evr, EVRCMP_COMPARE);
+            int cmp = dnf_sack_evr_split_cmp(pImpl->sack, low->getEVR(), s->evr);
             if ((cmp > 0 && cmpType & HY_GT) ||
                 (cmp < 0 && cmpType & HY_LT) ||
                 (cmp == 0 && cmpType & HY_EQ)) {
@@ -1868,7 +2186,7 @@ hy_query_to_name_ordered_queue(HyQuery query, Queue *samename)
     Pool *pool = dnf_sack_get_pool(query->getSack());
 
     queue_init(samename);
-    const auto result = query->getResult();
+    const Map *result = hy_query_get_result(query);
     for (int i = 1; i < pool->nsolvables; ++i)
         if (MAPTST(result, i))
             queue_push(samename, i);
@@ -1883,7 +2201,7 @@ hy_query_to_name_arch_ordered_queue(HyQuery query, Queue *samename)
     Pool *pool = dnf_sack_get_pool(query->getSack());
 
     queue_init(samename);
-    const auto result = query->getResult();
+    const Map *result = hy_query_get_result(query);
     for (int i = 1; i < pool->nsolvables; ++i)
         if (MAPTST(result, i))
             queue_push(samename, i);
@@ -152,6 +152,7 @@ Selector::matches()
 
     queue_init(&solvables);
     selection_solvables(pool, &job, &solvables);
+    dnf_sack_check_frozen(sack);
 
     GPtrArray *plist = hy_packagelist_create();
     for (int i = 0; i < solvables.count; i++)
@@ -20,6 +20,8 @@
 
 #include "item.hpp"
 
+constexpr std::size_t Item::maxBoundValues;
+
 Item::Item(SQLite3Ptr conn)
   : conn{conn}
 {
@@ -50,3 +52,13 @@ Item::toStr()
 {
     return "<Item #" + std::to_string(getId()) + ">";
 }
+
+std::string
+Item::placeholders(std::size_t count)
+{
+    std::string result;
+    for (std::size_t i = 0; i < count; ++i) {
+        result += i > 0 ? ", ?" : "?";
+    }
+    return result;
+}
@@ -21,6 +21,7 @@
 #ifndef LIBDNF_SWDB_ITEM_HPP
 #define LIBDNF_SWDB_ITEM_HPP
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -70,6 +71,12 @@ public:
 protected:
     void dbInsert();
 
+    /// Most values bound to one statement; older SQLite limits them to 999.
+    static constexpr std::size_t maxBoundValues = 500;
+
+    /// Returns "?, ?, ..." with count placeholders for an IN (...) list.
+    static std::string placeholders(std::size_t count);
+
     SQLite3Ptr conn;
     int64_t id = 0;
     const ItemType itemType = ItemType::UNKNOWN;
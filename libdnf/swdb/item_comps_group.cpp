@@ -227,6 +227,56 @@ CompsGroupItem::getTransactionItems(SQLite3Ptr conn, int64_t transactionId)
     return result;
 }
 
+/**
+ * Load items of the transactions with the given ids, one query per maxBoundValues ids.
+ * \param transIds transaction ids in ascending order
+ * \return transaction items ordered by transaction id
+ */
+std::vector< TransactionItemPtr >
+CompsGroupItem::getTransactionItems(SQLite3Ptr conn, const std::vector< int64_t > &transIds)
+{
+    std::vector< TransactionItemPtr > result;
+
+    const char *select = R"**(
+        SELECT
+            ti.trans_id,
+            ti.id as ti_id,
+            ti.action as ti_action,
+            ti.reason as ti_reason,
+            ti.done as ti_done,
+            i.item_id,
+            i.groupid,
+            i.name,
+            i.translated_name,
+            i.pkg_types
+        FROM
+            trans_item ti
+        JOIN
+            comps_group i USING (item_id)
+        WHERE
+            ti.trans_id IN (
+    )**";
+    const char *order = R"**(
+            )
+        ORDER BY
+            ti.trans_id,
+            ti.id
+    )**";
+    for (std::size_t begin = 0; begin < transIds.size(); begin += maxBoundValues) {
+        auto count = std::min(transIds.size() - begin, maxBoundValues);
+        SQLite3::Query query(*conn, select + placeholders(count) + order);
+        for (std::size_t i = 0; i < count; ++i) {
+            query.bind(static_cast< int >(i + 1), transIds[begin + i]);
+        }
+
+        while (query.step() == SQLite3::Statement::StepResult::ROW) {
+            result.push_back(
+                compsGroupTransactionItemFromQuery(conn, query, query.get< int64_t >("trans_id")));
+        }
+    }
+    return result;
+}
+
 std::string
 CompsGroupItem::toStr()
 {
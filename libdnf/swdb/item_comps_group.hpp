@@ -69,6 +69,8 @@ public:
         const std::string &pattern);
     static std::vector< TransactionItemPtr > getTransactionItems(SQLite3Ptr conn,
                                                                  int64_t transactionId);
+    static std::vector< TransactionItemPtr > getTransactionItems(SQLite3Ptr conn,
+                                                                 const std::vector< int64_t > &transIds);
 
 protected:
     const ItemType itemType = ItemType::GROUP;
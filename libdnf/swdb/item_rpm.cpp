@@ -20,12 +20,13 @@
 
 #include <algorithm>
 #include <map>
-#include <sstream>
 
 #include "../hy-nevra.hpp"
 #include "../hy-subject.h"
+#include "../utils/evrcmp.hpp"
 
 #include "item_rpm.hpp"
+#include "transformer.hpp"
 
 static const std::map< TransactionItemReason, int > reasonPriorities = {
     {TransactionItemReason::UNKNOWN, 0},
@@ -156,6 +157,60 @@ RPMItem::getTransactionItems(SQLite3Ptr conn, int64_t transaction_id)
     return result;
 }
 
+/**
+ * Load items of the transactions with the given ids, one query per maxBoundValues ids.
+ * \param transIds transaction ids in ascending order
+ * \return transaction items ordered by transaction id
+ */
+std::vector< TransactionItemPtr >
+RPMItem::getTransactionItems(SQLite3Ptr conn, const std::vector< int64_t > &transIds)
+{
+    std::vector< TransactionItemPtr > result;
+
+    const char *select = R"**(
+        SELECT
+            ti.trans_id,
+            ti.id,
+            ti.action,
+            ti.reason,
+            ti.done,
+            r.repoid,
+            i.item_id,
+            i.name,
+            i.epoch,
+            i.version,
+            i.release,
+            i.arch
+        FROM
+            trans_item ti
+        JOIN
+            repo r ON ti.repo_id = r.id
+        JOIN
+            rpm i ON ti.item_id = i.item_id
+        WHERE
+            ti.trans_id IN (
+    )**";
+    const char *order = R"**(
+            )
+        ORDER BY
+            ti.trans_id,
+            ti.id
+    )**";
+    for (std::size_t begin = 0; begin < transIds.size(); begin += maxBoundValues) {
+        auto count = std::min(transIds.size() - begin, maxBoundValues);
+        SQLite3::Query query(*conn, select + placeholders(count) + order);
+        for (std::size_t i = 0; i < count; ++i) {
+            query.bind(static_cast< int >(i + 1), transIds[begin + i]);
+        }
+
+        while (query.step() == SQLite3::Statement::StepResult::ROW) {
+            result.push_back(
+                transactionItemFromQuery(conn, query, query.get< int64_t >("trans_id")));
+        }
+    }
+    return result;
+}
+
 std::string
 RPMItem::getNEVRA()
 {
@@ -255,11 +310,65 @@ RPMItem::getTransactionItem(SQLite3Ptr conn, const std::string &nevra)
     return nullptr;
 }
 
-TransactionItemReason
-RPMItem::resolveTransactionItemReason(SQLite3Ptr conn,
-                                      const std::string &name,
-                                      const std::string &arch,
-                                      int64_t maxTransactionId)
+static TransactionItemReason
+resolveCurrentReason(SQLite3Ptr conn, const std::string &name, const std::string &arch)
+{
+    if (arch != "") {
+        const char *sql = R"**(
+            SELECT
+                action,
+                reason
+            FROM
+                current_reason
+            WHERE
+                name = ?
+                AND arch = ?
+        )**";
+
+        SQLite3::Query query(*conn, sql);
+        query.bindv(name, arch);
+
+        if (query.step() == SQLite3::Statement::StepResult::ROW) {
+            auto action = static_cast< TransactionItemAction >(query.get< int64_t >(0));
+            if (action == TransactionItemAction::REMOVE) {
+                return TransactionItemReason::UNKNOWN;
+            }
+            auto reason = static_cast< TransactionItemReason >(query.get< int64_t >(1));
+            return reason;
+        }
+    } else {
+        const char *sql = R"**(
+            SELECT
+                action,
+                reason
+            FROM
+                current_reason
+            WHERE
+                name = ?
+        )**";
+
+        SQLite3::Query query(*conn, sql);
+        query.bindv(name);
+
+        TransactionItemReason result = TransactionItemReason::UNKNOWN;
+
+        while (query.step() == SQLite3::Statement::StepResult::ROW) {
+            auto action = static_cast< TransactionItemAction >(query.get< int64_t >(0));
+            if (action == TransactionItemAction::REMOVE) {
+                continue;
+            }
+            auto reason = static_cast< TransactionItemReason >(query.get< int64_t >(1));
+            if (reasonPriorities.at(reason) > reasonPriorities.at(result)) {
+                result = reason;
+            }
+        }
+        return result;
+    }
+    return TransactionItemReason::UNKNOWN;
+}
+
+static TransactionItemReason
+resolveHistoryReason(SQLite3Ptr conn, const std::string &name, const std::string &arch)
 {
     const char *sql = R"**(
         SELECT
@@ -330,75 +439,270 @@ RPMItem::resolveTransactionItemReason(SQLite3Ptr conn,
     return TransactionItemReason::UNKNOWN;
 }
 
+TransactionItemReason
+RPMItem::resolveTransactionItemReason(SQLite3Ptr conn,
+                                      const std::string &name,
+                                      const std::string &arch,
+                                      int64_t maxTransactionId)
+{
+    // current_reason was added in schema 1.3
+    if (Transformer::hasSchemaVersion(conn, "1.3")) {
+        return resolveCurrentReason(conn, name, arch);
+    }
+    return resolveHistoryReason(conn, name, arch);
+}
+
+/**
+ * Resolve reasons of all name.arch pairs recorded in the history in a single query
+ * The callback is called once per name.arch with the reason of its latest transaction item.
+ * \param conn database connection
+ * \param callback function called for every name.arch
+ */
+void
+RPMItem::forEachLatestReason(
+    SQLite3Ptr conn,
+    const std::function< void(const char *name, const char *arch, TransactionItemReason reason) >
+        &callback)
+{
+    const char *sql = R"**(
+        SELECT
+            name,
+            arch,
+            reason
+        FROM
+            current_reason
+    )**";
+
+    // same rows computed from the history, see sql/rebuild_current_reason.sql
+    const char *history_sql = R"**(
+        SELECT
+            i.name as name,
+            i.arch as arch,
+            ti.reason as reason,
+            MAX(ti.id)
+        FROM
+            trans_item ti
+        JOIN
+            rpm i USING (item_id)
+        JOIN
+            trans t ON ti.trans_id = t.id
+        WHERE
+            t.done = 1
+            AND ti.action not in (3, 5, 7, 10)
+        GROUP BY
+            i.name,
+            i.arch
+    )**";
+
+    if (!Transformer::hasSchemaVersion(conn, "1.3")) {
+        sql = history_sql;
+    }
+
+    SQLite3::Query query(*conn, sql);
+    while (query.step() == SQLite3::Statement::StepResult::ROW) {
+        callback(query.get< const char * >(0),
+                 query.get< const char * >(1),
+                 static_cast< TransactionItemReason >(query.get< int >(2)));
+    }
+}
+
+/**
+ * Record reasons of a finished transaction in the current_reason table
+ * Items are applied in order, a later item of the same name.arch wins.
+ * \param conn database connection
+ * \param transId id of the finished transaction
+ * \param items items of the finished transaction
+ */
+void
+RPMItem::updateCurrentReasons(SQLite3Ptr conn,
+                              int64_t transId,
+                              const std::vector< TransactionItemPtr > &items)
+{
+    const char *sql = R"**(
+        INSERT OR REPLACE INTO
+            current_reason (name, arch, action, reason, trans_id)
+        VALUES
+            (?, ?, ?, ?, ?)
+    )**";
+
+    conn->exec("SAVEPOINT current_reason");
+    try {
+        SQLite3::Statement query(*conn, sql);
+        for (const auto &transItem : items) {
+            auto rpm = std::dynamic_pointer_cast< RPMItem >(transItem->getItem());
+            if (!rpm) {
+                continue;
+            }
+            // see comment in transactionitem.hpp - TransactionItemAction
+            switch (transItem->getAction()) {
+                case TransactionItemAction::DOWNGRADED:
+                case TransactionItemAction::OBSOLETED:
+                case TransactionItemAction::UPGRADED:
+                case TransactionItemAction::REINSTALLED:
+                    continue;
+                default:
+                    break;
+            }
+            query.bindv(rpm->getName(),
+                        rpm->getArch(),
+                        static_cast< int >(transItem->getAction()),
+                        static_cast< int >(transItem->getReason()),
+                        transId);
+            query.step();
+            query.reset();
+        }
+        conn->exec("RELEASE current_reason");
+    } catch (...) {
+        conn->exec("ROLLBACK TO current_reason; RELEASE current_reason");
+        throw;
+    }
+}
+
+/**
+ * Recompute the current_reason table from the complete history
+ * \param conn database connection
+ */
+void
+RPMItem::rebuildCurrentReasons(SQLite3Ptr conn)
+{
+    const char *sql =
+#include "sql/rebuild_current_reason.sql"
+        ;
+
+    conn->exec("SAVEPOINT current_reason");
+    try {
+        conn->exec(sql);
+        conn->exec("RELEASE current_reason");
+    } catch (...) {
+        conn->exec("ROLLBACK TO current_reason; RELEASE current_reason");
+        throw;
+    }
+}
+
 /**
  * Compare RPM packages
  * This method doesn't care about compare package names
  * \param other RPMItem to compare with
- * \return true if other package is newer (has higher version and/or epoch)
+ * \return true if other package is newer (has higher epoch, version or release)
  */
 bool
 RPMItem::operator<(const RPMItem &other) const
 {
-    // compare epochs
-    int32_t epochDif = other.getEpoch() - getEpoch();
-    if (epochDif > 0) {
-        return true;
-    } else if (epoch < 0) {
-        return false;
-    }
-
-    // compare versions
-    std::stringstream versionThis(getVersion());
-    std::stringstream versionOther(other.getVersion());
-
-    std::string bufferThis;
-    std::string bufferOther;
-    while (std::getline(versionThis, bufferThis, '.') &&
-           std::getline(versionOther, bufferOther, '.')) {
-        int subVersionThis = std::stoi(bufferThis);
-        int subVersionOther = std::stoi(bufferOther);
-        if (subVersionThis == subVersionOther) {
-            continue;
-        }
-        return subVersionOther > subVersionThis;
-    }
-    return false;
+    return libdnf::evrcmp(getEpoch(),
+                          getVersion(),
+                          getRelease(),
+                          other.getEpoch(),
+                          other.getVersion(),
+                          other.getRelease()) < 0;
 }
 
-std::vector< int64_t >
-RPMItem::searchTransactions(SQLite3Ptr conn, const std::vector< std::string > &patterns)
+static bool
+startsWithWildcard(const std::string &pattern)
 {
-    std::vector< int64_t > result;
+    return !pattern.empty() && (pattern[0] == '*' || pattern[0] == '?' || pattern[0] == '[');
+}
 
-    const char *sql = R"**(
+/**
+ * Add ids of finished transactions with an rpm matching any of patterns [first, last)
+ * to result, in a single query binding one value per pattern.
+ */
+static void
+searchTransactionsChunk(SQLite3Ptr conn,
+                        std::vector< std::string >::const_iterator first,
+                        std::vector< std::string >::const_iterator last,
+                        std::vector< int64_t > &result)
+{
+    std::string sql = R"**(
         SELECT DISTINCT
-            t.id
+            ti.trans_id
         FROM
-            trans t,
-            trans_item ti,
-            rpm i
+            trans_item ti
+        JOIN
+            trans t ON ti.trans_id = t.id
         WHERE
             t.done = 1
-            AND ti.item_id = i.item_id
-            AND (
-                i.name = ?
-                OR i.epoch = ?
-                OR i.version = ?
-                OR i.release = ?
-                OR i.arch = ?
+            AND ti.item_id IN (
+    )**";
+    // rpm_search was added in schema 1.4
+    if (Transformer::hasSchemaVersion(conn, "1.4")) {
+        // one indexed lookup per pattern; literal prefix of a glob is used as an index range,
+        // patterns starting with a wildcard can't use the index and share a single scan
+        std::string lookups;
+        std::string scan;
+        int param = 1;
+        for (auto it = first; it != last; ++it, ++param) {
+            auto glob = "form GLOB ?" + std::to_string(param);
+            if (startsWithWildcard(*it)) {
+                scan += scan.empty() ? glob : " OR " + glob;
+                continue;
+            }
+            if (!lookups.empty()) {
+                lookups += " UNION ";
+            }
+            lookups += "SELECT item_id FROM rpm_search WHERE " + glob;
+        }
+        if (!scan.empty()) {
+            if (!lookups.empty()) {
+                lookups += " UNION ";
+            }
+            lookups += "SELECT item_id FROM rpm_search WHERE " + scan;
+        }
+        sql += lookups;
+    } else {
+        // match the same forms by scanning rpm
+        sql += "SELECT item_id FROM rpm WHERE 0";
+        int param = 1;
+        for (auto it = first; it != last; ++it, ++param) {
+            auto glob = " GLOB ?" + std::to_string(param);
+            sql += " OR name" + glob;
+            sql += " OR name || '.' || arch" + glob;
+            sql += " OR name || '-' || version" + glob;
+            sql += " OR name || '-' || version || '-' || release" + glob;
+            sql += " OR name || '-' || version || '-' || release || '.' || arch" + glob;
+            sql += " OR name || '-' || epoch || ':' || version || '-' || release || '.' || arch" +
+                   glob;
+            sql += " OR epoch || ':' || name || '-' || version || '-' || release || '.' || arch" +
+                   glob;
+            sql += " OR epoch" + glob;
+            sql += " OR version" + glob;
+            sql += " OR release" + glob;
+            sql += " OR arch" + glob;
+        }
+    }
+    sql += R"**(
             )
-        ORDER BY
-           trans_id DESC
     )**";
+
     SQLite3::Query query(*conn, sql);
-    for (auto pattern : patterns) {
-        query.bindv(pattern, pattern, pattern, pattern, pattern);
-        while (query.step() == SQLite3::Statement::StepResult::ROW) {
-            result.push_back(query.get< int64_t >("id"));
-        }
+    int param = 1;
+    for (auto it = first; it != last; ++it, ++param) {
+        query.bind(param, *it);
+    }
+    while (query.step() == SQLite3::Statement::StepResult::ROW) {
+        result.push_back(query.get< int64_t >("trans_id"));
+    }
+}
+
+/**
+ * Find finished transactions containing an rpm matching any of the patterns.
+ * Patterns are globs matched against the forms stored in rpm_search
+ *  (name, name.arch, name-version, NEVRA, ...), one query per maxBoundValues patterns.
+ * A pattern with a literal prefix is an index range lookup on (form, item_id);
+ *  patterns starting with a wildcard ('*', '?', '[') scan the whole rpm_search table,
+ *  so all of them are matched together in one scan per query.
+ * \param patterns list of glob patterns
+ * \return ids of matching transactions sorted in ascending order
+ */
+std::vector< int64_t >
+RPMItem::searchTransactions(SQLite3Ptr conn, const std::vector< std::string > &patterns)
+{
+    std::vector< int64_t > result;
+    for (std::size_t begin = 0; begin < patterns.size(); begin += maxBoundValues) {
+        auto count = std::min(patterns.size() - begin, maxBoundValues);
+        searchTransactionsChunk(
+            conn, patterns.begin() + begin, patterns.begin() + begin + count, result);
     }
     std::sort(result.begin(), result.end());
-    auto last = std::unique(result.begin(), result.end());
-    result.erase(last, result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
     return result;
 }
@@ -21,6 +21,7 @@
 #ifndef LIBDNF_SWDB_ITEM_RPM_HPP
 #define LIBDNF_SWDB_ITEM_RPM_HPP
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -61,10 +62,20 @@ public:
     static std::vector< int64_t > searchTransactions(SQLite3Ptr conn, const std::vector< std::string > &patterns);
     static std::vector< TransactionItemPtr > getTransactionItems(SQLite3Ptr conn,
                                                                  int64_t transaction_id);
+    static std::vector< TransactionItemPtr > getTransactionItems(SQLite3Ptr conn,
+                                                                 const std::vector< int64_t > &transIds);
     static TransactionItemReason resolveTransactionItemReason(SQLite3Ptr conn,
                                                               const std::string &name,
                                                               const std::string &arch,
                                                               int64_t maxTransactionId);
+    static void forEachLatestReason(
+        SQLite3Ptr conn,
+        const std::function< void(const char *name, const char *arch, TransactionItemReason reason) >
+            &callback);
+    static void updateCurrentReasons(SQLite3Ptr conn,
+                                     int64_t transId,
+                                     const std::vector< TransactionItemPtr > &items);
+    static void rebuildCurrentReasons(SQLite3Ptr conn);
 
     bool operator<(const RPMItem &other) const;
 
@@ -18,6 +18,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <map>
+
+#include "item_comps_environment.hpp"
+#include "item_comps_group.hpp"
 #include "mergedtransaction.hpp"
 
 /**
@@ -177,19 +181,19 @@ MergedTransaction::getItems()
     ItemPairMap itemPairMap;
 
     // iterate over transaction
-    for (auto t : transactions) {
-        auto transItems = t->getItems();
+    for (const auto &transItems : loadItems()) {
         // iterate over transaction items
         for (auto transItem : transItems) {
-            // get item and its type
-            auto mTransItem = std::dynamic_pointer_cast< TransactionItemBase >(transItem);
-            mergeItem(itemPairMap, mTransItem);
+            mergeItem(itemPairMap, transItem);
         }
     }
 
     std::vector< TransactionItemBasePtr > items;
-    for (const auto &row : itemPairMap) {
-        ItemPair itemPair = row.second;
+    for (const auto &itemPair : itemPairMap.pairs) {
+        // Install -> Erase pairs are dropped
+        if (itemPair.first == nullptr) {
+            continue;
+        }
         items.push_back(itemPair.first);
         if (itemPair.second != nullptr) {
             items.push_back(itemPair.second);
@@ -198,6 +202,38 @@ MergedTransaction::getItems()
     return items;
 }
 
+/**
+ * Load items of exactly the merged transactions with one query per item type
+ * (per Item::maxBoundValues transactions)
+ * Items are always loaded fresh, merging modifies their actions.
+ * \return items of each transaction, in the order of transactions
+ */
+std::vector< std::vector< TransactionItemPtr > >
+MergedTransaction::loadItems() const
+{
+    std::vector< std::vector< TransactionItemPtr > > result(transactions.size());
+
+    std::map< int64_t, std::size_t > positions;
+    for (std::size_t i = 0; i < transactions.size(); ++i) {
+        positions[transactions[i]->getId()] = i;
+    }
+    std::vector< int64_t > ids;
+    for (const auto &position : positions) {
+        ids.push_back(position.first);
+    }
+    auto conn = transactions.front()->conn;
+
+    auto attach = [&positions, &result](const std::vector< TransactionItemPtr > &items) {
+        for (auto &item : items) {
+            result[positions.at(item->getTransactionId())].push_back(item);
+        }
+    };
+    attach(RPMItem::getTransactionItems(conn, ids));
+    attach(CompsGroupItem::getTransactionItems(conn, ids));
+    attach(CompsEnvironmentItem::getTransactionItems(conn, ids));
+    return result;
+}
+
 static std::string
 getItemIdentifier(ItemPtr item)
 {
@@ -240,7 +276,7 @@ MergedTransaction::resolveRPMDifference(ItemPair &previousItemPair,
         previousItemPair.first = mTransItem;
         previousItemPair.second = nullptr;
         return;
-    } else if ((*firstRPM) < (*secondRPM)) {
+    } else if (*firstRPM < *secondRPM) {
         // Upgrade to secondRPM
         previousItemPair.first->setAction(TransactionItemAction::UPGRADED);
         mTransItem->setAction(TransactionItemAction::UPGRADE);
@@ -345,17 +381,28 @@ MergedTransaction::resolveAltered(ItemPair &previousItemPair, TransactionItemBas
 void
 MergedTransaction::mergeItem(ItemPairMap &itemPairMap, TransactionItemBasePtr mTransItem)
 {
-    // get item identifier
-    std::string name = getItemIdentifier(mTransItem->getItem());
+    // get item key, the identifier string is built only for an item seen for the first time
+    auto item = mTransItem->getItem();
+    std::size_t index;
+    auto knownItem = itemPairMap.itemIndex.find(item->getId());
+    if (knownItem != itemPairMap.itemIndex.end()) {
+        index = knownItem->second;
+    } else {
+        auto inserted = itemPairMap.nameIndex.emplace(getItemIdentifier(item),
+                                                      itemPairMap.pairs.size());
+        index = inserted.first->second;
+        if (inserted.second) {
+            itemPairMap.pairs.emplace_back();
+        }
+        itemPairMap.itemIndex.emplace(item->getId(), index);
+    }
 
-    auto previous = itemPairMap.find(name);
-    if (previous == itemPairMap.end()) {
-        itemPairMap[name] = ItemPair(mTransItem, nullptr);
+    ItemPair &previousItemPair = itemPairMap.pairs[index];
+    if (previousItemPair.first == nullptr) {
+        previousItemPair = ItemPair(mTransItem, nullptr);
         return;
     }
 
-    ItemPair &previousItemPair = previous->second;
-
     auto firstState = previousItemPair.first->getAction();
     auto newState = mTransItem->getAction();
 
@@ -369,7 +416,7 @@ MergedTransaction::mergeItem(ItemPairMap &itemPairMap, TransactionItemBasePtr mT
             if (newState == TransactionItemAction::REMOVE ||
                 newState == TransactionItemAction::OBSOLETED) {
                 // Install -> Remove = (nothing)
-                itemPairMap.erase(name);
+                previousItemPair = ItemPair();
                 break;
             }
             // altered -> transfer install to the altered package
@@ -21,6 +21,7 @@
 #ifndef LIBDNF_SWDB_MERGEDTRANSACTION_HPP
 #define LIBDNF_SWDB_MERGEDTRANSACTION_HPP
 
+#include <cstddef>
 #include <memory>
 #include <set>
 #include <string>
@@ -66,8 +67,17 @@ protected:
         TransactionItemBasePtr second = nullptr;
     };
 
-    typedef std::unordered_map< std::string, ItemPair > ItemPairMap;
+    /*
+     * Merged items keyed by an integer: item ids map to the index of their
+     * name in pairs, so the identifier string is built once per distinct item.
+     */
+    struct ItemPairMap {
+        std::vector< ItemPair > pairs;
+        std::unordered_map< int64_t, std::size_t > itemIndex;
+        std::unordered_map< std::string, std::size_t > nameIndex;
+    };
 
+    std::vector< std::vector< TransactionItemPtr > > loadItems() const;
     void mergeItem(ItemPairMap &itemPairMap, TransactionItemBasePtr transItem);
     void resolveRPMDifference(ItemPair &previousItemPair, TransactionItemBasePtr mTransItem);
     void resolveErase(ItemPair &previousItemPair, TransactionItemBasePtr mTransItem);
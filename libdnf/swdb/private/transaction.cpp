@@ -25,11 +25,30 @@
 #include "transactionitem.hpp"
 
 
+// console output is written out when one of these is exceeded
+static constexpr std::size_t consoleOutputFlushLines = 256;
+static constexpr std::size_t consoleOutputFlushBytes = 64 * 1024;
+static constexpr std::chrono::seconds consoleOutputFlushInterval{1};
+
+// rows per multi-row INSERT; 3 bound values each, below SQLITE_MAX_VARIABLE_NUMBER
+static constexpr std::size_t consoleOutputRowsPerInsert = 64;
+
+constexpr std::size_t SwdbPrivate::Transaction::consoleOutputDroppedNoteSize;
+
 SwdbPrivate::Transaction::Transaction(SQLite3Ptr conn)
   : libdnf::Transaction(conn)
 {
 }
 
+SwdbPrivate::Transaction::~Transaction()
+{
+    // an unfinished transaction keeps the output it has produced
+    try {
+        flushConsoleOutput();
+    } catch (...) {
+    }
+}
+
 void
 SwdbPrivate::Transaction::begin()
 {
@@ -43,8 +62,12 @@ SwdbPrivate::Transaction::begin()
 void
 SwdbPrivate::Transaction::finish(bool success)
 {
+    flushConsoleOutput();
     setDone(success);
     dbUpdate();
+    if (success) {
+        RPMItem::updateCurrentReasons(conn, id, getItems());
+    }
 }
 
 void
@@ -191,10 +214,14 @@ SwdbPrivate::Transaction::addSoftwarePerformedWith(std::shared_ptr< RPMItem > so
 }
 
 /**
- * Save console output line for current transaction to the database. Transaction has
+ * Add a console output line to the transaction
+ * Lines are buffered and written in batches by flushConsoleOutput(),
+ * at the latest when the transaction finishes. Transaction has
  *  to be saved in advance, otherwise an exception will be thrown.
- * \param fileDescriptor UNIX file descriptor index (1 = stdout, 2 = stderr).
- * \param line console output content
+ * With a size limit set, room for the dropped lines note is kept
+ * within the limit and all lines after the first dropped one are dropped.
+ * \param fileDescriptor 1 for stdout, 2 for stderr
+ * \param line output line
  */
 void
 SwdbPrivate::Transaction::addConsoleOutputLine(int fileDescriptor, const std::string &line)
@@ -203,17 +230,99 @@ SwdbPrivate::Transaction::addConsoleOutputLine(int fileDescriptor, const std::st
         throw std::runtime_error("Can't add console output to unsaved transaction");
     }
 
-    const char *sql = R"**(
-        INSERT INTO
-            console_output (
-                trans_id,
-                file_descriptor,
-                line
-            )
-        VALUES
-            (?, ?, ?);
-    )**";
-    SQLite3::Statement query(*conn, sql);
-    query.bindv(getId(), fileDescriptor, line);
-    query.step();
+    // once a line is dropped, the rest is dropped too so that the note stays last
+    if (consoleOutputDropped ||
+        (consoleOutputSizeLimit &&
+         consoleOutputSize + line.size() + consoleOutputDroppedNoteSize > consoleOutputSizeLimit)) {
+        consoleOutputDropped++;
+        return;
+    }
+    consoleOutputSize += line.size();
+
+    consoleOutputBuffer.emplace_back(fileDescriptor, line);
+    consoleOutputBufferSize += line.size();
+
+    if (consoleOutputBuffer.size() >= consoleOutputFlushLines ||
+        consoleOutputBufferSize >= consoleOutputFlushBytes ||
+        std::chrono::steady_clock::now() - consoleOutputFlushed >= consoleOutputFlushInterval) {
+        flushConsoleOutput();
+    }
+}
+
+static std::string
+consoleOutputInsertSql(std::size_t rows)
+{
+    std::string sql = "INSERT INTO console_output (trans_id, file_descriptor, line) VALUES (?, ?, ?)";
+    for (std::size_t i = 1; i < rows; ++i) {
+        sql += ", (?, ?, ?)";
+    }
+    return sql;
+}
+
+/**
+ * Write buffered console output lines to the database
+ * All lines are inserted in a single SQL transaction using multi-row INSERTs.
+ * If lines were dropped due to the size limit, a single note with the total
+ * count is kept after them and updated in place by later flushes.
+ */
+void
+SwdbPrivate::Transaction::flushConsoleOutput()
+{
+    consoleOutputFlushed = std::chrono::steady_clock::now();
+    if (consoleOutputBuffer.empty() && consoleOutputDropped == consoleOutputDroppedSaved) {
+        return;
+    }
+
+    conn->exec("SAVEPOINT console_output");
+    try {
+        auto it = consoleOutputBuffer.begin();
+        auto remaining = consoleOutputBuffer.size();
+
+        if (remaining >= consoleOutputRowsPerInsert) {
+            SQLite3::Statement query(*conn, consoleOutputInsertSql(consoleOutputRowsPerInsert));
+            for (; remaining >= consoleOutputRowsPerInsert; remaining -= consoleOutputRowsPerInsert) {
+                int pos = 1;
+                for (std::size_t i = 0; i < consoleOutputRowsPerInsert; ++i, ++it) {
+                    query.bind(pos++, getId());
+                    query.bind(pos++, it->first);
+                    query.bind(pos++, it->second);
+                }
+                query.step();
+                query.reset();
+            }
+        }
+
+        if (remaining) {
+            SQLite3::Statement query(*conn, consoleOutputInsertSql(remaining));
+            int pos = 1;
+            for (; it != consoleOutputBuffer.end(); ++it) {
+                query.bind(pos++, getId());
+                query.bind(pos++, it->first);
+                query.bind(pos++, it->second);
+            }
+            query.step();
+        }
+
+        if (consoleOutputDropped != consoleOutputDroppedSaved) {
+            auto note = "[" + std::to_string(consoleOutputDropped) + " lines of output dropped]";
+            if (consoleOutputDroppedNoteId) {
+                SQLite3::Statement query(*conn, "UPDATE console_output SET line = ? WHERE id = ?");
+                query.bindv(note, consoleOutputDroppedNoteId);
+                query.step();
+            } else {
+                SQLite3::Statement query(*conn, consoleOutputInsertSql(1));
+                query.bindv(getId(), 2, note);
+                query.step();
+                consoleOutputDroppedNoteId = conn->lastInsertRowID();
+            }
+        }
+        conn->exec("RELEASE console_output");
+    } catch (...) {
+        conn->exec("ROLLBACK TO console_output; RELEASE console_output");
+        throw;
+    }
+
+    consoleOutputBuffer.clear();
+    consoleOutputBufferSize = 0;
+    consoleOutputDroppedSaved = consoleOutputDropped;
 }
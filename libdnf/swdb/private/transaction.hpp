@@ -21,6 +21,12 @@
 #ifndef LIBDNF_SWDB_TRANSACTION_PRIVATE_HPP
 #define LIBDNF_SWDB_TRANSACTION_PRIVATE_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "../transaction.hpp"
 
 namespace SwdbPrivate {
@@ -32,6 +38,7 @@ class Transaction : public libdnf::Transaction {
 public:
     // create an empty object, don't read from db
     explicit Transaction(SQLite3Ptr conn);
+    ~Transaction();
 
     void setId(int64_t value) { id = value; }
     void setDtBegin(int64_t value) { dtBegin = value; }
@@ -53,6 +60,12 @@ public:
                                TransactionItemReason reason);
 
     void addConsoleOutputLine(int fileDescriptor, const std::string &line);
+    void flushConsoleOutput();
+    void setConsoleOutputSizeLimit(std::size_t value) { consoleOutputSizeLimit = value; }
+
+    // longest "[N lines of output dropped]" note, kept free within the size limit
+    static constexpr std::size_t consoleOutputDroppedNoteSize =
+        sizeof("[18446744073709551615 lines of output dropped]") - 1;
     void addSoftwarePerformedWith(std::shared_ptr< RPMItem > software);
 
 protected:
@@ -61,6 +74,19 @@ protected:
 
     void dbInsert();
     void dbUpdate();
+
+    // console output lines waiting for flushConsoleOutput()
+    std::vector< std::pair< int, std::string > > consoleOutputBuffer;
+    std::size_t consoleOutputBufferSize = 0;
+    std::chrono::steady_clock::time_point consoleOutputFlushed = std::chrono::steady_clock::now();
+
+    // bytes of console output stored so far; 0 limit means unlimited
+    std::size_t consoleOutputSize = 0;
+    std::size_t consoleOutputSizeLimit = 0;
+    std::size_t consoleOutputDropped = 0;
+    // dropped count already in the note row and the id of that row
+    std::size_t consoleOutputDroppedSaved = 0;
+    int64_t consoleOutputDroppedNoteId = 0;
 };
 };
 
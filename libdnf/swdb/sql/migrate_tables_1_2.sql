@@ -0,0 +1,13 @@
+R"**(
+    /* transaction items by transaction: getItems(), history listing */
+    CREATE INDEX IF NOT EXISTS trans_item_trans_id ON trans_item(trans_id);
+
+    /* latest item of a name.arch: reason resolution, filterUnneeded() */
+    DROP INDEX IF EXISTS rpm_name;
+    CREATE INDEX IF NOT EXISTS rpm_name_arch ON rpm(name, arch, item_id);
+    DROP INDEX IF EXISTS trans_item_item_id;
+    CREATE INDEX IF NOT EXISTS trans_item_item_id ON trans_item(item_id, id, trans_id, action, reason);
+
+    /* groups containing a package */
+    CREATE INDEX IF NOT EXISTS comps_group_package_name ON comps_group_package(name);
+)**"
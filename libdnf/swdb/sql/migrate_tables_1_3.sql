@@ -0,0 +1,11 @@
+R"**(
+    /* latest reason of every name.arch; maintained when a transaction finishes */
+    CREATE TABLE IF NOT EXISTS current_reason (
+        name TEXT NOT NULL,
+        arch TEXT NOT NULL,
+        action INTEGER NOT NULL,
+        reason INTEGER NOT NULL,
+        trans_id INTEGER NOT NULL REFERENCES trans(id),
+        PRIMARY KEY (name, arch)
+    );
+)**"
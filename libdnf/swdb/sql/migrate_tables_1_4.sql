@@ -0,0 +1,29 @@
+R"**(
+    /* all forms an rpm can be searched by: name, name.arch, NEVRA variants and their parts */
+    CREATE TABLE IF NOT EXISTS rpm_search (
+        form TEXT NOT NULL,
+        item_id INTEGER NOT NULL REFERENCES rpm(item_id),
+        PRIMARY KEY (form, item_id)
+    );
+
+    CREATE TRIGGER IF NOT EXISTS rpm_search_insert AFTER INSERT ON rpm
+    BEGIN
+        INSERT OR IGNORE INTO rpm_search (form, item_id) VALUES
+            (NEW.name, NEW.item_id),
+            (NEW.name || '.' || NEW.arch, NEW.item_id),
+            (NEW.name || '-' || NEW.version, NEW.item_id),
+            (NEW.name || '-' || NEW.version || '-' || NEW.release, NEW.item_id),
+            (NEW.name || '-' || NEW.version || '-' || NEW.release || '.' || NEW.arch, NEW.item_id),
+            (NEW.name || '-' || NEW.epoch || ':' || NEW.version || '-' || NEW.release || '.' || NEW.arch, NEW.item_id),
+            (NEW.epoch || ':' || NEW.name || '-' || NEW.version || '-' || NEW.release || '.' || NEW.arch, NEW.item_id),
+            (NEW.epoch, NEW.item_id),
+            (NEW.version, NEW.item_id),
+            (NEW.release, NEW.item_id),
+            (NEW.arch, NEW.item_id);
+    END;
+
+    CREATE TRIGGER IF NOT EXISTS rpm_search_delete AFTER DELETE ON rpm
+    BEGIN
+        DELETE FROM rpm_search WHERE item_id = OLD.item_id;
+    END;
+)**"
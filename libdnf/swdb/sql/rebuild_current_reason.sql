@@ -0,0 +1,34 @@
+R"**(
+    DELETE FROM current_reason;
+
+    /* see comment in transactionitem.hpp - TransactionItemAction */
+    INSERT INTO current_reason (name, arch, action, reason, trans_id)
+    SELECT
+        name,
+        arch,
+        action,
+        reason,
+        trans_id
+    FROM (
+        /* SQLite takes bare columns from the row holding MAX() of the group */
+        SELECT
+            i.name as name,
+            i.arch as arch,
+            ti.action as action,
+            ti.reason as reason,
+            ti.trans_id as trans_id,
+            MAX(ti.id)
+        FROM
+            trans_item ti
+        JOIN
+            rpm i USING (item_id)
+        JOIN
+            trans t ON ti.trans_id = t.id
+        WHERE
+            t.done = 1
+            AND ti.action not in (3, 5, 7, 10)
+        GROUP BY
+            i.name,
+            i.arch
+    );
+)**"
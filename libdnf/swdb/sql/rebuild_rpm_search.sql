@@ -0,0 +1,17 @@
+R"**(
+    DELETE FROM rpm_search;
+
+    /* keep in sync with the rpm_search_insert trigger */
+    INSERT OR IGNORE INTO rpm_search (form, item_id)
+              SELECT name, item_id FROM rpm
+    UNION ALL SELECT name || '.' || arch, item_id FROM rpm
+    UNION ALL SELECT name || '-' || version, item_id FROM rpm
+    UNION ALL SELECT name || '-' || version || '-' || release, item_id FROM rpm
+    UNION ALL SELECT name || '-' || version || '-' || release || '.' || arch, item_id FROM rpm
+    UNION ALL SELECT name || '-' || epoch || ':' || version || '-' || release || '.' || arch, item_id FROM rpm
+    UNION ALL SELECT epoch || ':' || name || '-' || version || '-' || release || '.' || arch, item_id FROM rpm
+    UNION ALL SELECT epoch, item_id FROM rpm
+    UNION ALL SELECT version, item_id FROM rpm
+    UNION ALL SELECT release, item_id FROM rpm
+    UNION ALL SELECT arch, item_id FROM rpm;
+)**"
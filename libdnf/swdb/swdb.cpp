@@ -19,6 +19,8 @@
  */
 
 #include <cstdio>
+#include <map>
+#include <unordered_map>
 #include <solv/bitmap.h>
 #include <solv/solvable.h>
 
@@ -68,6 +70,7 @@ Swdb::initTransaction()
     }
     transactionInProgress =
         std::unique_ptr< SwdbPrivate::Transaction >(new SwdbPrivate::Transaction(conn));
+    transactionInProgress->setConsoleOutputSizeLimit(consoleOutputSizeLimit);
     itemsInProgress.clear();
 }
 
@@ -182,6 +185,16 @@ Swdb::resolveRPMTransactionItemReason(const std::string &name,
     return RPMItem::resolveTransactionItemReason(conn, name, arch, maxTransactionId);
 }
 
+/**
+ * Recompute latest reasons of all packages from the complete history
+ * Only needed when the history was modified without going through Swdb.
+ */
+void
+Swdb::rebuildRPMReasons()
+{
+    RPMItem::rebuildCurrentReasons(conn);
+}
+
 const std::string
 Swdb::getRPMRepo(const std::string &nevra)
 {
@@ -258,22 +271,131 @@ Swdb::getLastTransaction()
 std::vector< libdnf::TransactionPtr >
 Swdb::listTransactions()
 {
-    const char *sql = R"**(
+    return listTransactions(libdnf::TransactionRange(), false);
+}
+
+std::vector< libdnf::TransactionPtr >
+Swdb::listTransactions(const libdnf::TransactionRange &range, bool withItems)
+{
+    std::vector< libdnf::TransactionPtr > result;
+    forEachTransaction(range, withItems, [&result](libdnf::TransactionPtr trans) {
+        result.push_back(trans);
+        return true;
+    });
+    return result;
+}
+
+// number of transactions whose items are loaded by one set of queries
+static constexpr std::size_t transactionBatchSize = 512;
+
+/**
+ * Load items of a batch of consecutive transactions with one query per item type
+ * and attach them to the transactions, so that getItems() doesn't hit the database.
+ */
+void
+Swdb::prefetchTransactionItems(std::vector< libdnf::TransactionPtr > &batch)
+{
+    std::map< int64_t, libdnf::TransactionPtr > byId;
+    for (auto &trans : batch) {
+        byId[trans->getId()] = trans;
+    }
+    std::vector< int64_t > ids;
+    for (const auto &trans : byId) {
+        ids.push_back(trans.first);
+    }
+
+    auto attach = [&byId](const std::vector< TransactionItemPtr > &items) {
+        for (auto &item : items) {
+            byId.at(item->getTransactionId())->prefetchedItems.push_back(item);
+        }
+    };
+    attach(RPMItem::getTransactionItems(conn, ids));
+    attach(CompsGroupItem::getTransactionItems(conn, ids));
+    attach(CompsEnvironmentItem::getTransactionItems(conn, ids));
+
+    for (auto &trans : batch) {
+        trans->itemsPrefetched = true;
+    }
+}
+
+/**
+ * Stream transactions selected by range to callback, in id order.
+ * All filtering and pagination is done in SQL; with withItems the items are
+ * loaded in batches with a few set-based queries instead of per transaction.
+ * The callback returns false to stop the iteration.
+ */
+void
+Swdb::forEachTransaction(const libdnf::TransactionRange &range,
+                         bool withItems,
+                         const std::function< bool(libdnf::TransactionPtr) > &callback)
+{
+    std::string sql = R"**(
         SELECT
-            id
+            id,
+            dt_begin,
+            dt_end,
+            rpmdb_version_begin,
+            rpmdb_version_end,
+            releasever,
+            user_id,
+            cmdline,
+            done
         FROM
             trans
-        ORDER BY
-            id
+        WHERE
+            1
     )**";
-    SQLite3::Statement query(*conn, sql);
-    std::vector< libdnf::TransactionPtr > result;
-    while (query.step() == SQLite3::Statement::StepResult::ROW) {
-        auto transId = query.get< int64_t >(0);
-        auto transaction = std::make_shared< libdnf::Transaction >(conn, transId);
-        result.push_back(transaction);
+    std::vector< int64_t > args;
+    if (range.idMin > 0) {
+        sql += " AND id >= ?";
+        args.push_back(range.idMin);
+    }
+    if (range.idMax > 0) {
+        sql += " AND id <= ?";
+        args.push_back(range.idMax);
+    }
+    if (range.dtBeginMin > 0) {
+        sql += " AND dt_begin >= ?";
+        args.push_back(range.dtBeginMin);
+    }
+    if (range.dtBeginMax > 0) {
+        sql += " AND dt_begin <= ?";
+        args.push_back(range.dtBeginMax);
+    }
+    sql += range.reverse ? " ORDER BY id DESC" : " ORDER BY id";
+    sql += " LIMIT ? OFFSET ?";
+    args.push_back(range.limit > 0 ? range.limit : -1);
+    args.push_back(range.offset);
+
+    SQLite3::Query query(*conn, sql);
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        query.bind(i + 1, args[i]);
+    }
+
+    std::vector< libdnf::TransactionPtr > batch;
+    bool more = true;
+    while (more) {
+        more = query.step() == SQLite3::Statement::StepResult::ROW;
+        if (more) {
+            batch.push_back(
+                libdnf::TransactionPtr(new libdnf::Transaction(conn, query)));
+            if (batch.size() < transactionBatchSize) {
+                continue;
+            }
+        }
+        if (batch.empty()) {
+            break;
+        }
+        if (withItems) {
+            prefetchTransactionItems(batch);
+        }
+        for (auto &trans : batch) {
+            if (!callback(trans)) {
+                return;
+            }
+        }
+        batch.clear();
     }
-    return result;
 }
 
 void
@@ -285,6 +407,20 @@ Swdb::addConsoleOutputLine(int fileDescriptor, std::string line)
     transactionInProgress->addConsoleOutputLine(fileDescriptor, line);
 }
 
+/**
+ * Limit the amount of console output stored per transaction
+ * Lines beyond the limit are dropped and replaced with a single note.
+ * \param bytes maximum size of the stored lines, 0 for no limit
+ */
+void
+Swdb::setConsoleOutputSizeLimit(std::size_t bytes)
+{
+    consoleOutputSizeLimit = bytes;
+    if (transactionInProgress) {
+        transactionInProgress->setConsoleOutputSizeLimit(bytes);
+    }
+}
+
 TransactionItemPtr
 Swdb::getCompsGroupItem(const std::string &groupid)
 {
@@ -477,7 +613,22 @@ Swdb::createCompsGroupItem()
     return std::make_shared< CompsGroupItem >(conn);
 }
 
+/**
+ * Open sw.db in WAL mode, see SQLite3::ConnectionMode::WAL
+ * It falls back to exclusive mode in chroots and for in-memory databases
+ * where WAL isn't available.
+ */
 Swdb::Swdb(const std::string &path)
+  : Swdb(path, SQLite3::ConnectionMode::WAL)
+{
+}
+
+/**
+ * Open sw.db in the given connection mode
+ * SQLite3::ConnectionMode::EXCLUSIVE locks out every other connection;
+ * it can't be opened while WAL connections use the database.
+ */
+Swdb::Swdb(const std::string &path, SQLite3::ConnectionMode mode)
   : conn(nullptr)
 {
     // check if DB file is present
@@ -493,9 +644,13 @@ Swdb::Swdb(const std::string &path)
         found = path.find_last_of("/", found-1);
         Transformer transformer(path, path.substr(0, found));
         transformer.transform();
-        conn = std::make_shared< SQLite3 >(path);
+        conn = std::make_shared< SQLite3 >(path, mode);
     } else {
-        conn = std::make_shared< SQLite3 >(path);
+        conn = std::make_shared< SQLite3 >(path, mode);
+        // an old database opened read-only keeps its schema, readers fall back to the old tables
+        if (!conn->isReadOnly()) {
+            Transformer::migrateSchema(conn);
+        }
     }
 }
 
@@ -508,51 +663,43 @@ std::vector< Id >
 Swdb::filterUnneeded(HyQuery installed, Pool *pool) const
 {
 
-    const char *sql = R"**(
-        SELECT
-          reason
-        FROM
-          trans_item
-          join rpm using (item_id)
-        WHERE
-          name = ?
-          AND arch = ?
-        ORDER BY
-          trans_item.id DESC
-        LIMIT 1
-    )**";
-
-    SQLite3::Query query(*conn, sql);
+    // latest reason of every name.arch known to both the history and the pool,
+    // keyed by the pool string ids
+    std::unordered_map< uint64_t, TransactionItemReason > reasons;
+    RPMItem::forEachLatestReason(
+        conn, [&reasons, pool](const char *name, const char *arch, TransactionItemReason reason) {
+            Id nameId = pool_str2id(pool, name, 0);
+            Id archId = pool_str2id(pool, arch, 0);
+            if (nameId && archId) {
+                reasons[static_cast< uint64_t >(nameId) << 32 | static_cast< uint32_t >(archId)] =
+                    reason;
+            }
+        });
 
     std::vector< Id > userInstalled;
+    const Map *installedMap = hy_query_get_result(installed);
 
     // iterate over solvables
     for (Id id = 1; id < pool->nsolvables; ++id) {
 
-        if (!MAPTST(installed->getResult(), id)) {
+        if (!MAPTST(installedMap, id)) {
             continue;
         }
 
         Solvable *s = pool_id2solvable(pool, id);
-        const char *name = pool_id2str(pool, s->name);
-        const char *arch = pool_id2str(pool, s->arch);
-
-        query.bindv(name, arch);
-
-        if (query.step() == SQLite3::Statement::StepResult::ROW) {
-            int reason = query.get< int >("reason");
+        auto it = reasons.find(static_cast< uint64_t >(s->name) << 32 |
+                               static_cast< uint32_t >(s->arch));
 
+        if (it != reasons.end()) {
             // if not dep or weak, than consider it user installed
-            if (reason != static_cast<int>(TransactionItemReason::DEPENDENCY) &&
-                reason != static_cast<int>(TransactionItemReason::WEAK_DEPENDENCY)) {
+            if (it->second != TransactionItemReason::DEPENDENCY &&
+                it->second != TransactionItemReason::WEAK_DEPENDENCY) {
                 userInstalled.push_back(id);
             }
         } else {
             // rpm not found - consider it user installed
             userInstalled.push_back(id);
         }
-
-        query.reset();
     }
     return userInstalled;
 }
@@ -21,6 +21,8 @@
 #ifndef LIBDNF_SWDB_SWDB_HPP
 #define LIBDNF_SWDB_SWDB_HPP
 
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <sys/stat.h>
 #include <unordered_map>
@@ -42,6 +44,7 @@ class Swdb {
 public:
     explicit Swdb(SQLite3Ptr conn);
     explicit Swdb(const std::string &path);
+    Swdb(const std::string &path, SQLite3::ConnectionMode mode);
     ~Swdb();
 
     SQLite3Ptr getConn() { return conn; }
@@ -65,6 +68,11 @@ public:
 
     libdnf::TransactionPtr getLastTransaction();
     std::vector< libdnf::TransactionPtr > listTransactions(); // std::vector<long long> transactionIds);
+    std::vector< libdnf::TransactionPtr > listTransactions(const libdnf::TransactionRange &range,
+                                                           bool withItems);
+    void forEachTransaction(const libdnf::TransactionRange &range,
+                            bool withItems,
+                            const std::function< bool(libdnf::TransactionPtr) > &callback);
 
     // TransactionItems
     TransactionItemPtr addItem(ItemPtr item,
@@ -84,6 +92,7 @@ public:
     TransactionItemReason resolveRPMTransactionItemReason(const std::string &name,
                                                           const std::string &arch,
                                                           int64_t maxTransactionId);
+    void rebuildRPMReasons();
     const std::string getRPMRepo(const std::string &nevra);
     std::shared_ptr< const TransactionItem > getRPMTransactionItem(const std::string &nevra);
     std::vector< int64_t > searchTransactionsByRPM(const std::vector< std::string > &patterns);
@@ -100,6 +109,7 @@ public:
 
     // Console
     void addConsoleOutputLine(int fileDescriptor, std::string line);
+    void setConsoleOutputSizeLimit(std::size_t bytes);
 
     // misc
     std::vector< Id > filterUnneeded(HyQuery installed, Pool *pool) const;
@@ -108,8 +118,10 @@ protected:
     SQLite3Ptr conn;
     std::unique_ptr< SwdbPrivate::Transaction > transactionInProgress = nullptr;
     std::unordered_map< std::string, TransactionItemPtr > itemsInProgress;
+    std::size_t consoleOutputSizeLimit = 0;
 
 private:
+    void prefetchTransactionItems(std::vector< libdnf::TransactionPtr > &batch);
 };
 
 #endif // LIBDNF_SWDB_SWDB_HPP
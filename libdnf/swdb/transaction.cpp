@@ -35,6 +35,12 @@ libdnf::Transaction::Transaction(SQLite3Ptr conn)
 {
 }
 
+libdnf::Transaction::Transaction(SQLite3Ptr conn, SQLite3::Query &query)
+  : conn{conn}
+{
+    loadFromQuery(query);
+}
+
 bool
 libdnf::Transaction::operator==(const libdnf::Transaction &other) const
 {
@@ -112,6 +118,24 @@ libdnf::Transaction::dbSelect(int64_t pk)
     done = query.get< bool >("done");
 }
 
+/**
+ * Fill the transaction from the current row of a query selecting
+ * the same columns as dbSelect() plus "id".
+ */
+void
+libdnf::Transaction::loadFromQuery(SQLite3::Query &query)
+{
+    id = query.get< int64_t >("id");
+    dtBegin = query.get< int64_t >("dt_begin");
+    dtEnd = query.get< int64_t >("dt_end");
+    rpmdbVersionBegin = query.get< std::string >("rpmdb_version_begin");
+    rpmdbVersionEnd = query.get< std::string >("rpmdb_version_end");
+    releasever = query.get< std::string >("releasever");
+    userId = query.get< uint32_t >("user_id");
+    cmdline = query.get< std::string >("cmdline");
+    done = query.get< bool >("done");
+}
+
 /**
  * Loader for the transaction items.
  * \return list of transaction items associated with the transaction
@@ -119,6 +143,10 @@ libdnf::Transaction::dbSelect(int64_t pk)
 std::vector< TransactionItemPtr >
 libdnf::Transaction::getItems() const
 {
+    if (itemsPrefetched) {
+        return prefetchedItems;
+    }
+
     std::vector< TransactionItemPtr > result;
     auto rpms = RPMItem::getTransactionItems(conn, getId());
     result.insert(result.end(), rpms.begin(), rpms.end());
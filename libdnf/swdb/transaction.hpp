@@ -27,10 +27,27 @@
 
 #include "../utils/sqlite3/sqlite3.hpp"
 
+class MergedTransaction;
+class Swdb;
+
 namespace libdnf {
 
 class Transaction;
 typedef std::shared_ptr< Transaction > TransactionPtr;
+
+/**
+ * Selects transactions for Swdb::listTransactions().
+ * Zero bounds are open, date bounds are compared against dt_begin.
+ */
+struct TransactionRange {
+    int64_t idMin = 0;
+    int64_t idMax = 0;
+    int64_t dtBeginMin = 0;
+    int64_t dtBeginMax = 0;
+    int64_t offset = 0;
+    int64_t limit = 0;
+    bool reverse = false;
+};
 };
 
 #include "item.hpp"
@@ -62,12 +79,21 @@ public:
 
 protected:
     explicit Transaction(SQLite3Ptr conn);
+    // load from a row of a bulk query
+    Transaction(SQLite3Ptr conn, SQLite3::Query &query);
     void dbSelect(int64_t transaction_id);
+    void loadFromQuery(SQLite3::Query &query);
     std::set< std::shared_ptr< RPMItem > > softwarePerformedWith;
 
     friend class ::TransactionItem;
+    friend class ::Swdb;
+    friend class ::MergedTransaction;
     SQLite3Ptr conn;
 
+    // items loaded together with the transaction by Swdb
+    std::vector< TransactionItemPtr > prefetchedItems;
+    bool itemsPrefetched = false;
+
     int64_t id = 0;
     int64_t dtBegin = 0;
     int64_t dtEnd = 0;
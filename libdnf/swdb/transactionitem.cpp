@@ -94,6 +94,12 @@ TransactionItem::TransactionItem(SQLite3Ptr conn, int64_t transID)
 {
 }
 
+int64_t
+TransactionItem::getTransactionId() const noexcept
+{
+    return trans ? trans->getId() : transID;
+}
+
 void
 TransactionItem::save()
 {
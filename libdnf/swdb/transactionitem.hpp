@@ -87,7 +87,7 @@ public:
     int64_t getId() const noexcept { return id; }
     void setId(int64_t value) { id = value; }
 
-    // int64_t getTransactionId() const noexcept { return trans.getId(); }
+    int64_t getTransactionId() const noexcept;
 
     const std::vector< TransactionItemPtr > &getReplacedBy() const noexcept { return replacedBy; }
     void addReplacedBy(TransactionItemPtr value) { replacedBy.push_back(value); }
@@ -39,10 +39,115 @@ static const char *sql_create_tables =
 #include "sql/create_tables.sql"
     ;
 
+/**
+ * Schema changes applied on top of create_tables.sql, in ascending order.
+ * Each one moves config.version to its version.
+ */
+static const struct {
+    const char *version;
+    const char *sql;
+} schemaMigrations[] = {
+    {"1.2",
+#include "sql/migrate_tables_1_2.sql"
+    },
+    {"1.3",
+#include "sql/migrate_tables_1_3.sql"
+#include "sql/rebuild_current_reason.sql"
+    },
+    {"1.4",
+#include "sql/migrate_tables_1_4.sql"
+#include "sql/rebuild_rpm_search.sql"
+    },
+};
+
+/**
+ * Parse "major.minor" schema version
+ */
+static std::pair< int, int >
+parseSchemaVersion(const std::string &version)
+{
+    int major = 0;
+    int minor = 0;
+    sscanf(version.c_str(), "%d.%d", &major, &minor);
+    return std::make_pair(major, minor);
+}
+
 void
 Transformer::createDatabase(SQLite3Ptr conn)
 {
     conn->exec(sql_create_tables);
+    migrateSchema(conn);
+}
+
+/**
+ * Get schema version stored in the config table
+ * The version is also cached on the connection for hasSchemaVersion().
+ */
+std::string
+Transformer::getSchemaVersion(SQLite3Ptr conn)
+{
+    const char *sql = R"**(
+        SELECT
+            value
+        FROM
+            config
+        WHERE
+            key = 'version'
+    )**";
+    SQLite3::Query query(*conn, sql);
+    if (query.step() != SQLite3::Statement::StepResult::ROW) {
+        throw Exception("Database schema version is not set");
+    }
+    auto version = query.get< std::string >("value");
+    conn->setSchemaVersion(version);
+    return version;
+}
+
+/**
+ * Check whether the database schema is at least the given version
+ * The stored version is read once per connection, migrateSchema() keeps it up to date.
+ */
+bool
+Transformer::hasSchemaVersion(SQLite3Ptr conn, const std::string &version)
+{
+    if (conn->getSchemaVersion().empty()) {
+        getSchemaVersion(conn);
+    }
+    return parseSchemaVersion(conn->getSchemaVersion()) >= parseSchemaVersion(version);
+}
+
+/**
+ * Upgrade database schema to the latest version.
+ * Every migration runs in its own SQL transaction together with the version bump,
+ * so an interrupted upgrade is resumed by the next call.
+ * Nothing is written unless the stored version is older than the library's.
+ * Databases created by a newer libdnf are left untouched.
+ */
+void
+Transformer::migrateSchema(SQLite3Ptr conn)
+{
+    auto current = parseSchemaVersion(getSchemaVersion(conn));
+
+    for (const auto &migration : schemaMigrations) {
+        if (parseSchemaVersion(migration.version) <= current) {
+            continue;
+        }
+        conn->exec("BEGIN");
+        try {
+            conn->exec(migration.sql);
+            {
+                SQLite3::Statement query(*conn, "UPDATE config SET value = ? WHERE key = 'version'");
+                query.bindv(migration.version);
+                query.step();
+            }
+            conn->exec("COMMIT");
+        } catch (const std::exception &) {
+            conn->exec("ROLLBACK");
+            throw;
+        }
+        conn->setSchemaVersion(migration.version);
+        current = parseSchemaVersion(migration.version);
+    }
 }
 
 /**
@@ -98,7 +203,8 @@ Transformer::Transformer(const std::string &outputFile, const std::string &input
 
 /**
  * Perform the database transformation routine.
- * The database is transformed in-memory.
+ * The database is transformed in-memory, in a single SQL transaction,
+ * with the history database attached to the same connection.
  * Final scheme is dumped into outputFile
  */
 void
@@ -111,13 +217,26 @@ Transformer::transform()
 
     // migrate history db if it exists
     try {
-        auto history = std::make_shared< SQLite3 >(historyPath().c_str());
+        {
+            SQLite3::Statement attach(*swdb, "ATTACH DATABASE ? AS history");
+            attach.bindv(historyPath());
+            attach.step();
+        }
 
-        // transform objects
-        transformTrans(swdb, history);
+        swdb->exec("BEGIN");
+        try {
+            // transform objects
+            transformTrans(swdb);
 
-        // transform groups
-        transformGroups(swdb);
+            // transform groups
+            transformGroups(swdb);
+
+            swdb->exec("COMMIT");
+        } catch (...) {
+            swdb->exec("ROLLBACK");
+            throw;
+        }
+        swdb->exec("DETACH DATABASE history");
     }
     catch (Exception ex) {
         // TODO: use a different (more specific) exception
@@ -127,16 +246,56 @@ Transformer::transform()
     swdb->backup(outputFile);
 }
 
+/**
+ * Set a function to be called after each transformed transaction
+ * \param callback function receiving the number of transformed and total transactions
+ */
+void
+Transformer::setProgressCallback(const ProgressCallback &callback)
+{
+    progressCallback = callback;
+}
+
+/**
+ * Load reason and repoid of all the history packages from yumdb
+ * \param swdb pointer to SQLite3 object with the history database attached
+ */
+void
+Transformer::loadYumdbData(SQLite3Ptr swdb)
+{
+    const char *sql = R"**(
+        SELECT
+            pkgtupid,
+            yumdb_key as key,
+            yumdb_val as value
+        FROM
+            pkg_yumdb
+        WHERE
+            key IN ('reason', 'from_repo')
+    )**";
+
+    yumdbData.clear();
+    SQLite3::Query query(*swdb, sql);
+    while (query.step() == SQLite3::Statement::StepResult::ROW) {
+        auto &data = yumdbData[query.get< int64_t >("pkgtupid")];
+        std::string key = query.get< std::string >("key");
+        if (key == "reason") {
+            data.first = Transformer::getReason(query.get< std::string >("value"));
+        } else if (key == "from_repo") {
+            data.second = query.get< std::string >("value");
+        }
+    }
+}
+
 /**
  * Transform transactions from the history database
+ * History tables are read through the swdb connection,
+ * the history database is expected to be attached to it.
  * \param swdb pointer to swdb SQLite3 object
- * \param swdb pointer to history database SQLite3 object
  */
 void
-Transformer::transformTrans(SQLite3Ptr swdb, SQLite3Ptr history)
+Transformer::transformTrans(SQLite3Ptr swdb)
 {
-    std::vector< std::shared_ptr< TransformerTransaction > > result;
-
     // we need to left join with trans_cmdline
     // there is no cmdline for certain transactions (e.g. 1)
     const char *trans_sql = R"**(
@@ -157,6 +316,14 @@ Transformer::transformTrans(SQLite3Ptr swdb, SQLite3Ptr history)
             tb.tid
     )**";
 
+    const char *count_sql = R"**(
+        SELECT
+            COUNT(*)
+        FROM
+            trans_beg
+            JOIN trans_end using(tid)
+    )**";
+
     const char *releasever_sql = R"**(
         SELECT DISTINCT
             trans_data_pkgs.tid as tid,
@@ -169,16 +336,64 @@ Transformer::transformTrans(SQLite3Ptr swdb, SQLite3Ptr history)
             yumdb_key='releasever'
     )**";
 
+    // the order is important here - its Update, Updated
+    const char *pkg_sql = R"**(
+        SELECT
+            t.state,
+            t.done,
+            r.pkgtupid as id,
+            r.name,
+            r.epoch,
+            r.version,
+            r.release,
+            r.arch
+        FROM
+            trans_data_pkgs t
+            JOIN pkgtups r using(pkgtupid)
+        WHERE
+            t.tid=?
+    )**";
+
+    const char *with_sql = R"**(
+        SELECT
+            pkgtupid as id,
+            name,
+            epoch,
+            version,
+            release,
+            arch
+        FROM
+            trans_with_pkgs
+            JOIN pkgtups using (pkgtupid)
+        WHERE
+            tid=?
+    )**";
+
     // get release version for all the transactions
     std::map< int64_t, std::string > releasever;
-    SQLite3::Query releasever_query(*history.get(), releasever_sql);
+    SQLite3::Query releasever_query(*swdb, releasever_sql);
     while (releasever_query.step() == SQLite3::Statement::StepResult::ROW) {
         std::string releaseVerStr = releasever_query.get< std::string >("releasever");
         releasever[releasever_query.get< int64_t >("tid")] = releaseVerStr;
     }
 
+    int64_t total = 0;
+    if (progressCallback) {
+        SQLite3::Query count_query(*swdb, count_sql);
+        count_query.step();
+        total = count_query.get< int64_t >(0);
+    }
+
+    loadYumdbData(swdb);
+    rpmItems.clear();
+
+    // per transaction queries are prepared once
+    SQLite3::Query pkg_query(*swdb, pkg_sql);
+    SQLite3::Query with_query(*swdb, with_sql);
+
     // iterate over history transactions
-    SQLite3::Query query(*history.get(), trans_sql);
+    int64_t processed = 0;
+    SQLite3::Query query(*swdb, trans_sql);
     while (query.step() == SQLite3::Statement::StepResult::ROW) {
         auto trans = std::make_shared< TransformerTransaction >(swdb);
         trans->setId(query.get< int >("id"));
@@ -198,166 +413,127 @@ Transformer::transformTrans(SQLite3Ptr swdb, SQLite3Ptr history)
 
         bool done = query.get< int >("done") == 0 ? true : false;
 
-        transformRPMItems(swdb, history, trans);
-        transformTransWith(swdb, history, trans);
+        pkg_query.bindv(trans->getId());
+        transformRPMItems(swdb, pkg_query, trans);
+        pkg_query.reset();
 
-        trans->begin();
-
-        transformOutput(history, trans);
+        with_query.bindv(trans->getId());
+        transformTransWith(swdb, with_query, trans);
+        with_query.reset();
 
+        trans->begin();
         trans->finish(done);
+
+        if (progressCallback) {
+            progressCallback(++processed, total);
+        }
     }
+
+    transformOutput(swdb);
+
+    // history was inserted behind the back of current_reason
+    RPMItem::rebuildCurrentReasons(swdb);
 }
 
-static void
-fillRPMItem(std::shared_ptr< RPMItem > rpm, SQLite3::Query &query)
+/**
+ * Get RPM item for a history package, create it on the first use
+ * \param swdb pointer to swdb SQLite3 object
+ * \param query query positioned at a pkgtups row
+ */
+std::shared_ptr< RPMItem >
+Transformer::getRPMItem(SQLite3Ptr swdb, SQLite3::Query &query)
 {
+    auto pkgtupId = query.get< int64_t >("id");
+    auto it = rpmItems.find(pkgtupId);
+    if (it != rpmItems.end()) {
+        return it->second;
+    }
+
+    auto rpm = std::make_shared< RPMItem >(swdb);
     rpm->setName(query.get< std::string >("name"));
     rpm->setEpoch(query.get< int64_t >("epoch"));
     rpm->setVersion(query.get< std::string >("version"));
     rpm->setRelease(query.get< std::string >("release"));
     rpm->setArch(query.get< std::string >("arch"));
     rpm->save();
+    rpmItems[pkgtupId] = rpm;
+    return rpm;
 }
 
 /**
  * Transform binding between a Transaction and packages, which performed the transaction.
  * \param swdb pointer to swdb SQLite3 object
- * \param swdb pointer to history database SQLite3 object
+ * \param query trans_with_pkgs query bound to the transaction
+ * \param trans Transaction whose software should be transformed
  */
 void
 Transformer::transformTransWith(SQLite3Ptr swdb,
-                                SQLite3Ptr history,
+                                SQLite3::Query &query,
                                 std::shared_ptr< TransformerTransaction > trans)
 {
-    const char *sql = R"**(
-        SELECT
-            name,
-            epoch,
-            version,
-            release,
-            arch
-        FROM
-            trans_with_pkgs
-            JOIN pkgtups using (pkgtupid)
-        WHERE
-            tid=?
-    )**";
-
-    // transform stdout
-    SQLite3::Query query(*history.get(), sql);
-    query.bindv(trans->getId());
     while (query.step() == SQLite3::Statement::StepResult::ROW) {
-        // create RPM item object
-        auto rpm = std::make_shared< RPMItem >(swdb);
-        fillRPMItem(rpm, query);
-        trans->addSoftwarePerformedWith(rpm);
+        trans->addSoftwarePerformedWith(getRPMItem(swdb, query));
     }
 }
 
 /**
- * Transform transaction console outputs.
- * \param swdb pointer to history database SQLite3 object
+ * Transform console outputs of all the transformed transactions.
+ * stdout lines of a transaction go first, followed by its errors.
+ * \param swdb pointer to swdb SQLite3 object
  */
 void
-Transformer::transformOutput(SQLite3Ptr history, std::shared_ptr< TransformerTransaction > trans)
+Transformer::transformOutput(SQLite3Ptr swdb)
 {
     const char *sql = R"**(
+        INSERT INTO
+            console_output (
+                trans_id,
+                file_descriptor,
+                line
+            )
         SELECT
-            line
-        FROM
-            trans_script_stdout
-        WHERE
-            tid = ?
-        ORDER BY
-            lid
-    )**";
-
-    // transform stdout
-    SQLite3::Query query(*history.get(), sql);
-    query.bindv(trans->getId());
-    while (query.step() == SQLite3::Statement::StepResult::ROW) {
-        trans->addConsoleOutputLine(1, query.get< std::string >("line"));
-    }
-
-    sql = R"**(
-        SELECT
-            msg
-        FROM
-            trans_error
-        WHERE
-            tid = ?
+            o.tid,
+            o.file_descriptor,
+            o.line
+        FROM (
+            SELECT
+                tid,
+                1 as file_descriptor,
+                line,
+                lid as pos
+            FROM
+                trans_script_stdout
+            UNION ALL
+            SELECT
+                tid,
+                2 as file_descriptor,
+                msg as line,
+                mid as pos
+            FROM
+                trans_error
+        ) o
+        JOIN
+            trans t ON t.id = o.tid
         ORDER BY
-            mid
+            o.tid,
+            o.file_descriptor,
+            o.pos
     )**";
 
-    // transform stderr
-    SQLite3::Query errorQuery(*history.get(), sql);
-    errorQuery.bindv(trans->getId());
-    while (errorQuery.step() == SQLite3::Statement::StepResult::ROW) {
-        trans->addConsoleOutputLine(2, errorQuery.get< std::string >("msg"));
-    }
-}
-
-static void
-getYumdbData(int64_t itemId, SQLite3Ptr history, TransactionItemReason &reason, std::string &repoid)
-{
-    const char *sql = R"**(
-        SELECT
-            yumdb_key as key,
-            yumdb_val as value
-        FROM
-            pkg_yumdb
-        WHERE
-            pkgtupid=?
-            and key IN ('reason', 'from_repo')
-    )**";
-
-    // load reason and repoid data from yumdb
-    SQLite3::Query query(*history.get(), sql);
-    query.bindv(itemId);
-    while (query.step() == SQLite3::Statement::StepResult::ROW) {
-        std::string key = query.get< std::string >("key");
-        if (key == "reason") {
-            reason = Transformer::getReason(query.get< std::string >("value"));
-        } else if (key == "from_repo") {
-            repoid = query.get< std::string >("value");
-        }
-    }
+    swdb->exec(sql);
 }
 
 /**
  * Transform RPM Items from a particular transaction.
  * \param swdb pointer to swdb SQLite3 object
- * \param swdb pointer to history database SQLite3 objects
+ * \param query trans_data_pkgs query bound to the transaction
  * \param trans Transaction whose items should be transformed
  */
 void
 Transformer::transformRPMItems(SQLite3Ptr swdb,
-                               SQLite3Ptr history,
+                               SQLite3::Query &query,
                                std::shared_ptr< TransformerTransaction > trans)
 {
-    // the order is important here - its Update, Updated
-    const char *pkg_sql = R"**(
-        SELECT
-            t.state,
-            t.done,
-            r.pkgtupid as id,
-            r.name,
-            r.epoch,
-            r.version,
-            r.release,
-            r.arch
-        FROM
-            trans_data_pkgs t
-            JOIN pkgtups r using(pkgtupid)
-        WHERE
-            t.tid=?
-    )**";
-
-    SQLite3::Query query(*history.get(), pkg_sql);
-    query.bindv(trans->getId());
-
     TransactionItemPtr last = nullptr;
 
     /*
@@ -373,9 +549,8 @@ Transformer::transformRPMItems(SQLite3Ptr swdb,
     // interate over transaction packages in the history database
     while (query.step() == SQLite3::Statement::StepResult::ROW) {
 
-        // create RPM item object
-        auto rpm = std::make_shared< RPMItem >(swdb);
-        fillRPMItem(rpm, query);
+        // get or create RPM item object
+        auto rpm = getRPMItem(swdb, query);
 
         // get item state/action
         std::string stateString = query.get< std::string >("state");
@@ -394,10 +569,14 @@ Transformer::transformRPMItems(SQLite3Ptr swdb,
         if (pastObsoleted == obsoletedItems.end()) {
             // item hasn't been obsoleted yet
 
-            // load reason and from_repo
+            // reason and from_repo
             TransactionItemReason reason = TransactionItemReason::UNKNOWN;
             std::string repoid;
-            getYumdbData(query.get< int64_t >("id"), history, reason, repoid);
+            auto yumdb = yumdbData.find(query.get< int64_t >("id"));
+            if (yumdb != yumdbData.end()) {
+                reason = yumdb->second.first;
+                repoid = yumdb->second.second;
+            }
 
             // add TransactionItem object
             transItem = trans->addItem(rpm, repoid, action, reason);
@@ -21,8 +21,12 @@
 #ifndef LIBDNF_SWDB_TRANSFORMER_HPP
 #define LIBDNF_SWDB_TRANSFORMER_HPP
 
+#include <functional>
 #include <json/json.h>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "../utils/sqlite3/sqlite3.hpp"
@@ -45,6 +49,13 @@ public:
         dbInsert();
         saveItems();
     }
+
+    // current_reason is rebuilt once all the transactions are transformed
+    void finish(bool success)
+    {
+        setDone(success);
+        dbUpdate();
+    }
 };
 
 /**
@@ -64,26 +75,34 @@ public:
         }
     };
 
+    typedef std::function< void(int64_t processed, int64_t total) > ProgressCallback;
+
     Transformer(const std::string &outputFile, const std::string &inputDir);
     void transform();
+    void setProgressCallback(const ProgressCallback &callback);
 
     static void createDatabase(SQLite3Ptr conn);
+    static void migrateSchema(SQLite3Ptr conn);
+    static std::string getSchemaVersion(SQLite3Ptr conn);
+    static bool hasSchemaVersion(SQLite3Ptr conn, const std::string &version);
 
     static TransactionItemReason getReason(const std::string &reason);
 
 protected:
-    void transformTrans(SQLite3Ptr swdb, SQLite3Ptr history);
+    void transformTrans(SQLite3Ptr swdb);
 
     void transformGroups(SQLite3Ptr swdb);
     void processGroupPersistor(SQLite3Ptr swdb, const Json::Value &root);
 
 private:
+    void loadYumdbData(SQLite3Ptr swdb);
+    std::shared_ptr< RPMItem > getRPMItem(SQLite3Ptr swdb, SQLite3::Query &query);
     void transformRPMItems(SQLite3Ptr swdb,
-                           SQLite3Ptr history,
+                           SQLite3::Query &query,
                            std::shared_ptr< TransformerTransaction > trans);
-    void transformOutput(SQLite3Ptr history, std::shared_ptr< TransformerTransaction > trans);
+    void transformOutput(SQLite3Ptr swdb);
     void transformTransWith(SQLite3Ptr swdb,
-                            SQLite3Ptr history,
+                            SQLite3::Query &query,
                             std::shared_ptr< TransformerTransaction > trans);
     CompsGroupItemPtr processGroup(SQLite3Ptr swdb,
                                    const std::string &groupId,
@@ -95,6 +114,12 @@ private:
     const std::string inputDir;
     const std::string outputFile;
     const std::string transformFile;
+    ProgressCallback progressCallback;
+
+    // history pkgtupid -> reason and repoid from yumdb
+    std::unordered_map< int64_t, std::pair< TransactionItemReason, std::string > > yumdbData;
+    // history pkgtupid -> RPM item
+    std::unordered_map< int64_t, std::shared_ptr< RPMItem > > rpmItems;
 };
 
 #endif
@@ -0,0 +1,290 @@
+/*
+ * Allocation free comparison of RPM epoch, version and release strings
+ *
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "evrcmp.hpp"
+
+namespace libdnf {
+
+// locale independent replacements of isdigit() and isalpha()
+static inline bool
+isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool
+isAlpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool
+isSegmentStart(char c)
+{
+    return isDigit(c) || isAlpha(c) || c == '~' || c == '^';
+}
+
+int
+rpmvercmp(const char *first, const char *firstEnd, const char *second, const char *secondEnd)
+{
+    while (true) {
+        while (first < firstEnd && !isSegmentStart(*first)) {
+            first++;
+        }
+        while (second < secondEnd && !isSegmentStart(*second)) {
+            second++;
+        }
+
+        // tilde sorts before everything else, even before the end of the string
+        bool firstTilde = first < firstEnd && *first == '~';
+        bool secondTilde = second < secondEnd && *second == '~';
+        if (firstTilde || secondTilde) {
+            if (!secondTilde) {
+                return -1;
+            }
+            if (!firstTilde) {
+                return 1;
+            }
+            first++;
+            second++;
+            continue;
+        }
+
+        // caret sorts after the end of the string, but before anything else
+        bool firstCaret = first < firstEnd && *first == '^';
+        bool secondCaret = second < secondEnd && *second == '^';
+        if (firstCaret || secondCaret) {
+            if (first == firstEnd) {
+                return -1;
+            }
+            if (second == secondEnd) {
+                return 1;
+            }
+            if (!firstCaret) {
+                return 1;
+            }
+            if (!secondCaret) {
+                return -1;
+            }
+            first++;
+            second++;
+            continue;
+        }
+
+        if (first == firstEnd || second == secondEnd) {
+            break;
+        }
+
+        const char *firstSegmentEnd = first;
+        const char *secondSegmentEnd = second;
+        if (isDigit(*first) || isDigit(*second)) {
+            // numeric segment is newer than alpha one: the alpha side has empty digit run
+            while (first + 1 < firstEnd && *first == '0' && isDigit(first[1])) {
+                first++;
+            }
+            while (second + 1 < secondEnd && *second == '0' && isDigit(second[1])) {
+                second++;
+            }
+            firstSegmentEnd = first;
+            while (firstSegmentEnd < firstEnd && isDigit(*firstSegmentEnd)) {
+                firstSegmentEnd++;
+            }
+            secondSegmentEnd = second;
+            while (secondSegmentEnd < secondEnd && isDigit(*secondSegmentEnd)) {
+                secondSegmentEnd++;
+            }
+            auto firstLength = firstSegmentEnd - first;
+            auto secondLength = secondSegmentEnd - second;
+            // without leading zeros the longer number is the bigger one
+            if (firstLength != secondLength) {
+                return firstLength > secondLength ? 1 : -1;
+            }
+            int result = std::memcmp(first, second, firstLength);
+            if (result != 0) {
+                return result > 0 ? 1 : -1;
+            }
+        } else {
+            while (firstSegmentEnd < firstEnd && isAlpha(*firstSegmentEnd)) {
+                firstSegmentEnd++;
+            }
+            while (secondSegmentEnd < secondEnd && isAlpha(*secondSegmentEnd)) {
+                secondSegmentEnd++;
+            }
+            auto firstLength = firstSegmentEnd - first;
+            auto secondLength = secondSegmentEnd - second;
+            int result = std::memcmp(first, second, std::min(firstLength, secondLength));
+            if (result != 0) {
+                return result > 0 ? 1 : -1;
+            }
+            if (firstLength != secondLength) {
+                return firstLength > secondLength ? 1 : -1;
+            }
+        }
+        first = firstSegmentEnd;
+        second = secondSegmentEnd;
+    }
+
+    if (first < firstEnd) {
+        return 1;
+    }
+    if (second < secondEnd) {
+        return -1;
+    }
+    return 0;
+}
+
+int
+rpmvercmp(const std::string &first, const std::string &second)
+{
+    return rpmvercmp(
+        first.data(), first.data() + first.size(), second.data(), second.data() + second.size());
+}
+
+/**
+ * Find the end of the leading epoch of an "[epoch:]version[-release]" string
+ * \return pointer to the ':' or nullptr if the string has no epoch
+ */
+static const char *
+findEpochEnd(const char *evr, const char *evrEnd)
+{
+    const char *pos = evr;
+    while (pos < evrEnd && isDigit(*pos)) {
+        pos++;
+    }
+    if (pos == evr || pos == evrEnd || *pos != ':') {
+        return nullptr;
+    }
+    return pos;
+}
+
+/**
+ * Check if the epoch in [epoch, epochEnd) consists of zeros only
+ */
+static bool
+isZeroEpoch(const char *epoch, const char *epochEnd)
+{
+    while (epoch < epochEnd && *epoch == '0') {
+        epoch++;
+    }
+    return epoch == epochEnd;
+}
+
+/**
+ * Find the dash separating version from release - the last one in the string
+ * \return pointer to the '-' or nullptr if the string has no release
+ */
+static const char *
+findReleaseStart(const char *evr, const char *evrEnd)
+{
+    for (const char *pos = evrEnd; pos > evr; --pos) {
+        if (pos[-1] == '-') {
+            return pos - 1;
+        }
+    }
+    return nullptr;
+}
+
+int
+evrcmp(const char *first, const char *firstEnd, const char *second, const char *secondEnd)
+{
+    if (first == second && firstEnd == secondEnd) {
+        return 0;
+    }
+
+    const char *firstEpochEnd = findEpochEnd(first, firstEnd);
+    const char *secondEpochEnd = findEpochEnd(second, secondEnd);
+    if (firstEpochEnd && secondEpochEnd) {
+        int result = rpmvercmp(first, firstEpochEnd, second, secondEpochEnd);
+        if (result != 0) {
+            return result;
+        }
+    } else if (firstEpochEnd) {
+        if (!isZeroEpoch(first, firstEpochEnd)) {
+            return 1;
+        }
+    } else if (secondEpochEnd) {
+        if (!isZeroEpoch(second, secondEpochEnd)) {
+            return -1;
+        }
+    }
+    if (firstEpochEnd) {
+        first = firstEpochEnd + 1;
+    }
+    if (secondEpochEnd) {
+        second = secondEpochEnd + 1;
+    }
+
+    const char *firstDash = findReleaseStart(first, firstEnd);
+    const char *secondDash = findReleaseStart(second, secondEnd);
+    int result = rpmvercmp(first,
+                           firstDash ? firstDash : firstEnd,
+                           second,
+                           secondDash ? secondDash : secondEnd);
+    if (result != 0) {
+        return result;
+    }
+    if (!firstDash || !secondDash) {
+        if (firstDash) {
+            return 1;
+        }
+        if (secondDash) {
+            return -1;
+        }
+        return 0;
+    }
+    return rpmvercmp(firstDash + 1, firstEnd, secondDash + 1, secondEnd);
+}
+
+int
+evrcmp(const char *first, const char *second)
+{
+    return evrcmp(first, first + std::strlen(first), second, second + std::strlen(second));
+}
+
+int
+evrcmp(int32_t firstEpoch,
+       const std::string &firstVersion,
+       const std::string &firstRelease,
+       int32_t secondEpoch,
+       const std::string &secondVersion,
+       const std::string &secondRelease)
+{
+    if (firstEpoch < 0) {
+        firstEpoch = 0;
+    }
+    if (secondEpoch < 0) {
+        secondEpoch = 0;
+    }
+    if (firstEpoch != secondEpoch) {
+        return firstEpoch > secondEpoch ? 1 : -1;
+    }
+    int result = rpmvercmp(firstVersion, secondVersion);
+    if (result != 0) {
+        return result;
+    }
+    return rpmvercmp(firstRelease, secondRelease);
+}
+
+} // namespace libdnf
@@ -0,0 +1,80 @@
+/*
+ * Allocation free comparison of RPM epoch, version and release strings
+ *
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef LIBDNF_EVRCMP_HPP
+#define LIBDNF_EVRCMP_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace libdnf {
+
+/**
+ * Compare two version (or release) strings using the rpmvercmp() rules
+ *  - both strings are split into alphanumeric segments, other characters are separators
+ *  - numeric segments are compared as numbers of arbitrary length, they are newer than alpha ones
+ *  - '~' sorts before anything, including the end of the string
+ *  - '^' sorts after the end of the string, but before anything else
+ * Strings are given as [begin, end) ranges and don't have to be NUL terminated.
+ * \return <0, 0, >0 if first is older, equal or newer than second
+ */
+int
+rpmvercmp(const char *first, const char *firstEnd, const char *second, const char *secondEnd);
+
+/**
+ * Compare two version (or release) strings using the rpmvercmp() rules
+ * \return <0, 0, >0 if first is older, equal or newer than second
+ */
+int
+rpmvercmp(const std::string &first, const std::string &second);
+
+/**
+ * Compare two "[epoch:]version[-release]" strings the same way
+ *  pool_evrcmp_str(pool, first, second, EVRCMP_COMPARE) does for rpm pools.
+ * A missing epoch equals to 0, a missing release is older than any release.
+ * \return <0, 0, >0 if first is older, equal or newer than second
+ */
+int
+evrcmp(const char *first, const char *firstEnd, const char *second, const char *secondEnd);
+
+/**
+ * Compare two NUL terminated "[epoch:]version[-release]" strings
+ * \return <0, 0, >0 if first is older, equal or newer than second
+ */
+int
+evrcmp(const char *first, const char *second);
+
+/**
+ * Compare already split epoch, version and release; negative epoch equals to 0
+ * \return <0, 0, >0 if first is older, equal or newer than second
+ */
+int
+evrcmp(int32_t firstEpoch,
+       const std::string &firstVersion,
+       const std::string &firstRelease,
+       int32_t secondEpoch,
+       const std::string &secondVersion,
+       const std::string &secondRelease);
+
+} // namespace libdnf
+
+#endif // LIBDNF_EVRCMP_HPP
@@ -30,8 +30,71 @@ SQLite3::open()
             sqlite3_close(db);
             throw LibException(result, "Open failed");
         }
+        sqlite3_busy_timeout(db, busyTimeout);
+        if (mode == ConnectionMode::WAL && enableWAL()) {
+            activeMode = ConnectionMode::WAL;
+            return;
+        }
+        if (!enableExclusive()) {
+            sqlite3_close(db);
+            db = nullptr;
+            throw LibException(SQLITE_BUSY, "Open failed: " + path + " is in use by WAL connections");
+        }
+        activeMode = ConnectionMode::EXCLUSIVE;
+    }
+}
+
+/**
+ * Switch the database to a rollback journal with exclusive locking.
+ * \return false if WAL connections have the database open,
+ *         its journal mode can't be changed under them
+ */
+bool
+SQLite3::enableExclusive()
+{
+    try {
         // sqlite doesn't behave correctly in chroots without following line:
-        exec("PRAGMA journal_mode = TRUNCATE; PRAGMA locking_mode = EXCLUSIVE");
+        Query query(*this, "PRAGMA journal_mode = TRUNCATE");
+        if (query.step() == Statement::StepResult::ROW && query.get< std::string >(0) == "wal") {
+            return false;
+        }
+    } catch (const LibException &e) {
+        if (e.code() != SQLITE_BUSY && e.code() != SQLITE_LOCKED) {
+            throw;
+        }
+        return false;
+    }
+    exec("PRAGMA locking_mode = EXCLUSIVE");
+    return true;
+}
+
+/**
+ * Switch the database to write-ahead logging with normal locking.
+ * \return false if the database can't use WAL (in-memory database,
+ *         no shared memory support, locked by an exclusive connection)
+ */
+bool
+SQLite3::enableWAL()
+{
+    try {
+        exec("PRAGMA locking_mode = NORMAL");
+        Query query(*this, "PRAGMA journal_mode = WAL");
+        if (query.step() != Statement::StepResult::ROW ||
+            query.get< std::string >(0) != "wal") {
+            return false;
+        }
+    } catch (const LibException &) {
+        return false;
+    }
+    return true;
+}
+
+void
+SQLite3::setBusyTimeout(int milliseconds)
+{
+    busyTimeout = milliseconds;
+    if (db != nullptr) {
+        sqlite3_busy_timeout(db, busyTimeout);
     }
 }
 
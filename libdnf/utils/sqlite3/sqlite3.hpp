@@ -68,6 +68,19 @@ public:
         const void *data;
     };
 
+    /**
+     * How the database file is shared with other connections.
+     * EXCLUSIVE: rollback journal, the first connection locks out everybody else;
+     *            works in chroots and on filesystems without shared memory support.
+     * WAL: write-ahead log with normal locking; readers don't block the writer
+     *      and the writer doesn't block readers. Falls back to EXCLUSIVE
+     *      if WAL can't be enabled for the database.
+     * The modes don't mix on one file: a WAL connection opened next to an
+     * EXCLUSIVE one falls back to EXCLUSIVE and waits for the lock, and opening
+     * an EXCLUSIVE connection while WAL connections are open throws.
+     */
+    enum class ConnectionMode { EXCLUSIVE, WAL };
+
     class Statement {
     public:
         enum class StepResult { DONE, ROW, BUSY };
@@ -331,8 +344,9 @@ public:
     SQLite3(const SQLite3 &) = delete;
     SQLite3 &operator=(const SQLite3 &) = delete;
 
-    SQLite3(const std::string &dbPath)
+    SQLite3(const std::string &dbPath, ConnectionMode mode = ConnectionMode::EXCLUSIVE)
       : path{dbPath}
+      , mode{mode}
       , db{nullptr}
     {
         open();
@@ -346,6 +360,19 @@ public:
     void close();
     bool isOpened() { return db != nullptr; };
 
+    /// Mode the connection actually runs in, EXCLUSIVE if WAL fell back.
+    ConnectionMode getConnectionMode() const noexcept { return activeMode; }
+
+    /// True if the database file could only be opened for reading.
+    bool isReadOnly() { return sqlite3_db_readonly(db, "main") == 1; }
+
+    /// Time in ms to wait for a lock held by another connection before failing with BUSY.
+    void setBusyTimeout(int milliseconds);
+
+    /// Schema version the application cached for this connection, empty until it is set.
+    const std::string &getSchemaVersion() const noexcept { return schemaVersion; }
+    void setSchemaVersion(const std::string &version) { schemaVersion = version; }
+
     void exec(const char *sql)
     {
         auto result = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
@@ -363,7 +390,14 @@ public:
     void backup(const std::string &outputFile);
 
 protected:
+    bool enableWAL();
+    bool enableExclusive();
+
     std::string path;
+    ConnectionMode mode;
+    ConnectionMode activeMode = ConnectionMode::EXCLUSIVE;
+    int busyTimeout = 10000;
+    std::string schemaVersion;
 
     sqlite3 *db;
 };
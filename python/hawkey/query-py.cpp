@@ -785,7 +785,7 @@ q_contains(PyObject *self, PyObject *pypkg)
     if (pkg) {
         Id id = dnf_package_get_id(pkg);
         q->apply();
-        if (MAPTST(q->getResult(), id))
+        if (MAPTST(hy_query_get_result(q), id))
             Py_RETURN_TRUE;
     }
     Py_RETURN_FALSE;
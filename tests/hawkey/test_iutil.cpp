@@ -24,6 +24,7 @@
 
 
 #include <solv/pool.h>
+#include <solv/solv_xfopen.h>
 
 
 #include "libdnf/hy-util.h"
@@ -174,6 +175,33 @@ START_TEST(test_version_split)
 }
 END_TEST
 
+START_TEST(test_xfopen_threaded)
+{
+    char *fn = solv_dupjoin(test_globals.repo_dir, "yum/updateinfo.xml.gz", NULL);
+    FILE *expected = solv_xfopen(fn, "r");
+    FILE *fp = xfopen_threaded(fn);
+    char buf_expected[4096], buf[4096];
+    size_t n_expected, n, total = 0;
+
+    fail_if(expected == NULL);
+    fail_if(fp == NULL);
+    do {
+        n_expected = fread(buf_expected, 1, sizeof(buf_expected), expected);
+        n = fread(buf, 1, sizeof(buf), fp);
+        ck_assert_int_eq(n, n_expected);
+        fail_if(memcmp(buf, buf_expected, n));
+        total += n;
+    } while (n > 0);
+    fail_unless(total > 0);
+    fail_if(ferror(fp));
+
+    fclose(expected);
+    fclose(fp);
+    fail_unless(xfopen_threaded("/no/such/file.gz") == NULL);
+    g_free(fn);
+}
+END_TEST
+
 Suite *
 iutil_suite(void)
 {
@@ -184,6 +212,7 @@ iutil_suite(void)
     tcase_add_test(tc, test_checksum_write_read);
     tcase_add_test(tc, test_mkcachedir);
     tcase_add_test(tc, test_version_split);
+    tcase_add_test(tc, test_xfopen_threaded);
     suite_add_tcase(s, tc);
     return s;
 }
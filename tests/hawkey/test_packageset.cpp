@@ -71,6 +71,24 @@ START_TEST(test_clone)
 }
 END_TEST
 
+START_TEST(test_clone_modify)
+{
+    auto pset2 = std::unique_ptr <DnfPackageSet> (dnf_packageset_clone(pset));
+
+    // clones share the bitmap until one of them is modified
+    fail_unless(dnf_packageset_peek_map(pset) == dnf_packageset_peek_map(pset2.get()));
+    pset2->set(8);
+    fail_unless(pset2->has(8));
+    fail_if(pset->has(8));
+    fail_unless(dnf_packageset_count(pset) == 3);
+    fail_unless(dnf_packageset_count(pset2.get()) == 4);
+
+    pset->set(7);
+    fail_unless(pset->has(7));
+    fail_if(pset2->has(7));
+}
+END_TEST
+
 START_TEST(test_has)
 {
     DnfSack *sack = test_globals.sack;
@@ -177,6 +195,7 @@ packageset_suite(void)
     TCase *tc = tcase_create("Core");
     tcase_add_checked_fixture(tc, packageset_fixture, packageset_teardown);
     tcase_add_test(tc, test_clone);
+    tcase_add_test(tc, test_clone_modify);
     tcase_add_test(tc, test_has);
     tcase_add_test(tc, test_get_clone);
     tcase_add_test(tc, test_get_pkgid);
@@ -86,6 +86,20 @@ START_TEST(test_query_clear)
 }
 END_TEST
 
+START_TEST(test_query_get_result)
+{
+    HyQuery q = hy_query_create(test_globals.sack);
+
+    // nothing to read before the query is applied
+    fail_unless(hy_query_get_result(q) == NULL);
+    hy_query_apply(q);
+    fail_if(hy_query_get_result(q) == NULL);
+    hy_query_clear(q);
+    fail_unless(hy_query_get_result(q) == NULL);
+    hy_query_free(q);
+}
+END_TEST
+
 START_TEST(test_query_clone)
 {
     const char *namelist[] = {"penny", "fool", NULL};
@@ -881,6 +895,33 @@ START_TEST(test_query_nevra)
 }
 END_TEST
 
+START_TEST(test_query_nevra_forms)
+{
+    DnfSack *sack = test_globals.sack;
+    const struct {
+        int cmp_type;
+        const char *nevra;
+        int count;
+    } cases[] = {
+        {HY_EQ, "penny-lib-4-1.x86_64", 1},
+        {HY_EQ, "penny-0:4-1.noarch", 1},
+        {HY_EQ, "baby-6:5.0-11.x86_64", 1},
+        {HY_EQ, "baby-5.0-11.x86_64", 1},
+        {HY_EQ, "baby-0:5.0-11.x86_64", 0},
+        {HY_EQ, "penny-4-1.x86_64", 0},
+        {HY_EQ, "unknown-4-1.noarch", 0},
+        {HY_GLOB, "penny-4-1.noarch", 1},
+        {HY_EQ | HY_ICASE, "PENNY-4-1.noarch", 1},
+    };
+
+    for (auto c : cases) {
+        HyQuery q = hy_query_create(sack);
+        hy_query_filter(q, HY_PKG_NEVRA, c.cmp_type, c.nevra);
+        ck_assert_int_eq(size_and_free(q), c.count);
+    }
+}
+END_TEST
+
 START_TEST(test_query_multiple_flags)
 {
     DnfSack *sack = test_globals.sack;
@@ -1023,6 +1064,7 @@ query_suite(void)
     tcase_add_test(tc, test_query_sanity);
     tcase_add_test(tc, test_query_run_set_sanity);
     tcase_add_test(tc, test_query_clear);
+    tcase_add_test(tc, test_query_get_result);
     tcase_add_test(tc, test_query_clone);
     tcase_add_test(tc, test_query_empty);
     tcase_add_test(tc, test_query_repo);
@@ -1041,6 +1083,7 @@ query_suite(void)
     tcase_add_test(tc, test_query_fileprovides);
     tcase_add_test(tc, test_query_nevra);
     tcase_add_test(tc, test_query_nevra_glob);
+    tcase_add_test(tc, test_query_nevra_forms);
     tcase_add_test(tc, test_query_multiple_flags);
     tcase_add_test(tc, test_query_apply);
     suite_add_tcase(s, tc);
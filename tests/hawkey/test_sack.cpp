@@ -25,11 +25,14 @@
 #include <sys/types.h>
 
 
+#include <solv/evr.h>
 #include <solv/testcase.h>
 
 #include <glib/gstdio.h>
 
 #include "libdnf/dnf-types.h"
+#include "libdnf/hy-packageset.h"
+#include "libdnf/hy-query.h"
 #include "libdnf/hy-package-private.hpp"
 #include "libdnf/hy-repo-private.hpp"
 #include "libdnf/dnf-sack-private.hpp"
@@ -92,6 +95,39 @@ START_TEST(test_list_arches)
 }
 END_TEST
 
+START_TEST(test_evr_split)
+{
+    g_autoptr(DnfSack) sack = dnf_sack_new();
+    Pool *pool = dnf_sack_get_pool(sack);
+    const char *evrs[] = {"1.0", "1.0-1", "1.0-2", "1.0~rc1-3", "2:0.1-1", "1:3-1.fc28",
+                          "1:3-1.fc28.1", "10-1", "9.9-1"};
+    DnfEvrSplit split;
+
+    split = dnf_sack_get_evr_split(sack, pool_str2id(pool, "3:4.1-2.fc28", 1));
+    fail_unless(split.epoch == 3);
+    ck_assert_str_eq(pool_id2str(pool, split.version), "4.1");
+    ck_assert_str_eq(pool_id2str(pool, split.release), "2.fc28");
+    split = dnf_sack_get_evr_split(sack, pool_str2id(pool, "3:4.1-2.fc28", 0));
+    fail_unless(split.epoch == 3);
+
+    split = dnf_sack_get_evr_split(sack, pool_str2id(pool, "4.1", 1));
+    fail_unless(split.epoch == 0);
+    ck_assert_str_eq(pool_id2str(pool, split.version), "4.1");
+    fail_unless(split.release == 0);
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(evrs); ++i) {
+        for (unsigned j = 0; j < G_N_ELEMENTS(evrs); ++j) {
+            Id evr1 = pool_str2id(pool, evrs[i], 1);
+            Id evr2 = pool_str2id(pool, evrs[j], 1);
+            int expected = pool_evrcmp(pool, evr1, evr2, EVRCMP_COMPARE);
+            int cmp = dnf_sack_evr_split_cmp(sack, evr1, evr2);
+            fail_unless((cmp > 0) == (expected > 0) && (cmp < 0) == (expected < 0),
+                        "%s <=> %s", evrs[i], evrs[j]);
+        }
+    }
+}
+END_TEST
+
 START_TEST(test_load_repo_err)
 {
     g_autoptr(GError) error = NULL;
@@ -239,6 +275,37 @@ check_prestoinfo(Pool *pool)
     return;
 }
 
+START_TEST(test_prime_fileprovides)
+{
+    DnfSack *sack = dnf_sack_new();
+    dnf_sack_set_cachedir(sack, test_globals.tmpdir);
+    fail_unless(dnf_sack_setup(sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, NULL));
+    char *fn = g_build_filename(test_globals.tmpdir, "fileprovides.list", NULL);
+    fail_unless(g_file_set_contents(fn, "/usr/bin/ste\n", -1, NULL));
+    g_free(fn);
+    setup_yum_sack(sack, YUM_REPO_NAME);
+    dnf_sack_prime_fileprovides(sack);
+    g_object_unref(sack);
+
+    /* the rewritten cache remembers the primed path */
+    sack = dnf_sack_new();
+    dnf_sack_set_cachedir(sack, test_globals.tmpdir);
+    fail_unless(dnf_sack_setup(sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, NULL));
+    setup_yum_sack(sack, YUM_REPO_NAME);
+    Pool *pool = dnf_sack_get_pool(sack);
+    HyRepo repo = hrepo_by_name(sack, YUM_REPO_NAME);
+    Repodata *data = repo_id2repodata(repo->libsolv_repo, 1);
+    Queue q;
+    queue_init(&q);
+    fail_unless(repodata_lookup_idarray(data, SOLVID_META,
+                                        REPOSITORY_ADDEDFILEPROVIDES, &q));
+    fail_unless(q.count == 1);
+    ck_assert_str_eq(pool_id2str(pool, q.elements[0]), "/usr/bin/ste");
+    queue_free(&q);
+    g_object_unref(sack);
+}
+END_TEST
+
 START_TEST(test_presto)
 {
     DnfSack *sack = test_globals.sack;
@@ -267,6 +334,89 @@ START_TEST(test_presto_from_cache)
 }
 END_TEST
 
+static HyQuery
+frozen_query(DnfSack *sack)
+{
+    HyQuery q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_VERSION, HY_GT, "1");
+    hy_query_filter(q, HY_PKG_EVR, HY_GT, "0:0.1-1");
+    return q;
+}
+
+static guint frozen_fool_count;
+
+static guint
+frozen_query_count(DnfSack *sack, int keyname, int cmp_type, const char *match)
+{
+    HyQuery q = hy_query_create(sack);
+    hy_query_filter(q, keyname, cmp_type, match);
+    DnfPackageSet *pset = hy_query_run_set(q);
+    guint count = dnf_packageset_count(pset);
+    dnf_packageset_free(pset);
+    hy_query_free(q);
+    return count;
+}
+
+static gpointer
+frozen_query_thread(gpointer user_data)
+{
+    auto sack = static_cast<DnfSack *>(user_data);
+    guint total = 0;
+
+    for (int i = 0; i < 100; ++i) {
+        HyQuery q = frozen_query(sack);
+        GPtrArray *plist = hy_query_run(q);
+        for (guint j = 0; j < plist->len; ++j) {
+            auto pkg = static_cast<DnfPackage *>(g_ptr_array_index(plist, j));
+            if (dnf_package_get_nevra(pkg) && dnf_package_get_version(pkg))
+                total++;
+        }
+        g_ptr_array_unref(plist);
+        hy_query_free(q);
+
+        /* none of these relations are in the pool */
+        if (frozen_query_count(sack, HY_PKG_PROVIDES, HY_EQ, "no-such-provide") != 0 ||
+            frozen_query_count(sack, HY_PKG_REQUIRES, HY_EQ, "no-such-provide > 1") != 0 ||
+            frozen_query_count(sack, HY_PKG_PROVIDES, HY_GLOB, "no-such-*") != 0 ||
+            frozen_query_count(sack, HY_PKG_PROVIDES, HY_EQ, "fool < 1.9.7") != frozen_fool_count ||
+            frozen_query_count(sack, HY_PKG_PROVIDES, HY_GLOB, "fo?l < 1.9.7") != frozen_fool_count)
+            return GUINT_TO_POINTER(0);
+    }
+    return GUINT_TO_POINTER(total);
+}
+
+START_TEST(test_freeze)
+{
+    DnfSack *sack = test_globals.sack;
+    GThread *threads[4];
+
+    HyQuery q = frozen_query(sack);
+    DnfPackageSet *pset = hy_query_run_set(q);
+    guint expected = dnf_packageset_count(pset) * 100;
+    fail_unless(expected > 0);
+    dnf_packageset_free(pset);
+    hy_query_free(q);
+
+    Pool *pool = dnf_sack_get_pool(sack);
+    frozen_fool_count = frozen_query_count(sack, HY_PKG_PROVIDES, HY_EQ, "fool < 2.0");
+    fail_unless(frozen_fool_count > 0);
+    fail_if(pool_str2id(pool, "no-such-provide", 0));
+    fail_if(pool_str2id(pool, "1.9.7", 0));
+
+    fail_if(dnf_sack_is_frozen(sack));
+    dnf_sack_freeze(sack);
+    fail_unless(dnf_sack_is_frozen(sack));
+
+    for (guint i = 0; i < G_N_ELEMENTS(threads); ++i)
+        threads[i] = g_thread_new("frozen-query", frozen_query_thread, sack);
+    for (guint i = 0; i < G_N_ELEMENTS(threads); ++i)
+        ck_assert_uint_eq(GPOINTER_TO_UINT(g_thread_join(threads[i])), expected);
+    dnf_sack_check_frozen(sack);
+    fail_if(pool_str2id(pool, "no-such-provide", 0));
+    fail_if(pool_str2id(pool, "1.9.7", 0));
+}
+END_TEST
+
 Suite *
 sack_suite(void)
 {
@@ -276,6 +426,7 @@ sack_suite(void)
     tcase_add_test(tc, test_sack_create);
     tcase_add_test(tc, test_give_cache_fn);
     tcase_add_test(tc, test_list_arches);
+    tcase_add_test(tc, test_evr_split);
     tcase_add_test(tc, test_load_repo_err);
     tcase_add_test(tc, test_repo_written);
     tcase_add_test(tc, test_add_cmdline_package);
@@ -290,12 +441,14 @@ sack_suite(void)
     tcase_add_unchecked_fixture(tc, fixture_yum, teardown);
     tcase_add_test(tc, test_filelist);
     tcase_add_test(tc, test_filelist_from_cache);
+    tcase_add_test(tc, test_prime_fileprovides);
     tcase_add_test(tc, test_presto);
     tcase_add_test(tc, test_presto_from_cache);
     suite_add_tcase(s, tc);
 
     tc = tcase_create("SackKnows");
     tcase_add_unchecked_fixture(tc, fixture_all, teardown);
+    tcase_add_test(tc, test_freeze);
     suite_add_tcase(s, tc);
 
     return s;
@@ -31,6 +31,7 @@
 #include "libdnf/dnf-sack.h"
 #include "libdnf/hy-subject.h"
 #include "libdnf/hy-subject-private.hpp"
+#include "libdnf/hy-query.h"
 #include "fixtures.h"
 #include "testshared.h"
 #include "test_suites.h"
@@ -481,6 +482,40 @@ START_TEST(module_form_combined)
 }
 END_TEST
 
+START_TEST(best_solutions_batch)
+{
+    const char *subjects[] = {"penny-lib", "penny-lib-4-1.i686", "jay-5.0", "P-lib", "pen*",
+                              "fool-1-3.noarch", "/no/answers", "not-available"};
+    const int nsubjects = sizeof(subjects) / sizeof(subjects[0]);
+    DnfSack *sack = test_globals.sack;
+    HyNevra nevras[nsubjects];
+
+    GPtrArray *queries = hy_subject_get_best_solutions((HySubject *) subjects, nsubjects, sack,
+                                                       NULL, nevras, FALSE, TRUE, TRUE, TRUE);
+    fail_unless(queries->len == (guint) nsubjects);
+    for (int i = 0; i < nsubjects; ++i) {
+        HyNevra nevra{nullptr};
+        HyQuery expected = hy_subject_get_best_solution((HySubject) subjects[i], sack, NULL,
+                                                        &nevra, FALSE, TRUE, TRUE, TRUE);
+        auto query = static_cast<HyQuery>(g_ptr_array_index(queries, i));
+        hy_query_apply(expected);
+        hy_query_apply(query);
+        const Map *expected_map = hy_query_get_result(expected);
+        const Map *map = hy_query_get_result(query);
+        fail_unless(expected_map->size == map->size);
+        fail_if(memcmp(expected_map->map, map->map, map->size), subjects[i]);
+        if (nevra == nullptr)
+            fail_unless(nevras[i] == nullptr);
+        else
+            fail_unless(nevras[i] != nullptr && *nevra == *nevras[i]);
+        delete nevra;
+        delete nevras[i];
+        hy_query_free(expected);
+    }
+    g_ptr_array_unref(queries);
+}
+END_TEST
+
 Suite *
 subject_suite(void)
 {
@@ -514,6 +549,7 @@ subject_suite(void)
 
     tc = tcase_create("Full");
     tcase_add_unchecked_fixture(tc, fixture_all, teardown);
+    tcase_add_test(tc, best_solutions_batch);
     suite_add_tcase(s, tc);
 
     return s;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+
+#include "libdnf/dnf-transaction-private.hpp"
+#include "fixtures.h"
+#include "test_suites.h"
+
+static const gchar *sha256_empty =
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+
+START_TEST(test_pick_delta)
+{
+    const guint64 too_big[] = {800, 750};
+    const guint64 kernels[] = {700, 300, 500};
+    const guint64 unknown[] = {0, 600};
+
+    /* only deltas below 75% of the 1000 bytes package are worth it */
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, too_big, 2, 75), -1);
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, too_big, 2, 90), 1);
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, kernels, 3, 0), -1);
+
+    /* the smallest delta wins */
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, kernels, 3, 75), 1);
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, kernels, 1, 75), 0);
+
+    /* deltas without a size are skipped */
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, unknown, 2, 75), 1);
+    ck_assert_int_eq(dnf_transaction_pick_delta(1000, unknown, 0, 75), -1);
+}
+END_TEST
+
+START_TEST(test_apply_delta_missing)
+{
+    g_autofree gchar *delta_fn = g_build_filename(test_globals.tmpdir, "missing.drpm", NULL);
+    g_autofree gchar *rpm_fn = g_build_filename(test_globals.tmpdir, "missing.rpm", NULL);
+
+    /* a delta that failed to download leaves the package to the full download */
+    fail_unless(g_file_set_contents(rpm_fn, "cached", -1, NULL));
+    fail_if(dnf_transaction_apply_delta(G_CHECKSUM_SHA256, sha256_empty, "noarch",
+                                        delta_fn, rpm_fn));
+    fail_unless(g_file_test(rpm_fn, G_FILE_TEST_EXISTS));
+    g_unlink(rpm_fn);
+}
+END_TEST
+
+START_TEST(test_apply_delta_broken)
+{
+    g_autofree gchar *delta_fn = g_build_filename(test_globals.tmpdir, "broken.drpm", NULL);
+    g_autofree gchar *rpm_fn = g_build_filename(test_globals.tmpdir, "broken.rpm", NULL);
+
+    /* nothing of a failed rebuild is left for the full download to trip over */
+    fail_unless(g_file_set_contents(delta_fn, "not a delta rpm", -1, NULL));
+    fail_unless(g_file_set_contents(rpm_fn, "partial", -1, NULL));
+    fail_if(dnf_transaction_apply_delta(G_CHECKSUM_SHA256, sha256_empty, "noarch",
+                                        delta_fn, rpm_fn));
+    fail_if(g_file_test(delta_fn, G_FILE_TEST_EXISTS));
+    fail_if(g_file_test(rpm_fn, G_FILE_TEST_EXISTS));
+}
+END_TEST
+
+Suite *
+transaction_suite(void)
+{
+    Suite *s = suite_create("Transaction");
+    TCase *tc = tcase_create("Deltas");
+    tcase_add_test(tc, test_pick_delta);
+    tcase_add_test(tc, test_apply_delta_missing);
+    tcase_add_test(tc, test_apply_delta_broken);
+    suite_add_tcase(s, tc);
+    return s;
+}
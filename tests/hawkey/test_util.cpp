@@ -21,9 +21,15 @@
 #include <check.h>
 #include <stdio.h>
 
+#include <string>
+#include <vector>
+
+#include <solv/evr.h>
+#include <solv/pool.h>
 
 #include "libdnf/dnf-types.h"
 #include "libdnf/hy-util.h"
+#include "libdnf/utils/evrcmp.hpp"
 #include "test_suites.h"
 
 START_TEST(test_detect_arch)
@@ -85,6 +91,79 @@ START_TEST(test_split_nevra)
 }
 END_TEST
 
+static int
+sign(int value)
+{
+    return value > 0 ? 1 : value < 0 ? -1 : 0;
+}
+
+static std::vector<std::string>
+combine(const std::vector<std::string> & prefixes, const std::vector<std::string> & suffixes)
+{
+    std::vector<std::string> result;
+    for (auto & prefix : prefixes)
+        for (auto & suffix : suffixes)
+            result.push_back(prefix + suffix);
+    return result;
+}
+
+START_TEST(test_rpmvercmp)
+{
+    ck_assert_int_eq(libdnf::rpmvercmp("1.0", "1.0"), 0);
+    ck_assert_int_lt(libdnf::rpmvercmp("1.0", "1.0.1"), 0);
+    ck_assert_int_gt(libdnf::rpmvercmp("1.10", "1.9"), 0);
+    ck_assert_int_eq(libdnf::rpmvercmp("1.001", "1.1"), 0);
+    ck_assert_int_gt(libdnf::rpmvercmp("1.0", "1.a"), 0);
+    ck_assert_int_lt(libdnf::rpmvercmp("1.0~rc1", "1.0"), 0);
+    ck_assert_int_gt(libdnf::rpmvercmp("1.0^git1", "1.0"), 0);
+    ck_assert_int_lt(libdnf::rpmvercmp("1.0^git1", "1.0.1"), 0);
+    ck_assert_int_gt(libdnf::rpmvercmp("18446744073709551617", "18446744073709551616"), 0);
+
+    ck_assert_int_eq(libdnf::evrcmp("0:1.0-1", "1.0-1"), 0);
+    ck_assert_int_gt(libdnf::evrcmp("1:0.1-1", "2.0-1"), 0);
+    ck_assert_int_lt(libdnf::evrcmp("1.0", "1.0-1"), 0);
+    ck_assert_int_lt(libdnf::evrcmp(-1, "1.0", "1", 0, "1.0", "2"), 0);
+}
+END_TEST
+
+START_TEST(test_rpmvercmp_conformance)
+{
+    // every combination of up to three segments and separators, compared
+    // pairwise against libsolv; '^' is left out as older libsolv ignores it
+    std::vector<std::string> tokens = {"", "0", "1", "01", "10", "a", "b", "ab", "~", ".", "_"};
+    auto versions = combine(combine(tokens, tokens), tokens);
+    Pool *pool = pool_create();
+    for (auto & first : versions)
+        for (auto & second : versions) {
+            int expected = sign(pool_evrcmp_str(pool, first.c_str(), second.c_str(),
+                                                EVRCMP_COMPARE));
+            int result = sign(libdnf::rpmvercmp(first, second));
+            fail_unless(result == expected, "rpmvercmp(\"%s\", \"%s\") = %d, libsolv says %d",
+                        first.c_str(), second.c_str(), result, expected);
+        }
+    pool_free(pool);
+}
+END_TEST
+
+START_TEST(test_evrcmp_conformance)
+{
+    std::vector<std::string> epochs = {"", "0:", "00:", "1:", "2:", "10:"};
+    std::vector<std::string> versions = {"", "0", "1", "1.0", "1.a", "1~rc", "1a"};
+    std::vector<std::string> releases = {"", "-", "-1", "-1.fc28", "-1~b", "-2-3"};
+    auto evrs = combine(combine(epochs, versions), releases);
+    Pool *pool = pool_create();
+    for (auto & first : evrs)
+        for (auto & second : evrs) {
+            int expected = sign(pool_evrcmp_str(pool, first.c_str(), second.c_str(),
+                                                EVRCMP_COMPARE));
+            int result = sign(libdnf::evrcmp(first.c_str(), second.c_str()));
+            fail_unless(result == expected, "evrcmp(\"%s\", \"%s\") = %d, libsolv says %d",
+                        first.c_str(), second.c_str(), result, expected);
+        }
+    pool_free(pool);
+}
+END_TEST
+
 Suite *
 util_suite(void)
 {
@@ -92,6 +171,9 @@ util_suite(void)
     TCase *tc = tcase_create("Main");
     tcase_add_test(tc, test_detect_arch);
     tcase_add_test(tc, test_split_nevra);
+    tcase_add_test(tc, test_rpmvercmp);
+    tcase_add_test(tc, test_rpmvercmp_conformance);
+    tcase_add_test(tc, test_evrcmp_conformance);
     suite_add_tcase(s, tc);
 
     return s;
@@ -22,8 +22,10 @@
 
 #include <glib-object.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <glib/gstdio.h>
+#include <utime.h>
 #include "libdnf/libdnf.h"
 
 /**
@@ -674,6 +676,146 @@ dnf_state_speed_func(void)
     g_assert(state == NULL);
 }
 
+static void
+dnf_state_progress_rate_func(void)
+{
+    DnfState *state;
+    DnfState *child;
+    guint i;
+
+    _updates = 0;
+    _last_percent = 0;
+
+    state = dnf_state_new();
+    g_object_add_weak_pointer(G_OBJECT(state),(gpointer *) &state);
+    dnf_state_set_progress_rate(state, 1);
+    g_signal_connect(state, "percentage-changed", G_CALLBACK(dnf_state_test_percentage_changed_cb), NULL);
+    dnf_state_set_number_steps(state, 2);
+
+    /* a burst of child updates is coalesced into one signal */
+    child = dnf_state_get_child(state);
+    dnf_state_set_number_steps(child, 1);
+    for (i = 1; i < 100; i++)
+        dnf_state_set_percentage(child, i);
+    g_assert_cmpint(_updates, ==, 1);
+    g_assert_cmpint(dnf_state_get_percentage(state), ==, 49);
+
+    /* finishing a step flushes the pending value */
+    g_assert(dnf_state_done(child, NULL));
+    g_assert_cmpint(_updates, ==, 2);
+    g_assert_cmpint(_last_percent, ==, 50);
+
+    /* completion is always reported */
+    g_assert(dnf_state_done(state, NULL));
+    g_assert_cmpint(_updates, ==, 3);
+    g_assert_cmpint(_last_percent, ==, 100);
+
+    g_object_unref(state);
+    g_assert(state == NULL);
+}
+
+static void
+dnf_state_trace_func(void)
+{
+    DnfState *state;
+    DnfState *child;
+    gchar *trace;
+
+    state = dnf_state_new();
+    g_object_add_weak_pointer(G_OBJECT(state),(gpointer *) &state);
+
+    /* nothing recorded */
+    g_assert(dnf_state_get_trace(state, DNF_STATE_TRACE_FORMAT_CHROME) == NULL);
+
+    dnf_state_set_enable_trace(state, TRUE);
+    dnf_state_set_number_steps(state, 2);
+    child = dnf_state_get_child(state);
+    dnf_state_set_number_steps(child, 1);
+    dnf_state_action_start(child, DNF_STATE_ACTION_LOADING_CACHE, "fedora");
+    dnf_state_action_stop(child);
+    g_assert(dnf_state_done(child, NULL));
+    g_assert(dnf_state_done(state, NULL));
+    g_assert(dnf_state_done(state, NULL));
+
+    /* each state, step and action is a complete event */
+    trace = dnf_state_get_trace(state, DNF_STATE_TRACE_FORMAT_CHROME);
+    g_assert(g_str_has_prefix(trace, "{"));
+    g_assert(strstr(trace, "\"traceEvents\"") != NULL);
+    g_assert(strstr(trace, "\"ph\":\"X\"") != NULL);
+    g_assert(strstr(trace, "loading-cache fedora") != NULL);
+    g_free(trace);
+
+    /* summary lists every span name once */
+    trace = dnf_state_get_trace(state, DNF_STATE_TRACE_FORMAT_SUMMARY);
+    g_assert(strstr(trace, "wall ms") != NULL);
+    g_assert(strstr(trace, "step 2/2") != NULL);
+    g_assert(strstr(trace, "loading-cache fedora") != NULL);
+    g_free(trace);
+
+    g_object_unref(state);
+    g_assert(state == NULL);
+}
+
+static void
+dnf_state_trace_bounded_func(void)
+{
+    DnfState *state;
+    gchar *trace;
+    guint i;
+
+    state = dnf_state_new();
+    dnf_state_set_enable_trace(state, TRUE);
+    dnf_state_set_number_steps(state, 1);
+
+    /* only the most recent spans are kept */
+    for (i = 0; i < 70000; i++) {
+        dnf_state_action_start(state, DNF_STATE_ACTION_LOADING_CACHE, "fedora");
+        dnf_state_action_stop(state);
+    }
+    trace = dnf_state_get_trace(state, DNF_STATE_TRACE_FORMAT_SUMMARY);
+    g_assert(strstr(trace, " 65536  loading-cache fedora") != NULL);
+    g_assert(strstr(trace, "step 1/1") == NULL);
+    g_free(trace);
+
+    g_assert(dnf_state_done(state, NULL));
+    g_object_unref(state);
+}
+
+static void
+dnf_state_progress_rate_release_func(void)
+{
+    DnfState *state;
+    DnfState *child;
+    DnfState *grandchild;
+
+    state = dnf_state_new();
+    g_object_add_weak_pointer(G_OBJECT(state),(gpointer *) &state);
+    dnf_state_set_progress_rate(state, 1);
+    dnf_state_set_number_steps(state, 2);
+
+    /* keep the child and its own child alive after the parent resets */
+    child = g_object_ref(dnf_state_get_child(state));
+    dnf_state_set_number_steps(child, 2);
+    grandchild = g_object_ref(dnf_state_get_child(child));
+    dnf_state_set_number_steps(grandchild, 1);
+    dnf_state_reset(state);
+
+    /* a released child no longer moves the parent */
+    dnf_state_set_percentage(grandchild, 50);
+    g_assert_cmpint(dnf_state_get_percentage(child), ==, 25);
+    dnf_state_set_speed(child, 1000);
+    g_assert_cmpint(dnf_state_get_percentage(state), ==, 0);
+    g_assert_cmpint(dnf_state_get_speed(state), ==, 0);
+
+    /* and may outlive it */
+    g_object_unref(state);
+    g_assert(state == NULL);
+    dnf_state_set_percentage(grandchild, 100);
+    g_assert_cmpint(dnf_state_get_percentage(child), ==, 50);
+    g_object_unref(grandchild);
+    g_object_unref(child);
+}
+
 static void
 dnf_state_finished_func(void)
 {
@@ -799,6 +941,7 @@ dnf_repo_loader_func(void)
     g_autoptr(DnfContext) ctx = NULL;
     g_autoptr(DnfRepoLoader) repo_loader = NULL;
     guint metadata_expire;
+    GKeyFile *keyfile;
 
     /* set up local context */
     ctx = dnf_context_new();
@@ -854,6 +997,42 @@ dnf_repo_loader_func(void)
     g_assert_no_error(error);
     g_assert(ret);
 
+    /* changed keyfile data is parsed again when it is next applied */
+    ret = dnf_repo_set_data(repo, "metadata_expire", "1h", &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    ret = dnf_repo_setup(repo, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    g_assert_cmpuint(dnf_repo_get_metadata_expire(repo), ==, 60 * 60);
+
+    /* an exclude list is dropped again when the key goes away */
+    ret = dnf_repo_set_data(repo, "exclude", "foo bar", &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    ret = dnf_repo_setup(repo, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    g_assert(dnf_repo_get_exclude_packages(repo) != NULL);
+    g_assert_cmpstr(dnf_repo_get_exclude_packages(repo)[0], ==, "foo");
+    keyfile = g_key_file_new();
+    ret = g_key_file_load_from_data(keyfile,
+                                    "[local]\n"
+                                    "name=Local\n"
+                                    "baseurl=file:///tmp/repo\n"
+                                    "enabled=1\n"
+                                    "gpgcheck=0\n"
+                                    "metadata_expire=1h\n",
+                                    -1, G_KEY_FILE_NONE, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    dnf_repo_set_keyfile(repo, keyfile);
+    g_key_file_unref(keyfile);
+    ret = dnf_repo_setup(repo, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    g_assert(dnf_repo_get_exclude_packages(repo) == NULL);
+
     /* try to check local repo that will not exist */
     dnf_state_reset(state);
     ret = dnf_repo_check(repo, 1, state, &error);
@@ -862,6 +1041,341 @@ dnf_repo_loader_func(void)
     g_clear_error(&error);
 }
 
+static void
+dnf_repo_loader_snapshot_func(void)
+{
+    GError *error = NULL;
+    DnfRepo *repo;
+    GPtrArray *repos;
+    gboolean ret;
+    guint n_repos;
+    g_autofree gchar *repos_dir = NULL;
+    g_autofree gchar *cache_dir = NULL;
+    g_autofree gchar *cache_fn = NULL;
+    g_autoptr(DnfContext) ctx = NULL;
+    g_autoptr(DnfRepoLoader) repo_loader = NULL;
+
+    /* set up local context with a private cache */
+    ctx = dnf_context_new();
+    repos_dir = dnf_test_get_filename("yum.repos.d");
+    cache_dir = g_dir_make_tmp("libdnf-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    dnf_context_set_repo_dir(ctx, repos_dir);
+    dnf_context_set_solv_dir(ctx, "/tmp");
+    dnf_context_set_cache_dir(ctx, cache_dir);
+    ret = dnf_context_setup(ctx, NULL, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+
+    /* the first load writes the snapshot */
+    repo_loader = dnf_repo_loader_new(ctx);
+    repos = dnf_repo_loader_get_repos(repo_loader, &error);
+    g_assert_no_error(error);
+    g_assert(repos != NULL);
+    n_repos = repos->len;
+    g_ptr_array_unref(repos);
+    cache_fn = g_build_filename(cache_dir, "repos.d.cache", NULL);
+    g_assert(g_file_test(cache_fn, G_FILE_TEST_IS_REGULAR));
+    g_clear_object(&repo_loader);
+
+    /* the second one gets the same repos from it */
+    repo_loader = dnf_repo_loader_new(ctx);
+    repos = dnf_repo_loader_get_repos(repo_loader, &error);
+    g_assert_no_error(error);
+    g_assert(repos != NULL);
+    g_assert_cmpint(repos->len, ==, n_repos);
+    g_ptr_array_unref(repos);
+    repo = dnf_repo_loader_get_repo_by_id(repo_loader, "bumblebee", &error);
+    g_assert_no_error(error);
+    g_assert(repo != NULL);
+    g_assert(dnf_repo_get_gpgcheck(repo));
+    g_assert(!dnf_repo_get_gpgcheck_md(repo));
+
+    ret = dnf_remove_recursive(cache_dir, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+}
+
+static DnfRepo *
+dnf_repo_loader_snapshot_load(DnfContext *ctx, const gchar *id, guint n_repos)
+{
+    GError *error = NULL;
+    GPtrArray *repos;
+    DnfRepo *repo;
+    g_autoptr(DnfRepoLoader) repo_loader = NULL;
+
+    repo_loader = dnf_repo_loader_new(ctx);
+    repos = dnf_repo_loader_get_repos(repo_loader, &error);
+    g_assert_no_error(error);
+    g_assert(repos != NULL);
+    g_assert_cmpint(repos->len, ==, n_repos);
+    g_ptr_array_unref(repos);
+    repo = dnf_repo_loader_get_repo_by_id(repo_loader, id, &error);
+    g_assert_no_error(error);
+    g_assert(repo != NULL);
+    return g_object_ref(repo);
+}
+
+static void
+dnf_repo_loader_snapshot_changed_func(void)
+{
+    GError *error = NULL;
+    FILE *fp;
+    gboolean ret;
+    struct utimbuf times;
+    g_autofree gchar *repos_dir = NULL;
+    g_autofree gchar *cache_dir = NULL;
+    g_autofree gchar *first_fn = NULL;
+    g_autofree gchar *second_fn = NULL;
+    g_autoptr(DnfContext) ctx = NULL;
+    g_autoptr(DnfRepo) repo = NULL;
+
+    repos_dir = g_dir_make_tmp("libdnf-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    cache_dir = g_dir_make_tmp("libdnf-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    first_fn = g_build_filename(repos_dir, "first.repo", NULL);
+    ret = g_file_set_contents(first_fn,
+                              "[first]\nname=First\nbaseurl=file:///tmp\ngpgcheck=0\n",
+                              -1, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+
+    ctx = dnf_context_new();
+    dnf_context_set_repo_dir(ctx, repos_dir);
+    dnf_context_set_solv_dir(ctx, "/tmp");
+    dnf_context_set_cache_dir(ctx, cache_dir);
+    ret = dnf_context_setup(ctx, NULL, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+
+    repo = dnf_repo_loader_snapshot_load(ctx, "first", 1);
+    g_assert(!dnf_repo_get_gpgcheck(repo));
+    g_clear_object(&repo);
+
+    /* an edit in place keeps the size and the inode, only the mtime tells;
+     * set it explicitly, two writes may share a coarse timestamp */
+    fp = fopen(first_fn, "r+");
+    g_assert(fp != NULL);
+    g_assert_cmpint(fseek(fp, -2, SEEK_END), ==, 0);
+    g_assert_cmpint(fputc('1', fp), ==, '1');
+    g_assert_cmpint(fclose(fp), ==, 0);
+    times.actime = times.modtime = 1000000000;
+    g_assert_cmpint(g_utime(first_fn, &times), ==, 0);
+    repo = dnf_repo_loader_snapshot_load(ctx, "first", 1);
+    g_assert(dnf_repo_get_gpgcheck(repo));
+    g_clear_object(&repo);
+
+    /* a new file changes the directory */
+    second_fn = g_build_filename(repos_dir, "second.repo", NULL);
+    ret = g_file_set_contents(second_fn,
+                              "[second]\nname=Second\nbaseurl=file:///tmp\n",
+                              -1, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    times.actime = times.modtime = 1000000001;
+    g_assert_cmpint(g_utime(repos_dir, &times), ==, 0);
+    repo = dnf_repo_loader_snapshot_load(ctx, "second", 2);
+    g_clear_object(&repo);
+
+    ret = dnf_remove_recursive(cache_dir, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    ret = dnf_remove_recursive(repos_dir, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+}
+
+static void
+dnf_sack_server_request_func(void)
+{
+    GPtrArray *nevras;
+    g_autoptr(GError) error = NULL;
+    const gchar *ping[] = { "ping", NULL };
+    const gchar *bad[] = { "subject", "bash\tzsh", NULL };
+
+    /* fields must not contain the separators */
+    nevras = dnf_sack_server_request("/tmp/libdnf-test-no-such.sock", bad, &error);
+    g_assert_error(error, DNF_ERROR, DNF_ERROR_BAD_QUERY);
+    g_assert(nevras == NULL);
+    g_clear_error(&error);
+
+    /* nobody is listening */
+    nevras = dnf_sack_server_request("/tmp/libdnf-test-no-such.sock", ping, &error);
+    g_assert(error != NULL);
+    g_assert(nevras == NULL);
+}
+
+typedef struct {
+    const gchar         *socket_path;
+    const gchar * const *request;
+    GPtrArray           *nevras;
+    GError              *error;
+    gint                 done;
+} DnfSackServerTestRequest;
+
+static gpointer
+dnf_sack_server_test_request_thread(gpointer user_data)
+{
+    DnfSackServerTestRequest *req = (DnfSackServerTestRequest *) user_data;
+    req->nevras = dnf_sack_server_request(req->socket_path, req->request, &req->error);
+    g_atomic_int_set(&req->done, TRUE);
+    g_main_context_wakeup(NULL);
+    return NULL;
+}
+
+/* the server accepts connections in the main context, so the client runs in a thread */
+static GPtrArray *
+dnf_sack_server_test_request(const gchar *socket_path,
+                             const gchar * const *request,
+                             GError **error)
+{
+    DnfSackServerTestRequest req = { socket_path, request, NULL, NULL, FALSE };
+    GThread *thread;
+
+    thread = g_thread_new("sack-server-test", dnf_sack_server_test_request_thread, &req);
+    while (!g_atomic_int_get(&req.done))
+        g_main_context_iteration(NULL, TRUE);
+    g_thread_join(thread);
+    if (req.error != NULL)
+        g_propagate_error(error, req.error);
+    return req.nevras;
+}
+
+static void
+dnf_sack_server_listen_func(void)
+{
+    gboolean ret;
+    GPtrArray *nevras;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(DnfContext) ctx = NULL;
+    g_autoptr(DnfSackServer) server = NULL;
+    g_autoptr(DnfSackServer) other = NULL;
+    GStatBuf st;
+    g_autofree gchar *tmp_dir = NULL;
+    g_autofree gchar *repos_dir = NULL;
+    g_autofree gchar *repo_fn = NULL;
+    g_autofree gchar *repo_data = NULL;
+    g_autofree gchar *repo_url = NULL;
+    g_autofree gchar *rpmdb_dir = NULL;
+    g_autofree gchar *rpmdb_fn = NULL;
+    g_autofree gchar *socket_path = NULL;
+    g_autofree gchar *key = g_strdup_printf("%i", HY_PKG_NAME);
+    g_autofree gchar *cmp = g_strdup_printf("%i", HY_EQ);
+    g_autofree gchar *too_long = g_strnfill(5000, 'x');
+    const gchar *ping[] = { "ping", NULL };
+    const gchar *query[] = { "query", key, cmp, "tour", NULL };
+    const gchar *subject[] = { "subject", "tour", NULL };
+    const gchar *bad_key[] = { "query", "name", cmp, "tour", NULL };
+    const gchar *bad_cmp[] = { "query", key, "1x", "tour", NULL };
+    const gchar *long_request[] = { "subject", too_long, NULL };
+
+    /* the local test repo and an empty install root */
+    tmp_dir = g_dir_make_tmp("libdnf-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    repos_dir = g_build_filename(tmp_dir, "yum.repos.d", NULL);
+    g_assert_cmpint(g_mkdir(repos_dir, 0755), ==, 0);
+    repo_url = dnf_test_get_filename("hawkey/yum");
+    repo_data = g_strdup_printf("[server]\nbaseurl=file://%s/\ngpgcheck=0\n", repo_url);
+    repo_fn = g_build_filename(repos_dir, "server.repo", NULL);
+    ret = g_file_set_contents(repo_fn, repo_data, -1, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+
+    ctx = dnf_context_new();
+    dnf_context_set_install_root(ctx, tmp_dir);
+    dnf_context_set_release_ver(ctx, "26");
+    dnf_context_set_repo_dir(ctx, repos_dir);
+    dnf_context_set_cache_dir(ctx, tmp_dir);
+    dnf_context_set_solv_dir(ctx, tmp_dir);
+    dnf_context_set_lock_dir(ctx, tmp_dir);
+    ret = dnf_context_setup(ctx, NULL, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+
+    /* the sack is loaded before the socket appears */
+    server = dnf_sack_server_new(ctx);
+    socket_path = g_build_filename(tmp_dir, "sack.sock", NULL);
+    ret = dnf_sack_server_listen(server, socket_path, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    g_assert_cmpint(dnf_sack_server_get_generation(server), ==, 1);
+    g_assert_cmpint(g_stat(socket_path, &st), ==, 0);
+    g_assert_cmpint(st.st_mode & 0777, ==, 0666);
+
+    /* a live server keeps its socket */
+    other = dnf_sack_server_new(ctx);
+    ret = dnf_sack_server_listen(other, socket_path, &error);
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE);
+    g_assert(!ret);
+    g_clear_error(&error);
+
+    nevras = dnf_sack_server_test_request(socket_path, ping, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(nevras->len, ==, 0);
+    g_ptr_array_unref(nevras);
+
+    nevras = dnf_sack_server_test_request(socket_path, query, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(nevras->len, ==, 1);
+    g_assert_cmpstr(g_ptr_array_index(nevras, 0), ==, "tour-4-6.noarch");
+    g_ptr_array_unref(nevras);
+
+    nevras = dnf_sack_server_test_request(socket_path, subject, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(nevras->len, ==, 1);
+    g_assert_cmpstr(g_ptr_array_index(nevras, 0), ==, "tour-4-6.noarch");
+    g_ptr_array_unref(nevras);
+    g_assert_cmpint(dnf_sack_server_get_generation(server), ==, 1);
+
+    /* key and comparison have to be numbers */
+    nevras = dnf_sack_server_test_request(socket_path, bad_key, &error);
+    g_assert_error(error, DNF_ERROR, DNF_ERROR_FAILED);
+    g_assert(nevras == NULL);
+    g_clear_error(&error);
+    nevras = dnf_sack_server_test_request(socket_path, bad_cmp, &error);
+    g_assert_error(error, DNF_ERROR, DNF_ERROR_FAILED);
+    g_assert(nevras == NULL);
+    g_clear_error(&error);
+
+    /* requests are bounded */
+    nevras = dnf_sack_server_test_request(socket_path, long_request, &error);
+    g_assert_error(error, DNF_ERROR, DNF_ERROR_FAILED);
+    g_assert(nevras == NULL);
+    g_clear_error(&error);
+
+    /* the sack is reloaded after an invalidate */
+    dnf_context_invalidate(ctx, "test");
+    nevras = dnf_sack_server_test_request(socket_path, subject, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(nevras->len, ==, 1);
+    g_ptr_array_unref(nevras);
+    g_assert_cmpint(dnf_sack_server_get_generation(server), ==, 2);
+
+    /* and after the rpmdb changed */
+    rpmdb_dir = g_build_filename(tmp_dir, "var", "lib", "rpm", NULL);
+    g_assert_cmpint(g_mkdir_with_parents(rpmdb_dir, 0755), ==, 0);
+    rpmdb_fn = g_build_filename(rpmdb_dir, "Packages", NULL);
+    ret = g_file_set_contents(rpmdb_fn, "", -1, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    nevras = dnf_sack_server_test_request(socket_path, ping, &error);
+    g_assert_no_error(error);
+    g_ptr_array_unref(nevras);
+    g_assert_cmpint(dnf_sack_server_get_generation(server), ==, 2);
+    nevras = dnf_sack_server_test_request(socket_path, query, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(nevras->len, ==, 1);
+    g_ptr_array_unref(nevras);
+    g_assert_cmpint(dnf_sack_server_get_generation(server), ==, 3);
+
+    dnf_sack_server_stop(server);
+    g_assert(!g_file_test(socket_path, G_FILE_TEST_EXISTS));
+    ret = dnf_remove_recursive(tmp_dir, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+}
+
 static void
 dnf_context_func(void)
 {
@@ -886,11 +1400,17 @@ dnf_context_func(void)
     g_assert(dnf_context_get_check_disk_space(ctx));
     g_assert(dnf_context_get_check_transaction(ctx));
     g_assert(!dnf_context_get_keep_cache(ctx));
+    g_assert(!dnf_context_get_deltarpm(ctx));
+    g_assert_cmpint(dnf_context_get_deltarpm_percentage(ctx), ==, 75);
 
     dnf_context_set_cache_dir(ctx, "/var");
     dnf_context_set_repo_dir(ctx, "/etc");
+    dnf_context_set_deltarpm(ctx, TRUE);
+    dnf_context_set_deltarpm_percentage(ctx, 50);
     g_assert_cmpstr(dnf_context_get_cache_dir(ctx), ==, "/var");
     g_assert_cmpstr(dnf_context_get_repo_dir(ctx), ==, "/etc");
+    g_assert(dnf_context_get_deltarpm(ctx));
+    g_assert_cmpint(dnf_context_get_deltarpm_percentage(ctx), ==, 50);
 
     g_object_unref(ctx);
 }
@@ -1106,6 +1626,99 @@ dnf_repo_loader_cache_dir_check_func(void)
 }
 
 
+static void
+dnf_context_refresh_invalidate_cb(DnfContext *context, const gchar *message, guint *invalidated)
+{
+    (*invalidated)++;
+}
+
+static void
+dnf_context_refresh_done_cb(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    GMainLoop *loop = user_data;
+    g_autoptr(GError) error = NULL;
+
+    g_assert(dnf_context_refresh_metadata_finish(DNF_CONTEXT(source), result, &error));
+    g_assert_no_error(error);
+    g_main_loop_quit(loop);
+}
+
+static void
+dnf_context_refresh_func(void)
+{
+    gboolean ret;
+    guint invalidated = 0;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(DnfContext) ctx = NULL;
+    g_autoptr(GMainLoop) loop = NULL;
+    g_autofree gchar *tmp_dir = NULL;
+    g_autofree gchar *repos_dir = NULL;
+    g_autofree gchar *repo_fn = NULL;
+    g_autofree gchar *repo_data = NULL;
+    g_autofree gchar *repo_url = NULL;
+    g_autofree gchar *cache_dir = NULL;
+    g_autofree gchar *solv_dir = NULL;
+    g_autofree gchar *solv_fn = NULL;
+    g_autofree gchar *local_solv_fn = NULL;
+    GPtrArray *repos;
+
+    /* the test repo twice, $testdatadir keeps a file:// baseurl remote, so
+     * only the first one has metadata to refresh */
+    tmp_dir = g_dir_make_tmp("libdnf-test-XXXXXX", &error);
+    g_assert_no_error(error);
+    repos_dir = g_build_filename(tmp_dir, "yum.repos.d", NULL);
+    cache_dir = g_build_filename(tmp_dir, "cache", NULL);
+    solv_dir = g_build_filename(tmp_dir, "solv", NULL);
+    g_assert_cmpint(g_mkdir(repos_dir, 0755), ==, 0);
+    repo_url = dnf_test_get_filename("hawkey/yum");
+    repo_data = g_strdup_printf("[refresh]\nbaseurl=file://$testdatadir/hawkey/yum/\ngpgcheck=0\n"
+                                "[local]\nbaseurl=file://%s/\ngpgcheck=0\n", repo_url);
+    repo_fn = g_build_filename(repos_dir, "refresh.repo", NULL);
+    ret = g_file_set_contents(repo_fn, repo_data, -1, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+
+    ctx = dnf_context_new();
+    dnf_context_set_repo_dir(ctx, repos_dir);
+    dnf_context_set_cache_dir(ctx, cache_dir);
+    dnf_context_set_solv_dir(ctx, solv_dir);
+    dnf_context_set_lock_dir(ctx, tmp_dir);
+    dnf_context_set_release_ver(ctx, "26");
+    ret = dnf_context_setup(ctx, NULL, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+    g_signal_connect(ctx, "invalidate",
+                     G_CALLBACK(dnf_context_refresh_invalidate_cb), &invalidated);
+    repos = dnf_context_get_repos(ctx);
+    g_assert_cmpint(repos->len, ==, 2);
+    for (guint i = 0; i < repos->len; i++) {
+        DnfRepo *repo = g_ptr_array_index(repos, i);
+        if (g_strcmp0(dnf_repo_get_id(repo), "refresh") == 0)
+            g_assert_cmpint(dnf_repo_get_kind(repo), ==, DNF_REPO_KIND_REMOTE);
+        else
+            g_assert_cmpint(dnf_repo_get_kind(repo), ==, DNF_REPO_KIND_LOCAL);
+    }
+
+    /* the metadata is downloaded and the .solv built in a worker thread */
+    loop = g_main_loop_new(NULL, FALSE);
+    dnf_context_refresh_metadata_async(ctx, NULL, dnf_context_refresh_done_cb, loop);
+    g_main_loop_run(loop);
+    g_assert_cmpint(invalidated, ==, 1);
+    solv_fn = g_build_filename(solv_dir, "refresh.solv", NULL);
+    g_assert(g_file_test(solv_fn, G_FILE_TEST_IS_REGULAR));
+    local_solv_fn = g_build_filename(solv_dir, "local.solv", NULL);
+    g_assert(!g_file_test(local_solv_fn, G_FILE_TEST_EXISTS));
+
+    /* nothing expired the second time */
+    dnf_context_refresh_metadata_async(ctx, NULL, dnf_context_refresh_done_cb, loop);
+    g_main_loop_run(loop);
+    g_assert_cmpint(invalidated, ==, 1);
+
+    ret = dnf_remove_recursive(tmp_dir, &error);
+    g_assert_no_error(error);
+    g_assert(ret);
+}
+
 static void
 touch_file(const char *filename)
 {
@@ -1208,10 +1821,15 @@ main(int argc, char **argv)
     g_test_add_func("/libdnf/repo_loader{gpg-wrong-asc}", dnf_repo_loader_gpg_wrong_asc_func);
     g_test_add_func("/libdnf/repo_loader{gpg-no-asc}", dnf_repo_loader_gpg_no_asc_func);
     g_test_add_func("/libdnf/repo_loader", dnf_repo_loader_func);
+    g_test_add_func("/libdnf/repo_loader{snapshot}", dnf_repo_loader_snapshot_func);
+    g_test_add_func("/libdnf/repo_loader{snapshot-changed}", dnf_repo_loader_snapshot_changed_func);
     g_test_add_func("/libdnf/repo_loader{gpg-no-pubkey}", dnf_repo_loader_gpg_no_pubkey_func);
     g_test_add_func("/libdnf/repo_loader{cache-dir-check}", dnf_repo_loader_cache_dir_check_func);
     g_test_add_func("/libdnf/context", dnf_context_func);
+    g_test_add_func("/libdnf/sack-server{request}", dnf_sack_server_request_func);
+    g_test_add_func("/libdnf/sack-server{listen}", dnf_sack_server_listen_func);
     g_test_add_func("/libdnf/context{cache-clean-check}", dnf_context_cache_clean_check_func);
+    g_test_add_func("/libdnf/context{refresh}", dnf_context_refresh_func);
     g_test_add_func("/libdnf/lock", dnf_lock_func);
     g_test_add_func("/libdnf/lock[threads]", dnf_lock_threads_func);
     g_test_add_func("/libdnf/repo", ch_test_repo_func);
@@ -1222,6 +1840,10 @@ main(int argc, char **argv)
     g_test_add_func("/libdnf/state[no-progress]", dnf_state_no_progress_func);
     g_test_add_func("/libdnf/state[finish]", dnf_state_finish_func);
     g_test_add_func("/libdnf/state[speed]", dnf_state_speed_func);
+    g_test_add_func("/libdnf/state[progress-rate]", dnf_state_progress_rate_func);
+    g_test_add_func("/libdnf/state[progress-rate-release]", dnf_state_progress_rate_release_func);
+    g_test_add_func("/libdnf/state[trace]", dnf_state_trace_func);
+    g_test_add_func("/libdnf/state[trace-bounded]", dnf_state_trace_bounded_func);
     g_test_add_func("/libdnf/state[locking]", dnf_state_locking_func);
     g_test_add_func("/libdnf/state[finished]", dnf_state_finished_func);
     g_test_add_func("/libdnf/state[small-step]", dnf_state_small_step_func);
@@ -323,6 +323,22 @@ MergedTransactionTest::testMergeAlterAlter()
     CPPUNIT_ASSERT_EQUAL(TransactionItemAction::REINSTALL, item->getAction());
 }
 
+/// Erase -> Install = Upgrade, version segments compare numerically
+void
+MergedTransactionTest::testMergeEraseInstallNumericUpgrade()
+{
+    auto merged = prepareMergedTransaction(
+        conn, TransactionItemAction::REMOVE, TransactionItemAction::INSTALL, "0.9.0", "0.10.0");
+
+    auto items = merged->getItems();
+    CPPUNIT_ASSERT_EQUAL(1, (int)items.size());
+    CPPUNIT_ASSERT_EQUAL(TransactionItemAction::UPGRADE, items.at(0)->getAction());
+
+    // items are loaded again, the result doesn't depend on a previous merge
+    items = merged->getItems();
+    CPPUNIT_ASSERT_EQUAL(1, (int)items.size());
+    CPPUNIT_ASSERT_EQUAL(TransactionItemAction::UPGRADE, items.at(0)->getAction());
+}
 
 static RPMItemPtr
 nevraToRPMItem(SQLite3Ptr conn, std::string nevra)
@@ -18,6 +18,7 @@ class MergedTransactionTest : public CppUnit::TestCase {
 //     CPPUNIT_TEST(testMergeAlterReinstall);
 //     CPPUNIT_TEST(testMergeAlterErase);
 //     CPPUNIT_TEST(testMergeAlterAlter);
+    CPPUNIT_TEST(testMergeEraseInstallNumericUpgrade);
     CPPUNIT_TEST(test_add_remove_installed);
     CPPUNIT_TEST(test_add_remove_removed);
     CPPUNIT_TEST(test_add_install_installed);
@@ -40,6 +41,7 @@ public:
     void testMergeAlterReinstall();
     void testMergeAlterErase();
     void testMergeAlterAlter();
+    void testMergeEraseInstallNumericUpgrade();
     // BEGIN: tests ported from DNF unit tests
     void test_add_remove_installed();
     void test_add_remove_removed();
@@ -1,7 +1,9 @@
 #include <chrono>
 #include <cstdio>
 #include <iostream>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "RpmItemTest.hpp"
 #include "libdnf/swdb/item_rpm.hpp"
@@ -80,3 +82,157 @@ RpmItemTest::testGetTransactionItems()
     //CPPUNIT_ASSERT(createMs.count() == 0);
     //CPPUNIT_ASSERT(readMs.count() == 0);
 }
+
+static std::shared_ptr< RPMItem >
+createRPMItem(std::shared_ptr< SQLite3 > conn, const std::string &name, const std::string &version)
+{
+    auto rpm = std::make_shared< RPMItem >(conn);
+    rpm->setName(name);
+    rpm->setEpoch(0);
+    rpm->setVersion(version);
+    rpm->setRelease("1.fc26");
+    rpm->setArch("x86_64");
+    return rpm;
+}
+
+void
+RpmItemTest::testForEachLatestReason()
+{
+    SwdbPrivate::Transaction trans1(conn);
+    trans1.addItem(createRPMItem(conn, "bash", "4.4.12"),
+                   "base",
+                   TransactionItemAction::INSTALL,
+                   TransactionItemReason::USER);
+    trans1.addItem(createRPMItem(conn, "sed", "4.4"),
+                   "base",
+                   TransactionItemAction::INSTALL,
+                   TransactionItemReason::DEPENDENCY);
+    trans1.begin();
+    trans1.finish(true);
+
+    // the latest item of a name.arch wins
+    SwdbPrivate::Transaction trans2(conn);
+    trans2.addItem(createRPMItem(conn, "bash", "4.4.19"),
+                   "base",
+                   TransactionItemAction::UPGRADE,
+                   TransactionItemReason::DEPENDENCY);
+    trans2.begin();
+    trans2.finish(true);
+
+    std::map< std::string, TransactionItemReason > reasons;
+    RPMItem::forEachLatestReason(
+        conn, [&reasons](const char *name, const char *arch, TransactionItemReason reason) {
+            reasons[std::string(name) + "." + arch] = reason;
+        });
+
+    CPPUNIT_ASSERT_EQUAL(static_cast< size_t >(2), reasons.size());
+    CPPUNIT_ASSERT(reasons.at("bash.x86_64") == TransactionItemReason::DEPENDENCY);
+    CPPUNIT_ASSERT(reasons.at("sed.x86_64") == TransactionItemReason::DEPENDENCY);
+}
+
+void
+RpmItemTest::testSearchTransactions()
+{
+    SwdbPrivate::Transaction trans1(conn);
+    trans1.addItem(createRPMItem(conn, "bash", "4.4.12"),
+                   "base",
+                   TransactionItemAction::INSTALL,
+                   TransactionItemReason::USER);
+    trans1.begin();
+    trans1.finish(true);
+
+    SwdbPrivate::Transaction trans2(conn);
+    trans2.addItem(createRPMItem(conn, "bash-completion", "2.7"),
+                   "base",
+                   TransactionItemAction::INSTALL,
+                   TransactionItemReason::USER);
+    trans2.begin();
+    trans2.finish(true);
+
+    // unfinished transactions are never returned
+    SwdbPrivate::Transaction trans3(conn);
+    trans3.addItem(createRPMItem(conn, "bash", "4.4.19"),
+                   "base",
+                   TransactionItemAction::UPGRADE,
+                   TransactionItemReason::USER);
+    trans3.begin();
+
+    auto onlyFirst = std::vector< int64_t >{trans1.getId()};
+    auto both = std::vector< int64_t >{trans1.getId(), trans2.getId()};
+
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash"}) == onlyFirst);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash.x86_64"}) == onlyFirst);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash-4.4.12-1.fc26"}) == onlyFirst);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash-0:4.4.12-1.fc26.x86_64"}) ==
+                   onlyFirst);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash*"}) == both);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash-[0-9]*"}) == onlyFirst);
+    // results are deduplicated and sorted
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash-completion", "bash", "bash*"}) ==
+                   both);
+    // leading wildcards are matched in one scan next to the index lookups
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"*-completion", "?ash"}) == both);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash", "*.x86_64"}) == both);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"zsh"}).empty());
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {}).empty());
+
+    // more patterns than one statement can bind are split over several queries
+    std::vector< std::string > many(1200, "zsh");
+    many.push_back("bash-completion");
+    many.push_back("bash");
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, many) == both);
+}
+
+void
+RpmItemTest::testOldSchema()
+{
+    SwdbPrivate::Transaction trans1(conn);
+    trans1.addItem(createRPMItem(conn, "bash", "4.4.12"),
+                   "base",
+                   TransactionItemAction::INSTALL,
+                   TransactionItemReason::USER);
+    trans1.addItem(createRPMItem(conn, "sed", "4.4"),
+                   "base",
+                   TransactionItemAction::INSTALL,
+                   TransactionItemReason::DEPENDENCY);
+    trans1.begin();
+    trans1.finish(true);
+
+    SwdbPrivate::Transaction trans2(conn);
+    trans2.addItem(createRPMItem(conn, "sed", "4.4"),
+                   "base",
+                   TransactionItemAction::REMOVE,
+                   TransactionItemReason::DEPENDENCY);
+    trans2.begin();
+    trans2.finish(true);
+
+    // a 1.1 database opened read-only is not migrated, reads use trans_item instead
+    conn->exec("DROP TABLE current_reason; DROP TRIGGER rpm_search_insert; "
+               "DROP TRIGGER rpm_search_delete; DROP TABLE rpm_search; "
+               "UPDATE config SET value = '1.1' WHERE key = 'version'");
+    // the schema changed under the connection, read the version again
+    CPPUNIT_ASSERT_EQUAL(std::string("1.1"), Transformer::getSchemaVersion(conn));
+
+    CPPUNIT_ASSERT(RPMItem::resolveTransactionItemReason(conn, "bash", "x86_64", -1) ==
+                   TransactionItemReason::USER);
+    CPPUNIT_ASSERT(RPMItem::resolveTransactionItemReason(conn, "bash", "", -1) ==
+                   TransactionItemReason::USER);
+    CPPUNIT_ASSERT(RPMItem::resolveTransactionItemReason(conn, "sed", "x86_64", -1) ==
+                   TransactionItemReason::UNKNOWN);
+
+    std::map< std::string, TransactionItemReason > reasons;
+    RPMItem::forEachLatestReason(
+        conn, [&reasons](const char *name, const char *arch, TransactionItemReason reason) {
+            reasons[std::string(name) + "." + arch] = reason;
+        });
+    CPPUNIT_ASSERT_EQUAL(static_cast< size_t >(2), reasons.size());
+    CPPUNIT_ASSERT(reasons.at("bash.x86_64") == TransactionItemReason::USER);
+
+    auto both = std::vector< int64_t >{trans1.getId(), trans2.getId()};
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash"}) ==
+                   std::vector< int64_t >{trans1.getId()});
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"sed-4.4-1.fc26.x86_64"}) == both);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"bash-0:4.4.12-1.fc26.x86_64", "se*"}) ==
+                   both);
+    CPPUNIT_ASSERT(RPMItem::searchTransactions(conn, {"zsh"}).empty());
+}
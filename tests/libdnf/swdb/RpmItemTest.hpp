@@ -9,6 +9,9 @@ class RpmItemTest : public CppUnit::TestCase {
     CPPUNIT_TEST_SUITE(RpmItemTest);
     CPPUNIT_TEST(testCreate);
     CPPUNIT_TEST(testGetTransactionItems);
+    CPPUNIT_TEST(testForEachLatestReason);
+    CPPUNIT_TEST(testSearchTransactions);
+    CPPUNIT_TEST(testOldSchema);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -17,6 +20,9 @@ public:
 
     void testCreate();
     void testGetTransactionItems();
+    void testForEachLatestReason();
+    void testSearchTransactions();
+    void testOldSchema();
 
 private:
     std::shared_ptr< SQLite3 > conn;
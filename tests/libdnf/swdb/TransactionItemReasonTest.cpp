@@ -302,3 +302,36 @@ TransactionItemReasonTest::testRemovedPackage()
         TransactionItemReason::GROUP,
         static_cast< TransactionItemReason >(swdb.resolveRPMTransactionItemReason("bash", "", -1)));
 }
+
+// reasons are recomputed from the history when the projection gets lost
+void
+TransactionItemReasonTest::testRebuildReasons()
+{
+    Swdb swdb(conn);
+
+    swdb.initTransaction();
+
+    auto rpm_bash = std::make_shared< RPMItem >(conn);
+    rpm_bash->setName("bash");
+    rpm_bash->setEpoch(0);
+    rpm_bash->setVersion("4.4.12");
+    rpm_bash->setRelease("5.fc26");
+    rpm_bash->setArch("x86_64");
+    std::string repoid = "base";
+    TransactionItemAction action = TransactionItemAction::INSTALL;
+    TransactionItemReason reason = TransactionItemReason::GROUP;
+    swdb.addItem(rpm_bash, repoid, action, reason);
+
+    swdb.beginTransaction(1, "", "", 0);
+    swdb.endTransaction(2, "", true);
+
+    conn->exec("DELETE FROM current_reason");
+    CPPUNIT_ASSERT_EQUAL(TransactionItemReason::UNKNOWN,
+                         static_cast< TransactionItemReason >(
+                             swdb.resolveRPMTransactionItemReason("bash", "x86_64", -1)));
+
+    swdb.rebuildRPMReasons();
+    CPPUNIT_ASSERT_EQUAL(TransactionItemReason::GROUP,
+                         static_cast< TransactionItemReason >(
+                             swdb.resolveRPMTransactionItemReason("bash", "x86_64", -1)));
+}
@@ -15,6 +15,7 @@ class TransactionItemReasonTest : public CppUnit::TestCase {
     CPPUNIT_TEST(test_OneTransaction_TwoTransactionItems);
     CPPUNIT_TEST(test_TwoTransactions_TwoTransactionItems);
     CPPUNIT_TEST(testRemovedPackage);
+    CPPUNIT_TEST(testRebuildReasons);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -28,6 +29,7 @@ public:
     void test_OneTransaction_TwoTransactionItems();
     void test_TwoTransactions_TwoTransactionItems();
     void testRemovedPackage();
+    void testRebuildReasons();
 
 private:
     std::shared_ptr< SQLite3 > conn;
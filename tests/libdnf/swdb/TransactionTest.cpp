@@ -1,7 +1,10 @@
+#include <cstdio>
+
 #include "TransactionTest.hpp"
 #include "libdnf/swdb/item_rpm.hpp"
 #include "libdnf/swdb/transaction.hpp"
 #include "libdnf/swdb/private/transaction.hpp"
+#include "libdnf/swdb/swdb.hpp"
 #include "libdnf/swdb/transformer.hpp"
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TransactionTest);
@@ -115,3 +118,190 @@ TransactionTest::testComparison()
     second.setRpmdbVersionBegin("0");
     CPPUNIT_ASSERT(first == second);
 }
+
+void
+TransactionTest::testListTransactions()
+{
+    for (int i = 1; i <= 3; ++i) {
+        SwdbPrivate::Transaction trans(conn);
+        trans.setDtBegin(i * 10);
+        trans.setRpmdbVersionBegin("begin");
+        auto rpm = std::make_shared< RPMItem >(conn);
+        rpm->setName("pkg" + std::to_string(i));
+        rpm->setEpoch(0);
+        rpm->setVersion("1");
+        rpm->setRelease("1");
+        rpm->setArch("x86_64");
+        trans.addItem(rpm, "base", TransactionItemAction::INSTALL, TransactionItemReason::USER);
+        trans.begin();
+        trans.finish(true);
+    }
+
+    Swdb swdb(conn);
+    CPPUNIT_ASSERT(swdb.listTransactions().size() == 3);
+
+    // range by id and by date
+    libdnf::TransactionRange range;
+    range.idMin = 2;
+    CPPUNIT_ASSERT(swdb.listTransactions(range, false).size() == 2);
+    range = libdnf::TransactionRange();
+    range.dtBeginMax = 20;
+    CPPUNIT_ASSERT(swdb.listTransactions(range, false).size() == 2);
+
+    // pagination, newest first
+    range = libdnf::TransactionRange();
+    range.reverse = true;
+    range.offset = 1;
+    range.limit = 1;
+    auto page = swdb.listTransactions(range, true);
+    CPPUNIT_ASSERT(page.size() == 1);
+    CPPUNIT_ASSERT(page[0]->getId() == 2);
+    CPPUNIT_ASSERT(page[0]->getDtBegin() == 20);
+
+    // prefetched items match the ones loaded per transaction
+    auto items = page[0]->getItems();
+    CPPUNIT_ASSERT(items.size() == 1);
+    CPPUNIT_ASSERT(items[0]->getTransactionId() == 2);
+    CPPUNIT_ASSERT(items[0]->getRPMItem()->getName() == "pkg2");
+    CPPUNIT_ASSERT(items[0]->getRepoid() == "base");
+    CPPUNIT_ASSERT(libdnf::Transaction(conn, 2).getItems().size() == 1);
+}
+
+void
+TransactionTest::testConsoleOutput()
+{
+    // enough lines to need several batches and a partial one
+    constexpr int num = 1000;
+
+    SwdbPrivate::Transaction trans(conn);
+    trans.setDtBegin(1);
+    trans.setRpmdbVersionBegin("begin");
+    trans.setReleasever("26");
+    trans.setUserId(1000);
+    trans.setCmdline("dnf install foo");
+    trans.begin();
+    for (int i = 0; i < num; i++) {
+        trans.addConsoleOutputLine(i % 2 + 1, "line " + std::to_string(i));
+    }
+    trans.finish(true);
+
+    libdnf::Transaction trans2(conn, trans.getId());
+    auto output = trans2.getConsoleOutput();
+    CPPUNIT_ASSERT_EQUAL(static_cast< size_t >(num), output.size());
+    for (int i = 0; i < num; i++) {
+        CPPUNIT_ASSERT_EQUAL(i % 2 + 1, output.at(i).first);
+        CPPUNIT_ASSERT_EQUAL("line " + std::to_string(i), output.at(i).second);
+    }
+}
+
+void
+TransactionTest::testConsoleOutputSizeLimit()
+{
+    Swdb swdb(conn);
+    // the note about dropped lines is counted against the limit
+    swdb.setConsoleOutputSizeLimit(SwdbPrivate::Transaction::consoleOutputDroppedNoteSize + 10);
+
+    swdb.initTransaction();
+    auto transId = swdb.beginTransaction(1, "", "", 0);
+    swdb.addConsoleOutputLine(1, "12345");
+    swdb.addConsoleOutputLine(1, "67890");
+    swdb.addConsoleOutputLine(1, "dropped");
+    swdb.addConsoleOutputLine(2, "dropped");
+    swdb.endTransaction(2, "", true);
+
+    libdnf::Transaction trans(conn, transId);
+    auto output = trans.getConsoleOutput();
+    CPPUNIT_ASSERT_EQUAL(static_cast< size_t >(3), output.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("12345"), output.at(0).second);
+    CPPUNIT_ASSERT_EQUAL(std::string("67890"), output.at(1).second);
+    CPPUNIT_ASSERT_EQUAL(2, output.at(2).first);
+    CPPUNIT_ASSERT_EQUAL(std::string("[2 lines of output dropped]"), output.at(2).second);
+}
+
+void
+TransactionTest::testConsoleOutputDroppedNote()
+{
+    SwdbPrivate::Transaction trans(conn);
+    trans.setConsoleOutputSizeLimit(SwdbPrivate::Transaction::consoleOutputDroppedNoteSize + 10);
+    trans.setDtBegin(1);
+    trans.setRpmdbVersionBegin("begin");
+    trans.setReleasever("26");
+    trans.setUserId(1000);
+    trans.setCmdline("dnf install foo");
+    trans.begin();
+    trans.addConsoleOutputLine(1, "12345");
+    trans.addConsoleOutputLine(1, "dropped");
+    trans.flushConsoleOutput();
+    // a short line still fitting under the limit is dropped to keep the note last
+    trans.addConsoleOutputLine(1, "x");
+    trans.addConsoleOutputLine(2, "dropped");
+    trans.flushConsoleOutput();
+    trans.addConsoleOutputLine(1, "dropped");
+    trans.finish(true);
+
+    libdnf::Transaction trans2(conn, trans.getId());
+    auto output = trans2.getConsoleOutput();
+    CPPUNIT_ASSERT_EQUAL(static_cast< size_t >(2), output.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("12345"), output.at(0).second);
+    CPPUNIT_ASSERT_EQUAL(2, output.at(1).first);
+    CPPUNIT_ASSERT_EQUAL(std::string("[4 lines of output dropped]"), output.at(1).second);
+}
+
+void
+TransactionTest::testConcurrentReader()
+{
+    const std::string path = "TransactionTest_testConcurrentReader.db";
+    std::remove(path.c_str());
+
+    auto writer = std::make_shared< SQLite3 >(path, SQLite3::ConnectionMode::WAL);
+    CPPUNIT_ASSERT(writer->getConnectionMode() == SQLite3::ConnectionMode::WAL);
+    Transformer::createDatabase(writer);
+
+    {
+        SwdbPrivate::Transaction trans(writer);
+        trans.setDtBegin(1);
+        trans.setReleasever("26");
+        trans.setUserId(1000);
+        trans.begin();
+        trans.finish(true);
+    }
+
+    // a reader sees the last commit while a write is in progress
+    auto reader = std::make_shared< SQLite3 >(path, SQLite3::ConnectionMode::WAL);
+    reader->setBusyTimeout(0);
+    writer->exec("BEGIN; UPDATE trans SET cmdline = 'uncommitted'");
+
+    SQLite3::Query query(*reader, "SELECT cmdline FROM trans WHERE id = 1");
+    CPPUNIT_ASSERT(query.step() == SQLite3::Statement::StepResult::ROW);
+    CPPUNIT_ASSERT(query.get< std::string >(0) != "uncommitted");
+
+    writer->exec("COMMIT");
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+    std::remove(path.c_str());
+}
+
+void
+TransactionTest::testConnectionMode()
+{
+    const std::string path = "TransactionTest_testConnectionMode.db";
+    std::remove(path.c_str());
+    Transformer::createDatabase(std::make_shared< SQLite3 >(path));
+
+    // WAL unless exclusive access is asked for
+    {
+        Swdb swdb(path);
+        CPPUNIT_ASSERT(swdb.getConn()->getConnectionMode() == SQLite3::ConnectionMode::WAL);
+
+        // the modes don't mix on one file
+        CPPUNIT_ASSERT_THROW(Swdb(path, SQLite3::ConnectionMode::EXCLUSIVE), SQLite3::Exception);
+    }
+    {
+        Swdb swdb(path, SQLite3::ConnectionMode::EXCLUSIVE);
+        CPPUNIT_ASSERT(swdb.getConn()->getConnectionMode() == SQLite3::ConnectionMode::EXCLUSIVE);
+    }
+
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+    std::remove(path.c_str());
+}
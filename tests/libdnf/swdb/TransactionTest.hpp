@@ -12,6 +12,12 @@ class TransactionTest : public CppUnit::TestCase {
     CPPUNIT_TEST(testInsertWithSpecifiedId);
     CPPUNIT_TEST(testUpdate);
     CPPUNIT_TEST(testComparison);
+    CPPUNIT_TEST(testListTransactions);
+    CPPUNIT_TEST(testConsoleOutput);
+    CPPUNIT_TEST(testConsoleOutputSizeLimit);
+    CPPUNIT_TEST(testConsoleOutputDroppedNote);
+    CPPUNIT_TEST(testConcurrentReader);
+    CPPUNIT_TEST(testConnectionMode);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -22,6 +28,12 @@ public:
     void testInsertWithSpecifiedId();
     void testUpdate();
     void testComparison();
+    void testListTransactions();
+    void testConsoleOutput();
+    void testConsoleOutputSizeLimit();
+    void testConsoleOutputDroppedNote();
+    void testConcurrentReader();
+    void testConnectionMode();
 
 private:
     std::shared_ptr< SQLite3 > conn;
@@ -2,6 +2,8 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "libdnf/swdb/item_rpm.hpp"
 #include "libdnf/swdb/swdb.hpp"
@@ -31,9 +33,10 @@ void
 TransformerTest::setUp()
 {
     swdb = std::make_shared< SQLite3 >(":memory:");
-    history = std::make_shared< SQLite3 >(":memory:");
     Transformer::createDatabase(swdb);
-    history.get()->exec(create_history_sql);
+
+    // history tables are read through the swdb connection
+    swdb->exec(create_history_sql);
 }
 
 void
@@ -107,7 +110,7 @@ void
 TransformerTest::testTransformTrans()
 {
     // perform database transformation
-    transformer.transformTrans(swdb, history);
+    transformer.transformTrans(swdb);
 
     // check first transaction attributes
     libdnf::Transaction first(swdb, 1);
@@ -208,3 +211,71 @@ TransformerTest::testTransformTrans()
 
     swdb->backup("sql.db");
 }
+
+void
+TransformerTest::testTransformProgress()
+{
+    std::vector< std::pair< int64_t, int64_t > > progress;
+    transformer.setProgressCallback(
+        [&progress](int64_t processed, int64_t total) { progress.emplace_back(processed, total); });
+
+    transformer.transformTrans(swdb);
+
+    CPPUNIT_ASSERT_EQUAL(static_cast< size_t >(2), progress.size());
+    CPPUNIT_ASSERT_EQUAL((int64_t)1, progress.at(0).first);
+    CPPUNIT_ASSERT_EQUAL((int64_t)2, progress.at(0).second);
+    CPPUNIT_ASSERT_EQUAL((int64_t)2, progress.at(1).first);
+    CPPUNIT_ASSERT_EQUAL((int64_t)2, progress.at(1).second);
+
+    // the transformation also fills current_reason
+    CPPUNIT_ASSERT_EQUAL(TransactionItemReason::DEPENDENCY,
+                         RPMItem::resolveTransactionItemReason(swdb, "kernel", "x86_64", -1));
+    CPPUNIT_ASSERT_EQUAL(TransactionItemReason::USER,
+                         RPMItem::resolveTransactionItemReason(swdb, "chrony", "x86_64", -1));
+}
+
+static bool
+indexExists(std::shared_ptr< SQLite3 > conn, const std::string &name)
+{
+    SQLite3::Query query(*conn, "SELECT name FROM sqlite_master WHERE type = 'index' AND name = ?");
+    query.bindv(name);
+    return query.step() == SQLite3::Statement::StepResult::ROW;
+}
+
+void
+TransformerTest::testMigrateSchema()
+{
+    // a new database is created with the latest schema
+    CPPUNIT_ASSERT_EQUAL(std::string("1.4"), Transformer::getSchemaVersion(swdb));
+    CPPUNIT_ASSERT(Transformer::hasSchemaVersion(swdb, "1.3"));
+    CPPUNIT_ASSERT(Transformer::hasSchemaVersion(swdb, "1.4"));
+    CPPUNIT_ASSERT(!Transformer::hasSchemaVersion(swdb, "1.5"));
+    CPPUNIT_ASSERT(indexExists(swdb, "trans_item_trans_id"));
+    CPPUNIT_ASSERT(indexExists(swdb, "rpm_name_arch"));
+    CPPUNIT_ASSERT(indexExists(swdb, "comps_group_package_name"));
+    CPPUNIT_ASSERT(!indexExists(swdb, "rpm_name"));
+    CPPUNIT_ASSERT(indexExists(swdb, "sqlite_autoindex_current_reason_1"));
+    CPPUNIT_ASSERT(indexExists(swdb, "sqlite_autoindex_rpm_search_1"));
+
+    // downgrade to 1.1 and upgrade again
+    swdb->exec("DROP INDEX trans_item_trans_id; DROP INDEX rpm_name_arch; "
+               "DROP INDEX comps_group_package_name; CREATE INDEX rpm_name ON rpm(name); "
+               "DROP TABLE current_reason; DROP TRIGGER rpm_search_insert; "
+               "DROP TRIGGER rpm_search_delete; DROP TABLE rpm_search; "
+               "UPDATE config SET value = '1.1' WHERE key = 'version'");
+    CPPUNIT_ASSERT_EQUAL(std::string("1.1"), Transformer::getSchemaVersion(swdb));
+    CPPUNIT_ASSERT(!Transformer::hasSchemaVersion(swdb, "1.2"));
+    Transformer::migrateSchema(swdb);
+    CPPUNIT_ASSERT(Transformer::hasSchemaVersion(swdb, "1.4"));
+    CPPUNIT_ASSERT_EQUAL(std::string("1.4"), Transformer::getSchemaVersion(swdb));
+    CPPUNIT_ASSERT(indexExists(swdb, "trans_item_trans_id"));
+    CPPUNIT_ASSERT(indexExists(swdb, "rpm_name_arch"));
+    CPPUNIT_ASSERT(indexExists(swdb, "comps_group_package_name"));
+    CPPUNIT_ASSERT(!indexExists(swdb, "rpm_name"));
+    CPPUNIT_ASSERT(indexExists(swdb, "sqlite_autoindex_current_reason_1"));
+    CPPUNIT_ASSERT(indexExists(swdb, "sqlite_autoindex_rpm_search_1"));
+
+    // migrating an up to date database is a no-op
+    Transformer::migrateSchema(swdb);
+    CPPUNIT_ASSERT_EQUAL(std::string("1.4"), Transformer::getSchemaVersion(swdb));
+}
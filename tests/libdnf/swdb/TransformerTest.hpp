@@ -11,6 +11,7 @@ public:
     TransformerMock();
     using Transformer::Exception;
     using Transformer::processGroupPersistor;
+    using Transformer::setProgressCallback;
     using Transformer::transformTrans;
 };
 
@@ -18,6 +19,8 @@ class TransformerTest : public CppUnit::TestCase {
     CPPUNIT_TEST_SUITE(TransformerTest);
     CPPUNIT_TEST(testGroupTransformation);
     CPPUNIT_TEST(testTransformTrans);
+    CPPUNIT_TEST(testTransformProgress);
+    CPPUNIT_TEST(testMigrateSchema);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -25,12 +28,13 @@ public:
     void tearDown() override;
 
     void testTransformTrans();
+    void testTransformProgress();
     void testGroupTransformation();
+    void testMigrateSchema();
 
 protected:
     TransformerMock transformer;
     std::shared_ptr< SQLite3 > swdb;
-    std::shared_ptr< SQLite3 > history;
 };
 
 #endif // LIBDNF_SWDB_RPMITEM_TEST_HPP